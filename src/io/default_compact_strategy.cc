@@ -167,6 +167,15 @@ bool DefaultCompactStrategy::MergeAtomicOPs(leveldb::Iterator* it,
                                 true, NULL);
 }
 
+bool DefaultCompactStrategy::IsSameRow(const Slice& k1, const Slice& k2) {
+    Slice row1, row2;
+    if (!m_raw_key_operator->ExtractTeraKey(k1, &row1, NULL, NULL, NULL, NULL)
+        || !m_raw_key_operator->ExtractTeraKey(k2, &row2, NULL, NULL, NULL, NULL)) {
+        return k1 == k2;
+    }
+    return row1 == row2;
+}
+
 bool DefaultCompactStrategy::InternalMergeProcess(leveldb::Iterator* it,
                                                   std::string* merged_value,
                                                   std::string* merged_key,
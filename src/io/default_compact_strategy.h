@@ -38,6 +38,8 @@ public:
     virtual bool MergeAtomicOPs(leveldb::Iterator* it, std::string* merged_value,
                                 std::string* merged_key);
 
+    virtual bool IsSameRow(const Slice& k1, const Slice& k2);
+
 private:
     bool DropIllegalColumnFamily(const std::string& column_family,
                             int32_t* cf_idx = NULL) const;
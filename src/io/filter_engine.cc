@@ -0,0 +1,266 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "io/filter_engine.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace tera {
+namespace io {
+
+FilterEngine::FilterEngine(const FilterList& filter_list)
+    : m_root(NULL), m_need_all_columns(false) {
+    m_root = CompileList(filter_list);
+}
+
+FilterEngine::~FilterEngine() {
+    FreeNode(m_root);
+}
+
+void FilterEngine::GetAllCfs(std::set<std::string>* cf_set) const {
+    CollectCfs(m_root, cf_set);
+}
+
+bool FilterEngine::MayMatchRow(const leveldb::Slice& row) const {
+    return Eval(m_root, row, NULL) != kFalse;
+}
+
+bool FilterEngine::Check(const ScanRowBuffer& row_buf) const {
+    if (row_buf.Empty()) {
+        return false;
+    }
+    return Eval(m_root, row_buf.Key(0), &row_buf) == kTrue;
+}
+
+FilterEngine::Node* FilterEngine::CompileList(const FilterList& filter_list) {
+    Node* node = new Node;
+    node->is_list = true;
+    node->is_or = (filter_list.op() == OrOp);
+    for (int i = 0; i < filter_list.filter_size(); ++i) {
+        node->children.push_back(CompileFilter(filter_list.filter(i)));
+    }
+    for (int i = 0; i < filter_list.sub_list_size(); ++i) {
+        node->children.push_back(CompileList(filter_list.sub_list(i)));
+    }
+    return node;
+}
+
+FilterEngine::Node* FilterEngine::CompileFilter(const Filter& filter) {
+    Node* node = new Node;
+    node->filter.CopyFrom(filter);
+    switch (filter.type()) {
+    case Regex: {
+        int ret = regcomp(&node->regex, filter.ref_value().c_str(),
+                          REG_EXTENDED | REG_NOSUB);
+        if (ret != 0) {
+            char err[256];
+            regerror(ret, &node->regex, err, sizeof(err));
+            LOG(ERROR) << "bad regex filter: " << filter.ref_value() << ", " << err;
+            node->valid = false;
+        } else {
+            node->regex_compiled = true;
+        }
+        break;
+    }
+    case SubStr:
+    case Prefix:
+        break;
+    case BinComp:
+        if ((filter.value_type() == kINT64 || filter.value_type() == kUINT64)
+            && filter.ref_value().size() != sizeof(int64_t)) {
+            LOG(ERROR) << "bad integer in filter, size: " << filter.ref_value().size();
+            node->valid = false;
+        }
+        break;
+    default:
+        LOG(ERROR) << "unknown filter type: " << filter.type();
+        node->valid = false;
+    }
+    switch (filter.field()) {
+    case CfFilter:
+        m_need_all_columns = true;
+        break;
+    case QuFilter:
+        if (filter.content().empty()) {
+            m_need_all_columns = true;
+        }
+        break;
+    case RowFilter:
+    case ValueFilter:
+        break;
+    default:
+        LOG(ERROR) << "unknown filter field: " << filter.field();
+        node->valid = false;
+    }
+    return node;
+}
+
+void FilterEngine::FreeNode(Node* node) {
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        FreeNode(node->children[i]);
+    }
+    if (node->regex_compiled) {
+        regfree(&node->regex);
+    }
+    delete node;
+}
+
+void FilterEngine::CollectCfs(const Node* node, std::set<std::string>* cf_set) const {
+    if (node->is_list) {
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            CollectCfs(node->children[i], cf_set);
+        }
+        return;
+    }
+    const Filter& filter = node->filter;
+    if ((filter.field() == ValueFilter || filter.field() == QuFilter)
+        && !filter.content().empty()) {
+        cf_set->insert(filter.content());
+    }
+}
+
+FilterEngine::Result FilterEngine::Eval(const Node* node, const leveldb::Slice& row,
+                                        const ScanRowBuffer* row_buf) const {
+    if (!node->is_list) {
+        return EvalLeaf(node, row, row_buf);
+    }
+    // an empty AND list holds, an empty OR list does not
+    Result result = node->is_or ? kFalse : kTrue;
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        Result r = Eval(node->children[i], row, row_buf);
+        if (node->is_or) {
+            if (r == kTrue) {
+                return kTrue;
+            }
+        } else if (r == kFalse) {
+            return kFalse;
+        }
+        if (r == kUnknown) {
+            result = kUnknown;
+        }
+    }
+    return result;
+}
+
+FilterEngine::Result FilterEngine::EvalLeaf(const Node* node, const leveldb::Slice& row,
+                                            const ScanRowBuffer* row_buf) const {
+    if (!node->valid) {
+        return kFalse;
+    }
+    const Filter& filter = node->filter;
+    if (filter.field() == RowFilter) {
+        return Match(node, row) ? kTrue : kFalse;
+    }
+    if (row_buf == NULL) {
+        return kUnknown;
+    }
+
+    const std::string& family = filter.content();
+    leveldb::Slice last_col;
+    for (uint32_t i = 0; i < row_buf->Size(); ++i) {
+        leveldb::Slice col = row_buf->Column(i);
+        switch (filter.field()) {
+        case CfFilter:
+            // cells of a family are contiguous, check each family once
+            if (i > 0 && col == last_col) {
+                break;
+            }
+            last_col = col;
+            if (Match(node, col)) {
+                return kTrue;
+            }
+            break;
+        case QuFilter:
+            if ((family.empty() || col == family) && Match(node, row_buf->Qualifier(i))) {
+                return kTrue;
+            }
+            break;
+        case ValueFilter:
+            if (col == family && !Match(node, row_buf->Value(i))) {
+                return kFalse;
+            }
+            break;
+        default:
+            return kFalse;
+        }
+    }
+    return filter.field() == ValueFilter ? kTrue : kFalse;
+}
+
+bool FilterEngine::Match(const Node* node, const leveldb::Slice& data) const {
+    const std::string& ref = node->filter.ref_value();
+    switch (node->filter.type()) {
+    case Regex: {
+        // regexec() wants a NUL-terminated string; a local copy keeps a
+        // shared engine safe to use from many scan threads
+        std::string buf(data.data(), data.size());
+        return regexec(&node->regex, buf.c_str(), 0, NULL, 0) == 0;
+    }
+    case SubStr:
+        return std::search(data.data(), data.data() + data.size(),
+                           ref.begin(), ref.end()) != data.data() + data.size()
+            || ref.empty();
+    case Prefix:
+        return data.starts_with(ref);
+    case BinComp:
+        return Compare(node, data);
+    default:
+        return false;
+    }
+}
+
+template <typename T>
+static int CompareNumber(const leveldb::Slice& data, const std::string& ref) {
+    T v1, v2;
+    memcpy(&v1, data.data(), sizeof(T));
+    memcpy(&v2, ref.data(), sizeof(T));
+    return v1 < v2 ? -1 : (v1 > v2 ? 1 : 0);
+}
+
+bool FilterEngine::Compare(const Node* node, const leveldb::Slice& data) const {
+    const Filter& filter = node->filter;
+    int res = 0;
+    switch (filter.value_type()) {
+    case kINT64:
+        if (data.size() != sizeof(int64_t)) {
+            return false;
+        }
+        res = CompareNumber<int64_t>(data, filter.ref_value());
+        break;
+    case kUINT64:
+        if (data.size() != sizeof(uint64_t)) {
+            return false;
+        }
+        res = CompareNumber<uint64_t>(data, filter.ref_value());
+        break;
+    default:
+        res = data.compare(filter.ref_value());
+    }
+
+    switch (filter.bin_comp_op()) {
+    case EQ:
+        return res == 0;
+    case NE:
+        return res != 0;
+    case LT:
+        return res < 0;
+    case LE:
+        return res <= 0;
+    case GT:
+        return res > 0;
+    case GE:
+        return res >= 0;
+    default:
+        LOG(ERROR) << "illegal compare operator: " << filter.bin_comp_op();
+    }
+    return false;
+}
+
+} // namespace io
+} // namespace tera
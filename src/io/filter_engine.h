@@ -0,0 +1,93 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TERA_IO_FILTER_ENGINE_H_
+#define TERA_IO_FILTER_ENGINE_H_
+
+#include <regex.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "io/scan_row_buffer.h"
+#include "leveldb/slice.h"
+#include "proto/tabletnode_rpc.pb.h"
+
+namespace tera {
+namespace io {
+
+// Row filters of a scan, compiled once per scan.
+//
+// Rows are checked on the cells of the row buffer, before any of them is
+// serialized, and only rows that pass are shipped. Filters that look at
+// the row key alone are also checked as soon as a new row starts, so the
+// cells of a rejected row are not even buffered.
+//
+// A filter that cannot be compiled (bad regex, unknown type) matches no
+// row.
+class FilterEngine {
+public:
+    explicit FilterEngine(const FilterList& filter_list);
+    ~FilterEngine();
+
+    // Families whose cells must all be read to check the filters.
+    void GetAllCfs(std::set<std::string>* cf_set) const;
+
+    // True if a filter looks at the cells of any family, the scan must
+    // then read all families.
+    bool NeedAllColumns() const { return m_need_all_columns; }
+
+    // Return false if the row fails whatever its cells are.
+    bool MayMatchRow(const leveldb::Slice& row) const;
+
+    // Check the row assembled in "row_buf".
+    bool Check(const ScanRowBuffer& row_buf) const;
+
+private:
+    enum Result {
+        kFalse = 0,
+        kTrue = 1,
+        kUnknown = 2
+    };
+
+    struct Node {
+        // leaf
+        Filter filter;
+        regex_t regex;
+        bool regex_compiled;
+        bool valid;
+        // list
+        bool is_list;
+        bool is_or;
+        std::vector<Node*> children;
+
+        Node() : regex_compiled(false), valid(true), is_list(false), is_or(false) {}
+    };
+
+    Node* CompileList(const FilterList& filter_list);
+    Node* CompileFilter(const Filter& filter);
+    void FreeNode(Node* node);
+    void CollectCfs(const Node* node, std::set<std::string>* cf_set) const;
+
+    // "row_buf" NULL checks the row key alone
+    Result Eval(const Node* node, const leveldb::Slice& row,
+                const ScanRowBuffer* row_buf) const;
+    Result EvalLeaf(const Node* node, const leveldb::Slice& row,
+                    const ScanRowBuffer* row_buf) const;
+    bool Match(const Node* node, const leveldb::Slice& data) const;
+    bool Compare(const Node* node, const leveldb::Slice& data) const;
+
+    Node* m_root;
+    bool m_need_all_columns;
+
+    // No copying allowed
+    FilterEngine(const FilterEngine&);
+    void operator=(const FilterEngine&);
+};
+
+} // namespace io
+} // namespace tera
+
+#endif // TERA_IO_FILTER_ENGINE_H_
@@ -14,20 +14,21 @@ namespace io {
 
 class MockTabletIO : public TabletIO {
 public:
+    MockTabletIO(const std::string& key_start = "",
+                 const std::string& key_end = "")
+        : TabletIO(key_start, key_end) {}
+
     MOCK_CONST_METHOD0(GetCompactStatus,
         CompactStatus());
     MOCK_CONST_METHOD0(GetSchema,
         const TableSchema&());
-    MOCK_METHOD10(Load,
+    MOCK_METHOD7(Load,
         bool(const TableSchema& schema,
-             const std::string& key_start,
-             const std::string& key_end,
              const std::string& path,
              const std::vector<uint64_t>& parent_tablets,
              std::map<uint64_t, uint64_t> snapshots,
-             leveldb::Logger* logger,
-             leveldb::Cache* block_cache,
-             leveldb::TableCache* table_cache,
+             std::map<uint64_t, uint64_t> rollbacks,
+             const SharedResources& resources,
              StatusCode* status));
     MOCK_METHOD1(Unload,
         bool(StatusCode* status));
@@ -53,9 +54,10 @@ public:
              uint32_t* success_num,
              uint64_t snapshot_id,
              StatusCode* status));
-    MOCK_METHOD3(ReadCells,
+    MOCK_METHOD4(ReadCells,
         bool(const RowReaderInfo& row_reader,
              RowResult* value_list,
+             uint64_t snapshot_id,
              StatusCode* status));
     MOCK_METHOD7(Write,
         bool(const WriteTabletRequest* request,
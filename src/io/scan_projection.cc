@@ -0,0 +1,110 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "io/scan_projection.h"
+
+#include "types.h"
+
+namespace tera {
+namespace io {
+
+// Next() calls tried before falling back to Seek()
+static const int kMaxSequentialSkips = 8;
+
+ScanProjection::ScanProjection(const leveldb::RawKeyOperator* key_operator,
+                               RawKey raw_key,
+                               const std::set<std::string>& cf_set,
+                               const ColumnFamilyMap& cf_list,
+                               const std::set<std::string>& all_qual_cfs)
+    : m_key_operator(key_operator), m_raw_key(raw_key), m_has_cur_col(false) {
+    if (raw_key != Readable && raw_key != Binary) {
+        // kv tables have no columns
+        return;
+    }
+    std::set<std::string>::const_iterator it = cf_set.begin();
+    for (; it != cf_set.end(); ++it) {
+        const std::set<std::string>* quals = NULL;
+        ColumnFamilyMap::const_iterator cf_it = cf_list.find(*it);
+        if (cf_it != cf_list.end() && !cf_it->second.empty() &&
+            all_qual_cfs.find(*it) == all_qual_cfs.end()) {
+            quals = &cf_it->second;
+        }
+        m_families[*it] = quals;
+    }
+    m_cur_family = m_families.end();
+}
+
+bool ScanProjection::SkipColumn(const leveldb::Slice& row, const leveldb::Slice& col,
+                                const leveldb::Slice& qual, leveldb::TeraKeyType type,
+                                std::string* seek_key) {
+    if (type == leveldb::TKT_DEL) {
+        // row deleting tag
+        return false;
+    }
+    if (!m_has_cur_col || col.compare(m_cur_col) != 0) {
+        m_cur_col.assign(col.data(), col.size());
+        m_cur_family = m_families.find(m_cur_col);
+        m_has_cur_col = true;
+    }
+    if (m_cur_family == m_families.end()) {
+        SeekNextFamily(row, col, seek_key);
+        return true;
+    }
+
+    const std::set<std::string>* quals = m_cur_family->second;
+    if (quals == NULL || type < leveldb::TKT_VALUE) {
+        return false;
+    }
+    std::set<std::string>::const_iterator q_it = quals->lower_bound(qual.ToString());
+    if (q_it != quals->end() && qual.compare(*q_it) == 0) {
+        return false;
+    }
+    if (q_it != quals->end()) {
+        m_key_operator->EncodeTeraKey(row.ToString(), m_cur_col, *q_it, kLatestTs,
+                                      leveldb::TKT_FORSEEK, seek_key);
+    } else {
+        SeekNextFamily(row, col, seek_key);
+    }
+    return true;
+}
+
+void ScanProjection::SkipVersions(const leveldb::Slice& row, const leveldb::Slice& col,
+                                  const leveldb::Slice& qual, std::string* seek_key) const {
+    // versions are ordered by descending timestamp
+    m_key_operator->EncodeTeraKey(row.ToString(), col.ToString(), qual.ToString(), 0,
+                                  leveldb::TKT_FORSEEK, seek_key);
+}
+
+void ScanProjection::SkipTo(leveldb::Iterator* it, const std::string& seek_key) const {
+    for (int i = 0; i < kMaxSequentialSkips; ++i) {
+        it->Next();
+        if (!it->Valid() || m_key_operator->Compare(it->key(), seek_key) >= 0) {
+            return;
+        }
+    }
+    it->Seek(seek_key);
+}
+
+void ScanProjection::SeekNextFamily(const leveldb::Slice& row, const leveldb::Slice& col,
+                                    std::string* seek_key) const {
+    FamilyMap::const_iterator it = m_families.upper_bound(col.ToString());
+    if (it == m_families.end()) {
+        SeekNextRow(row, seek_key);
+        return;
+    }
+    m_key_operator->EncodeTeraKey(row.ToString(), it->first, "", kLatestTs,
+                                  leveldb::TKT_FORSEEK, seek_key);
+}
+
+void ScanProjection::SeekNextRow(const leveldb::Slice& row, std::string* seek_key) const {
+    // readable keys end the row with '\0', so the row cannot contain it and
+    // row + '\1' sorts after all its cells; binary keys compare rows alone
+    std::string next_row(row.data(), row.size());
+    next_row.push_back(m_raw_key == Readable ? '\1' : '\0');
+    m_key_operator->EncodeTeraKey(next_row, "", "", kLatestTs,
+                                  leveldb::TKT_FORSEEK, seek_key);
+}
+
+} // namespace io
+} // namespace tera
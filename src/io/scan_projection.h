@@ -0,0 +1,85 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TERA_IO_SCAN_PROJECTION_H_
+#define TERA_IO_SCAN_PROJECTION_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "leveldb/iterator.h"
+#include "leveldb/raw_key_operator.h"
+#include "leveldb/slice.h"
+#include "proto/table_schema.pb.h"
+
+namespace tera {
+namespace io {
+
+// Column projection of a scan, applied on the storage iterator.
+//
+// Cells of families and qualifiers the scan does not want, and versions
+// beyond max_versions, are not read one by one: the projection builds the
+// tera key of the first cell that may be wanted and the iterator seeks to
+// it. Delete marks of wanted families are never skipped, the compact
+// strategy needs them to drop deleted cells.
+class ScanProjection {
+public:
+    typedef std::map<std::string, std::set<std::string> > ColumnFamilyMap;
+
+    // "cf_set" lists the families to read, "cf_list" may narrow some of
+    // them to a set of qualifiers. Families in "all_qual_cfs" are read
+    // whole whatever "cf_list" says (value filters check every qualifier).
+    // An empty "cf_set" reads all columns and disables the projection.
+    ScanProjection(const leveldb::RawKeyOperator* key_operator, RawKey raw_key,
+                   const std::set<std::string>& cf_set,
+                   const ColumnFamilyMap& cf_list,
+                   const std::set<std::string>& all_qual_cfs);
+
+    bool Enabled() const { return !m_families.empty(); }
+
+    // Return true if the cell is not wanted; "seek_key" is then set to the
+    // first tera key after it that may be wanted.
+    bool SkipColumn(const leveldb::Slice& row, const leveldb::Slice& col,
+                    const leveldb::Slice& qual, leveldb::TeraKeyType type,
+                    std::string* seek_key);
+
+    // Set "seek_key" past the remaining versions of the qualifier.
+    void SkipVersions(const leveldb::Slice& row, const leveldb::Slice& col,
+                      const leveldb::Slice& qual, std::string* seek_key) const;
+
+    // Move "it" forward to "seek_key". A few Next() are tried first, short
+    // gaps are cheaper to step over than to seek. Always moves at least once.
+    void SkipTo(leveldb::Iterator* it, const std::string& seek_key) const;
+
+    // Set "seek_key" to the first tera key after all cells of "row".
+    void SeekNextRow(const leveldb::Slice& row, std::string* seek_key) const;
+
+private:
+    // qualifiers to read, NULL for all
+    typedef std::map<std::string, const std::set<std::string>*> FamilyMap;
+
+    void SeekNextFamily(const leveldb::Slice& row, const leveldb::Slice& col,
+                        std::string* seek_key) const;
+
+    const leveldb::RawKeyOperator* m_key_operator;
+    RawKey m_raw_key;
+    FamilyMap m_families;
+
+    // lookup cache for the family of the last cell
+    std::string m_cur_col;
+    FamilyMap::const_iterator m_cur_family;
+    bool m_has_cur_col;
+
+    // No copying allowed
+    ScanProjection(const ScanProjection&);
+    void operator=(const ScanProjection&);
+};
+
+} // namespace io
+} // namespace tera
+
+#endif // TERA_IO_SCAN_PROJECTION_H_
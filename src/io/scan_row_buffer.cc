@@ -0,0 +1,40 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "io/scan_row_buffer.h"
+
+namespace tera {
+namespace io {
+
+void ScanRowBuffer::Add(const leveldb::Slice& key, const leveldb::Slice& col,
+                        const leveldb::Slice& qual, int64_t ts,
+                        const leveldb::Slice& value) {
+    Cell c;
+    c.offset = m_data.size();
+    c.key_size = key.size();
+    c.col_size = col.size();
+    c.qual_size = qual.size();
+    c.value_size = value.size();
+    c.ts = ts;
+    m_data.append(key.data(), key.size());
+    m_data.append(col.data(), col.size());
+    m_data.append(qual.data(), qual.size());
+    m_data.append(value.data(), value.size());
+    m_cells.push_back(c);
+}
+
+void ScanRowBuffer::SerializeCell(uint32_t i, KeyValuePair* kv) const {
+    leveldb::Slice key = Key(i);
+    leveldb::Slice col = Column(i);
+    leveldb::Slice qual = Qualifier(i);
+    leveldb::Slice value = Value(i);
+    kv->set_key(key.data(), key.size());
+    kv->set_column_family(col.data(), col.size());
+    kv->set_qualifier(qual.data(), qual.size());
+    kv->set_timestamp(m_cells[i].ts);
+    kv->set_value(value.data(), value.size());
+}
+
+} // namespace io
+} // namespace tera
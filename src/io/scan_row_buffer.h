@@ -0,0 +1,84 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TERA_IO_SCAN_ROW_BUFFER_H_
+#define TERA_IO_SCAN_ROW_BUFFER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "leveldb/slice.h"
+#include "proto/table_meta.pb.h"
+
+namespace tera {
+namespace io {
+
+// Cells of the row being assembled by a scan.
+//
+// Iterator slices are only valid until the iterator moves, so the cell
+// fields are appended to one flat buffer and serialized into the result
+// only if the row passes the filters. Clear() keeps the memory, a scan
+// reuses the same buffer for all its rows.
+class ScanRowBuffer {
+public:
+    ScanRowBuffer() {}
+
+    void Add(const leveldb::Slice& key, const leveldb::Slice& col,
+             const leveldb::Slice& qual, int64_t ts, const leveldb::Slice& value);
+
+    void Clear() {
+        m_data.clear();
+        m_cells.clear();
+    }
+
+    uint32_t Size() const { return m_cells.size(); }
+    bool Empty() const { return m_cells.empty(); }
+
+    leveldb::Slice Key(uint32_t i) const {
+        const Cell& c = m_cells[i];
+        return leveldb::Slice(m_data.data() + c.offset, c.key_size);
+    }
+    leveldb::Slice Column(uint32_t i) const {
+        const Cell& c = m_cells[i];
+        return leveldb::Slice(m_data.data() + c.offset + c.key_size, c.col_size);
+    }
+    leveldb::Slice Qualifier(uint32_t i) const {
+        const Cell& c = m_cells[i];
+        return leveldb::Slice(m_data.data() + c.offset + c.key_size + c.col_size,
+                              c.qual_size);
+    }
+    leveldb::Slice Value(uint32_t i) const {
+        const Cell& c = m_cells[i];
+        return leveldb::Slice(m_data.data() + c.offset + c.key_size + c.col_size
+                              + c.qual_size, c.value_size);
+    }
+    int64_t Timestamp(uint32_t i) const { return m_cells[i].ts; }
+
+    // Fill "kv" with cell i.
+    void SerializeCell(uint32_t i, KeyValuePair* kv) const;
+
+private:
+    struct Cell {
+        uint32_t offset;
+        uint32_t key_size;
+        uint32_t col_size;
+        uint32_t qual_size;
+        uint32_t value_size;
+        int64_t ts;
+    };
+
+    std::string m_data;
+    std::vector<Cell> m_cells;
+
+    // No copying allowed
+    ScanRowBuffer(const ScanRowBuffer&);
+    void operator=(const ScanRowBuffer&);
+};
+
+} // namespace io
+} // namespace tera
+
+#endif // TERA_IO_SCAN_ROW_BUFFER_H_
@@ -5,6 +5,7 @@
 #include "io/tablet_io.h"
 
 #include <stdint.h>
+#include <string.h>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
@@ -12,6 +13,7 @@
 #include "io/coding.h"
 #include "io/default_compact_strategy.h"
 #include "io/io_utils.h"
+#include "io/scan_projection.h"
 #include "io/tablet_writer.h"
 #include "io/timekey_comparator.h"
 #include "io/ttlkv_compact_strategy.h"
@@ -24,9 +26,11 @@
 #include "leveldb/env_flash.h"
 #include "leveldb/env_inmem.h"
 #include "leveldb/filter_policy.h"
+#include "proto/aggregate_helper.h"
+#include "proto/packed_result.h"
 #include "types.h"
 #include "utils/counter.h"
-#include "utils/scan_filter.h"
+#include "utils/latency_histogram.h"
 #include "utils/string_util.h"
 #include "utils/timer.h"
 #include "utils/utils_cmd.h"
@@ -52,8 +56,11 @@ DECLARE_int32(tera_tabletnode_retry_period);
 DECLARE_string(tera_leveldb_compact_strategy);
 DECLARE_bool(tera_leveldb_verify_checksums);
 DECLARE_bool(tera_leveldb_ignore_corruption_in_compaction);
+DECLARE_int32(tera_leveldb_max_subcompactions);
+DECLARE_int32(tera_leveldb_compact_readahead_size);
 
 DECLARE_int32(tera_tabletnode_scan_pack_max_size);
+DECLARE_int32(tera_tabletnode_scan_readahead_size);
 DECLARE_bool(tera_tabletnode_cache_enabled);
 DECLARE_int32(tera_leveldb_env_local_seek_latency);
 DECLARE_int32(tera_leveldb_env_dfs_seek_latency);
@@ -64,7 +71,8 @@ DECLARE_bool(tera_tablet_use_memtable_on_leveldb);
 DECLARE_int64(tera_tablet_memtable_ldb_write_buffer_size);
 DECLARE_int64(tera_tablet_memtable_ldb_block_size);
 
-extern tera::Counter row_read_delay;
+extern tera::ShardedCounter row_read_delay;
+extern tera::LatencyHistogram read_cells_latency;
 
 namespace tera {
 namespace io {
@@ -134,9 +142,7 @@ bool TabletIO::Load(const TableSchema& schema,
                     const std::vector<uint64_t>& parent_tablets,
                     std::map<uint64_t, uint64_t> snapshots,
                     std::map<uint64_t, uint64_t> rollbacks,
-                    leveldb::Logger* logger,
-                    leveldb::Cache* block_cache,
-                    leveldb::TableCache* table_cache,
+                    const SharedResources& resources,
                     StatusCode* status) {
     {
         MutexLock lock(&m_mutex);
@@ -195,7 +201,7 @@ bool TabletIO::Load(const TableSchema& schema,
     m_ldb_options.max_block_log_number = FLAGS_tera_tablet_max_block_log_number;
     m_ldb_options.write_log_time_out = FLAGS_tera_tablet_write_log_time_out;
     m_ldb_options.log_async_mode = FLAGS_tera_log_async_mode;
-    m_ldb_options.info_log = logger;
+    m_ldb_options.info_log = resources.logger;
     m_ldb_options.max_open_files = FLAGS_tera_memenv_table_cache_size;
 
     m_ldb_options.use_memtable_on_leveldb = FLAGS_tera_tablet_use_memtable_on_leveldb;
@@ -210,11 +216,18 @@ bool TabletIO::Load(const TableSchema& schema,
 
     if (m_kv_only && m_table_schema.raw_key() == TTLKv) {
         m_ldb_options.filter_policy = leveldb::NewTTLKvBloomFilterPolicy(10);
-    } else {
+    } else if (m_kv_only) {
         m_ldb_options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    }
-    m_ldb_options.block_cache = block_cache;
-    m_ldb_options.table_cache = table_cache;
+    } else {
+        // table reads seek by row, filter on the whole key never matches
+        m_ldb_options.filter_policy =
+            leveldb::NewRowKeyBloomFilterPolicy(10, m_key_operator);
+    }
+    m_ldb_options.block_cache = resources.block_cache;
+    m_ldb_options.table_cache = resources.table_cache;
+    m_ldb_options.commit_log = resources.commit_log;
+    m_ldb_options.rate_limiter = resources.rate_limiter;
+    m_ldb_options.arena_pool = resources.arena_pool;
     m_ldb_options.flush_triggered_log_num = FLAGS_tera_tablet_flush_log_num;
     m_ldb_options.log_file_size = FLAGS_tera_tablet_log_file_size * 1024 * 1024;
     m_ldb_options.parent_tablets = parent_tablets;
@@ -231,6 +244,9 @@ bool TabletIO::Load(const TableSchema& schema,
     }
     m_ldb_options.verify_checksums_in_compaction = FLAGS_tera_leveldb_verify_checksums;
     m_ldb_options.ignore_corruption_in_compaction = FLAGS_tera_leveldb_ignore_corruption_in_compaction;
+    m_ldb_options.max_subcompactions = FLAGS_tera_leveldb_max_subcompactions;
+    m_ldb_options.compaction_readahead_size =
+        static_cast<size_t>(FLAGS_tera_leveldb_compact_readahead_size) << 10;
     m_ldb_options.disable_wal = m_table_schema.disable_wal();
     SetupOptionsForLG();
 
@@ -562,6 +578,22 @@ bool TabletIO::Workload(double* write_workload) {
     return true;
 }
 
+bool TabletIO::GetMemTableSize(uint64_t* size) {
+    {
+        MutexLock lock(&m_mutex);
+        if (m_status != kReady) {
+            return false;
+        }
+        m_db_ref_count++;
+    }
+    *size = m_db->GetMemTableUsage();
+    {
+        MutexLock lock(&m_mutex);
+        m_db_ref_count--;
+    }
+    return true;
+}
+
 bool TabletIO::SnapshotIDToSeq(uint64_t snapshot_id, uint64_t* snapshot_sequence) {
     std::map<uint64_t, uint64_t>::iterator it = id_to_snapshot_num_.find(snapshot_id);
     if (it == id_to_snapshot_num_.end()) {
@@ -685,8 +717,20 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
     // init compact strategy
     leveldb::CompactStrategy* compact_strategy =
         m_ldb_options.compact_strategy_factory->NewInstance();
-    std::list<KeyValuePair> row_buf;
+    ScanRowBuffer row_buf;
+    const FilterEngine* filter = scan_options.filter.get();
+    std::set<std::string> all_qual_cfs;
+    if (filter != NULL) {
+        filter->GetAllCfs(&all_qual_cfs);
+    }
+    ScanProjection projection(m_key_operator,
+                              m_kv_only ? GeneralKv : m_table_schema.raw_key(),
+                              scan_options.iter_cf_set,
+                              scan_options.column_family_list, all_qual_cfs);
+    std::string seek_key;
     std::string last_key, last_col, last_qual;
+    std::string filter_row;
+    bool row_rejected = false;
     uint32_t buffer_size = 0;
     uint32_t version_num = 1;
     uint64_t nr_scan_round = 0;
@@ -746,12 +790,23 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
             break;
         }
 
-        const std::set<std::string>& cf_set = scan_options.iter_cf_set;
-        if (cf_set.size() > 0 &&
-            cf_set.find(col.ToString()) == cf_set.end() &&
-            type != leveldb::TKT_DEL) {
-            // donot need this column, skip row deleting tag
-            it->Next();
+        if (filter != NULL) {
+            if (filter_row.empty() || key.compare(filter_row) != 0) {
+                filter_row.assign(key.data(), key.size());
+                row_rejected = !filter->MayMatchRow(key);
+            }
+            if (row_rejected) {
+                // the row key alone fails the filters, seek over the row
+                projection.SeekNextRow(key, &seek_key);
+                projection.SkipTo(it, seek_key);
+                continue;
+            }
+        }
+
+        if (projection.Enabled() &&
+            projection.SkipColumn(key, col, qual, type, &seek_key)) {
+            // donot need this column or qualifier, seek over it
+            projection.SkipTo(it, seek_key);
             continue;
         }
 
@@ -780,22 +835,30 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
         }
 
         // begin to scan next row
-        if (key.compare(last_key) != 0) {
+        bool row_changed = (key.compare(last_key) != 0);
+        if (row_changed) {
             *read_row_count += 1;
             ProcessRowBuffer(row_buf, scan_options, value_list, &buffer_size);
-            row_buf.clear();
+            row_buf.Clear();
         }
 
         // max version filter
-        if (key.compare(last_key) == 0 &&
+        if (!row_changed &&
             col.compare(last_col) == 0 &&
             qual.compare(last_qual) == 0) {
             if (++version_num > scan_options.max_versions) {
-                it->Next();
+                if (projection.Enabled()) {
+                    projection.SkipVersions(key, col, qual, &seek_key);
+                    projection.SkipTo(it, seek_key);
+                } else {
+                    it->Next();
+                }
                 continue;
             }
         } else {
-            last_key.assign(key.data(), key.size());
+            if (row_changed) {
+                last_key.assign(key.data(), key.size());
+            }
             last_col.assign(col.data(), col.size());
             last_qual.assign(qual.data(), qual.size());
             version_num = 1;
@@ -815,10 +878,8 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
             }
         }
 
-        KeyValuePair kv;
         (const_cast<ScanOptions&>(scan_options)).version_num = version_num;
-        MakeKvPair(key, col, qual, ts, value, &kv);
-        row_buf.push_back(kv);
+        row_buf.Add(key, col, qual, ts, value);
 
         // check scan buffer
         if (buffer_size >= scan_options.max_size) {
@@ -930,7 +991,7 @@ bool TabletIO::LowLevelSeek(const std::string& row_key,
     ColumnFamilyMap::const_iterator it_cf =
         scan_options.column_family_list.begin();
     for (; it_cf != scan_options.column_family_list.end(); ++it_cf) {
-        const string& cf_name = it_cf->first;
+        const std::string& cf_name = it_cf->first;
         const std::set<std::string>& qu_set = it_cf->second;
 
         // seek to the cf start & process cf delete mark
@@ -961,7 +1022,7 @@ bool TabletIO::LowLevelSeek(const std::string& row_key,
         }
         std::set<std::string>::iterator it_qu = qu_set.begin();
         for (; it_qu != qu_set.end(); ++it_qu) {
-            const string& qu_name = *it_qu;
+            const std::string& qu_name = *it_qu;
             VLOG(10) << "ll-seek: try find " << "tablet=[" << m_tablet_path
                 << "] row_key=[" << row_key << "] cf=[" << cf_name
                 << "] qu=[" << qu_name << "]";
@@ -1060,7 +1121,9 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
         }
         if (!Read(key, &value, snapshot_id, status)) {
             m_counter.read_rows.Inc();
-            row_read_delay.Add(get_micros() - read_ms);
+            int64_t read_us = get_micros() - read_ms;
+            row_read_delay.Add(read_us);
+            read_cells_latency.Add(read_us);
             {
                 MutexLock lock(&m_mutex);
                 m_db_ref_count--;
@@ -1072,7 +1135,9 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
         result->set_value(value);
         m_counter.read_rows.Inc();
         m_counter.read_size.Add(result->ByteSize());
-        row_read_delay.Add(get_micros() - read_ms);
+        int64_t read_us = get_micros() - read_ms;
+        row_read_delay.Add(read_us);
+        read_cells_latency.Add(read_us);
         {
             MutexLock lock(&m_mutex);
             m_db_ref_count--;
@@ -1109,6 +1174,7 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
     }
 
     scan_options.snapshot_id = snapshot_id;
+    scan_options.single_row_read = true;
 
     VLOG(10) << "ReadCells: " << "key=[" << DebugString(row_reader.key()) << "]";
 
@@ -1129,7 +1195,9 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
                            &is_complete, status);
     }
     m_counter.read_rows.Inc();
-    row_read_delay.Add(get_micros() - read_ms);
+    int64_t read_us = get_micros() - read_ms;
+    row_read_delay.Add(read_us);
+    read_cells_latency.Add(read_us);
     {
         MutexLock lock(&m_mutex);
         m_db_ref_count--;
@@ -1277,6 +1345,9 @@ bool TabletIO::ScanRowsRestricted(const ScanTabletRequest* request,
     if (LowLevelScan(start_tera_key, end_row_key, scan_options,
                      response->mutable_results(), response->mutable_next_start_point(),
                      &read_row_count, &read_bytes, &is_complete, &status)) {
+        if (request->packed()) {
+            PackRowResult(response->mutable_results());
+        }
         response->set_complete(is_complete);
         m_counter.scan_rows.Add(read_row_count);
         m_counter.scan_size.Add(read_bytes);
@@ -1305,6 +1376,11 @@ bool TabletIO::ScanRowsStreaming(const ScanTabletRequest* request,
 
     ScanOptions scan_options;
     SetupScanRowOptions(request, &scan_options);
+    // a stream scan reads each block once, keep it out of the hot blocks
+    scan_options.low_cache_priority = true;
+    // and goes through whole sst files, read them in large chunks
+    scan_options.readahead_size =
+        static_cast<size_t>(FLAGS_tera_tabletnode_scan_readahead_size) << 10;
 
     uint32_t read_row_count = 0;
     uint32_t read_bytes = 0;
@@ -1330,6 +1406,9 @@ bool TabletIO::ScanRowsStreaming(const ScanTabletRequest* request,
             m_counter.scan_rows.Add(read_row_count);
             m_counter.scan_size.Add(read_bytes);
 
+            if (request->packed()) {
+                PackRowResult(&value_list);
+            }
             scan_stream->SetCompleted(is_complete);
             if (!scan_stream->PushData(data_id, value_list)) {
                 break;
@@ -1476,13 +1555,19 @@ void TabletIO::SetupScanRowOptions(const ScanTabletRequest* request,
     }
 
     if (request->has_filter_list() &&
-        request->filter_list().filter_size() > 0) {
+        (request->filter_list().filter_size() > 0 ||
+         request->filter_list().sub_list_size() > 0)) {
         scan_options->filter_list.CopyFrom(request->filter_list());
+        scan_options->filter.reset(new FilterEngine(scan_options->filter_list));
     }
-    if (scan_options->iter_cf_set.size() > 0 &&
-        scan_options->filter_list.filter_size() > 0) {
-        ScanFilter scan_filter(scan_options->filter_list);
-        scan_filter.GetAllCfs(&scan_options->iter_cf_set);
+    if (scan_options->iter_cf_set.size() > 0 && scan_options->filter) {
+        if (scan_options->filter->NeedAllColumns()) {
+            // the filters look at every family, the output is still
+            // limited to column_family_list
+            scan_options->iter_cf_set.clear();
+        } else {
+            scan_options->filter->GetAllCfs(&scan_options->iter_cf_set);
+        }
     }
     if (request->has_max_version()) {
         scan_options->max_versions = request->max_version();
@@ -1499,6 +1584,18 @@ void TabletIO::SetupScanRowOptions(const ScanTabletRequest* request,
     }
     scan_options->version_num = 0;
     scan_options->snapshot_id = request->snapshot_id();
+    scan_options->aggregate = request->aggregate();
+}
+
+static leveldb::CompressionType CodecToCompressionType(CompressCodec codec) {
+    switch (codec) {
+    case CodecSnappy:
+        return leveldb::kSnappyCompression;
+    case CodecZstd:
+        return leveldb::kZstdCompression;
+    default:
+        return leveldb::kNoCompression;
+    }
 }
 
 void TabletIO::SetupOptionsForLG() {
@@ -1555,9 +1652,15 @@ void TabletIO::SetupOptionsForLG() {
             m_ldb_options.seek_latency = FLAGS_tera_leveldb_env_dfs_seek_latency;
         }
 
-        if (compress) {
+        if (lg_schema.has_compress_codec()) {
+            lg_info->compression = CodecToCompressionType(lg_schema.compress_codec());
+        } else if (compress) {
             lg_info->compression = leveldb::kSnappyCompression;
         }
+        lg_info->bottom_compression =
+            CodecToCompressionType(lg_schema.bottom_compress_codec());
+        lg_info->bottom_compression_level = lg_schema.bottom_compress_level();
+        lg_info->compression_dict_size = lg_schema.compress_dict_size();
 
         lg_info->block_size = lg_schema.block_size() * 1024;
         if (lg_schema.use_memtable_on_leveldb()) {
@@ -1657,6 +1760,9 @@ void TabletIO::SetupIteratorOptions(const ScanOptions& scan_options,
     if (target_lgs.size() > 0) {
         leveldb_opts->target_lgs = new std::set<uint32_t>(target_lgs);
     }
+    leveldb_opts->single_row_read = scan_options.single_row_read;
+    leveldb_opts->low_cache_priority = scan_options.low_cache_priority;
+    leveldb_opts->readahead_size = scan_options.readahead_size;
 }
 
 void TabletIO::TearDownIteratorOptions(leveldb::ReadOptions* opts) {
@@ -1666,97 +1772,42 @@ void TabletIO::TearDownIteratorOptions(leveldb::ReadOptions* opts) {
     }
 }
 
-static bool CheckValue(const KeyValuePair& kv, const Filter& filter) {
-    int64_t v1 = *(int64_t*)kv.value().c_str();
-    int64_t v2 = *(int64_t*)filter.ref_value().c_str();
-    BinCompOp op = filter.bin_comp_op();
-    switch (op) {
-    case EQ:
-        return v1 == v2;
-        break;
-    case NE:
-        return v1 != v2;
-        break;
-    case LT:
-        return v1 < v2;
-        break;
-    case LE:
-        return v1 <= v2;
-        break;
-    case GT:
-        return v1 > v2;
-        break;
-    case GE:
-        return v1 >= v2;
-        break;
-    default:
-        LOG(ERROR) << "illegal compare operator: " << op;
-    }
-    return false;
-}
-
-static bool CheckCell(const KeyValuePair& kv, const Filter& filter) {
-    switch (filter.type()) {
-    case BinComp: {
-        if (filter.field() == ValueFilter) {
-            if (!CheckValue(kv, filter)) {
-                return false;
-            }
-        } else {
-            LOG(ERROR) << "only support value-compare.";
-        }
-        break;
-    }
-    default: {
-        LOG(ERROR) << "only support compare.";
-        break;
-    }}
-    return true;
-}
-
-void TabletIO::ProcessRowBuffer(std::list<KeyValuePair>& row_buf,
+void TabletIO::ProcessRowBuffer(const ScanRowBuffer& row_buf,
                                 const ScanOptions& scan_options,
                                 RowResult* value_list,
                                 uint32_t* buffer_size) {
-    if (row_buf.size() <= 0) {
+    if (row_buf.Empty()) {
+        return;
+    }
+    if (scan_options.filter && !scan_options.filter->Check(row_buf)) {
+        VLOG(10) << "Filter check fail: kv_num: " << row_buf.Size();
         return;
     }
-    std::list<KeyValuePair>::iterator it;
-    int filter_num = scan_options.filter_list.filter_size();
-
-    VLOG(10) << "Filter check: kv_num: " << row_buf.size()
-        << ", filter_num: " << filter_num;
 
-    for (int i = 0; i < filter_num; ++i) {
-        const Filter& filter = scan_options.filter_list.filter(i);
-        for (it = row_buf.begin(); it != row_buf.end(); ++it) {
-            if (it->column_family() != filter.content()) {
-                continue;
-            }
-            if (filter.value_type() != kINT64) {
-                LOG(ERROR) << "only support int64 value.";
-                return;
-            }
-            if (!CheckCell(*it, filter)) {
-                return;
-            }
-        }
+    AggregateResult* aggregate = NULL;
+    if (scan_options.aggregate) {
+        aggregate = value_list->mutable_aggregate();
     }
+    bool row_counted = false;
 
-    for (it = row_buf.begin(); it != row_buf.end(); ++it) {
-        const std::string& key = it->key();
-        const std::string& col = it->column_family();
-        const std::string& qual = it->qualifier();
-        const std::string& value = it->value();
-        int64_t ts = it->timestamp();
+    // lookup keys of column_family_list, reused for all cells
+    std::string col_str, qual_str;
+    for (uint32_t i = 0; i < row_buf.Size(); ++i) {
+        leveldb::Slice key = row_buf.Key(i);
+        leveldb::Slice col = row_buf.Column(i);
+        leveldb::Slice qual = row_buf.Qualifier(i);
+        leveldb::Slice value = row_buf.Value(i);
+        int64_t ts = row_buf.Timestamp(i);
 
         // skip unnecessary columns and qualifiers
         if (scan_options.column_family_list.size() > 0) {
+            col_str.assign(col.data(), col.size());
             ColumnFamilyMap::const_iterator it =
-                scan_options.column_family_list.find(col);
+                scan_options.column_family_list.find(col_str);
             if (it != scan_options.column_family_list.end()) {
                 const std::set<std::string>& qual_list = it->second;
-                if (qual_list.size() > 0 && qual_list.end() == qual_list.find(qual)) {
+                qual_str.assign(qual.data(), qual.size());
+                if (qual_list.size() > 0 && qual_list.end() == qual_list.find(qual_str)) {
                     continue;
                 }
             } else {
@@ -1768,7 +1819,12 @@ void TabletIO::ProcessRowBuffer(std::list<KeyValuePair>& row_buf,
             continue;
         }
 
-        value_list->add_key_values()->CopyFrom(*it);
+        if (aggregate != NULL) {
+            AggregateCell(key, value, !row_counted, aggregate);
+            row_counted = true;
+            continue;
+        }
+        row_buf.SerializeCell(i, value_list->add_key_values());
 
         *buffer_size += key.size() + col.size() + qual.size()
             + sizeof(ts) + value.size();
@@ -1885,6 +1941,9 @@ void TabletIO::GetAndClearCounter(TabletCounter* counter) {
     double write_workload = 0;
     Workload(&write_workload);
     counter->set_write_workload(write_workload);
+    uint64_t memtable_size = 0;
+    GetMemTableSize(&memtable_size);
+    counter->set_memtable_size(memtable_size);
 }
 
 int32_t TabletIO::AddRef() {
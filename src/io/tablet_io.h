@@ -11,8 +11,12 @@
 #include <string>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include "common/base/scoped_ptr.h"
 #include "common/mutex.h"
+#include "io/filter_engine.h"
+#include "io/scan_row_buffer.h"
 #include "io/stream_scan.h"
 #include "leveldb/db.h"
 #include "leveldb/options.h"
@@ -52,27 +56,50 @@ public:
         int64_t ts_end;
         uint64_t snapshot_id;
         FilterList filter_list;
+        boost::shared_ptr<FilterEngine> filter; // compiled filter_list, NULL if empty
         ColumnFamilyMap column_family_list;
         std::set<std::string> iter_cf_set;
         int64_t timeout;
+        bool single_row_read; // only read one row, allow row bloomfilter to skip sst
+        bool low_cache_priority; // blocks read are not promoted in block cache
+        size_t readahead_size; // read sst files in chunks of this size, 0 block by block
+        bool aggregate; // fold cells into value_list->aggregate, return no cell
 
         ScanOptions()
             : max_versions(UINT32_MAX), version_num(0), max_size(UINT32_MAX),
-              ts_start(kOldestTs), ts_end(kLatestTs), snapshot_id(0), timeout(INT64_MAX / 2)
+              ts_start(kOldestTs), ts_end(kLatestTs), snapshot_id(0), timeout(INT64_MAX / 2),
+              single_row_read(false), low_cache_priority(false), readahead_size(0),
+              aggregate(false)
+        {}
+    };
+
+    // Resources of the tabletnode shared by all its tablets, NULL ones are
+    // created by each tablet for itself or left unused.
+    struct SharedResources {
+        leveldb::Logger* logger;
+        leveldb::Cache* block_cache;
+        leveldb::TableCache* table_cache;
+        leveldb::CommitLog* commit_log;
+        leveldb::RateLimiter* rate_limiter;
+        leveldb::ArenaPool* arena_pool;
+
+        SharedResources()
+            : logger(NULL), block_cache(NULL), table_cache(NULL), commit_log(NULL),
+              rate_limiter(NULL), arena_pool(NULL)
         {}
     };
 
     struct StatCounter {
-        tera::Counter low_read_cell;
-        tera::Counter scan_rows;
-        tera::Counter scan_kvs;
-        tera::Counter scan_size;
-        tera::Counter read_rows;
-        tera::Counter read_kvs;
-        tera::Counter read_size;
-        tera::Counter write_rows;
-        tera::Counter write_kvs;
-        tera::Counter write_size;
+        tera::ShardedCounter low_read_cell;
+        tera::ShardedCounter scan_rows;
+        tera::ShardedCounter scan_kvs;
+        tera::ShardedCounter scan_size;
+        tera::ShardedCounter read_rows;
+        tera::ShardedCounter read_kvs;
+        tera::ShardedCounter read_size;
+        tera::ShardedCounter write_rows;
+        tera::ShardedCounter write_kvs;
+        tera::ShardedCounter write_size;
     };
 
 public:
@@ -93,9 +120,7 @@ public:
                       const std::vector<uint64_t>& parent_tablets,
                       std::map<uint64_t, uint64_t> snapshots,
                       std::map<uint64_t, uint64_t> rollbacks,
-                      leveldb::Logger* logger = NULL,
-                      leveldb::Cache* block_cache = NULL,
-                      leveldb::TableCache* table_cache = NULL,
+                      const SharedResources& resources = SharedResources(),
                       StatusCode* status = NULL);
     virtual bool Unload(StatusCode* status = NULL);
     virtual bool Split(std::string* split_key, StatusCode* status = NULL);
@@ -108,6 +133,9 @@ public:
 
     bool IsBusy();
     bool Workload(double* write_workload);
+    // approximate memory usage of the memtables of the tablet, as their
+    // arenas count it; the memtable pool only counts node totals
+    bool GetMemTableSize(uint64_t* size);
 
     bool SnapshotIDToSeq(uint64_t snapshot_id, uint64_t* snapshot_sequence);
 
@@ -186,7 +214,7 @@ private:
                               leveldb::ReadOptions* leveldb_opts);
     void TearDownIteratorOptions(leveldb::ReadOptions* opts);
 
-    void ProcessRowBuffer(std::list<KeyValuePair>& row_buf,
+    void ProcessRowBuffer(const ScanRowBuffer& row_buf,
                           const ScanOptions& scan_options,
                           RowResult* value_list,
                           uint32_t* buffer_size);
@@ -15,6 +15,7 @@
 #include "leveldb/lg_coding.h"
 #include "proto/proto_helper.h"
 #include "utils/counter.h"
+#include "utils/latency_histogram.h"
 #include "utils/timer.h"
 
 DECLARE_int32(tera_asyncwriter_pending_limit);
@@ -24,6 +25,8 @@ DECLARE_int32(tera_asyncwriter_sync_size_threshold);
 DECLARE_int32(tera_asyncwriter_batch_size);
 DECLARE_bool(tera_sync_log);
 
+extern tera::LatencyHistogram write_flush_latency;
+
 namespace tera {
 namespace io {
 
@@ -358,7 +361,9 @@ StatusCode TabletWriter::FlushToDiskBatch(WriteTaskBuffer* task_buffer) {
 
     StatusCode status = kTableOk;
     const bool disable_wal = false;
+    int64_t start_micros = get_micros();
     m_tablet->WriteBatch(&batch, disable_wal, FLAGS_tera_sync_log, &status);
+    write_flush_latency.Add(get_micros() - start_micros);
     batch.Clear();
     for (size_t i = 0; i < task_num; i++) {
         FinishTask((*task_buffer)[i], status);
@@ -0,0 +1,128 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Compare the row assembly of LowLevelScan before and after ScanRowBuffer:
+//   old: cell -> KeyValuePair -> std::list copy -> CopyFrom into RowResult
+//   new: cell -> ScanRowBuffer -> RowResult
+
+#include <stdio.h>
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+
+#include "io/scan_row_buffer.h"
+#include "proto/table_meta.pb.h"
+#include "utils/timer.h"
+
+DEFINE_int32(bench_rows, 200000, "rows assembled per round");
+DEFINE_int32(bench_cells_per_row, 10, "cells in each row");
+DEFINE_int32(bench_value_size, 64, "value size of each cell");
+DEFINE_int32(bench_rows_per_result, 100, "rows serialized into one RowResult");
+DEFINE_int32(bench_rounds, 3, "rounds of each mode");
+
+namespace tera {
+namespace io {
+
+struct BenchCell {
+    std::string key;
+    std::string col;
+    std::string qual;
+    std::string value;
+    int64_t ts;
+};
+
+static void MakeCells(std::vector<BenchCell>* cells) {
+    cells->resize(FLAGS_bench_cells_per_row);
+    for (int i = 0; i < FLAGS_bench_cells_per_row; ++i) {
+        BenchCell& c = (*cells)[i];
+        c.key = "row_key_0000000001";
+        c.col = "cf";
+        char qual[32];
+        snprintf(qual, sizeof(qual), "qualifier_%04d", i);
+        c.qual = qual;
+        c.value.assign(FLAGS_bench_value_size, 'v');
+        c.ts = 1000000 + i;
+    }
+}
+
+static void MakeKvPair(const BenchCell& c, KeyValuePair* kv) {
+    kv->set_key(c.key);
+    kv->set_column_family(c.col);
+    kv->set_qualifier(c.qual);
+    kv->set_timestamp(c.ts);
+    kv->set_value(c.value);
+}
+
+static int64_t RunListCopy(const std::vector<BenchCell>& cells) {
+    RowResult result;
+    int64_t bytes = 0;
+    for (int r = 0; r < FLAGS_bench_rows; ++r) {
+        if (r % FLAGS_bench_rows_per_result == 0) {
+            result.clear_key_values();
+        }
+        std::list<KeyValuePair> row_buf;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            KeyValuePair kv;
+            MakeKvPair(cells[i], &kv);
+            row_buf.push_back(kv);
+        }
+        std::list<KeyValuePair>::iterator it = row_buf.begin();
+        for (; it != row_buf.end(); ++it) {
+            result.add_key_values()->CopyFrom(*it);
+            bytes += it->value().size();
+        }
+    }
+    return bytes;
+}
+
+static int64_t RunRowBuffer(const std::vector<BenchCell>& cells) {
+    RowResult result;
+    ScanRowBuffer row_buf;
+    int64_t bytes = 0;
+    for (int r = 0; r < FLAGS_bench_rows; ++r) {
+        if (r % FLAGS_bench_rows_per_result == 0) {
+            result.clear_key_values();
+        }
+        row_buf.Clear();
+        for (size_t i = 0; i < cells.size(); ++i) {
+            const BenchCell& c = cells[i];
+            row_buf.Add(c.key, c.col, c.qual, c.ts, c.value);
+        }
+        for (uint32_t i = 0; i < row_buf.Size(); ++i) {
+            row_buf.SerializeCell(i, result.add_key_values());
+            bytes += row_buf.Value(i).size();
+        }
+    }
+    return bytes;
+}
+
+static void Report(const char* name, int64_t (*run)(const std::vector<BenchCell>&),
+                   const std::vector<BenchCell>& cells) {
+    for (int round = 0; round < FLAGS_bench_rounds; ++round) {
+        int64_t start = get_micros();
+        int64_t bytes = run(cells);
+        int64_t used = get_micros() - start;
+        if (used <= 0) {
+            used = 1;
+        }
+        double cell_num = static_cast<double>(FLAGS_bench_rows) * cells.size();
+        fprintf(stdout, "%-12s round %d: %10.0f cells/s %8.1f MB/s\n", name, round,
+                cell_num * 1000000 / used, bytes / 1048576.0 * 1000000 / used);
+    }
+}
+
+} // namespace io
+} // namespace tera
+
+int main(int argc, char* argv[]) {
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    std::vector<tera::io::BenchCell> cells;
+    tera::io::MakeCells(&cells);
+    tera::io::Report("list_copy", &tera::io::RunListCopy, cells);
+    tera::io::Report("row_buffer", &tera::io::RunRowBuffer, cells);
+    return 0;
+}
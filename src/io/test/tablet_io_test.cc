@@ -16,6 +16,7 @@
 #include "db/filename.h"
 #include "leveldb/raw_key_operator.h"
 #include "leveldb/table_utils.h"
+#include "proto/packed_result.h"
 #include "proto/proto_helper.h"
 #include "proto/status_code.pb.h"
 #include "utils/timer.h"
@@ -91,7 +92,7 @@ TEST_F(TabletIOTest, General) {
 
     TabletIO tablet(key_start, key_end);
     EXPECT_TRUE(tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
 
     std::string key = "555";
     std::string value = "value of 555";
@@ -116,7 +117,7 @@ TEST_F(TabletIOTest, Split) {
 
     TabletIO tablet(key_start, key_end);
     EXPECT_TRUE(tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
 
     // prepare test data
     EXPECT_TRUE(PrepareTestData(&tablet, N));
@@ -137,7 +138,7 @@ TEST_F(TabletIOTest, Split) {
     key_end = "8000";
     TabletIO other_tablet(key_start, key_end);
     EXPECT_TRUE(other_tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     other_tablet.GetDataSize(&size, NULL, &status);
     LOG(INFO) << "table[" << key_start << ", " << key_end
         << "]: size = " << size;
@@ -151,7 +152,7 @@ TEST_F(TabletIOTest, Split) {
     key_end = "5000";
     TabletIO l_tablet(key_start, key_end);
     EXPECT_TRUE(l_tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     l_tablet.GetDataSize(&size, NULL, &status);
     LOG(INFO) << "table[" << key_start << ", " << key_end
         << "]: size = " << size;
@@ -161,7 +162,7 @@ TEST_F(TabletIOTest, Split) {
     key_end = "";
     TabletIO r_tablet(key_start, key_end);
     EXPECT_TRUE(r_tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     r_tablet.GetDataSize(&size, NULL, &status);
     LOG(INFO) << "table[" << key_start << ", " << key_end
         << "]: size = " << size;
@@ -178,7 +179,7 @@ TEST_F(TabletIOTest, SplitAndCheckSize) {
 
     TabletIO tablet(key_start, key_end);
     EXPECT_TRUE(tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
 
     // prepare test data
     EXPECT_TRUE(PrepareTestData(&tablet, N));
@@ -198,7 +199,7 @@ TEST_F(TabletIOTest, SplitAndCheckSize) {
     // open from split key to check scope size
     TabletIO l_tablet(key_start, split_key);
     EXPECT_TRUE(l_tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     l_tablet.GetDataSize(&size, NULL, &status);
     LOG(INFO) << "table[" << key_start << ", " << split_key
         << "]: size = " << size;
@@ -206,7 +207,7 @@ TEST_F(TabletIOTest, SplitAndCheckSize) {
 
     TabletIO r_tablet(split_key, key_end);
     EXPECT_TRUE(r_tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     r_tablet.GetDataSize(&size, NULL, &status);
     LOG(INFO) << "table[" << split_key << ", " << key_end
         << "]: size = " << size;
@@ -223,7 +224,7 @@ TEST_F(TabletIOTest, OverWrite) {
 
     TabletIO tablet(key_start, key_end);
     EXPECT_TRUE(tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
 
     std::string key = "555";
     std::string value = "value of 555";
@@ -249,7 +250,7 @@ TEST_F(TabletIOTest, Compact) {
 
     TabletIO tablet(key_start, key_end);
     EXPECT_TRUE(tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
 
     // prepare test data
     EXPECT_TRUE(PrepareTestData(&tablet, 100));
@@ -265,7 +266,7 @@ TEST_F(TabletIOTest, Compact) {
     std::string new_key_end = StringFormat("%011llu", 50); // NumberToString(800);
     TabletIO new_tablet(new_key_start, new_key_end);
     EXPECT_TRUE(new_tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     EXPECT_TRUE(new_tablet.Compact(0, &status));
 
     uint64_t new_table_size = 0;
@@ -295,7 +296,7 @@ TEST_F(TabletIOTest, LowLevelScan) {
 
     TabletIO tablet(key_start, key_end);
     EXPECT_TRUE(tablet.Load(GetTableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
 
     std::string tkey1;
 
@@ -368,6 +369,280 @@ TEST_F(TabletIOTest, LowLevelScan) {
     EXPECT_TRUE(tablet.Unload());
 }
 
+TEST_F(TabletIOTest, LowLevelScanProjection) {
+    std::string tablet_path = working_dir + "llscan_projection_tablet";
+    std::string key_start = "";
+    std::string key_end = "";
+    StatusCode status;
+
+    ColumnFamilySchema* cf = schema_.add_column_families();
+    cf->set_name("other");
+    cf->set_locality_group("lg0");
+    cf->set_max_versions(3);
+
+    TabletIO tablet(key_start, key_end);
+    EXPECT_TRUE(tablet.Load(GetTableSchema(), tablet_path, std::vector<uint64_t>(),
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
+
+    // 3 wide rows, 3 versions of each cell
+    std::string tkey;
+    for (int r = 0; r < 3; ++r) {
+        std::string row = StringFormat("row%d", r);
+        for (int q = 0; q < 50; ++q) {
+            std::string qual = StringFormat("q%03d", q);
+            for (int64_t ts = 1; ts <= 3; ++ts) {
+                tablet.GetRawKeyOperator()->EncodeTeraKey(row, "column", qual, ts,
+                                                          leveldb::TKT_VALUE, &tkey);
+                EXPECT_TRUE(tablet.WriteOne(tkey, "v", false, NULL));
+                tablet.GetRawKeyOperator()->EncodeTeraKey(row, "other", qual, ts,
+                                                          leveldb::TKT_VALUE, &tkey);
+                EXPECT_TRUE(tablet.WriteOne(tkey, "v", false, NULL));
+            }
+        }
+    }
+    // a deleted qualifier must stay deleted when seeking to it
+    tablet.GetRawKeyOperator()->EncodeTeraKey("row1", "column", "q020", 4,
+                                              leveldb::TKT_DEL_QUALIFIERS, &tkey);
+    EXPECT_TRUE(tablet.WriteOne(tkey, "", false, NULL));
+
+    std::string start_tera_key;
+    RowResult value_list;
+    KeyValuePair next_start_point;
+    uint32_t read_row_count = 0;
+    uint32_t read_bytes = 0;
+    bool is_complete = false;
+    TabletIO::ScanOptions scan_options;
+    scan_options.column_family_list["column"].insert("q010");
+    scan_options.column_family_list["column"].insert("q020");
+    scan_options.iter_cf_set.insert("column");
+    scan_options.max_versions = 2;
+    EXPECT_TRUE(tablet.LowLevelScan(start_tera_key, "", scan_options,
+                                    &value_list, &next_start_point, &read_row_count,
+                                    &read_bytes, &is_complete, NULL));
+    EXPECT_TRUE(is_complete);
+    // 2 versions of 2 qualifiers per row, minus the deleted one
+    ASSERT_EQ(value_list.key_values_size(), 10);
+    for (int i = 0; i < value_list.key_values_size(); ++i) {
+        const KeyValuePair& kv = value_list.key_values(i);
+        EXPECT_EQ(kv.column_family(), "column");
+        EXPECT_TRUE(kv.qualifier() == "q010" || kv.qualifier() == "q020");
+        EXPECT_GE(kv.timestamp(), 2);
+        EXPECT_FALSE(kv.key() == "row1" && kv.qualifier() == "q020");
+    }
+
+    // whole family
+    scan_options.column_family_list.clear();
+    scan_options.iter_cf_set.clear();
+    scan_options.iter_cf_set.insert("other");
+    scan_options.max_versions = 1;
+    EXPECT_TRUE(tablet.LowLevelScan(start_tera_key, "", scan_options,
+                                    &value_list, &next_start_point, &read_row_count,
+                                    &read_bytes, &is_complete, NULL));
+    EXPECT_EQ(value_list.key_values_size(), 150);
+    EXPECT_TRUE(tablet.Unload());
+}
+
+static std::set<std::string> ScanRowsWithFilter(TabletIO* tablet, const FilterList& filter_list) {
+    RowResult value_list;
+    KeyValuePair next_start_point;
+    uint32_t read_row_count = 0;
+    uint32_t read_bytes = 0;
+    bool is_complete = false;
+    TabletIO::ScanOptions scan_options;
+    scan_options.column_family_list["column"];
+    scan_options.filter.reset(new FilterEngine(filter_list));
+    EXPECT_TRUE(tablet->LowLevelScan("", "", scan_options,
+                                     &value_list, &next_start_point, &read_row_count,
+                                     &read_bytes, &is_complete, NULL));
+    EXPECT_TRUE(is_complete);
+    std::set<std::string> rows;
+    for (int i = 0; i < value_list.key_values_size(); ++i) {
+        EXPECT_EQ(value_list.key_values(i).column_family(), "column");
+        rows.insert(value_list.key_values(i).key());
+    }
+    return rows;
+}
+
+TEST_F(TabletIOTest, LowLevelScanFilter) {
+    std::string tablet_path = working_dir + "llscan_filter_tablet";
+    StatusCode status;
+
+    ColumnFamilySchema* cf = schema_.add_column_families();
+    cf->set_name("num");
+    cf->set_locality_group("lg0");
+
+    TabletIO tablet("", "");
+    EXPECT_TRUE(tablet.Load(GetTableSchema(), tablet_path, std::vector<uint64_t>(),
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
+
+    std::string tkey;
+    for (int64_t r = 0; r < 10; ++r) {
+        std::string row = StringFormat("row%d", (int)r);
+        tablet.GetRawKeyOperator()->EncodeTeraKey(row, "column", "name", 1,
+                                                  leveldb::TKT_VALUE, &tkey);
+        EXPECT_TRUE(tablet.WriteOne(tkey, StringFormat("name%d", (int)r), false, NULL));
+        tablet.GetRawKeyOperator()->EncodeTeraKey(row, "num", "", 1,
+                                                  leveldb::TKT_VALUE, &tkey);
+        EXPECT_TRUE(tablet.WriteOne(tkey, std::string((char*)&r, sizeof(r)), false, NULL));
+    }
+
+    // row key prefix OR row key regex
+    FilterList filter_list;
+    filter_list.set_op(OrOp);
+    Filter* filter = filter_list.add_filter();
+    filter->set_field(RowFilter);
+    filter->set_type(Prefix);
+    filter->set_ref_value("row1");
+    filter = filter_list.add_filter();
+    filter->set_field(RowFilter);
+    filter->set_type(Regex);
+    filter->set_ref_value("^row[78]$");
+    std::set<std::string> rows = ScanRowsWithFilter(&tablet, filter_list);
+    ASSERT_EQ(rows.size(), 3U);
+    EXPECT_TRUE(rows.count("row1") && rows.count("row7") && rows.count("row8"));
+
+    // typed value compare AND qualifier regex, on families not returned
+    filter_list.Clear();
+    filter = filter_list.add_filter();
+    filter->set_field(ValueFilter);
+    filter->set_type(BinComp);
+    filter->set_value_type(kINT64);
+    filter->set_bin_comp_op(GE);
+    filter->set_content("num");
+    int64_t ref = 5;
+    filter->set_ref_value(std::string((char*)&ref, sizeof(ref)));
+    FilterList* sub_list = filter_list.add_sub_list();
+    filter = sub_list->add_filter();
+    filter->set_field(QuFilter);
+    filter->set_type(Regex);
+    filter->set_content("column");
+    filter->set_ref_value("^na");
+    rows = ScanRowsWithFilter(&tablet, filter_list);
+    EXPECT_EQ(rows.size(), 5U);
+    EXPECT_EQ(rows.count("row4"), 0U);
+
+    // value substring
+    filter_list.Clear();
+    filter = filter_list.add_filter();
+    filter->set_field(ValueFilter);
+    filter->set_type(SubStr);
+    filter->set_content("column");
+    filter->set_ref_value("me3");
+    rows = ScanRowsWithFilter(&tablet, filter_list);
+    ASSERT_EQ(rows.size(), 1U);
+    EXPECT_EQ(*rows.begin(), "row3");
+
+    // no such family, and a bad regex, match nothing
+    filter->set_field(CfFilter);
+    filter->set_type(BinComp);
+    filter->set_bin_comp_op(EQ);
+    filter->set_ref_value("missing");
+    EXPECT_TRUE(ScanRowsWithFilter(&tablet, filter_list).empty());
+    filter->set_type(Regex);
+    filter->set_ref_value("(");
+    EXPECT_TRUE(ScanRowsWithFilter(&tablet, filter_list).empty());
+    EXPECT_TRUE(tablet.Unload());
+}
+
+TEST_F(TabletIOTest, LowLevelScanAggregate) {
+    std::string tablet_path = working_dir + "llscan_aggregate_tablet";
+    StatusCode status;
+
+    TabletIO tablet("", "");
+    EXPECT_TRUE(tablet.Load(GetTableSchema(), tablet_path, std::vector<uint64_t>(),
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
+
+    std::string tkey;
+    for (int64_t r = 0; r < 10; ++r) {
+        std::string row = StringFormat("row%d", (int)r);
+        tablet.GetRawKeyOperator()->EncodeTeraKey(row, "column", "num", 1,
+                                                  leveldb::TKT_VALUE, &tkey);
+        int64_t v = r - 3;
+        EXPECT_TRUE(tablet.WriteOne(tkey, std::string((char*)&v, sizeof(v)), false, NULL));
+        tablet.GetRawKeyOperator()->EncodeTeraKey(row, "column", "name", 1,
+                                                  leveldb::TKT_VALUE, &tkey);
+        EXPECT_TRUE(tablet.WriteOne(tkey, "name", false, NULL));
+    }
+
+    RowResult value_list;
+    KeyValuePair next_start_point;
+    uint32_t read_row_count = 0;
+    uint32_t read_bytes = 0;
+    bool is_complete = false;
+    TabletIO::ScanOptions scan_options;
+    scan_options.aggregate = true;
+    scan_options.max_size = 1;
+    EXPECT_TRUE(tablet.LowLevelScan("", "row8", scan_options,
+                                    &value_list, &next_start_point, &read_row_count,
+                                    &read_bytes, &is_complete, NULL));
+    // no cell is shipped, so the buffer limit never cuts the scan
+    EXPECT_TRUE(is_complete);
+    EXPECT_EQ(value_list.key_values_size(), 0);
+    ASSERT_TRUE(value_list.has_aggregate());
+    const AggregateResult& aggregate = value_list.aggregate();
+    EXPECT_EQ(aggregate.row_count(), 8U);
+    EXPECT_EQ(aggregate.cell_count(), 16U);
+    EXPECT_EQ(aggregate.int64_count(), 8U);
+    EXPECT_EQ(aggregate.sum(), 4);
+    EXPECT_EQ(aggregate.min(), -3);
+    EXPECT_EQ(aggregate.max(), 4);
+    EXPECT_EQ(aggregate.first_row(), "row0");
+    EXPECT_EQ(aggregate.last_row(), "row7");
+    EXPECT_TRUE(tablet.Unload());
+}
+
+TEST_F(TabletIOTest, LowLevelScanPacked) {
+    std::string tablet_path = working_dir + "llscan_packed_tablet";
+    StatusCode status;
+
+    TabletIO tablet("", "");
+    EXPECT_TRUE(tablet.Load(GetTableSchema(), tablet_path, std::vector<uint64_t>(),
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
+
+    std::string tkey;
+    for (int r = 0; r < 3; ++r) {
+        std::string row = StringFormat("row%d", r);
+        for (int q = 0; q < 20; ++q) {
+            tablet.GetRawKeyOperator()->EncodeTeraKey(row, "column", StringFormat("qu%02d", q),
+                                                      q + 1, leveldb::TKT_VALUE, &tkey);
+            EXPECT_TRUE(tablet.WriteOne(tkey, StringFormat("value%d", q), false, NULL));
+        }
+        tablet.GetRawKeyOperator()->EncodeTeraKey(row, "column", "", 1,
+                                                  leveldb::TKT_VALUE, &tkey);
+        EXPECT_TRUE(tablet.WriteOne(tkey, "", false, NULL));
+    }
+
+    RowResult value_list;
+    KeyValuePair next_start_point;
+    uint32_t read_row_count = 0;
+    uint32_t read_bytes = 0;
+    bool is_complete = false;
+    TabletIO::ScanOptions scan_options;
+    EXPECT_TRUE(tablet.LowLevelScan("", "", scan_options,
+                                    &value_list, &next_start_point, &read_row_count,
+                                    &read_bytes, &is_complete, NULL));
+    EXPECT_EQ(value_list.key_values_size(), 63);
+
+    RowResult packed_list(value_list);
+    PackRowResult(&packed_list);
+    EXPECT_EQ(packed_list.key_values_size(), 0);
+    ASSERT_TRUE(packed_list.has_packed());
+    EXPECT_EQ(packed_list.packed().row_keys_size(), 3);
+    EXPECT_EQ(packed_list.packed().families_size(), 1);
+    EXPECT_LT(packed_list.ByteSize(), value_list.ByteSize() / 2);
+
+    EXPECT_TRUE(UnpackRowResult(&packed_list));
+    EXPECT_FALSE(packed_list.has_packed());
+    EXPECT_EQ(packed_list.SerializeAsString(), value_list.SerializeAsString());
+
+    // truncated cells must not be decoded
+    PackRowResult(&packed_list);
+    std::string* cells = packed_list.mutable_packed()->mutable_cells();
+    cells->resize(cells->size() - 1);
+    EXPECT_FALSE(UnpackRowResult(&packed_list));
+    EXPECT_TRUE(tablet.Unload());
+}
+
 TEST_F(TabletIOTest, SplitToSubTable) {
     LOG(INFO) << "SplitToSubTable() begin ...";
     std::string tablet_path = leveldb::GetTabletPathFromNum(working_dir, 1);
@@ -378,7 +653,7 @@ TEST_F(TabletIOTest, SplitToSubTable) {
 
     TabletIO tablet(key_start, key_end);
     EXPECT_TRUE(tablet.Load(TableSchema(), tablet_path, std::vector<uint64_t>(),
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
 
     // prepare test data
     EXPECT_TRUE(PrepareTestData(&tablet, N / 2, 0));
@@ -409,7 +684,7 @@ TEST_F(TabletIOTest, SplitToSubTable) {
     // 1. load sub-table 1
     TabletIO l_tablet(key_start, split_key);
     EXPECT_TRUE(l_tablet.Load(TableSchema(), split_path_1, parent_tablet,
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     l_tablet.GetDataSize(&size, NULL, &status);
     LOG(INFO) << "table[" << key_start << ", " << split_key
         << "]: size = " << size;
@@ -427,7 +702,7 @@ TEST_F(TabletIOTest, SplitToSubTable) {
     // 2. load sub-table 2
     TabletIO r_tablet(split_key, key_end);
     EXPECT_TRUE(r_tablet.Load(TableSchema(), split_path_2, parent_tablet,
-                            empty_snaphsots_, empty_rollback_, NULL, NULL, NULL, &status));
+                            empty_snaphsots_, empty_rollback_, TabletIO::SharedResources(), &status));
     r_tablet.GetDataSize(&size, NULL, &status);
     LOG(INFO) << "table[" << split_key << ", " << key_end
         << "]: size = " << size;
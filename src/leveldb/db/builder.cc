@@ -16,6 +16,7 @@
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
 #include "leveldb/compact_strategy.h"
+#include "leveldb/rate_limiter.h"
 
 namespace leveldb {
 
@@ -38,6 +39,9 @@ Status BuildTable(const std::string& dbname,
     if (!s.ok()) {
       return s;
     }
+    if (options.rate_limiter != NULL) {
+      file = NewRateLimitedFile(file, options.rate_limiter, RateLimiter::kFlush);
+    }
     SequenceNumber snapshot = smallest_snapshot;
 
     CompactStrategy* compact_strategy = NULL;
@@ -0,0 +1,619 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "db/commit_log.h"
+
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/filename.h"
+#include "db/log_reader.h"
+#include "db/log_writer.h"
+#include "db/write_batch_internal.h"
+#include "leveldb/env.h"
+#include "leveldb/write_batch.h"
+#include "util/coding.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+struct CommitLog::PendingRecord {
+    std::string tablet;
+    std::string data;
+    uint64_t last_seq;
+    bool sync;
+    bool done;
+    Status status;
+    std::string file_path;
+};
+
+struct CommitLog::LogFile {
+    uint64_t size;
+    // tablet -> last sequence written into this file
+    std::map<std::string, uint64_t> tablets;
+
+    LogFile() : size(0) {}
+};
+
+struct CommitLog::LogSplit {
+    bool splitting;
+    Status status;
+    uint64_t file_size;
+    uint64_t bytes;
+    uint64_t last_use;
+    // tablet -> its length prefixed records
+    std::map<std::string, std::string> records;
+    // tablets that have not taken their records yet
+    std::set<std::string> pending;
+
+    LogSplit() : splitting(true), file_size(0), bytes(0), last_use(0) {}
+};
+
+class CommitLog::WriterThread : public Thread {
+public:
+    explicit WriterThread(CommitLog* log) : log_(log) {}
+    virtual void Run(void* params) {
+        log_->BackgroundWrite();
+    }
+private:
+    CommitLog* log_;
+};
+
+CommitLog::CommitLog(Env* env, const std::string& log_dir,
+                     uint64_t max_file_size, uint32_t max_file_num)
+    : env_(env), log_dir_(log_dir),
+      max_file_size_(max_file_size), max_file_num_(max_file_num),
+      work_cv_(&mutex_), done_cv_(&mutex_), callback_cv_(&mutex_), stop_(false),
+      writer_thread_(NULL), logfile_(NULL), log_(NULL),
+      logfile_number_(0), logfile_size_(0), running_callbacks_(0),
+      split_bytes_(0), split_clock_(0), split_cv_(&mutex_),
+      orphan_gc_scheduled_(false), orphan_gc_running_(false) {
+}
+
+CommitLog::~CommitLog() {
+    if (writer_thread_) {
+        mutex_.Lock();
+        stop_ = true;
+        work_cv_.SignalAll();
+        mutex_.Unlock();
+        writer_thread_->Join();
+        delete writer_thread_;
+    }
+    mutex_.Lock();
+    while (orphan_gc_scheduled_ || orphan_gc_running_) {
+        split_cv_.Wait();
+    }
+    mutex_.Unlock();
+    delete log_;
+    delete logfile_;
+    // keep files on storage, tablets not dumped yet need them for recovery
+    std::map<uint64_t, LogFile*>::iterator it = files_.begin();
+    for (; it != files_.end(); ++it) {
+        delete it->second;
+    }
+    std::map<std::string, LogSplit*>::iterator split = splits_.begin();
+    for (; split != splits_.end(); ++split) {
+        assert(!split->second->splitting);
+        delete split->second;
+    }
+    std::map<uint64_t, std::set<std::string>*>::iterator orphan = orphans_.begin();
+    for (; orphan != orphans_.end(); ++orphan) {
+        delete orphan->second;
+    }
+}
+
+Status CommitLog::Open() {
+    env_->CreateDir(log_dir_);
+    std::vector<std::string> children;
+    Status s = env_->GetChildren(log_dir_, &children);
+    if (!s.ok()) {
+        Log("[commit log] fail to list %s: %s",
+            log_dir_.c_str(), s.ToString().c_str());
+        return s;
+    }
+    // never reuse numbers of the files left by last run,
+    // tablets recovering on other nodes may still read them
+    for (size_t i = 0; i < children.size(); ++i) {
+        uint64_t number = 0;
+        FileType type = kUnknown;
+        if (ParseFileName(children[i], &number, &type)
+            && type == kCommitLogFile) {
+            orphans_[number] = NULL;
+            if (number > logfile_number_) {
+                logfile_number_ = number;
+            }
+        }
+    }
+    s = RollLogFile();
+    if (!s.ok()) {
+        return s;
+    }
+    writer_thread_ = new WriterThread(this);
+    writer_thread_->Start();
+    Log("[commit log] open %s", logfile_path_.c_str());
+    return s;
+}
+
+Status CommitLog::AddRecord(const std::string& tablet, const Slice& record,
+                            bool sync, std::string* file_path) {
+    WriteBatch batch;
+    WriteBatchInternal::SetContents(&batch, record);
+
+    PendingRecord r;
+    r.tablet = tablet;
+    EncodeRecord(tablet, record, &r.data);
+    r.last_seq = WriteBatchInternal::Sequence(&batch)
+        + WriteBatchInternal::Count(&batch) - 1;
+    r.sync = sync;
+    r.done = false;
+
+    MutexLock lock(&mutex_);
+    if (stop_) {
+        return Status::IOError("commit log stopped");
+    }
+    pending_.push_back(&r);
+    work_cv_.Signal();
+    while (!r.done) {
+        done_cv_.Wait();
+    }
+    if (file_path) {
+        *file_path = r.file_path;
+    }
+    return r.status;
+}
+
+void CommitLog::BackgroundWrite() {
+    std::deque<PendingRecord*> group;
+    while (true) {
+        mutex_.Lock();
+        while (pending_.empty() && !stop_) {
+            work_cv_.Wait();
+        }
+        if (pending_.empty()) {
+            mutex_.Unlock();
+            break;
+        }
+        // group commit: take all records queued while last sync is running
+        group.swap(pending_);
+        mutex_.Unlock();
+
+        Status s;
+        bool need_sync = false;
+        uint64_t bytes = 0;
+        if (log_ == NULL) {
+            s = RollLogFile();
+        }
+        for (size_t i = 0; s.ok() && i < group.size(); ++i) {
+            s = log_->AddRecord(group[i]->data);
+            need_sync = need_sync || group[i]->sync;
+            bytes += group[i]->data.size();
+        }
+        if (s.ok()) {
+            s = need_sync ? logfile_->Sync() : logfile_->Flush();
+        }
+        if (!s.ok()) {
+            Log("[commit log] fail to write %s: %s",
+                logfile_path_.c_str(), s.ToString().c_str());
+        }
+
+        mutex_.Lock();
+        if (s.ok()) {
+            LogFile* file = files_[logfile_number_];
+            file->size += bytes;
+            for (size_t i = 0; i < group.size(); ++i) {
+                uint64_t& last_seq = file->tablets[group[i]->tablet];
+                if (last_seq < group[i]->last_seq) {
+                    last_seq = group[i]->last_seq;
+                }
+            }
+            logfile_size_ += bytes;
+        }
+        for (size_t i = 0; i < group.size(); ++i) {
+            group[i]->status = s;
+            group[i]->file_path = logfile_path_;
+            group[i]->done = true;
+        }
+        group.clear();
+        done_cv_.SignalAll();
+        bool need_roll = !s.ok() || logfile_size_ >= max_file_size_;
+        mutex_.Unlock();
+
+        if (need_roll) {
+            // a failed file is never appended again
+            RollLogFile();
+            NotifyTablets();
+            MaybeScheduleOrphanGC();
+        }
+    }
+}
+
+Status CommitLog::RollLogFile() {
+    uint64_t number = logfile_number_ + 1;
+    std::string path = LogFilePath(number);
+    WritableFile* file = NULL;
+    Status s = env_->NewWritableFile(path, &file);
+    delete log_;
+    delete logfile_;
+    log_ = NULL;
+    logfile_ = NULL;
+    if (!s.ok()) {
+        Log("[commit log] fail to open %s: %s", path.c_str(), s.ToString().c_str());
+        return s;
+    }
+
+    MutexLock lock(&mutex_);
+    logfile_ = file;
+    log_ = new log::Writer(file);
+    logfile_number_ = number;
+    logfile_size_ = 0;
+    logfile_path_ = path;
+    files_[number] = new LogFile;
+    return s;
+}
+
+void CommitLog::NotifyTablets() {
+    std::vector<TabletCallback> callbacks;
+    std::vector<bool> need_flush;
+    {
+        MutexLock lock(&mutex_);
+        if (files_.size() <= 1) {
+            return;
+        }
+        LogFile* oldest = files_.begin()->second;
+        bool too_many = files_.size() > max_file_num_;
+        std::map<std::string, TabletCallback>::iterator it = tablets_.begin();
+        for (; it != tablets_.end(); ++it) {
+            // tablets may release the sealed files they wrote
+            bool sealed = false;
+            std::map<uint64_t, LogFile*>::iterator f = files_.begin();
+            for (; f != files_.end() && f->first != logfile_number_; ++f) {
+                if (f->second->tablets.find(it->first) != f->second->tablets.end()) {
+                    sealed = true;
+                    break;
+                }
+            }
+            if (!sealed) {
+                continue;
+            }
+            callbacks.push_back(it->second);
+            need_flush.push_back(too_many &&
+                oldest->tablets.find(it->first) != oldest->tablets.end());
+        }
+        ++running_callbacks_;
+    }
+
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+        (*callbacks[i].callback)(callbacks[i].arg, need_flush[i]);
+    }
+
+    MutexLock lock(&mutex_);
+    --running_callbacks_;
+    callback_cv_.SignalAll();
+}
+
+void CommitLog::Release(const std::string& tablet, uint64_t seq) {
+    {
+        MutexLock lock(&mutex_);
+        std::map<uint64_t, LogFile*>::iterator it = files_.begin();
+        for (; it != files_.end(); ++it) {
+            std::map<std::string, uint64_t>& tablets = it->second->tablets;
+            std::map<std::string, uint64_t>::iterator t = tablets.find(tablet);
+            if (t != tablets.end() && t->second <= seq) {
+                tablets.erase(t);
+            }
+        }
+    }
+    MaybeDeleteFiles();
+}
+
+void CommitLog::MaybeDeleteFiles() {
+    std::vector<uint64_t> obsolete;
+    {
+        MutexLock lock(&mutex_);
+        std::map<uint64_t, LogFile*>::iterator it = files_.begin();
+        while (it != files_.end()) {
+            if (it->first != logfile_number_ && it->second->tablets.empty()) {
+                obsolete.push_back(it->first);
+                delete it->second;
+                files_.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (size_t i = 0; i < obsolete.size(); ++i) {
+        std::string path = LogFilePath(obsolete[i]);
+        Status s = env_->DeleteFile(path);
+        Log("[commit log] delete %s: %s", path.c_str(), s.ToString().c_str());
+    }
+}
+
+void CommitLog::RegisterTablet(const std::string& tablet,
+                               ReleaseCallback callback, void* arg) {
+    MutexLock lock(&mutex_);
+    TabletCallback& cb = tablets_[tablet];
+    cb.callback = callback;
+    cb.arg = arg;
+}
+
+void CommitLog::UnregisterTablet(const std::string& tablet) {
+    MutexLock lock(&mutex_);
+    tablets_.erase(tablet);
+    while (running_callbacks_ > 0) {
+        callback_cv_.Wait();
+    }
+}
+
+uint64_t CommitLog::LiveFileNum() {
+    MutexLock lock(&mutex_);
+    return files_.size();
+}
+
+uint64_t CommitLog::OrphanFileNum() {
+    MutexLock lock(&mutex_);
+    return orphans_.size();
+}
+
+Status CommitLog::ReadTabletRecords(const std::string& log_path,
+                                    const std::string& tablet,
+                                    std::string* records) {
+    uint64_t file_size = 0;
+    Status s = env_->GetFileSize(log_path, &file_size);
+    if (!s.ok()) {
+        return s;
+    }
+
+    MutexLock lock(&mutex_);
+    LogSplit* split = NULL;
+    while (true) {
+        std::map<std::string, LogSplit*>::iterator it = splits_.find(log_path);
+        if (it == splits_.end()) {
+            break;
+        }
+        split = it->second;
+        if (split->splitting) {
+            split_cv_.Wait();
+            continue;
+        }
+        if (split->file_size == file_size) {
+            break;
+        }
+        // the file has grown since split, it was still being written
+        split_bytes_ -= split->bytes;
+        delete split;
+        splits_.erase(it);
+        split = NULL;
+    }
+
+    if (split == NULL) {
+        split = new LogSplit;
+        splits_[log_path] = split;
+        mutex_.Unlock();
+        std::map<std::string, std::string> split_records;
+        Status split_status = SplitLogFile(env_, log_path, NULL, &split_records);
+        uint64_t bytes = 0;
+        std::map<std::string, std::string>::iterator r = split_records.begin();
+        for (; r != split_records.end(); ++r) {
+            bytes += r->second.size();
+            split->pending.insert(r->first);
+        }
+        mutex_.Lock();
+        split->records.swap(split_records);
+        split->status = split_status;
+        split->file_size = file_size;
+        split->bytes = bytes;
+        split->splitting = false;
+        split_bytes_ += bytes;
+        split_cv_.SignalAll();
+        Log("[commit log] split %s: %lu tablets, %lu bytes, %s",
+            log_path.c_str(), split->records.size(), bytes,
+            split_status.ToString().c_str());
+    }
+
+    split->last_use = ++split_clock_;
+    std::map<std::string, std::string>::iterator it = split->records.find(tablet);
+    if (it != split->records.end()) {
+        records->assign(it->second);
+    } else {
+        records->clear();
+    }
+    s = split->status;
+    // records are kept until every tablet has taken them, in case a failed
+    // load is retried
+    split->pending.erase(tablet);
+    if (split->pending.empty()) {
+        split_bytes_ -= split->bytes;
+        delete split;
+        splits_.erase(log_path);
+    }
+    EvictSplits();
+    return s;
+}
+
+// Drop least recently used splits beyond the memory budget, records of
+// tablets served by other nodes are never taken here.
+void CommitLog::EvictSplits() {
+    mutex_.AssertHeld();
+    const uint64_t max_split_bytes = 4 * max_file_size_;
+    while (split_bytes_ > max_split_bytes) {
+        std::map<std::string, LogSplit*>::iterator victim = splits_.end();
+        std::map<std::string, LogSplit*>::iterator it = splits_.begin();
+        for (; it != splits_.end(); ++it) {
+            if (!it->second->splitting
+                && (victim == splits_.end()
+                    || it->second->last_use < victim->second->last_use)) {
+                victim = it;
+            }
+        }
+        if (victim == splits_.end()) {
+            break;
+        }
+        split_bytes_ -= victim->second->bytes;
+        delete victim->second;
+        splits_.erase(victim);
+    }
+}
+
+Status CommitLog::SplitLogFile(Env* env, const std::string& path,
+                               const std::string* tablet,
+                               std::map<std::string, std::string>* records) {
+    struct LogReporter : public log::Reader::Reporter {
+        const char* fname;
+        Status status;
+        virtual void Corruption(size_t bytes, const Status& s) {
+            Log("[commit log] %s: dropping %d bytes; %s",
+                fname, static_cast<int>(bytes), s.ToString().c_str());
+            if (status.ok()) {
+                status = s;
+            }
+        }
+    };
+
+    SequentialFile* file;
+    Status s = env->NewSequentialFile(path, &file);
+    if (!s.ok()) {
+        return s;
+    }
+    LogReporter reporter;
+    reporter.fname = path.c_str();
+    log::Reader reader(file, &reporter, true/*checksum*/, 0/*initial_offset*/);
+    std::string scratch;
+    Slice record;
+    while (reader.ReadRecord(&record, &scratch)) {
+        Slice record_tablet;
+        if (!DecodeRecord(&record, &record_tablet) || record.size() < 12) {
+            reporter.Corruption(record.size(),
+                                Status::Corruption("commit log record too small"));
+            continue;
+        }
+        if (tablet != NULL && record_tablet != *tablet) {
+            continue;
+        }
+        PutLengthPrefixedSlice(&(*records)[record_tablet.ToString()], record);
+    }
+    delete file;
+    return reporter.status;
+}
+
+void CommitLog::MaybeScheduleOrphanGC() {
+    MutexLock lock(&mutex_);
+    if (orphans_.empty() || orphan_gc_scheduled_ || stop_) {
+        return;
+    }
+    orphan_gc_scheduled_ = true;
+    env_->Schedule(&CommitLog::OrphanGCWrapper, this);
+}
+
+void CommitLog::OrphanGCWrapper(void* arg) {
+    CommitLog* log = reinterpret_cast<CommitLog*>(arg);
+    log->DeleteOrphanFiles();
+    MutexLock lock(&log->mutex_);
+    log->orphan_gc_scheduled_ = false;
+    log->split_cv_.SignalAll();
+}
+
+void CommitLog::DeleteOrphanFiles() {
+    std::map<uint64_t, std::set<std::string>*> orphans;
+    {
+        MutexLock lock(&mutex_);
+        while (orphan_gc_running_) {
+            split_cv_.Wait();
+        }
+        orphan_gc_running_ = true;
+        orphans = orphans_;
+    }
+
+    std::map<uint64_t, std::set<std::string>*> loaded;
+    std::vector<uint64_t> obsolete;
+    std::map<uint64_t, std::set<std::string>*>::iterator it = orphans.begin();
+    for (; it != orphans.end(); ++it) {
+        std::string path = LogFilePath(it->first);
+        std::set<std::string>* tablets = it->second;
+        if (tablets == NULL) {
+            // learn once which tablets may refer to the file
+            std::map<std::string, std::string> records;
+            Status s = SplitLogFile(env_, path, NULL, &records);
+            if (!s.ok() && env_->FileExists(path)) {
+                Log("[commit log] fail to read orphan %s: %s",
+                    path.c_str(), s.ToString().c_str());
+                continue;
+            }
+            tablets = new std::set<std::string>;
+            std::map<std::string, std::string>::iterator r = records.begin();
+            for (; r != records.end(); ++r) {
+                tablets->insert(r->first);
+            }
+            loaded[it->first] = tablets;
+        }
+        bool referred = false;
+        std::set<std::string>::iterator t = tablets->begin();
+        for (; t != tablets->end() && !referred; ++t) {
+            referred = HasTabletRef(*t, path);
+        }
+        if (!referred) {
+            obsolete.push_back(it->first);
+        }
+    }
+    for (size_t i = 0; i < obsolete.size(); ++i) {
+        std::string path = LogFilePath(obsolete[i]);
+        Status s = env_->DeleteFile(path);
+        Log("[commit log] delete orphan %s: %s", path.c_str(), s.ToString().c_str());
+    }
+
+    MutexLock lock(&mutex_);
+    std::map<uint64_t, std::set<std::string>*>::iterator l = loaded.begin();
+    for (; l != loaded.end(); ++l) {
+        orphans_[l->first] = l->second;
+    }
+    for (size_t i = 0; i < obsolete.size(); ++i) {
+        delete orphans_[obsolete[i]];
+        orphans_.erase(obsolete[i]);
+    }
+    orphan_gc_running_ = false;
+    split_cv_.SignalAll();
+}
+
+// Return true if a commit log ref of "tablet" points to "path", or if it
+// can not be told for sure.
+bool CommitLog::HasTabletRef(const std::string& tablet, const std::string& path) {
+    if (!env_->FileExists(tablet)) {
+        // tablet deleted, or merged & split with its memtable dumped
+        return false;
+    }
+    std::vector<std::string> children;
+    if (!env_->GetChildren(tablet, &children).ok()) {
+        return true;
+    }
+    for (size_t i = 0; i < children.size(); ++i) {
+        uint64_t number = 0;
+        FileType type = kUnknown;
+        if (!ParseFileName(children[i], &number, &type) || type != kCommitLogRefFile) {
+            continue;
+        }
+        std::string ref_path;
+        Status s = ReadFileToString(env_, CommitLogRefFileName(tablet, number), &ref_path);
+        if (!s.ok() || ref_path == path) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CommitLog::EncodeRecord(const std::string& tablet, const Slice& record,
+                             std::string* dst) {
+    dst->clear();
+    dst->reserve(tablet.size() + record.size() + 5);
+    PutLengthPrefixedSlice(dst, tablet);
+    dst->append(record.data(), record.size());
+}
+
+bool CommitLog::DecodeRecord(Slice* input, Slice* tablet) {
+    return GetLengthPrefixedSlice(input, tablet);
+}
+
+std::string CommitLog::LogFilePath(uint64_t number) const {
+    return CommitLogFileName(log_dir_, number);
+}
+
+}  // namespace leveldb
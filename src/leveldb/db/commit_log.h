@@ -0,0 +1,167 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef STORAGE_LEVELDB_DB_COMMIT_LOG_H_
+#define STORAGE_LEVELDB_DB_COMMIT_LOG_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+#include "port/port.h"
+#include "util/thread.h"
+
+namespace leveldb {
+
+class Env;
+class WritableFile;
+
+namespace log {
+class Writer;
+}
+
+// A node-wide write-ahead log shared by all tablets (DBTables) opened with
+// the same CommitLog in their options.
+//
+// Every record is tagged with the name of the tablet that wrote it, and all
+// pending records are appended and synced by one background thread in a
+// single group commit, so a node serving thousands of tablets issues one
+// sequential stream of appends instead of one log file per tablet.
+//
+// Log files are named "<log_dir>/H<hex number>.clog" and rolled when they
+// exceed the configured size. A file is deleted once every tablet that wrote
+// to it has released it, i.e. has dumped the corresponding memtable to sst.
+// Tablets pinning old files are asked to flush when too many files are live.
+// Files left by a previous run are deleted once no tablet refers to them.
+//
+// A tablet recovering from a shared file reads it through the CommitLog of
+// the node it is loaded on, which reads and splits the file by tablet once
+// for all the tablets it serves.
+class CommitLog {
+public:
+    // Called when a tablet should check what it can release, "need_flush"
+    // is true if the tablet is pinning the oldest live log file.
+    typedef void (*ReleaseCallback)(void* arg, bool need_flush);
+
+    CommitLog(Env* env, const std::string& log_dir,
+              uint64_t max_file_size, uint32_t max_file_num);
+    ~CommitLog();
+
+    // Create log dir and open the first log file.
+    Status Open();
+
+    // Append a record on behalf of "tablet" and wait until it is persisted.
+    // On success, "*file_path" is set to the log file holding the record.
+    Status AddRecord(const std::string& tablet, const Slice& record,
+                     bool sync, std::string* file_path);
+
+    // Records of "tablet" with sequence up to "seq" are persisted in sst,
+    // files that are no longer needed by any tablet will be deleted.
+    void Release(const std::string& tablet, uint64_t seq);
+
+    void RegisterTablet(const std::string& tablet,
+                        ReleaseCallback callback, void* arg);
+    // Wait until no callback of "tablet" is running.
+    void UnregisterTablet(const std::string& tablet);
+
+    // Encode & decode a record of the shared log file.
+    static void EncodeRecord(const std::string& tablet, const Slice& record,
+                             std::string* dst);
+    static bool DecodeRecord(Slice* input, Slice* tablet);
+
+    // Set "*records" to the records of "tablet" in the log file "log_path",
+    // each prefixed by its length. The file is split by tablet on the first
+    // call, the other tablets recovering from it take their records from the
+    // split until it is evicted.
+    Status ReadTabletRecords(const std::string& log_path,
+                             const std::string& tablet, std::string* records);
+
+    // Read log file "path" and append the length prefixed records of each
+    // tablet to "(*records)[tablet]". If "tablet" is non-NULL, records of
+    // the other tablets are skipped.
+    static Status SplitLogFile(Env* env, const std::string& path,
+                               const std::string* tablet,
+                               std::map<std::string, std::string>* records);
+
+    // Delete the files left by previous runs that are not referred to by any
+    // tablet any more, i.e. all tablets with records in them have recovered.
+    void DeleteOrphanFiles();
+
+    uint64_t LiveFileNum();
+    uint64_t OrphanFileNum();
+
+private:
+    struct PendingRecord;
+    struct LogFile;
+    struct LogSplit;
+    class WriterThread;
+
+    void BackgroundWrite();
+    Status RollLogFile();
+    void NotifyTablets();
+    void MaybeDeleteFiles();
+    void EvictSplits();
+    void MaybeScheduleOrphanGC();
+    static void OrphanGCWrapper(void* arg);
+    bool HasTabletRef(const std::string& tablet, const std::string& path);
+
+    std::string LogFilePath(uint64_t number) const;
+
+private:
+    Env* const env_;
+    const std::string log_dir_;
+    const uint64_t max_file_size_;
+    const uint32_t max_file_num_;
+
+    port::Mutex mutex_;
+    port::CondVar work_cv_;
+    port::CondVar done_cv_;
+    port::CondVar callback_cv_;
+    bool stop_;
+    WriterThread* writer_thread_;
+
+    std::deque<PendingRecord*> pending_;
+
+    // the file being written, only accessed by writer thread
+    WritableFile* logfile_;
+    log::Writer* log_;
+    uint64_t logfile_number_;
+    uint64_t logfile_size_;
+    std::string logfile_path_;
+
+    // number -> live log file, include the one being written
+    std::map<uint64_t, LogFile*> files_;
+
+    struct TabletCallback {
+        ReleaseCallback callback;
+        void* arg;
+    };
+    std::map<std::string, TabletCallback> tablets_;
+    int running_callbacks_;
+
+    // log path -> records of the file split by tablet
+    std::map<std::string, LogSplit*> splits_;
+    uint64_t split_bytes_;
+    uint64_t split_clock_;
+    port::CondVar split_cv_;
+
+    // number -> tablets with records in it, of the files left by previous
+    // runs, NULL until the file is read by DeleteOrphanFiles()
+    std::map<uint64_t, std::set<std::string>*> orphans_;
+    bool orphan_gc_scheduled_;
+    bool orphan_gc_running_;
+
+    // No copying allowed
+    CommitLog(const CommitLog&);
+    void operator=(const CommitLog&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_COMMIT_LOG_H_
@@ -0,0 +1,246 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "db/commit_log.h"
+
+#include "db/dbformat.h"
+#include "db/filename.h"
+#include "db/write_batch_internal.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "leveldb/write_batch.h"
+#include "port/port.h"
+#include "util/coding.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class CommitLogTest {
+ public:
+  std::string dir_;
+  Env* env_;
+
+  CommitLogTest() : env_(Env::Default()) {
+    dir_ = test::TmpDir() + "/commit_log_test";
+    DeleteAll(dir_);
+  }
+
+  ~CommitLogTest() {
+    DeleteAll(dir_);
+  }
+
+  void DeleteAll(const std::string& dir) {
+    std::vector<std::string> children;
+    env_->GetChildren(dir, &children);
+    for (size_t i = 0; i < children.size(); ++i) {
+      if (children[i] == "." || children[i] == "..") {
+        continue;
+      }
+      std::string path = dir + "/" + children[i];
+      if (env_->DeleteFile(path).ok()) {
+        continue;
+      }
+      DeleteAll(path);
+    }
+    env_->DeleteDir(dir);
+  }
+
+  std::string MakeRecord(uint64_t seq, int count) {
+    WriteBatch batch;
+    for (int i = 0; i < count; ++i) {
+      batch.Put("key", "value");
+    }
+    WriteBatchInternal::SetSequence(&batch, seq);
+    return WriteBatchInternal::Contents(&batch).ToString();
+  }
+
+  int CountFiles(const std::string& dir, FileType want) {
+    std::vector<std::string> children;
+    env_->GetChildren(dir, &children);
+    int n = 0;
+    for (size_t i = 0; i < children.size(); ++i) {
+      uint64_t number;
+      FileType type;
+      if (ParseFileName(children[i], &number, &type) && type == want) {
+        ++n;
+      }
+    }
+    return n;
+  }
+};
+
+TEST(CommitLogTest, EncodeDecode) {
+  std::string record = MakeRecord(100, 3);
+  std::string data;
+  CommitLog::EncodeRecord("tablet00000001", record, &data);
+  Slice input(data);
+  Slice tablet;
+  ASSERT_TRUE(CommitLog::DecodeRecord(&input, &tablet));
+  ASSERT_EQ("tablet00000001", tablet.ToString());
+  ASSERT_EQ(record, input.ToString());
+}
+
+struct Notification {
+  port::Mutex mu;
+  port::CondVar cv;
+  bool called;
+
+  Notification() : cv(&mu), called(false) { }
+
+  void Wait() {
+    MutexLock l(&mu);
+    while (!called) {
+      cv.Wait();
+    }
+  }
+};
+
+static void MarkCallback(void* arg, bool need_flush) {
+  Notification* n = reinterpret_cast<Notification*>(arg);
+  MutexLock l(&n->mu);
+  n->called = true;
+  n->cv.SignalAll();
+}
+
+TEST(CommitLogTest, RollAndRelease) {
+  // every group commit exceeds the file size and rolls a new file
+  CommitLog log(env_, dir_, 1, 16);
+  ASSERT_OK(log.Open());
+  Notification called_a;
+  Notification called_b;
+  log.RegisterTablet("a", MarkCallback, &called_a);
+  log.RegisterTablet("b", MarkCallback, &called_b);
+
+  std::string path1, path2;
+  ASSERT_OK(log.AddRecord("a", MakeRecord(1, 10), false, &path1));
+  ASSERT_OK(log.AddRecord("b", MakeRecord(1, 10), true, &path2));
+  ASSERT_TRUE(path1 != path2);
+  // files are rolled and then tablets notified after the writes are acked
+  called_a.Wait();
+  called_b.Wait();
+  ASSERT_EQ(3, static_cast<int>(log.LiveFileNum()));
+
+  // not all records of "a" are dumped, keep the file
+  log.Release("a", 5);
+  ASSERT_EQ(3, static_cast<int>(log.LiveFileNum()));
+  log.Release("a", 10);
+  ASSERT_EQ(2, static_cast<int>(log.LiveFileNum()));
+  ASSERT_TRUE(!env_->FileExists(path1));
+  log.Release("b", kMaxSequenceNumber);
+  ASSERT_EQ(1, static_cast<int>(log.LiveFileNum()));
+  ASSERT_EQ(1, CountFiles(dir_, kCommitLogFile));
+
+  log.UnregisterTablet("a");
+  log.UnregisterTablet("b");
+}
+
+TEST(CommitLogTest, DBTableReopen) {
+  std::string log_dir = dir_ + "/log";
+  env_->CreateDir(dir_);
+  CommitLog log(env_, log_dir, 1 << 20, 16);
+  ASSERT_OK(log.Open());
+
+  Options options;
+  options.commit_log = &log;
+  std::string dbname = dir_ + "/tablet00000001";
+
+  DB* db = NULL;
+  ASSERT_OK(DB::Open(options, dbname, &db));
+  ASSERT_OK(db->Put(WriteOptions(), "k1", "v1"));
+  ASSERT_OK(db->Put(WriteOptions(), "k2", "v2"));
+  ASSERT_EQ(1, CountFiles(dbname, kCommitLogRefFile));
+  ASSERT_EQ(0, CountFiles(dbname, kLogFile));
+  delete db;
+
+  ASSERT_OK(DB::Open(options, dbname, &db));
+  std::string value;
+  ASSERT_OK(db->Get(ReadOptions(), "k1", &value));
+  ASSERT_EQ("v1", value);
+  ASSERT_OK(db->Get(ReadOptions(), "k2", &value));
+  ASSERT_EQ("v2", value);
+  delete db;
+}
+
+TEST(CommitLogTest, SplitByTablet) {
+  CommitLog log(env_, dir_, 1 << 20, 16);
+  ASSERT_OK(log.Open());
+  std::string rec_a1 = MakeRecord(1, 1);
+  std::string rec_b = MakeRecord(1, 2);
+  std::string rec_a2 = MakeRecord(2, 3);
+  std::string path;
+  ASSERT_OK(log.AddRecord("a", rec_a1, true, &path));
+  ASSERT_OK(log.AddRecord("b", rec_b, true, &path));
+  ASSERT_OK(log.AddRecord("a", rec_a2, true, &path));
+
+  std::string records;
+  ASSERT_OK(log.ReadTabletRecords(path, "a", &records));
+  Slice input(records);
+  Slice record;
+  ASSERT_TRUE(GetLengthPrefixedSlice(&input, &record));
+  ASSERT_EQ(rec_a1, record.ToString());
+  ASSERT_TRUE(GetLengthPrefixedSlice(&input, &record));
+  ASSERT_EQ(rec_a2, record.ToString());
+  ASSERT_TRUE(input.empty());
+
+  // the file grows after it was split, the new record is not missed
+  std::string rec_b2 = MakeRecord(2, 1);
+  ASSERT_OK(log.AddRecord("b", rec_b2, true, &path));
+  ASSERT_OK(log.ReadTabletRecords(path, "b", &records));
+  input = records;
+  ASSERT_TRUE(GetLengthPrefixedSlice(&input, &record));
+  ASSERT_EQ(rec_b, record.ToString());
+  ASSERT_TRUE(GetLengthPrefixedSlice(&input, &record));
+  ASSERT_EQ(rec_b2, record.ToString());
+  ASSERT_TRUE(input.empty());
+
+  // a retried load reads its records again
+  ASSERT_OK(log.ReadTabletRecords(path, "a", &records));
+  input = records;
+  ASSERT_TRUE(GetLengthPrefixedSlice(&input, &record));
+  ASSERT_EQ(rec_a1, record.ToString());
+
+  ASSERT_OK(log.ReadTabletRecords(path, "c", &records));
+  ASSERT_TRUE(records.empty());
+}
+
+TEST(CommitLogTest, DeleteOrphanFiles) {
+  std::string log_dir = dir_ + "/log";
+  std::string tablet = dir_ + "/tablet00000001";
+  env_->CreateDir(dir_);
+  env_->CreateDir(tablet);
+  std::string record = MakeRecord(1, 1);
+  std::string path;
+  {
+    CommitLog log(env_, log_dir, 1 << 20, 16);
+    ASSERT_OK(log.Open());
+    ASSERT_OK(log.AddRecord(tablet, record, true, &path));
+    ASSERT_OK(WriteStringToFile(env_, path, CommitLogRefFileName(tablet, 1)));
+    // "tablet00000002" is gone, its records are not needed
+    ASSERT_OK(log.AddRecord(dir_ + "/tablet00000002", record, true, &path));
+  }
+
+  CommitLog log(env_, log_dir, 1 << 20, 16);
+  ASSERT_OK(log.Open());
+  ASSERT_EQ(1, static_cast<int>(log.OrphanFileNum()));
+  log.DeleteOrphanFiles();
+  ASSERT_TRUE(env_->FileExists(path));
+  ASSERT_EQ(1, static_cast<int>(log.OrphanFileNum()));
+
+  // the tablet has recovered
+  std::string records;
+  ASSERT_OK(log.ReadTabletRecords(path, tablet, &records));
+  ASSERT_EQ(record.size() + 1, records.size());
+  ASSERT_OK(env_->DeleteFile(CommitLogRefFileName(tablet, 1)));
+  log.DeleteOrphanFiles();
+  ASSERT_TRUE(!env_->FileExists(path));
+  ASSERT_EQ(0, static_cast<int>(log.OrphanFileNum()));
+  ASSERT_EQ(1, CountFiles(log_dir, kCommitLogFile));
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
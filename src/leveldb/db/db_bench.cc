@@ -9,13 +9,18 @@
 #include <sys/types.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
 #include "db/db_impl.h"
 #include "db/version_set.h"
 #include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/raw_key_operator.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
+#include "table/block_builder.h"
 #include "util/crc32c.h"
 #include "util/histogram.h"
 #include "util/mutexlock.h"
@@ -43,6 +48,8 @@
 //      seekrandom    -- N random seeks
 //      crc32c        -- repeated crc32c of 4K of data
 //      acquireload   -- load N*1000 times
+//      rowcodecs     -- ratio and decode speed of each codec on blocks of N
+//                       tera cells (--num_rows wide rows), not run by default
 //   Meta operations:
 //      compact     -- Compact the entire DB
 //      stats       -- Print DB stats
@@ -110,9 +117,15 @@ static const char* FLAGS_env = NULL;
 // disable WAL
 static bool FLAGS_disable_wal = false;
 
-// compress
+// compress: 0 none, 1 snappy, 2 bmz, 3 lz4, 4 zstd
 static int FLAGS_compress = 0;
 
+// zstd dictionary size, 0 for no dictionary
+static int FLAGS_compression_dict_size = 16384;
+
+// Number of rows the cells of rowcodecs are spread over
+static int FLAGS_num_rows = 1000;
+
 // block size
 static int FLAGS_block_size = 4096;
 
@@ -524,6 +537,8 @@ class Benchmark {
         method = &Benchmark::SnappyCompress;
       } else if (name == Slice("snappyuncomp")) {
         method = &Benchmark::SnappyUncompress;
+      } else if (name == Slice("rowcodecs")) {
+        method = &Benchmark::RowCodecs;
 #ifdef USE_COMPRESS_EXT
       } else if (name == Slice("lz4comp")) {
         method = &Benchmark::LZ4Compress;
@@ -822,6 +837,161 @@ class Benchmark {
   }
 #endif
 
+  static bool CompressBlock(CompressionType type, const Slice& raw,
+                            port::ZstdCompressor* zstd, bool use_dict,
+                            std::string* output) {
+    switch (type) {
+      case kSnappyCompression:
+        return port::Snappy_Compress(raw.data(), raw.size(), output);
+      case kZstdCompression:
+        return zstd->Compress(raw.data(), raw.size(), use_dict, output);
+      default:
+        output->assign(raw.data(), raw.size());
+        return true;
+    }
+  }
+
+  static bool UncompressBlock(CompressionType type, const Slice& input,
+                              const port::ZstdUncompressDict* dict,
+                              char* output, size_t output_size) {
+    switch (type) {
+      case kSnappyCompression:
+        return port::Snappy_Uncompress(input.data(), input.size(), output);
+      case kZstdCompression:
+        return port::Zstd_Uncompress(input.data(), input.size(), dict,
+                                     output, output_size);
+      default:
+        memcpy(output, input.data(), input.size());
+        return true;
+    }
+  }
+
+  // Data blocks as tabletnodes write them: readable tera keys of
+  // FLAGS_num_rows wide rows, values as compressible as
+  // FLAGS_compression_ratio.
+  void BuildRowBlocks(std::vector<std::string>* blocks) {
+    RandomGenerator gen;
+    const RawKeyOperator* key_operator = ReadableRawKeyOperator();
+    Options options;
+    options.block_size = FLAGS_block_size;
+    BlockBuilder builder(&options);
+    int num_rows = FLAGS_num_rows > 0 ? FLAGS_num_rows : 1;
+    int cells_per_row = (num_ + num_rows - 1) / num_rows;
+    std::string tera_key;
+    char row[32];
+    char qualifier[32];
+    for (int i = 0; i < num_; i++) {
+      snprintf(row, sizeof(row), "user%012d", i / cells_per_row);
+      snprintf(qualifier, sizeof(qualifier), "field%08d", i % cells_per_row);
+      key_operator->EncodeTeraKey(row, "cf", qualifier, 1, TKT_VALUE, &tera_key);
+      InternalKey ikey(tera_key, i, kTypeValue);
+      builder.Add(ikey.Encode(), gen.Generate(value_size_));
+      if (builder.CurrentSizeEstimate() >= options.block_size) {
+        blocks->push_back(builder.Finish().ToString());
+        builder.Reset();
+      }
+    }
+    if (!builder.empty()) {
+      blocks->push_back(builder.Finish().ToString());
+    }
+  }
+
+  void RowCodecs(ThreadState* thread) {
+    std::vector<std::string> blocks;
+    BuildRowBlocks(&blocks);
+    size_t raw_bytes = 0;
+    size_t max_block = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+      raw_bytes += blocks[i].size();
+      max_block = std::max(max_block, blocks[i].size());
+    }
+    if (blocks.empty()) {
+      thread->stats.AddMessage("(no block)");
+      return;
+    }
+
+    // trained like TableBuilder does it, on the first blocks, and
+    // digested once for all the blocks
+    std::string dict;
+    port::ZstdCompressor zstd;
+    port::ZstdUncompressDict* udict = NULL;
+    if (FLAGS_compression_dict_size > 0) {
+      std::string samples;
+      std::vector<size_t> sample_sizes;
+      for (size_t i = 0; i < blocks.size() &&
+           samples.size() < FLAGS_compression_dict_size * 32u; i++) {
+        samples.append(blocks[i]);
+        sample_sizes.push_back(blocks[i].size());
+      }
+      if (port::Zstd_TrainDict(samples, sample_sizes,
+                               FLAGS_compression_dict_size, &dict) &&
+          zstd.SetDict(dict.data(), dict.size())) {
+        udict = new port::ZstdUncompressDict(dict.data(), dict.size());
+      }
+    }
+
+    struct Codec {
+      const char* name;
+      CompressionType type;
+      bool use_dict;
+    };
+    const Codec codecs[] = {
+      { "none", kNoCompression, false },
+      { "snappy", kSnappyCompression, false },
+      { "zstd", kZstdCompression, false },
+      { "zstd-dict", kZstdCompression, true },
+    };
+    char* output = new char[max_block];
+    int64_t decoded_bytes = 0;
+    fprintf(stdout, "rowcodecs    : %d blocks, %.1f MB raw\n",
+            static_cast<int>(blocks.size()), raw_bytes / 1048576.0);
+    for (size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) {
+      const Codec& codec = codecs[c];
+      const port::ZstdUncompressDict* codec_dict =
+          codec.use_dict ? udict : NULL;
+      if (codec.use_dict && udict == NULL) {
+        fprintf(stdout, "%-12s : no dictionary\n", codec.name);
+        continue;
+      }
+      std::vector<std::string> compressed(blocks.size());
+      size_t compressed_bytes = 0;
+      bool ok = true;
+      for (size_t i = 0; ok && i < blocks.size(); i++) {
+        ok = CompressBlock(codec.type, blocks[i], &zstd, codec.use_dict,
+                           &compressed[i]);
+        compressed_bytes += compressed[i].size();
+      }
+      if (!ok) {
+        fprintf(stdout, "%-12s : not supported\n", codec.name);
+        continue;
+      }
+
+      // decode the blocks over and over, at least 256MB
+      int64_t bytes = 0;
+      uint64_t start = Env::Default()->NowMicros();
+      while (ok && bytes < 256 * 1048576) {
+        for (size_t i = 0; ok && i < blocks.size(); i++) {
+          ok = UncompressBlock(codec.type, compressed[i], codec_dict,
+                               output, blocks[i].size());
+          bytes += blocks[i].size();
+          thread->stats.FinishedSingleOp();
+        }
+      }
+      uint64_t micros = Env::Default()->NowMicros() - start;
+      decoded_bytes += bytes;
+      if (!ok) {
+        fprintf(stdout, "%-12s : decode failure\n", codec.name);
+        continue;
+      }
+      fprintf(stdout, "%-12s : output %5.1f%%, decode %8.1f MB/s\n",
+              codec.name, compressed_bytes * 100.0 / raw_bytes,
+              micros > 0 ? bytes / 1.048576 / micros : 0.0);
+    }
+    delete[] output;
+    delete udict;
+    thread->stats.AddBytes(decoded_bytes);
+  }
+
   CompressionType NumToCompressionType(int n) {
     if (n == 1) {
         return kSnappyCompression;
@@ -829,6 +999,8 @@ class Benchmark {
         return kBmzCompression;
     } else if (n == 3) {
         return kLZ4Compression;
+    } else if (n == 4) {
+        return kZstdCompression;
     } else {
         return kNoCompression;
     }
@@ -843,6 +1015,7 @@ class Benchmark {
     options.filter_policy = filter_policy_;
     options.block_size = FLAGS_block_size;
     options.compression = NumToCompressionType(FLAGS_compress);
+    options.compression_dict_size = FLAGS_compression_dict_size;
     Status log_s = Env::Default()->NewLogger("./ldblog", &options.info_log);
     if (FLAGS_env == NULL) {
         // do nothing
@@ -1105,8 +1278,13 @@ int main(int argc, char** argv) {
                (n == 0 || n == 1)) {
       FLAGS_disable_wal = n;
     } else if (sscanf(argv[i], "--compress=%d%c", &n, &junk) == 1 &&
-               (n == 0 || n == 1 || n == 2 || n == 3)) {
+               (n >= 0 && n <= 4)) {
       FLAGS_compress = n;
+    } else if (sscanf(argv[i], "--compression_dict_size=%d%c", &n, &junk) == 1 &&
+               n >= 0) {
+      FLAGS_compression_dict_size = n;
+    } else if (sscanf(argv[i], "--num_rows=%d%c", &n, &junk) == 1) {
+      FLAGS_num_rows = n;
     } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
       FLAGS_num = n;
     } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
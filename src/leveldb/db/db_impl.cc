@@ -30,6 +30,7 @@
 #include "leveldb/db.h"
 #include "leveldb/compact_strategy.h"
 #include "leveldb/env.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/status.h"
 #include "leveldb/table.h"
 #include "leveldb/table_builder.h"
@@ -41,15 +42,35 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "../utils/counter.h"
 
 namespace leveldb {
 
+// writes delayed or stopped for too many level-0 files
+tera::Counter l0_write_stall_counter;
+// writes stopped until the full imm_ is dumped
+tera::Counter mem_write_stall_counter;
+
 const int kNumNonTableCacheFiles = 10;
 
+// Seek stats are charged on one Get() out of kReadStatsSampleInterval of
+// each thread, weighing all of them, so that reads rarely take mutex_.
+const int kReadStatsSampleInterval = 16;
+
+// While waiting for the other subcompactions, the compaction thread checks
+// for an immutable memtable to dump that often
+const int kSubCompactionWaitMillis = 10;
+
+static bool SampleReadStats() {
+  static __thread uint32_t reads = 0;
+  return ++reads % kReadStatsSampleInterval == 0;
+}
+
 // Information kept for every waiting writer
 struct DBImpl::Writer {
   Status status;
   WriteBatch* batch;
+  const LGBatchView* view;
   bool sync;
   bool done;
   port::CondVar cv;
@@ -80,16 +101,47 @@ struct DBImpl::CompactionState {
 
   uint64_t total_bytes;
 
+  // User keys ending the key ranges before and of this state, NULL for
+  // unbounded, when the compaction is split into subcompactions.  Rows
+  // of the compact strategy are never cut, so the range holds the keys
+  // after the row of *start up to the row of *end.
+  const std::string* start;
+  const std::string* end;
+  Compaction::Cursor cursor;
+  CompactStrategy* compact_strategy;
+
   Output* current_output() { return &outputs[outputs.size()-1]; }
 
   explicit CompactionState(Compaction* c)
       : compaction(c),
         outfile(NULL),
         builder(NULL),
-        total_bytes(0) {
+        total_bytes(0),
+        start(NULL),
+        end(NULL),
+        compact_strategy(NULL) {
+  }
+  ~CompactionState() {
+    delete compact_strategy;
   }
 };
 
+// The subcompactions of a compaction, claimed one at a time by the
+// compaction thread and by the helpers it schedules on the env.
+struct DBImpl::SubCompactionJob {
+  port::Mutex mutex;
+  port::CondVar cv;
+  DBImpl* db;
+  const std::vector<CompactionState*>* subs;
+  size_t sub_num;
+  size_t next_sub;    // the first subcompaction not claimed yet
+  size_t done_num;
+  int refs;           // compaction thread and pending helpers
+  Status status;
+
+  SubCompactionJob() : cv(&mutex) {}
+};
+
 // Fix user-supplied options to be reasonable
 template <class T,class V>
 static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
@@ -141,6 +193,7 @@ DBImpl::DBImpl(const Options& options, const std::string& dbname)
       is_writting_mem_(false),
       mem_(NewMemTable()),
       imm_(NULL), recover_mem_(NULL),
+      read_view_(NULL),
       logfile_(NULL),
       logfile_number_(0),
       log_(NULL),
@@ -163,6 +216,8 @@ DBImpl::DBImpl(const Options& options, const std::string& dbname)
   }
   versions_ = new VersionSet(dbname_, &options_, table_cache_,
                              &internal_comparator_);
+  MutexLock l(&mutex_);
+  InstallReadView();
 }
 
 Status DBImpl::Shutdown1() {
@@ -197,6 +252,7 @@ Status DBImpl::Shutdown1() {
     has_imm_.Release_Store(imm_);
     mem_ = NewMemTable();
     mem_->Ref();
+    InstallReadView();
     bound_log_size_ = 0;
     s = CompactMemTable();
   }
@@ -232,6 +288,13 @@ DBImpl::~DBImpl() {
     env_->UnlockFile(db_lock_);
   }
 
+  if (read_view_ != NULL) {
+    MutexLock l(&mutex_);
+    if (__sync_sub_and_fetch(&read_view_->refs, 1) == 0) {
+      DeleteReadView(read_view_);
+    }
+    read_view_ = NULL;
+  }
   delete versions_;
   if (mem_ != NULL) mem_->Unref();
   if (imm_ != NULL) imm_->Unref();
@@ -515,6 +578,7 @@ Status DBImpl::Recover(VersionEdit* edit) {
       }
     }
   }
+  InstallReadView();
 
   if (s.ok()) {
     state_ = kOpened;
@@ -609,6 +673,7 @@ Status DBImpl::CompactMemTable() {
     imm_ = NULL;
     has_imm_.Release_Store(NULL);
   }
+  InstallReadView();
 
   return s;
 }
@@ -727,14 +792,30 @@ void DBImpl::AddInheritedLiveFiles(std::vector<std::set<uint64_t> >* live) {
 }
 
 Status DBImpl::RecoverInsertMem(WriteBatch* batch, VersionEdit* edit) {
+    return RecoverInsertMemImpl(batch, NULL, edit);
+}
+
+Status DBImpl::RecoverInsertMem(const LGBatchView& view, VersionEdit* edit) {
+    return RecoverInsertMemImpl(NULL, &view, edit);
+}
+
+Status DBImpl::RecoverInsertMemImpl(const WriteBatch* batch, const LGBatchView* view,
+                                    VersionEdit* edit) {
     MutexLock lock(&mutex_);
 
     if (recover_mem_ == NULL) {
         recover_mem_ = NewMemTable();
         recover_mem_->Ref();
     }
-    uint64_t log_sequence = WriteBatchInternal::Sequence(batch);
-    uint64_t last_sequence = log_sequence + WriteBatchInternal::Count(batch) - 1;
+    uint64_t log_sequence = 0;
+    uint64_t last_sequence = 0;
+    if (view != NULL) {
+        log_sequence = view->sequence;
+        last_sequence = log_sequence + view->Count() - 1;
+    } else {
+        log_sequence = WriteBatchInternal::Sequence(batch);
+        last_sequence = log_sequence + WriteBatchInternal::Count(batch) - 1;
+    }
 
     // if duplicate record, ignore
     if (log_sequence <= recover_mem_->GetLastSequence()) {
@@ -744,7 +825,8 @@ Status DBImpl::RecoverInsertMem(WriteBatch* batch, VersionEdit* edit) {
         return Status::OK();
     }
 
-    Status status = WriteBatchInternal::InsertInto(batch, recover_mem_);
+    Status status = (view != NULL) ? WriteBatchInternal::InsertInto(*view, recover_mem_)
+                                   : WriteBatchInternal::InsertInto(batch, recover_mem_);
     MaybeIgnoreError(&status);
     if (!status.ok()) {
         return status;
@@ -896,6 +978,7 @@ Status DBImpl::BackgroundCompaction() {
     c->edit()->DeleteFile(c->level(), *f);
     c->edit()->AddFile(c->level() + 1, *f);
     status = versions_->LogAndApply(c->edit(), &mutex_);
+    InstallReadView();
     VersionSet::LevelSummaryStorage tmp;
     Log(options_.info_log, "[%s] Moved #%08u, %08u to level-%d %lld bytes %s: %s\n",
         dbname_.c_str(),
@@ -979,8 +1062,18 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   // Make the output file
   std::string fname = TableFileName(dbname_, file_number);
   Status s = env_->NewWritableFile(fname, &compact->outfile);
+  if (s.ok() && options_.rate_limiter != NULL) {
+    compact->outfile = NewRateLimitedFile(compact->outfile, options_.rate_limiter,
+                                          RateLimiter::kCompaction);
+  }
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    Options opt = options_;
+    int output_level = compact->compaction->level() + 1;
+    if (options_.bottom_compression_level >= 0 &&
+        output_level >= options_.bottom_compression_level) {
+      opt.compression = options_.bottom_compression;
+    }
+    compact->builder = new TableBuilder(opt, compact->outfile);
   }
   return s;
 }
@@ -1066,7 +1159,25 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
         level + 1, BuildFullFileNumber(dbname_, out.number),
         out.file_size, out.smallest, out.largest);
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  Status s = versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  InstallReadView();
+  return s;
+}
+
+// Returns true if internal key "key" lies after the subcompaction that
+// ends with user key "end", i.e. after "end" and not in its row.
+static bool AfterSubCompaction(const Comparator* ucmp,
+                               CompactStrategy* compact_strategy,
+                               const Slice& key, const std::string& end) {
+  if (key.size() < 8) {
+    // corrupted keys stay with the keys before them
+    return false;
+  }
+  Slice user_key = ExtractUserKey(key);
+  if (ucmp->Compare(user_key, end) <= 0) {
+    return false;
+  }
+  return compact_strategy == NULL || !compact_strategy->IsSameRow(user_key, end);
 }
 
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
@@ -1089,25 +1200,183 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     compact->smallest_snapshot = *(snapshots_.begin());
   }
 
-  CompactStrategy* compact_strategy = NULL;
+  std::vector<std::string> boundaries;
+  versions_->GetSubCompactionBoundaries(compact->compaction,
+                                        options_.max_subcompactions,
+                                        &boundaries);
+  std::vector<CompactionState*> subs;
+  if (boundaries.empty()) {
+    subs.push_back(compact);
+  } else {
+    for (size_t i = 0; i <= boundaries.size(); i++) {
+      CompactionState* sub = new CompactionState(compact->compaction);
+      sub->smallest_snapshot = compact->smallest_snapshot;
+      sub->start = (i > 0 ? &boundaries[i - 1] : NULL);
+      sub->end = (i < boundaries.size() ? &boundaries[i] : NULL);
+      subs.push_back(sub);
+    }
+  }
+
+  // Strategies keep the state of the row they are in, one per subcompaction
   if (options_.compact_strategy_factory) {
-    compact_strategy = options_.compact_strategy_factory->NewInstance();
-    if (snapshots_.empty()) {
-      compact_strategy->SetSnapshot(kMaxSequenceNumber);
-    } else {
-      compact_strategy->SetSnapshot(*(snapshots_.begin()));
+    for (size_t i = 0; i < subs.size(); i++) {
+      CompactStrategy* compact_strategy =
+          options_.compact_strategy_factory->NewInstance();
+      if (snapshots_.empty()) {
+        compact_strategy->SetSnapshot(kMaxSequenceNumber);
+      } else {
+        compact_strategy->SetSnapshot(*(snapshots_.begin()));
+      }
+      subs[i]->compact_strategy = compact_strategy;
     }
   }
+  const double prio = bg_compaction_score_;
 
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
 
-  Log(options_.info_log,  "[%s] Compact strategy: %s",
-    dbname_.c_str(),
-    compact_strategy->Name());
+  if (subs[0]->compact_strategy) {
+    Log(options_.info_log,  "[%s] Compact strategy: %s",
+        dbname_.c_str(),
+        subs[0]->compact_strategy->Name());
+  }
+
+  Status status;
+  if (subs.size() == 1) {
+    status = DoSubCompactionWork(compact, &imm_micros);
+  } else {
+    Log(options_.info_log, "[%s] Split compaction into %d subcompactions",
+        dbname_.c_str(), static_cast<int>(subs.size()));
+    status = RunSubCompactions(subs, prio, &imm_micros);
+    for (size_t i = 0; i < subs.size(); i++) {
+      CompactionState* sub = subs[i];
+      if (sub->builder != NULL) {
+        sub->builder->Abandon();
+        delete sub->builder;
+      }
+      delete sub->outfile;
+      // subcompactions are in key order, so are their outputs
+      compact->outputs.insert(compact->outputs.end(),
+                              sub->outputs.begin(), sub->outputs.end());
+      compact->total_bytes += sub->total_bytes;
+      delete sub;
+    }
+  }
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
+
+  mutex_.Lock();
+  stats_[compact->compaction->level() + 1].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "[%s] compacted to: %s", dbname_.c_str(), versions_->LevelSummary(&tmp));
+  return status;
+}
+
+Status DBImpl::RunSubCompactions(const std::vector<CompactionState*>& subs,
+                                 double prio, int64_t* imm_micros) {
+  // helpers may start after the compaction is done, keep job on heap
+  SubCompactionJob* job = new SubCompactionJob;
+  job->db = this;
+  job->subs = &subs;
+  job->sub_num = subs.size();
+  job->next_sub = 0;
+  job->done_num = 0;
+  job->refs = subs.size();
+  for (size_t i = 1; i < subs.size(); i++) {
+    env_->Schedule(&DBImpl::SubCompactionWork, job, prio);
+  }
+
+  // The compaction thread works on the subcompactions as well, so they
+  // make progress even if all background threads are busy.  Once it has
+  // no more to take, it keeps dumping imm_ until the helpers are done:
+  // writers may be waiting for it.
+  RunSubCompactionJob(job, imm_micros);
+  job->mutex.Lock();
+  while (job->done_num < job->sub_num) {
+    if (has_imm_.NoBarrier_Load() != NULL) {
+      job->mutex.Unlock();
+      MaybeCompactImmutable(imm_micros);
+      job->mutex.Lock();
+      continue;
+    }
+    job->cv.Wait(kSubCompactionWaitMillis);
+  }
+  Status s = job->status;
+  job->mutex.Unlock();
+  UnrefSubCompactionJob(job);
+  return s;
+}
+
+void DBImpl::MaybeCompactImmutable(int64_t* imm_micros) {
+  const uint64_t imm_start = env_->NowMicros();
+  mutex_.Lock();
+  if (imm_ != NULL) {
+    CompactMemTable();
+    bg_cv_.SignalAll();  // Wakeup MakeRoomForWrite() if necessary
+  }
+  mutex_.Unlock();
+  *imm_micros += (env_->NowMicros() - imm_start);
+}
+
+void DBImpl::SubCompactionWork(void* job) {
+  SubCompactionJob* j = reinterpret_cast<SubCompactionJob*>(job);
+  RunSubCompactionJob(j, NULL);
+  UnrefSubCompactionJob(j);
+}
 
+void DBImpl::RunSubCompactionJob(SubCompactionJob* job, int64_t* imm_micros) {
+  MutexLock lock(&job->mutex);
+  while (job->next_sub < job->sub_num) {
+    CompactionState* sub = (*job->subs)[job->next_sub++];
+    job->mutex.Unlock();
+    Status s = job->db->DoSubCompactionWork(sub, imm_micros);
+    job->mutex.Lock();
+    if (job->status.ok() && !s.ok()) {
+      job->status = s;
+    }
+    if (++job->done_num == job->sub_num) {
+      job->cv.Signal();
+    }
+  }
+}
+
+void DBImpl::UnrefSubCompactionJob(SubCompactionJob* job) {
+  job->mutex.Lock();
+  bool last = (--job->refs == 0);
+  job->mutex.Unlock();
+  if (last) {
+    delete job;
+  }
+}
+
+Status DBImpl::DoSubCompactionWork(CompactionState* compact,
+                                   int64_t* imm_micros) {
+  CompactStrategy* compact_strategy = compact->compact_strategy;
   Iterator* input = versions_->MakeInputIterator(compact->compaction);
-  input->SeekToFirst();
+  if (compact->start != NULL) {
+    InternalKey start(*compact->start, 0, static_cast<ValueType>(0));
+    for (input->Seek(start.Encode());
+         input->Valid() && !AfterSubCompaction(user_comparator(), compact_strategy,
+                                               input->key(), *compact->start);
+         input->Next()) {
+    }
+  } else {
+    input->SeekToFirst();
+  }
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
@@ -1116,19 +1385,16 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
   for (; input->Valid() && !shutting_down_.Acquire_Load(); ) {
     // Prioritize immutable compaction work
-    if (has_imm_.NoBarrier_Load() != NULL) {
-      const uint64_t imm_start = env_->NowMicros();
-      mutex_.Lock();
-      if (imm_ != NULL) {
-        CompactMemTable();
-        bg_cv_.SignalAll();  // Wakeup MakeRoomForWrite() if necessary
-      }
-      mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+    if (imm_micros != NULL && has_imm_.NoBarrier_Load() != NULL) {
+      MaybeCompactImmutable(imm_micros);
     }
 
     Slice key = input->key();
-    if (compact->compaction->ShouldStopBefore(key) &&
+    if (compact->end != NULL &&
+        AfterSubCompaction(user_comparator(), compact_strategy, key, *compact->end)) {
+      break;
+    }
+    if (compact->compaction->ShouldStopBefore(key, &compact->cursor) &&
         compact->builder != NULL) {
       status = FinishCompactionOutputFile(compact, input);
       if (!status.ok()) {
@@ -1161,7 +1427,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       } else if (ikey.type == kTypeDeletion &&
                  ikey.sequence <= compact->smallest_snapshot &&
                  options_.drop_base_level_del_in_compaction &&
-                 compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+                 compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                                        &compact->cursor)) {
         // For this user key:
         // (1) there is no data in higher levels
         // (2) data in lower levels will have larger sequence numbers
@@ -1186,7 +1453,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         "%d smallest_snapshot: %d",
         ikey.user_key.ToString().c_str(),
         (int)ikey.sequence, ikey.type, kTypeValue, drop,
-        compact->compaction->IsBaseLevelForKey(ikey.user_key),
+        compact->compaction->IsBaseLevelForKey(ikey.user_key, &compact->cursor),
         (int)last_sequence_for_key, (int)compact->smallest_snapshot);
 #endif
 
@@ -1233,10 +1500,6 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     }
   }
 
-  if (compact_strategy) {
-    delete compact_strategy;
-  }
-
   if (status.ok() && shutting_down_.Acquire_Load()) {
     status = Status::IOError("Deleting DB during compaction");
   }
@@ -1252,77 +1515,90 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       }
   }
   delete input;
-  input = NULL;
+  return status;
+}
 
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
-    }
+void DBImpl::InstallReadView() {
+  mutex_.AssertHeld();
+  if (mem_ == NULL) {
+    // shutting down, readers keep the last view
+    return;
   }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
+  ReadView* view = new ReadView;
+  view->mem = mem_;
+  view->imm = imm_;
+  view->current = versions_->current();
+  view->mem->Ref();
+  if (view->imm != NULL) view->imm->Ref();
+  view->current->Ref();
+  view->refs = 1;  // held by read_view_
+
+  read_view_lock_.Lock();
+  ReadView* old = read_view_;
+  read_view_ = view;
+  read_view_lock_.Unlock();
+  if (old != NULL && __sync_sub_and_fetch(&old->refs, 1) == 0) {
+    DeleteReadView(old);
   }
+}
 
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
+DBImpl::ReadView* DBImpl::AcquireReadView() {
+  read_view_lock_.Lock();
+  ReadView* view = read_view_;
+  __sync_add_and_fetch(&view->refs, 1);
+  read_view_lock_.Unlock();
+  return view;
+}
 
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
+// REQUIRES: mutex_ not held
+void DBImpl::ReleaseReadView(ReadView* view) {
+  if (__sync_sub_and_fetch(&view->refs, 1) == 0) {
+    // replaced while we read, the memtables and version may go
+    MutexLock l(&mutex_);
+    DeleteReadView(view);
   }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log,
-      "[%s] compacted to: %s", dbname_.c_str(), versions_->LevelSummary(&tmp));
-  return status;
 }
 
-struct IterState {
-  port::Mutex* mu;
-  Version* version;
-  MemTable* mem;
-  MemTable* imm;
-};
+void DBImpl::DeleteReadView(ReadView* view) {
+  mutex_.AssertHeld();
+  view->mem->Unref();
+  if (view->imm != NULL) view->imm->Unref();
+  view->current->Unref();
+  delete view;
+}
 
-static void CleanupIteratorState(void* arg1, void* arg2) {
-  IterState* state = reinterpret_cast<IterState*>(arg1);
-  state->mu->Lock();
-  state->mem->Unref();
-  if (state->imm != NULL) state->imm->Unref();
-  state->version->Unref();
-  state->mu->Unlock();
-  delete state;
+// Same as GetLastSequence() on the memtables of "view", mutex_ is only
+// taken when both of them are empty.
+SequenceNumber DBImpl::ViewLastSequence(ReadView* view) {
+  if (view->mem->GetLastSequence() > 0) {
+    return view->mem->GetLastSequence();
+  } else if (view->imm != NULL && view->imm->GetLastSequence()) {
+    return view->imm->GetLastSequence();
+  }
+  MutexLock l(&mutex_);
+  return versions_->LastSequence();
+}
+
+void DBImpl::CleanupReadView(void* db, void* view) {
+  reinterpret_cast<DBImpl*>(db)->ReleaseReadView(reinterpret_cast<ReadView*>(view));
 }
 
 Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
                                       SequenceNumber* latest_snapshot) {
-  IterState* cleanup = new IterState;
-  mutex_.Lock();
-  *latest_snapshot = GetLastSequence(false);
-
-  MemTable* mem = mem_;
-  MemTable* imm = imm_;
-  Version* current = versions_->current();
-  mem->Ref();
-  if (imm != NULL) imm->Ref();
-  current->Ref();
-  mutex_.Unlock();
+  ReadView* view = AcquireReadView();
+  *latest_snapshot = ViewLastSequence(view);
 
   // Collect together all needed child iterators
   std::vector<Iterator*> list;
-  list.push_back(mem->NewIterator());
-  if (imm != NULL) {
-    list.push_back(imm->NewIterator());
+  list.push_back(view->mem->NewIterator());
+  if (view->imm != NULL) {
+    list.push_back(view->imm->NewIterator());
   }
-  current->AddIterators(options, &list);
+  view->current->AddIterators(options, &list);
   Iterator* internal_iter =
       NewMergingIterator(&internal_comparator_, &list[0], list.size());
 
-  cleanup->mu = &mutex_;
-  cleanup->mem = mem;
-  cleanup->imm = imm;
-  cleanup->version = current;
-  internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, NULL);
+  internal_iter->RegisterCleanup(CleanupReadView, this, view);
 
   return internal_iter;
 }
@@ -1341,46 +1617,31 @@ Status DBImpl::Get(const ReadOptions& options,
                    const Slice& key,
                    std::string* value) {
   Status s;
-  MutexLock l(&mutex_);
+  ReadView* view = AcquireReadView();
   SequenceNumber snapshot;
   if (options.snapshot != kMaxSequenceNumber) {
     snapshot = options.snapshot;
   } else {
-    snapshot = GetLastSequence(false);
+    snapshot = ViewLastSequence(view);
   }
 
-  MemTable* mem = mem_;
-  MemTable* imm = imm_;
-  Version* current = versions_->current();
-  mem->Ref();
-  if (imm != NULL) imm->Ref();
-  current->Ref();
-
-  bool have_stat_update = false;
-  Version::GetStats stats;
-
-  // Unlock while reading from files and memtables
-  {
-    mutex_.Unlock();
-    // First look in the memtable, then in the immutable memtable (if any).
-    LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, options.rollbacks, &s)) {
-      // Done
-    } else if (imm != NULL && imm->Get(lkey, value, options.rollbacks, &s)) {
-      // Done
-    } else {
-      s = current->Get(options, lkey, value, &stats);
-      have_stat_update = true;
+  // First look in the memtable, then in the immutable memtable (if any).
+  LookupKey lkey(key, snapshot);
+  if (view->mem->Get(lkey, value, options.rollbacks, &s)) {
+    // Done
+  } else if (view->imm != NULL && view->imm->Get(lkey, value, options.rollbacks, &s)) {
+    // Done
+  } else {
+    Version::GetStats stats;
+    s = view->current->Get(options, lkey, value, &stats);
+    if (stats.seek_file != NULL && SampleReadStats()) {
+      MutexLock l(&mutex_);
+      if (view->current->UpdateStats(stats, kReadStatsSampleInterval)) {
+        MaybeScheduleCompaction();
+      }
     }
-    mutex_.Lock();
-  }
-
-  if (have_stat_update && current->UpdateStats(stats)) {
-    MaybeScheduleCompaction();
   }
-  mem->Unref();
-  if (imm != NULL) imm->Unref();
-  current->Unref();
+  ReleaseReadView(view);
   return s;
 }
 
@@ -1439,8 +1700,18 @@ void DBImpl::Workload(double* write_workload) {
 }
 
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
+  return WriteImpl(options, my_batch, NULL);
+}
+
+Status DBImpl::Write(const WriteOptions& options, const LGBatchView& view) {
+  return WriteImpl(options, NULL, &view);
+}
+
+Status DBImpl::WriteImpl(const WriteOptions& options, WriteBatch* my_batch,
+                         const LGBatchView* view) {
   Writer w(&mutex_);
   w.batch = my_batch;
+  w.view = view;
   w.sync = options.sync;
   w.done = false;
 
@@ -1455,14 +1726,24 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
 
 
   // May temporarily unlock and wait.
-  Status status = MakeRoomForWrite(my_batch == NULL);
+  Status status = MakeRoomForWrite(my_batch == NULL && view == NULL);
 
   Writer* last_writer = &w;
-  if (status.ok() && my_batch != NULL) {  // NULL batch is for compactions
-    uint64_t batch_sequence = WriteBatchInternal::Sequence(my_batch);
-    WriteBatch* updates = BuildBatchGroup(&last_writer);
-    WriteBatchInternal::SetSequence(updates, batch_sequence);
-    assert(writers_.size() == 1);
+  // NULL batch is for compactions
+  if (status.ok() && (my_batch != NULL || view != NULL)) {
+    uint64_t batch_sequence = 0;
+    int count = 0;
+    WriteBatch* updates = NULL;
+    if (view != NULL) {
+      batch_sequence = view->sequence;
+      count = view->Count();
+    } else {
+      batch_sequence = WriteBatchInternal::Sequence(my_batch);
+      updates = BuildBatchGroup(&last_writer);
+      WriteBatchInternal::SetSequence(updates, batch_sequence);
+      count = WriteBatchInternal::Count(updates);
+      assert(writers_.size() == 1);
+    }
 
     // Apply to memtable.  We can release the lock
     // during this phase since &w is currently responsible for logging
@@ -1471,11 +1752,15 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
     is_writting_mem_ = true;
 
     mutex_.Unlock();
-    status = WriteBatchInternal::InsertInto(updates, mem_);
+    if (view != NULL) {
+      status = WriteBatchInternal::InsertInto(*view, mem_);
+    } else {
+      status = WriteBatchInternal::InsertInto(updates, mem_);
+    }
     mutex_.Lock();
 
     if (updates == tmp_batch_) tmp_batch_->Clear();
-    if (WriteBatchInternal::Count(updates) > 0) {
+    if (count > 0) {
       mem_->SetNonEmpty();
     }
     if (mem_->Empty() && imm_ == NULL) {
@@ -1576,6 +1861,7 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       // individual write by 1ms to reduce latency variance.  Also,
       // this delay hands over some CPU to the compaction thread in
       // case it is sharing the same core as the writer.
+      l0_write_stall_counter.Inc();
       mutex_.Unlock();
       env_->SleepForMicroseconds(1000);
       allow_delay = false;  // Do not delay a single write more than once
@@ -1591,17 +1877,20 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       // one is still being compacted, so we wait.
       Log(options_.info_log, "[%s] Current memtable full; waiting...\n",
           dbname_.c_str());
+      mem_write_stall_counter.Inc();
       bg_cv_.Wait();
     } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
       // There are too many level-0 files.
       Log(options_.info_log, "[%s] Too many L0 files; waiting...\n",
           dbname_.c_str());
+      l0_write_stall_counter.Inc();
       bg_cv_.Wait();
     } else {
       imm_ = mem_;
       has_imm_.Release_Store(imm_);
       mem_ = NewMemTable();
       mem_->Ref();
+      InstallReadView();
       bound_log_size_ = 0;
       force = false;   // Do not force another compaction if have room
       MaybeScheduleCompaction();
@@ -1727,6 +2016,18 @@ void DBImpl::GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize)
   }
 }
 
+uint64_t DBImpl::GetMemTableUsage() {
+  MutexLock l(&mutex_);
+  uint64_t usage = 0;
+  if (mem_) {
+    usage += mem_->ApproximateMemoryUsage();
+  }
+  if (imm_) {
+    usage += imm_->ApproximateMemoryUsage();
+  }
+  return usage;
+}
+
 uint64_t DBImpl::GetLastSequence(bool is_locked) {
   if (is_locked) {
       mutex_.Lock();
@@ -1748,7 +2049,8 @@ uint64_t DBImpl::GetLastSequence(bool is_locked) {
 MemTable* DBImpl::NewMemTable() const {
     if (!options_.use_memtable_on_leveldb) {
         return new MemTable(internal_comparator_,
-                  options_.enable_strategy_when_get ? options_.compact_strategy_factory : NULL);
+                  options_.enable_strategy_when_get ? options_.compact_strategy_factory : NULL,
+                  options_.arena_pool);
     } else {
         return new MemTableOnLevelDB(internal_comparator_,
                                      options_.compact_strategy_factory,
@@ -21,6 +21,7 @@
 
 namespace leveldb {
 
+struct LGBatchView;
 class MemTable;
 class TableCache;
 class Version;
@@ -39,6 +40,9 @@ class DBImpl : public DB {
   virtual Status Put(const WriteOptions&, const Slice& key, const Slice& value);
   virtual Status Delete(const WriteOptions&, const Slice& key);
   virtual Status Write(const WriteOptions& options, WriteBatch* updates);
+  // Write the entries of one lg split from a DBTable write, never grouped
+  // with other writers.
+  Status Write(const WriteOptions& options, const LGBatchView& view);
   virtual Status Get(const ReadOptions& options,
                      const Slice& key,
                      std::string* value);
@@ -50,6 +54,7 @@ class DBImpl : public DB {
   virtual void GetApproximateSizes(const Range* range, int n, uint64_t* sizes);
   // lgsize not used in db_impl, just for interface compatable
   virtual void GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize = NULL);
+  virtual uint64_t GetMemTableUsage();
   virtual void CompactRange(const Slice* begin, const Slice* end, int lg_no = -1);
 
   void AddBoundLogSize(uint64_t size);
@@ -95,8 +100,26 @@ class DBImpl : public DB {
   friend class DB;
   friend class DBTable;
   struct CompactionState;
+  struct SubCompactionJob;
   struct Writer;
 
+  // mem_, imm_ and the current version as seen by readers.  A new view is
+  // published by InstallReadView() whenever one of them changes, readers
+  // pin the view they find without taking mutex_.
+  struct ReadView {
+    MemTable* mem;
+    MemTable* imm;
+    Version* current;
+    volatile int refs;
+  };
+
+  ReadView* AcquireReadView();
+  void ReleaseReadView(ReadView* view);
+  void InstallReadView() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void DeleteReadView(ReadView* view) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  SequenceNumber ViewLastSequence(ReadView* view);
+
+  static void CleanupReadView(void* db, void* view);
   Iterator* NewInternalIterator(const ReadOptions&,
                                 SequenceNumber* latest_snapshot);
 
@@ -119,6 +142,8 @@ class DBImpl : public DB {
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   WriteBatch* BuildBatchGroup(Writer** last_writer);
+  Status WriteImpl(const WriteOptions& options, WriteBatch* my_batch,
+                   const LGBatchView* view);
 
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
@@ -128,6 +153,17 @@ class DBImpl : public DB {
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Compact the key range of "compact", compacting imm_ meanwhile iff
+  // "imm_micros" is non-NULL, which then gets the time spent on it added.
+  Status DoSubCompactionWork(CompactionState* compact, int64_t* imm_micros);
+  // Compact imm_ if there is one, adding the time spent to *imm_micros.
+  // REQUIRES: mutex_ not held
+  void MaybeCompactImmutable(int64_t* imm_micros);
+  Status RunSubCompactions(const std::vector<CompactionState*>& subs,
+                           double prio, int64_t* imm_micros);
+  static void SubCompactionWork(void* job);
+  static void RunSubCompactionJob(SubCompactionJob* job, int64_t* imm_micros);
+  static void UnrefSubCompactionJob(SubCompactionJob* job);
 
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
@@ -140,6 +176,9 @@ class DBImpl : public DB {
   std::string key_start_;
   std::string key_end_;
   Status RecoverInsertMem(WriteBatch* wb, VersionEdit* edit);
+  Status RecoverInsertMem(const LGBatchView& view, VersionEdit* edit);
+  Status RecoverInsertMemImpl(const WriteBatch* wb, const LGBatchView* view,
+                              VersionEdit* edit);
   Status RecoverLastDumpToLevel0(VersionEdit* edit);
 
   uint64_t GetLastSequence(bool is_locked = true);
@@ -173,6 +212,10 @@ class DBImpl : public DB {
   MemTable* imm_;                // Memtable being compacted
   MemTable* recover_mem_;
   port::AtomicPointer has_imm_;  // So bg thread can detect non-NULL imm_
+
+  // read_view_ is swapped and pinned under read_view_lock_ only
+  port::SpinLock read_view_lock_;
+  ReadView* read_view_;
   WritableFile* logfile_;
   uint64_t logfile_number_;
   log::Writer* log_;
@@ -9,9 +9,11 @@
 #include <vector>
 #include <stdio.h>
 
+#include "db/commit_log.h"
 #include "db/db_impl.h"
 #include "db/filename.h"
 #include "db/lg_compact_thread.h"
+#include "db/lg_write_thread.h"
 #include "db/log_reader.h"
 #include "db/memtable.h"
 #include "db/memtable.h"
@@ -25,10 +27,23 @@
 #include "leveldb/write_batch.h"
 #include "leveldb/table_utils.h"
 #include "table/merger.h"
+#include "util/coding.h"
 #include "util/string_ext.h"
+#include "../utils/latency_histogram.h"
 
 namespace leveldb {
 
+// A utility routine: write "data" to the named file and Sync() it.
+extern Status WriteStringToFileSync(Env* env, const Slice& data,
+                                    const std::string& fname);
+
+// Recovered records are applied to lgs in groups of this size,
+// so that every lg replays its part of the group in parallel.
+static const uint64_t kRecoverGroupSize = 4 << 20;
+
+// time a write waits for its log record to be synced
+tera::LatencyHistogram wal_sync_latency;
+
 struct DBTable::RecordWriter {
     Status status;
     WriteBatch* batch;
@@ -83,6 +98,9 @@ Options InitOptionsLG(const Options& options, uint32_t lg_id) {
         opt.env = lg_info->env;
     }
     opt.compression = lg_info->compression;
+    opt.bottom_compression = lg_info->bottom_compression;
+    opt.bottom_compression_level = lg_info->bottom_compression_level;
+    opt.compression_dict_size = lg_info->compression_dict_size;
     opt.block_size = lg_info->block_size;
     opt.use_memtable_on_leveldb = lg_info->use_memtable_on_leveldb;
     opt.memtable_ldb_write_buffer_size = lg_info->memtable_ldb_write_buffer_size;
@@ -100,8 +118,10 @@ DBTable::DBTable(const Options& options, const std::string& dbname)
       created_own_lg_list_(options_.exist_lg_list != options.exist_lg_list),
       created_own_info_log_(options_.info_log != options.info_log),
       created_own_compact_strategy_(options_.compact_strategy_factory != options.compact_strategy_factory),
-      commit_snapshot_(kMaxSequenceNumber), logfile_(NULL), log_(NULL), force_switch_log_(false),
+      commit_snapshot_(reinterpret_cast<void*>(static_cast<uintptr_t>(kMaxSequenceNumber))), logfile_(NULL), log_(NULL), force_switch_log_(false),
       last_sequence_(0), current_log_size_(0),
+      commit_log_(options_.commit_log), commit_log_need_flush_(false),
+      recover_record_num_(0), recover_batches_size_(0),
       tmp_batch_(new WriteBatch),
       bg_schedule_gc_(false), bg_schedule_gc_id_(0),
       bg_schedule_gc_score_(0), force_clean_log_seq_(0) {
@@ -125,6 +145,10 @@ Status DBTable::Shutdown1() {
         }
     }
 
+    if (commit_log_) {
+        commit_log_->UnregisterTablet(dbname_);
+    }
+
     Log(options_.info_log, "[%s] wait bg garbage clean finish", dbname_.c_str());
     mutex_.Lock();
     if (bg_schedule_gc_) {
@@ -167,10 +191,14 @@ Status DBTable::Shutdown2() {
     if (s.ok() && options_.dump_mem_on_shutdown) {
         Log(options_.info_log, "[%s] gather all log file", dbname_.c_str());
         std::vector<uint64_t> logfiles;
-        s = GatherLogFile(0, &logfiles);
+        std::set<uint64_t> log_refs;
+        s = GatherLogFile(0, &logfiles, &log_refs);
         if (s.ok()) {
             Log(options_.info_log, "[%s] delete all log file", dbname_.c_str());
-            s = DeleteLogFile(logfiles);
+            s = DeleteLogFile(logfiles, log_refs);
+        }
+        if (s.ok() && commit_log_) {
+            commit_log_->Release(dbname_, kMaxSequenceNumber);
         }
     }
 
@@ -206,6 +234,7 @@ DBTable::~DBTable() {
     if (created_own_info_log_) {
         delete options_.info_log;
     }
+    ReleaseRecoverBatches();
     delete tmp_batch_;
 }
 
@@ -267,7 +296,8 @@ Status DBTable::Init() {
     Log(options_.info_log, "[%s] start GatherLogFile", dbname_.c_str());
     // recover log files
     std::vector<uint64_t> logfiles;
-    s = GatherLogFile(min_log_sequence + 1, &logfiles);
+    std::set<uint64_t> log_refs;
+    s = GatherLogFile(min_log_sequence + 1, &logfiles, &log_refs);
     if (s.ok()) {
         for (uint32_t i = 0; i < logfiles.size(); ++i) {
             // If two log files have overlap sequence id, ignore records
@@ -276,7 +306,11 @@ Status DBTable::Init() {
             if (i < logfiles.size() - 1) {
                 recover_limit = logfiles[i + 1];
             }
-            s = RecoverLogFile(logfiles[i], recover_limit, &lg_edits);
+            if (log_refs.find(logfiles[i]) != log_refs.end()) {
+                s = RecoverCommitLogRef(logfiles[i], recover_limit, &lg_edits);
+            } else {
+                s = RecoverLogFile(logfiles[i], recover_limit, &lg_edits);
+            }
             if (!s.ok()) {
                 Log(options_.info_log, "[%s] Fail to RecoverLogFile %ld",
                     dbname_.c_str(), logfiles[i]);
@@ -285,6 +319,7 @@ Status DBTable::Init() {
     } else {
         Log(options_.info_log, "[%s] Fail to GatherLogFile", dbname_.c_str());
     }
+    ReleaseRecoverBatches();
 
     Log(options_.info_log, "[%s] start RecoverLogToLevel0Table", dbname_.c_str());
     std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
@@ -297,6 +332,7 @@ Status DBTable::Init() {
         if (s.ok()) {
             MutexLock lock(&impl->mutex_);
             s = impl->versions_->LogAndApply(lg_edits[i], &impl->mutex_);
+            impl->InstallReadView();
             if (s.ok()) {
                 impl->DeleteObsoleteFiles();
                 impl->MaybeScheduleCompaction();
@@ -313,10 +349,15 @@ Status DBTable::Init() {
 
     if (s.ok()) {
         Log(options_.info_log, "[%s] start DeleteLogFile", dbname_.c_str());
-        s = DeleteLogFile(logfiles);
+        s = DeleteLogFile(logfiles, log_refs);
     }
 
-    if (s.ok() && !options_.disable_wal) {
+    if (s.ok() && !options_.disable_wal && commit_log_) {
+        // all records recovered are in level0 now, release them in case this
+        // tablet was reloaded on the same node
+        commit_log_->Release(dbname_, last_sequence_);
+        commit_log_->RegisterTablet(dbname_, &DBTable::CommitLogReleaseWrapper, this);
+    } else if (s.ok() && !options_.disable_wal) {
         std::string log_file_name = LogHexFileName(dbname_, last_sequence_ + 1);
         s = options_.env->NewWritableFile(log_file_name, &logfile_);
         if (s.ok()) {
@@ -407,7 +448,7 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
         WriteBatchInternal::SetSequence(updates, last_sequence_ + 1);
     }
 
-    if (s.ok() && !options_.disable_wal && !options.disable_wal) {
+    if (s.ok() && !options_.disable_wal && !options.disable_wal && commit_log_ == NULL) {
         if (force_switch_log_ || current_log_size_ > options_.log_file_size) {
             mutex_.Unlock();
             if (SwitchLog(false) == 2) {
@@ -422,93 +463,35 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
     // dump to log
     if (s.ok() && !options_.disable_wal && !options.disable_wal) {
         mutex_.Unlock();
-
-        Slice slice = WriteBatchInternal::Contents(updates);
-        uint32_t wait_sec = options_.write_log_time_out;
-        for (; ; wait_sec <<= 1) {
-            // write a record into log
-            log_->AddRecord(slice);
-            s = log_->WaitDone(wait_sec);
-            if (s.IsTimeOut()) {
-                Log(options_.info_log, "[%s] AddRecord time out, current log size: %lu, "
-                    "record size: %lu, wait_sec: %u",
-                    dbname_.c_str(), current_log_size_, slice.size(), wait_sec);
-                int ret = SwitchLog(true);
-                if (ret == 0) {
-                    continue;
-                } else if (ret == 1) {
-                    s = log_->WaitDone(-1);
-                    if (!s.ok()) {
-                        break;
-                    }
-                } else {
-                    s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
-                    break;
-                }
-            }
-            // do sync if needed
-            if (!s.ok()) {
-                s = Status::IOError(dbname_ + ": fail to write log: ", s.ToString());
-                force_switch_log_ = true;
-            } else {
-                log_->Sync(options.sync);
-                s = log_->WaitDone(wait_sec);
-                if (s.IsTimeOut()) {
-                    Log(options_.info_log, "[%s] Sync time out %lu",
-                        dbname_.c_str(), current_log_size_);
-                    int ret = SwitchLog(true);
-                    if (ret == 0) {
-                        continue;
-                    } else if (ret == 1) {
-                        s = log_->WaitDone(-1);
-                        if (s.ok()) {
-                            continue;
-                        }
-                    } else {
-                        s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
-                        break;
-                    }
-                }
-                if (!s.ok()) {
-                    s = Status::IOError(dbname_ + ": fail to sync log: ", s.ToString());
-                    force_switch_log_ = true;
-                }
-            }
-            break;
+        if (commit_log_) {
+            s = WriteCommitLog(updates, options.sync);
+        } else {
+            s = WriteLogFile(WriteBatchInternal::Contents(updates), options.sync);
         }
         mutex_.Lock();
     }
     if (s.ok()) {
-        std::vector<WriteBatch*> lg_updates;
-        lg_updates.resize(lg_list_.size());
-        std::fill(lg_updates.begin(), lg_updates.end(), (WriteBatch*)0);
-        bool created_new_wb = false;
         // kv version may not create snapshot
         for (uint32_t i = 0; i < lg_list_.size(); ++i) {
             lg_list_[i]->GetSnapshot(last_sequence_);
         }
-        commit_snapshot_ = last_sequence_;
+        SetCommitSnapshot(last_sequence_);
         if (lg_list_.size() > 1) {
-            updates->SeperateLocalityGroup(&lg_updates);
-            created_new_wb = true;
-        } else {
-            lg_updates[0] = updates;
+            // lgs read their entries from "updates" in place
+            write_views_.resize(lg_list_.size());
+            s = WriteBatchInternal::SeperateLocalityGroup(updates, &write_views_);
         }
         mutex_.Unlock();
-        //TODO: should be multi-thread distributed
-        for (uint32_t i = 0; i < lg_updates.size(); ++i) {
-            assert(lg_updates[i] != NULL);
-            Status lg_s = lg_list_[i]->Write(WriteOptions(), lg_updates[i]);
-            if (!lg_s.ok()) {
-                // 这种情况下内存处于不一致状态
-                Log(options_.info_log, "[%s] [Fatal] Write to lg%u fail",
-                    dbname_.c_str(), i);
-                s = lg_s;
-                fatal_error_ = lg_s;
-                break;
-            }
+        if (s.ok()) {
+            LGWriteArg arg(this, updates);
+            s = LGWriteThreadPool::Default()->RunAll(&DBTable::WriteLG, &arg,
+                                                     lg_list_.size());
         }
         mutex_.Lock();
+        if (!s.ok()) {
+            // 这种情况下内存处于不一致状态
+            fatal_error_ = s;
+        }
         if (s.ok()) {
             for (uint32_t i = 0; i < lg_list_.size(); ++i) {
                 lg_list_[i]->AddBoundLogSize(updates->DataSize());
@@ -517,18 +500,9 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
         // Commit updates
         if (s.ok()) {
             for (uint32_t i = 0; i < lg_list_.size(); ++i) {
-                lg_list_[i]->ReleaseSnapshot(commit_snapshot_);
-            }
-            commit_snapshot_ = last_sequence_ + WriteBatchInternal::Count(updates);
-        }
-
-        if (created_new_wb) {
-            for (uint32_t i = 0; i < lg_updates.size(); ++i) {
-                if (lg_updates[i] != NULL) {
-                    delete lg_updates[i];
-                    lg_updates[i] = NULL;
-                }
+                lg_list_[i]->ReleaseSnapshot(CommitSnapshot());
             }
+            SetCommitSnapshot(last_sequence_ + WriteBatchInternal::Count(updates));
         }
     }
 
@@ -557,6 +531,89 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
     return s;
 }
 
+Status DBTable::WriteLogFile(const Slice& record, bool sync) {
+    Status s;
+    uint32_t wait_sec = options_.write_log_time_out;
+    for (; ; wait_sec <<= 1) {
+        // write a record into log
+        log_->AddRecord(record);
+        s = log_->WaitDone(wait_sec);
+        if (s.IsTimeOut()) {
+            Log(options_.info_log, "[%s] AddRecord time out, current log size: %lu, "
+                "record size: %lu, wait_sec: %u",
+                dbname_.c_str(), current_log_size_, record.size(), wait_sec);
+            int ret = SwitchLog(true);
+            if (ret == 0) {
+                continue;
+            } else if (ret == 1) {
+                s = log_->WaitDone(-1);
+                if (!s.ok()) {
+                    break;
+                }
+            } else {
+                s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
+                break;
+            }
+        }
+        // do sync if needed
+        if (!s.ok()) {
+            s = Status::IOError(dbname_ + ": fail to write log: ", s.ToString());
+            force_switch_log_ = true;
+        } else {
+            uint64_t sync_start = env_->NowMicros();
+            log_->Sync(sync);
+            s = log_->WaitDone(wait_sec);
+            wal_sync_latency.Add(env_->NowMicros() - sync_start);
+            if (s.IsTimeOut()) {
+                Log(options_.info_log, "[%s] Sync time out %lu",
+                    dbname_.c_str(), current_log_size_);
+                int ret = SwitchLog(true);
+                if (ret == 0) {
+                    continue;
+                } else if (ret == 1) {
+                    s = log_->WaitDone(-1);
+                    if (s.ok()) {
+                        continue;
+                    }
+                } else {
+                    s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
+                    break;
+                }
+            }
+            if (!s.ok()) {
+                s = Status::IOError(dbname_ + ": fail to sync log: ", s.ToString());
+                force_switch_log_ = true;
+            }
+        }
+        break;
+    }
+    return s;
+}
+
+Status DBTable::WriteCommitLog(WriteBatch* updates, bool sync) {
+    std::string log_path;
+    Status s = commit_log_->AddRecord(dbname_, WriteBatchInternal::Contents(updates),
+                                      sync, &log_path);
+    if (!s.ok()) {
+        return Status::IOError(dbname_ + ": fail to write commit log: ", s.ToString());
+    }
+    if (log_path == commit_log_path_) {
+        return s;
+    }
+    // first record in this commit log file, leave a reference in tablet dir
+    // before the write is acknowledged, so that recovery on any node finds it
+    std::string ref_name =
+        CommitLogRefFileName(dbname_, WriteBatchInternal::Sequence(updates));
+    s = WriteStringToFileSync(env_, log_path, ref_name);
+    if (!s.ok()) {
+        Log(options_.info_log, "[%s] fail to write commit log ref %s: %s",
+            dbname_.c_str(), ref_name.c_str(), s.ToString().c_str());
+        return Status::IOError(dbname_ + ": fail to write commit log ref: ", s.ToString());
+    }
+    commit_log_path_ = log_path;
+    return s;
+}
+
 // REQUIRES: Writer list must be non-empty
 // REQUIRES: First writer must have a non-NULL batch
 WriteBatch* DBTable::GroupWriteBatch(RecordWriter** last_writer) {
@@ -621,29 +678,25 @@ Status DBTable::Get(const ReadOptions& options,
         return Status::InvalidArgument("lg_id invalid: " + Uint64ToString(lg_id));
     }
     ReadOptions new_options = options;
-    MutexLock lock(&mutex_);
+    uint64_t commit_snapshot = CommitSnapshot();
     if (options.snapshot != kMaxSequenceNumber) {
         new_options.snapshot = options.snapshot;
-    } else if (commit_snapshot_ != kMaxSequenceNumber) {
-        new_options.snapshot = commit_snapshot_;
+    } else if (commit_snapshot != kMaxSequenceNumber) {
+        new_options.snapshot = commit_snapshot;
     }
-    mutex_.Unlock();
-    Status s = lg_list_[lg_id]->Get(new_options, real_key, value);
-    mutex_.Lock();
-    return s;
+    return lg_list_[lg_id]->Get(new_options, real_key, value);
 }
 
 Iterator* DBTable::NewIterator(const ReadOptions& options) {
     std::vector<Iterator*> list;
     ReadOptions new_options = options;
     std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
-    mutex_.Lock();
+    uint64_t commit_snapshot = CommitSnapshot();
     if (options.snapshot != kMaxSequenceNumber) {
         new_options.snapshot = options.snapshot;
-    } else if (commit_snapshot_ != kMaxSequenceNumber) {
-        new_options.snapshot = commit_snapshot_;
+    } else if (commit_snapshot != kMaxSequenceNumber) {
+        new_options.snapshot = commit_snapshot;
     }
-    mutex_.Unlock();
     it = options_.exist_lg_list->begin();
     for (; it != options_.exist_lg_list->end(); ++it) {
         if (options.target_lgs) {
@@ -743,6 +796,15 @@ void DBTable::GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize)
     }
 }
 
+uint64_t DBTable::GetMemTableUsage() {
+    uint64_t usage = 0;
+    std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
+    for (; it != options_.exist_lg_list->end(); ++it) {
+        usage += lg_list_[*it]->GetMemTableUsage();
+    }
+    return usage;
+}
+
 void DBTable::CompactRange(const Slice* begin, const Slice* end, int lg_no) {
     std::vector<LGCompactThread*> lg_threads;
     std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
@@ -762,7 +824,8 @@ void DBTable::CompactRange(const Slice* begin, const Slice* end, int lg_no) {
 
 // @begin_num:  the 1st record(sequence number) should be recover
 Status DBTable::GatherLogFile(uint64_t begin_num,
-                              std::vector<uint64_t>* logfiles) {
+                              std::vector<uint64_t>* logfiles,
+                              std::set<uint64_t>* log_refs) {
     std::vector<std::string> files;
     Status s = env_->GetChildren(dbname_, &files);
     if (!s.ok()) {
@@ -775,11 +838,16 @@ Status DBTable::GatherLogFile(uint64_t begin_num,
     for (uint32_t i = 0; i < files.size(); ++i) {
         type = kUnknown;
         number = 0;
-        if (ParseFileName(files[i], &number, &type)
-            && type == kLogFile
-            && number >= begin_num) {
+        if (!ParseFileName(files[i], &number, &type)
+            || (type != kLogFile && type != kCommitLogRefFile)) {
+            continue;
+        }
+        if (type == kCommitLogRefFile) {
+            log_refs->insert(number);
+        }
+        if (number >= begin_num) {
             logfiles->push_back(number);
-        } else if (type == kLogFile && number > last_number) {
+        } else if (number > last_number) {
             last_number = number;
         }
     }
@@ -846,79 +914,191 @@ Status DBTable::RecoverLogFile(uint64_t log_number, uint64_t recover_limit,
     // Read all the records and add to a memtable
     std::string scratch;
     Slice record;
-    WriteBatch batch;
     while (reader.ReadRecord(&record, &scratch) && status.ok()) {
         if (record.size() < 12) {
             reporter.Corruption(record.size(),
                                 Status::Corruption("log record too small"));
             continue;
         }
-        WriteBatchInternal::SetContents(&batch, record);
-        uint64_t first_seq = WriteBatchInternal::Sequence(&batch);
-        uint64_t last_seq = first_seq + WriteBatchInternal::Count(&batch) - 1;
-        //Log(options_.info_log, "[%s] batch_seq= %lu, last_seq= %lu, count=%d",
-        //    dbname_.c_str(), batch_seq, last_sequence_, WriteBatchInternal::Count(&batch));
-        if (last_seq >= recover_limit) {
-            Log(options_.info_log, "[%s] exceed limit %lu, ignore %lu ~ %lu",
-                        dbname_.c_str(), recover_limit, first_seq, last_seq);
-            continue;
-        }
+        status = RecoverLogRecord(record, recover_limit, edit_list);
+    }
+    Status apply_status = ApplyRecoverBatches(edit_list);
+    if (status.ok()) {
+        status = apply_status;
+    }
+    delete file;
 
-        if (last_seq > last_sequence_) {
-            last_sequence_ = last_seq;
-        }
+    return status;
+}
 
-        std::vector<WriteBatch*> lg_updates;
-        lg_updates.resize(lg_list_.size());
-        std::fill(lg_updates.begin(), lg_updates.end(), (WriteBatch*)0);
-        bool created_new_wb = false;
-        if (lg_list_.size() > 1) {
-            status = batch.SeperateLocalityGroup(&lg_updates);
-            created_new_wb = true;
-            if (!status.ok()) {
-                return status;
-            }
-        } else {
-            lg_updates[0] = (&batch);
+// Replay records of this tablet in the commit log file which
+// the reference file "ref_number" points to.
+Status DBTable::RecoverCommitLogRef(uint64_t ref_number, uint64_t recover_limit,
+                                    std::vector<VersionEdit*>* edit_list) {
+    mutex_.AssertHeld();
+
+    std::string log_path;
+    Status status = ReadFileToString(env_, CommitLogRefFileName(dbname_, ref_number),
+                                     &log_path);
+    if (!status.ok()) {
+        MaybeIgnoreError(&status);
+        return status;
+    }
+    Log(options_.info_log, "[%s] Recovering commit log %s, sequence limit %lu",
+        dbname_.c_str(), log_path.c_str(), recover_limit);
+
+    // the shared log holds records of all tablets on the node, it is split
+    // once by the commit log of this node for all tablets recovering from it
+    std::string records;
+    if (commit_log_) {
+        status = commit_log_->ReadTabletRecords(log_path, dbname_, &records);
+    } else {
+        std::map<std::string, std::string> split;
+        status = CommitLog::SplitLogFile(env_, log_path, &dbname_, &split);
+        records.swap(split[dbname_]);
+    }
+    if (!status.ok()) {
+        Log(options_.info_log, "[%s] fail to read commit log %s: %s",
+            dbname_.c_str(), log_path.c_str(), status.ToString().c_str());
+        MaybeIgnoreError(&status);
+        if (!status.ok()) {
+            return status;
         }
+    }
 
-        if (status.ok()) {
-            //TODO: should be multi-thread distributed
-            for (uint32_t i = 0; i < lg_updates.size(); ++i) {
-                if (lg_updates[i] == NULL) {
-                    continue;
-                }
-                if (last_seq <= lg_list_[i]->GetLastSequence()) {
-                    continue;
-                }
-                uint64_t first = WriteBatchInternal::Sequence(lg_updates[i]);
-                uint64_t last = first + WriteBatchInternal::Count(lg_updates[i]) - 1;
-                // Log(options_.info_log, "[%s] recover log batch first= %lu, last= %lu\n",
-                //     dbname_.c_str(), first, last);
-
-                Status lg_s = lg_list_[i]->RecoverInsertMem(lg_updates[i], (*edit_list)[i]);
-                if (!lg_s.ok()) {
-                    Log(options_.info_log, "[%s] recover log fail batch first= %lu, last= %lu\n",
-                        dbname_.c_str(), first, last);
-                    status = lg_s;
-                }
-            }
+    Slice input(records);
+    Slice record;
+    uint64_t record_num = 0;
+    while (status.ok() && GetLengthPrefixedSlice(&input, &record)) {
+        record_num++;
+        status = RecoverLogRecord(record, recover_limit, edit_list);
+    }
+    Status apply_status = ApplyRecoverBatches(edit_list);
+    if (status.ok()) {
+        status = apply_status;
+    }
+    Log(options_.info_log, "[%s] Recovered %lu records from commit log %s",
+        dbname_.c_str(), record_num, log_path.c_str());
+    return status;
+}
+
+Status DBTable::RecoverLogRecord(const Slice& record, uint64_t recover_limit,
+                                 std::vector<VersionEdit*>* edit_list) {
+    Status status;
+    WriteBatch batch;
+    WriteBatchInternal::SetContents(&batch, record);
+    uint64_t first_seq = WriteBatchInternal::Sequence(&batch);
+    uint64_t last_seq = first_seq + WriteBatchInternal::Count(&batch) - 1;
+    //Log(options_.info_log, "[%s] batch_seq= %lu, last_seq= %lu, count=%d",
+    //    dbname_.c_str(), batch_seq, last_sequence_, WriteBatchInternal::Count(&batch));
+    if (last_seq >= recover_limit) {
+        Log(options_.info_log, "[%s] exceed limit %lu, ignore %lu ~ %lu",
+                    dbname_.c_str(), recover_limit, first_seq, last_seq);
+        return status;
+    }
+
+    if (last_seq > last_sequence_) {
+        last_sequence_ = last_seq;
+    }
+
+    if (lg_list_.size() == 1) {
+        if (last_seq <= lg_list_[0]->GetLastSequence()) {
+            return status;
+        }
+        status = lg_list_[0]->RecoverInsertMem(&batch, (*edit_list)[0]);
+        if (!status.ok()) {
+            Log(options_.info_log, "[%s] recover log fail batch first= %lu, last= %lu\n",
+                dbname_.c_str(), first_seq, last_seq);
         }
+        return status;
+    }
 
-        if (created_new_wb) {
-            for (uint32_t i = 0; i < lg_updates.size(); ++i) {
-                if (lg_updates[i] != NULL) {
-                    delete lg_updates[i];
-                    lg_updates[i] = NULL;
-                }
-            }
+    // replayed by ApplyRecoverBatches together with the following records,
+    // "record" is only valid until the next read so keep a copy of it
+    if (recover_record_num_ == recover_records_.size()) {
+        recover_records_.push_back(new WriteBatch);
+        recover_views_.push_back(std::vector<LGBatchView>(lg_list_.size()));
+    }
+    WriteBatch* copy = recover_records_[recover_record_num_];
+    std::vector<LGBatchView>& views = recover_views_[recover_record_num_];
+    WriteBatchInternal::SetContents(copy, record);
+    status = WriteBatchInternal::SeperateLocalityGroup(copy, &views);
+    if (!status.ok()) {
+        return status;
+    }
+    for (uint32_t i = 0; i < views.size(); ++i) {
+        if (last_seq <= lg_list_[i]->GetLastSequence()) {
+            // already dumped by this lg
+            views[i].batch = NULL;
         }
     }
-    delete file;
+    recover_record_num_++;
+    recover_batches_size_ += record.size();
+    if (recover_batches_size_ >= kRecoverGroupSize) {
+        status = ApplyRecoverBatches(edit_list);
+    }
+    return status;
+}
 
+Status DBTable::ApplyRecoverBatches(std::vector<VersionEdit*>* edit_list) {
+    if (recover_batches_size_ == 0) {
+        return Status::OK();
+    }
+    LGRecoverArg arg(this, edit_list);
+    Status status = LGWriteThreadPool::Default()->RunAll(&DBTable::RecoverLG, &arg,
+                                                         lg_list_.size());
+    recover_record_num_ = 0;
+    recover_batches_size_ = 0;
     return status;
 }
 
+void DBTable::ReleaseRecoverBatches() {
+    for (uint32_t i = 0; i < recover_records_.size(); ++i) {
+        delete recover_records_[i];
+    }
+    recover_records_.clear();
+    recover_views_.clear();
+    recover_record_num_ = 0;
+    recover_batches_size_ = 0;
+}
+
+Status DBTable::WriteLG(void* arg, uint32_t lg_id) {
+    LGWriteArg* write_arg = reinterpret_cast<LGWriteArg*>(arg);
+    DBTable* db = write_arg->db;
+    Status s;
+    if (db->lg_list_.size() == 1) {
+        s = db->lg_list_[lg_id]->Write(WriteOptions(), write_arg->updates);
+    } else {
+        s = db->lg_list_[lg_id]->Write(WriteOptions(), db->write_views_[lg_id]);
+    }
+    if (!s.ok()) {
+        Log(db->options_.info_log, "[%s] [Fatal] Write to lg%u fail",
+            db->dbname_.c_str(), lg_id);
+    }
+    return s;
+}
+
+Status DBTable::RecoverLG(void* arg, uint32_t lg_id) {
+    LGRecoverArg* recover_arg = reinterpret_cast<LGRecoverArg*>(arg);
+    DBTable* db = recover_arg->db;
+    Status s;
+    for (uint32_t i = 0; s.ok() && i < db->recover_record_num_; ++i) {
+        const LGBatchView& view = db->recover_views_[i][lg_id];
+        if (view.batch == NULL) {
+            continue;
+        }
+        s = db->lg_list_[lg_id]->RecoverInsertMem(view,
+                                                  (*recover_arg->edit_list)[lg_id]);
+        if (!s.ok()) {
+            uint64_t first = view.sequence;
+            uint64_t last = first + view.Count() - 1;
+            Log(db->options_.info_log, "[%s] recover log fail lg%u batch first= %lu, last= %lu\n",
+                db->dbname_.c_str(), lg_id, first, last);
+        }
+    }
+    return s;
+}
+
 void DBTable::MaybeIgnoreError(Status* s) const {
     if (s->ok() || options_.paranoid_checks) {
         // No change needed
@@ -929,14 +1109,17 @@ void DBTable::MaybeIgnoreError(Status* s) const {
     }
 }
 
-Status DBTable::DeleteLogFile(const std::vector<uint64_t>& log_numbers) {
+Status DBTable::DeleteLogFile(const std::vector<uint64_t>& log_numbers,
+                              const std::set<uint64_t>& log_refs) {
     Status s;
     for (uint32_t i = 0; i < log_numbers.size() && s.ok(); ++i) {
         uint64_t log_number = log_numbers[i];
+        bool is_ref = (log_refs.find(log_number) != log_refs.end());
         Log(options_.info_log, "[%s] Delete type=%s #%llu",
-            dbname_.c_str(), FileTypeToString(kLogFile),
+            dbname_.c_str(), FileTypeToString(is_ref ? kCommitLogRefFile : kLogFile),
             static_cast<unsigned long long>(log_number));
-        std::string fname = LogHexFileName(dbname_, log_number);
+        std::string fname = is_ref ? CommitLogRefFileName(dbname_, log_number)
+                                   : LogHexFileName(dbname_, log_number);
         s = env_->DeleteFile(fname);
         // The last log file must be deleted before write a new log
         // in case of record sequence_id overlap;
@@ -965,7 +1148,7 @@ void DBTable::DeleteObsoleteFiles(uint64_t seq_no) {
     for (size_t i = 0; i < filenames.size(); ++i) {
         bool deleted = false;
         if (ParseFileName(filenames[i], &number, &type)
-            && type == kLogFile) {
+            && (type == kLogFile || type == kCommitLogRefFile)) {
             if (number < seq_no) {
                 deleted = true;
                 delete_log_num++;
@@ -1175,6 +1358,20 @@ void DBTable::GarbageCleanWrapper(void* db) {
 }
 
 void DBTable::BackgroundGarbageClean() {
+    mutex_.Lock();
+    bool need_flush = commit_log_need_flush_;
+    commit_log_need_flush_ = false;
+    mutex_.Unlock();
+    if (need_flush && !shutting_down_.Acquire_Load()) {
+        // this tablet pins the oldest commit log file, dump memtables so
+        // the file can be released by next garbage clean
+        Log(options_.info_log, "[%s] flush memtable to release commit log",
+            dbname_.c_str());
+        std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
+        for (; it != options_.exist_lg_list->end(); ++it) {
+            lg_list_[*it]->AddBoundLogSize(options_.flush_triggered_log_size);
+        }
+    }
     if (!shutting_down_.Acquire_Load()) {
         GarbageClean();
     }
@@ -1207,7 +1404,23 @@ void DBTable::GarbageClean() {
         Log(options_.info_log, "[%s] delete obsolete file, seq_no below: %lu",
             dbname_.c_str(), min_last_seq);
         DeleteObsoleteFiles(min_last_seq);
+        if (commit_log_) {
+            commit_log_->Release(dbname_, min_last_seq);
+        }
+    }
+}
+
+void DBTable::CommitLogReleaseWrapper(void* db, bool need_flush) {
+    DBTable* db_table = reinterpret_cast<DBTable*>(db);
+    db_table->ReleaseCommitLog(need_flush);
+}
+
+void DBTable::ReleaseCommitLog(bool need_flush) {
+    MutexLock lock(&mutex_);
+    if (need_flush) {
+        commit_log_need_flush_ = true;
     }
+    ScheduleGarbageClean(need_flush ? kDeleteLogUrgentScore : kDeleteLogScore);
 }
 
 } // namespace leveldb
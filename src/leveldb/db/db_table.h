@@ -18,6 +18,7 @@
 
 #include "db/dbformat.h"
 #include "db/version_edit.h"
+#include "db/write_batch_internal.h"
 #include "leveldb/db.h"
 
 namespace leveldb {
@@ -118,6 +119,10 @@ public:
     // lgsize: each lg size, include all storage
     virtual void GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize);
 
+    // tera-specific
+    // memory of the memtables of all lgs
+    virtual uint64_t GetMemTableUsage();
+
     // Compact the underlying storage for the key range [*begin,*end].
     // In particular, deleted and overwritten versions are discarded,
     // and the data is rearranged to reduce the cost of operations
@@ -150,12 +155,25 @@ private:
     struct RecordWriter;
     WriteBatch* GroupWriteBatch(RecordWriter** last_writer);
 
+    Status WriteLogFile(const Slice& record, bool sync);
+    Status WriteCommitLog(WriteBatch* updates, bool sync);
+
     Status RecoverLogFile(uint64_t log_number, uint64_t recover_limit,
                           std::vector<VersionEdit*>* edit_list);
+    Status RecoverCommitLogRef(uint64_t ref_number, uint64_t recover_limit,
+                               std::vector<VersionEdit*>* edit_list);
+    Status RecoverLogRecord(const Slice& record, uint64_t recover_limit,
+                            std::vector<VersionEdit*>* edit_list);
+    // Replay the records gathered in recover_records_, lgs in parallel.
+    Status ApplyRecoverBatches(std::vector<VersionEdit*>* edit_list);
+    void ReleaseRecoverBatches();
     void MaybeIgnoreError(Status* s) const;
+    // @log_refs: numbers in "logfiles" which refer to the shared commit log
     Status GatherLogFile(uint64_t begin_num,
-                         std::vector<uint64_t>* logfiles);
-    Status DeleteLogFile(const std::vector<uint64_t>& log_numbers);
+                         std::vector<uint64_t>* logfiles,
+                         std::set<uint64_t>* log_refs);
+    Status DeleteLogFile(const std::vector<uint64_t>& log_numbers,
+                         const std::set<uint64_t>& log_refs);
     void DeleteObsoleteFiles(uint64_t seq_no = -1U);
     void ArchiveFile(const std::string& filepath);
 
@@ -168,6 +186,33 @@ private:
     void BackgroundGarbageClean();
     void GarbageClean();
 
+    static void CommitLogReleaseWrapper(void* db, bool need_flush);
+    void ReleaseCommitLog(bool need_flush);
+
+    // per-lg tasks run by LGWriteThreadPool
+    struct LGWriteArg {
+        DBTable* db;
+        WriteBatch* updates;
+        LGWriteArg(DBTable* d, WriteBatch* u) : db(d), updates(u) {}
+    };
+    struct LGRecoverArg {
+        DBTable* db;
+        std::vector<VersionEdit*>* edit_list;
+        LGRecoverArg(DBTable* d, std::vector<VersionEdit*>* e) : db(d), edit_list(e) {}
+    };
+    static Status WriteLG(void* arg, uint32_t lg_id);
+    static Status RecoverLG(void* arg, uint32_t lg_id);
+
+    // commit_snapshot_ is kept in a pointer, sequence numbers fit in it on
+    // the 64-bit platforms tera runs on
+    SequenceNumber CommitSnapshot() const {
+        return reinterpret_cast<uintptr_t>(commit_snapshot_.Acquire_Load());
+    }
+    void SetCommitSnapshot(SequenceNumber sequence) {
+        commit_snapshot_.Release_Store(
+            reinterpret_cast<void*>(static_cast<uintptr_t>(sequence)));
+    }
+
 private:
     State state_;
     std::vector<DBImpl*> lg_list_;
@@ -182,7 +227,8 @@ private:
     bool created_own_lg_list_;
     bool created_own_info_log_;
     bool created_own_compact_strategy_;
-    uint64_t commit_snapshot_;
+    // written under mutex_, read without it by Get() and NewIterator()
+    port::AtomicPointer commit_snapshot_;
     Status fatal_error_;
 
     WritableFile* logfile_;
@@ -191,6 +237,22 @@ private:
     uint64_t last_sequence_;
     size_t current_log_size_;
 
+    // node-wide shared log, used instead of logfile_ if not NULL
+    CommitLog* commit_log_;
+    std::string commit_log_path_;
+    bool commit_log_need_flush_;
+
+    // per-lg views of the batch being written, only used by the writer
+    // at the front of writers_
+    std::vector<LGBatchView> write_views_;
+
+    // copies of the records waiting to be replayed and their per-lg views,
+    // kept for reuse until recovery is done
+    std::vector<WriteBatch*> recover_records_;
+    std::vector<std::vector<LGBatchView> > recover_views_;
+    uint32_t recover_record_num_;
+    uint64_t recover_batches_size_;
+
     std::deque<RecordWriter*> writers_;
     WriteBatch* tmp_batch_;
 
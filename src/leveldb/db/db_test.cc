@@ -12,10 +12,12 @@
 #include "db/filename.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/arena_pool.h"
 #include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/lg_coding.h"
+#include "leveldb/raw_key_operator.h"
 #include "leveldb/table.h"
 #include "util/hash.h"
 #include "util/logging.h"
@@ -203,6 +205,8 @@ class DBTest {
     kDefault,
     kFilter,
     kUncompressed,
+    kReadahead,
+    kArenaPool,
     kEnd
   };
   int option_config_;
@@ -213,10 +217,12 @@ class DBTest {
   DB* db_;
 
   Options last_options_;
+  ArenaPool* arena_pool_;
 
   DBTest() : option_config_(kDefault),
              env_(new SpecialEnv(Env::Default())) {
     filter_policy_ = NewBloomFilterPolicy(10);
+    arena_pool_ = NewArenaPool(1 << 20, 4 << 20, true);
     dbname_ = test::TmpDir() + "/db_test/tablet00000012";
     DestroyDB(dbname_, Options());
     db_ = NULL;
@@ -228,6 +234,7 @@ class DBTest {
     DestroyDB(dbname_, Options());
     delete env_;
     delete filter_policy_;
+    delete arena_pool_;
   }
 
   // Switch to a fresh database with the next option configuration to
@@ -257,6 +264,13 @@ class DBTest {
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kReadahead:
+        // small chunks, blocks often straddle two of them
+        options.compaction_readahead_size = 4096;
+        break;
+      case kArenaPool:
+        options.arena_pool = arena_pool_;
+        break;
       default:
         break;
     }
@@ -987,6 +1001,219 @@ TEST(DBTest, CompactionsGenerateMultipleFiles) {
   }
 }
 
+TEST(DBTest, SubCompactions) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000000;
+  options.sst_size = 50000;
+  options.max_subcompactions = 4;
+  Reopen(&options);
+
+  // Overlapping level-0 files, with deletions in the newest ones
+  Random rnd(301);
+  std::vector<std::string> values(400);
+  for (int round = 0; round < 4; round++) {
+    for (int i = round; i < 400; i += 2) {
+      if (round == 3 && i % 7 == 0) {
+        ASSERT_OK(Delete(Key(i)));
+        values[i] = "NOT_FOUND";
+      } else {
+        values[i] = RandomString(&rnd, 1000);
+        ASSERT_OK(Put(Key(i), values[i]));
+      }
+    }
+    dbfull()->TEST_CompactMemTable();
+  }
+
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    dbfull()->TEST_CompactRange(level, NULL, NULL);
+  }
+  for (int i = 0; i < 400; i++) {
+    ASSERT_EQ(Get(Key(i)), values[i]);
+  }
+
+  // Every key once, in order
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->SeekToFirst();
+  for (int i = 0; i < 400; i++) {
+    if (values[i] == "NOT_FOUND") {
+      continue;
+    }
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key().ToString(), Key(i));
+    ASSERT_EQ(iter->value().ToString(), values[i]);
+    iter->Next();
+  }
+  ASSERT_TRUE(!iter->Valid());
+  delete iter;
+}
+
+namespace {
+
+struct SubCompactionWriter {
+  DB* db;
+  int num;
+  port::AtomicPointer done;
+};
+
+static void SubCompactionWriterBody(void* arg) {
+  SubCompactionWriter* w = reinterpret_cast<SubCompactionWriter*>(arg);
+  for (int i = 0; i < w->num; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "w%06d", i);
+    ASSERT_OK(w->db->Put(WriteOptions(), key, std::string(1000, 'w')));
+  }
+  w->done.Release_Store(w);
+}
+
+}  // namespace
+
+// Memtables filled while subcompactions run are dumped meanwhile, also
+// once the compaction thread only waits for the others.
+TEST(DBTest, SubCompactionsWithWrites) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;
+  options.sst_size = 50000;
+  options.max_subcompactions = 4;
+  Reopen(&options);
+
+  Random rnd(301);
+  std::vector<std::string> values(400);
+  for (int round = 0; round < 4; round++) {
+    for (int i = round; i < 400; i += 2) {
+      values[i] = RandomString(&rnd, 1000);
+      ASSERT_OK(Put(Key(i), values[i]));
+    }
+    dbfull()->TEST_CompactMemTable();
+  }
+
+  SubCompactionWriter writer;
+  writer.db = db_;
+  writer.num = 2000;
+  writer.done.Release_Store(NULL);
+  env_->StartThread(SubCompactionWriterBody, &writer);
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    dbfull()->TEST_CompactRange(level, NULL, NULL);
+  }
+  while (writer.done.Acquire_Load() == NULL) {
+    DelayMilliseconds(10);
+  }
+
+  for (int i = 0; i < 400; i++) {
+    ASSERT_EQ(Get(Key(i)), values[i]);
+  }
+  char key[20];
+  for (int i = 0; i < writer.num; i++) {
+    snprintf(key, sizeof(key), "w%06d", i);
+    ASSERT_EQ(Get(key), std::string(1000, 'w'));
+  }
+}
+
+TEST(DBTest, ReadaheadIterator) {
+  do {
+    Random rnd(301);
+    std::vector<std::string> values(300);
+    for (int i = 0; i < 300; i++) {
+      values[i] = RandomString(&rnd, 1000);
+      ASSERT_OK(Put(Key(i), values[i]));
+      if (i % 100 == 99) {
+        dbfull()->TEST_CompactMemTable();
+      }
+    }
+
+    ReadOptions options;
+    options.readahead_size = 10000;
+    Iterator* iter = db_->NewIterator(options);
+    iter->SeekToFirst();
+    for (int i = 0; i < 300; i++) {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(iter->key().ToString(), Key(i));
+      ASSERT_EQ(iter->value().ToString(), values[i]);
+      iter->Next();
+    }
+    ASSERT_TRUE(!iter->Valid());
+    // seeks move the read-ahead
+    iter->Seek(Key(250));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->value().ToString(), values[250]);
+    iter->Seek(Key(10));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->value().ToString(), values[10]);
+    delete iter;
+  } while (ChangeOptions());
+}
+
+TEST(DBTest, ArenaPoolMemTable) {
+  Options options = CurrentOptions();
+  options.arena_pool = arena_pool_;
+  Reopen(&options);
+  // an empty memtable holds a single heap block, no chunk
+  ASSERT_EQ(arena_pool_->UsedBytes(), 0u);
+  ASSERT_LT(dbfull()->GetMemTableUsage(), ArenaPool::kMinChunkSize);
+
+  Random rnd(301);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
+  }
+  // the memtable memory is in chunks of the pool but for the first
+  // small blocks
+  uint64_t usage = dbfull()->GetMemTableUsage();
+  ASSERT_GE(usage, 1000 * 1000u);
+  ASSERT_GE(arena_pool_->UsedBytes(), usage - ArenaPool::kMinChunkSize);
+
+  // dumped memtables return their chunks
+  size_t used = arena_pool_->UsedBytes();
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_LT(arena_pool_->UsedBytes(), used / 2);
+  ASSERT_LT(dbfull()->GetMemTableUsage(), usage / 2);
+  ASSERT_GT(arena_pool_->FreeBytes(), 0u);
+}
+
+TEST(DBTest, BottomCompression) {
+  Options options = CurrentOptions();
+  options.compression = kSnappyCompression;
+  options.bottom_compression = kZstdCompression;
+  options.bottom_compression_level = 1;
+  options.compression_dict_size = 1024;
+  options.block_size = 1024;
+  Reopen(&options);
+
+  // two overlapping dumps, so that compactions rewrite the files
+  // rather than move them
+  Random rnd(301);
+  std::string tmp;
+  std::vector<std::string> values(400);
+  for (int round = 0; round < 2; round++) {
+    for (int i = round; i < 400; i++) {
+      values[i] = test::CompressibleString(&rnd, 0.25, 1000, &tmp).ToString();
+      ASSERT_OK(Put(Key(i), values[i]));
+    }
+    dbfull()->TEST_CompactMemTable();
+  }
+  for (int i = 0; i < 400; i++) {
+    ASSERT_EQ(Get(Key(i)), values[i]);
+  }
+  // then from the zstd files of the compacted levels
+  for (int level = 0; level < config::kNumLevels - 1; level++) {
+    dbfull()->TEST_CompactRange(level, NULL, NULL);
+  }
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  for (int i = 0; i < 400; i++) {
+    ASSERT_EQ(Get(Key(i)), values[i]);
+  }
+
+  Reopen(&options);
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->SeekToFirst();
+  for (int i = 0; i < 400; i++) {
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key().ToString(), Key(i));
+    ASSERT_EQ(iter->value().ToString(), values[i]);
+    iter->Next();
+  }
+  ASSERT_TRUE(!iter->Valid());
+  delete iter;
+}
+
 #if 0 // config::kL0_StopWritesTrigger is changed
 TEST(DBTest, RepeatedWritesToSameKey) {
   Options options = CurrentOptions();
@@ -1690,6 +1917,80 @@ TEST(DBTest, BloomFilter) {
   delete options.filter_policy;
 }
 
+static std::string RowKey(const std::string& row, const std::string& qualifier,
+                          TeraKeyType type) {
+  std::string key;
+  ReadableRawKeyOperator()->EncodeTeraKey(row, "cf", qualifier, 1, type, &key);
+  return key;
+}
+
+TEST(DBTest, RowBloomFilter) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewRowKeyBloomFilterPolicy(10, ReadableRawKeyOperator());
+  Reopen(&options);
+
+  // Populate multiple layers, 3 cells per row
+  const int N = 3000;
+  for (int i = 0; i < N; i++) {
+    for (int q = 0; q < 3; q++) {
+      ASSERT_OK(Put(RowKey(Key(i), Key(q), TKT_VALUE), Key(i)));
+    }
+  }
+  Compact("a", "z");
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_OK(Put(RowKey(Key(i), Key(0), TKT_VALUE), Key(i)));
+  }
+  dbfull()->TEST_CompactMemTable();
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_sstable_sync_.Release_Store(env_);
+
+  ReadOptions read_options;
+  read_options.single_row_read = true;
+
+  // Get on the whole key still works with row filter
+  ASSERT_EQ(Key(7), Get(RowKey(Key(7), Key(2), TKT_VALUE)));
+  ASSERT_EQ("NOT_FOUND", Get(RowKey(Key(7) + ".missing", Key(2), TKT_VALUE)));
+
+  // Seek present rows.
+  for (int i = 0; i < N; i++) {
+    Iterator* iter = db_->NewIterator(read_options);
+    iter->Seek(RowKey(Key(i), "", TKT_FORSEEK));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(RowKey(Key(i), Key(0), TKT_VALUE), iter->key().ToString());
+    iter->Seek(RowKey(Key(i), Key(2), TKT_FORSEEK));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(RowKey(Key(i), Key(2), TKT_VALUE), iter->key().ToString());
+    delete iter;
+  }
+
+  // Seek missing rows.  Should rarely read from either sstable.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    Iterator* iter = db_->NewIterator(read_options);
+    iter->Seek(RowKey(Key(i) + ".missing", "", TKT_FORSEEK));
+    if (iter->Valid()) {
+      Slice row;
+      ReadableRawKeyOperator()->ExtractTeraKey(iter->key(), &row,
+                                               NULL, NULL, NULL, NULL);
+      ASSERT_TRUE(row.ToString() != Key(i) + ".missing");
+    }
+    ASSERT_OK(iter->status());
+    delete iter;
+  }
+  int reads = env_->random_read_counter_.Read();
+  fprintf(stderr, "%d missing rows => %d reads\n", N, reads);
+  ASSERT_LE(reads, 3*N/100);
+
+  env_->delay_sstable_sync_.Release_Store(NULL);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
 // Multi-threaded test:
 namespace {
 
@@ -1789,6 +2090,146 @@ TEST(DBTest, MultiThreaded) {
   } while (ChangeOptions());
 }
 
+// Readers racing the installs of new read views: memtable switches,
+// compactions and shutdown.
+namespace {
+
+static const int kReadViewKeys = 1000;
+static const int kReadViewThreads = 4;
+
+struct ReadViewState {
+  DB* db;
+  port::AtomicPointer stop;
+  port::AtomicPointer thread_done[kReadViewThreads];
+};
+
+struct ReadViewThread {
+  ReadViewState* state;
+  int id;
+};
+
+static std::string ReadViewValue(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "value%d", i);
+  return std::string(buf) + std::string(200, 'v');
+}
+
+// Even threads get present and missing keys, the misses go through all
+// the overlapping files and feed the sampled seek compactions.  Odd
+// threads scan every key.
+static void ReadViewThreadBody(void* arg) {
+  ReadViewThread* t = reinterpret_cast<ReadViewThread*>(arg);
+  DB* db = t->state->db;
+  Random rnd(1000 + t->id);
+  std::string value;
+  while (t->state->stop.Acquire_Load() == NULL) {
+    if (t->id % 2 == 0) {
+      int i = rnd.Uniform(kReadViewKeys);
+      ASSERT_OK(db->Get(ReadOptions(), Key(i), &value));
+      ASSERT_EQ(value, ReadViewValue(i));
+      ASSERT_TRUE(db->Get(ReadOptions(), Key(i) + "x", &value).IsNotFound());
+    } else {
+      Iterator* iter = db->NewIterator(ReadOptions());
+      int i = 0;
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+        ASSERT_EQ(iter->key().ToString(), Key(i));
+        ASSERT_EQ(iter->value().ToString(), ReadViewValue(i));
+      }
+      ASSERT_OK(iter->status());
+      ASSERT_EQ(i, kReadViewKeys);
+      delete iter;
+    }
+  }
+  t->state->thread_done[t->id].Release_Store(t);
+}
+
+static void StartReadViewThreads(Env* env, ReadViewState* state,
+                                 ReadViewThread* threads) {
+  state->stop.Release_Store(NULL);
+  for (int id = 0; id < kReadViewThreads; id++) {
+    state->thread_done[id].Release_Store(NULL);
+    threads[id].state = state;
+    threads[id].id = id;
+    env->StartThread(ReadViewThreadBody, &threads[id]);
+  }
+}
+
+static void StopReadViewThreads(ReadViewState* state) {
+  state->stop.Release_Store(state);
+  for (int id = 0; id < kReadViewThreads; id++) {
+    while (state->thread_done[id].Acquire_Load() == NULL) {
+      DelayMilliseconds(10);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(DBTest, ReadViewSwitches) {
+  do {
+    Options options = CurrentOptions();
+    options.write_buffer_size = 128 << 10;
+    Reopen(&options);
+    for (int i = 0; i < kReadViewKeys; i++) {
+      ASSERT_OK(Put(Key(i), ReadViewValue(i)));
+    }
+
+    ReadViewState state;
+    state.db = db_;
+    ReadViewThread threads[kReadViewThreads];
+    StartReadViewThreads(env_, &state, threads);
+
+    // rewrite the same values: the memtable switches every few hundred
+    // keys, level-0 files pile up and get compacted under the readers
+    for (int round = 0; round < 10; round++) {
+      for (int i = round % 2; i < kReadViewKeys; i += 2) {
+        ASSERT_OK(Put(Key(i), ReadViewValue(i)));
+      }
+      if (round % 3 == 0) {
+        dbfull()->TEST_CompactMemTable();
+      }
+      if (round % 5 == 4) {
+        dbfull()->TEST_CompactRange(0, NULL, NULL);
+      }
+    }
+    DelayMilliseconds(100);
+    StopReadViewThreads(&state);
+  } while (ChangeOptions());
+}
+
+TEST(DBTest, ReadViewShutdown) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 128 << 10;
+  options.dump_mem_on_shutdown = true;
+  Reopen(&options);
+  // in the files, the memtable and the dumping one
+  for (int i = 0; i < kReadViewKeys; i++) {
+    ASSERT_OK(Put(Key(i), ReadViewValue(i)));
+  }
+  dbfull()->TEST_CompactMemTable();
+  for (int i = 0; i < kReadViewKeys; i += 3) {
+    ASSERT_OK(Put(Key(i), ReadViewValue(i)));
+  }
+
+  ReadViewState state;
+  state.db = db_;
+  ReadViewThread threads[kReadViewThreads];
+  StartReadViewThreads(env_, &state, threads);
+
+  // readers keep the last view once the memtables are gone
+  DelayMilliseconds(100);
+  ASSERT_OK(db_->Shutdown1());
+  DelayMilliseconds(100);
+  ASSERT_OK(db_->Shutdown2());
+  DelayMilliseconds(100);
+  StopReadViewThreads(&state);
+
+  Reopen(&options);
+  for (int i = 0; i < kReadViewKeys; i++) {
+    ASSERT_EQ(Get(Key(i)), ReadViewValue(i));
+  }
+}
+
 namespace {
 typedef std::map<std::string, std::string> KVMap;
 }
@@ -1878,6 +2319,10 @@ class ModelDB: public DB {
                                    std::vector<uint64_t>* lgsize = NULL) {
   }
 
+  virtual uint64_t GetMemTableUsage() {
+    return 0;
+  }
+
   virtual void CompactRange(const Slice* start, const Slice* end, int lg_no) {
   }
 
@@ -2125,6 +2570,46 @@ TEST(DBTest, LG_ReadWrite) {
 }
 #endif
 
+TEST(DBTest, LGParallelWriteAndRecover) {
+  const uint32_t lg_num = 4;
+  std::set<uint32_t> lg_list;
+  for (uint32_t i = 0; i < lg_num; ++i) {
+    lg_list.insert(i);
+  }
+  Options options = CurrentOptions();
+  options.exist_lg_list = &lg_list;
+  DestroyAndReopen(&options);
+
+  const int N = 2000;
+  for (int i = 0; i < N; ++i) {
+    WriteBatch batch;
+    for (uint32_t lg = 0; lg < lg_num; ++lg) {
+      // some batches leave lgs empty
+      if ((i + lg) % 3 == 0) {
+        continue;
+      }
+      std::string key = Key(i);
+      PutFixed32LGId(&key, lg);
+      batch.Put(key, Key(i * lg_num + lg));
+    }
+    ASSERT_OK(db_->Write(WriteOptions(), &batch));
+  }
+
+  // memtables are not dumped on shutdown, reopen replays the log to all lgs
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < N; ++i) {
+      for (uint32_t lg = 0; lg < lg_num; ++lg) {
+        std::string key = Key(i);
+        PutFixed32LGId(&key, lg);
+        std::string expect = ((i + lg) % 3 == 0) ? "NOT_FOUND" : Key(i * lg_num + lg);
+        ASSERT_EQ(expect, Get(key));
+      }
+    }
+    Reopen(&options);
+  }
+  Close();
+}
+
 std::string MakeKey(unsigned int num) {
   char buf[30];
   snprintf(buf, sizeof(buf), "%016u", num);
@@ -134,6 +134,7 @@ class InternalFilterPolicy : public FilterPolicy {
   virtual const char* Name() const;
   virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const;
   virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const;
+  virtual bool IsRowFilter() const;
 };
 
 // Modules in this directory should keep internal keys wrapped inside
@@ -72,6 +72,16 @@ std::string LogHexFileName(const std::string& name, uint64_t number) {
   return name + std::string("/H") + Uint64ToString(number, 16) + ".log";
 }
 
+std::string CommitLogFileName(const std::string& log_dir, uint64_t number) {
+  assert(number > 0);
+  return log_dir + std::string("/H") + Uint64ToString(number, 16) + ".clog";
+}
+
+std::string CommitLogRefFileName(const std::string& name, uint64_t number) {
+  assert(number > 0);
+  return name + std::string("/H") + Uint64ToString(number, 16) + ".clogref";
+}
+
 std::string TableFileName(const std::string& name, uint64_t number) {
   assert(number > 0);
   if (number < (1ull << 63)) {
@@ -120,6 +130,7 @@ std::string OldInfoLogFileName(const std::string& dbname) {
 //    dbname/LOG.old
 //    dbname/MANIFEST-[0-9]+
 //    dbname/[0-9]+.(log|sst)
+//    dbname/H[0-9a-f]+.(log|clog|clogref)
 bool ParseFileName(const std::string& fname,
                    uint64_t* number,
                    FileType* type) {
@@ -158,6 +169,10 @@ bool ParseFileName(const std::string& fname,
       *type = kTableFile;
     } else if (suffix == Slice(".dbtmp")) {
       *type = kTempFile;
+    } else if (suffix == Slice(".clog")) {
+      *type = kCommitLogFile;
+    } else if (suffix == Slice(".clogref")) {
+      *type = kCommitLogRefFile;
     } else {
       return false;
     }
@@ -205,6 +220,10 @@ const char* FileTypeToString(FileType type) {
     return "kTempFile";
   case kInfoLogFile:
     return "kInfoLogFile";
+  case kCommitLogFile:
+    return "kCommitLogFile";
+  case kCommitLogRefFile:
+    return "kCommitLogRefFile";
   default:
     return "kUnknown";
   }
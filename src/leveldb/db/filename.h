@@ -30,7 +30,9 @@ enum FileType {
   kDescriptorFile,
   kCurrentFile,
   kTempFile,
-  kInfoLogFile  // Either the current one, or an old one
+  kInfoLogFile,  // Either the current one, or an old one
+  kCommitLogFile,
+  kCommitLogRefFile
 };
 
 // Return the name of the log file with the specified number
@@ -41,6 +43,16 @@ extern std::string LogFileName(const std::string& dbname, uint64_t number);
 // for qinan
 extern std::string LogHexFileName(const std::string& dbname, uint64_t number);
 
+// Return the name of the node-wide commit log file with the specified
+// number in "log_dir".
+extern std::string CommitLogFileName(const std::string& log_dir,
+                                     uint64_t number);
+
+// Return the name of the file in the db named by "dbname" which refers
+// to the commit log holding records from sequence "number".
+extern std::string CommitLogRefFileName(const std::string& dbname,
+                                        uint64_t number);
+
 // Return the name of the sstable with the specified number
 // in the db named by "dbname".  The result will be prefixed with
 // "dbname".
@@ -0,0 +1,131 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "db/lg_write_thread.h"
+
+#include <pthread.h>
+
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+struct LGWriteThreadPool::Job {
+    port::Mutex mutex;
+    port::CondVar cv;
+    LGTask task;
+    void* arg;
+    uint32_t lg_num;
+    uint32_t next_lg;   // the first lg not claimed yet
+    uint32_t done_num;
+    int refs;           // caller and pending pool tasks
+    Status status;
+
+    Job() : cv(&mutex) {}
+};
+
+static pthread_once_t lg_write_pool_once = PTHREAD_ONCE_INIT;
+static LGWriteThreadPool* lg_write_pool = NULL;
+
+void LGWriteThreadPool::InitDefault() {
+    lg_write_pool = new LGWriteThreadPool;
+}
+
+LGWriteThreadPool* LGWriteThreadPool::Default() {
+    pthread_once(&lg_write_pool_once, &LGWriteThreadPool::InitDefault);
+    return lg_write_pool;
+}
+
+LGWriteThreadPool::LGWriteThreadPool()
+    : thread_num_(4), pool_(new ThreadPool) {
+    pool_->SetBackgroundThreads(thread_num_);
+}
+
+LGWriteThreadPool::~LGWriteThreadPool() {
+    delete pool_;
+}
+
+void LGWriteThreadPool::SetBackgroundThreads(int num) {
+    MutexLock lock(&mutex_);
+    thread_num_ = num;
+    if (num > 0) {
+        pool_->SetBackgroundThreads(num);
+    }
+}
+
+Status LGWriteThreadPool::RunAll(LGTask task, void* arg, uint32_t lg_num) {
+    int thread_num = 0;
+    {
+        MutexLock lock(&mutex_);
+        thread_num = thread_num_;
+    }
+    if (lg_num <= 1 || thread_num <= 0) {
+        Status s;
+        for (uint32_t i = 0; i < lg_num; ++i) {
+            Status lg_s = (*task)(arg, i);
+            if (s.ok() && !lg_s.ok()) {
+                s = lg_s;
+            }
+        }
+        return s;
+    }
+
+    // pool tasks may start after the caller returns, keep job on heap
+    Job* job = new Job;
+    job->task = task;
+    job->arg = arg;
+    job->lg_num = lg_num;
+    job->next_lg = 0;
+    job->done_num = 0;
+    uint32_t helper_num = lg_num - 1;
+    if (helper_num > static_cast<uint32_t>(thread_num)) {
+        helper_num = thread_num;
+    }
+    job->refs = helper_num + 1;
+    for (uint32_t i = 0; i < helper_num; ++i) {
+        pool_->Schedule(&LGWriteThreadPool::RunJobWrapper, job, 0, 0);
+    }
+
+    RunJob(job);
+    job->mutex.Lock();
+    while (job->done_num < job->lg_num) {
+        job->cv.Wait();
+    }
+    Status s = job->status;
+    job->mutex.Unlock();
+    UnrefJob(job);
+    return s;
+}
+
+void LGWriteThreadPool::RunJobWrapper(void* job) {
+    Job* j = reinterpret_cast<Job*>(job);
+    RunJob(j);
+    UnrefJob(j);
+}
+
+void LGWriteThreadPool::RunJob(Job* job) {
+    MutexLock lock(&job->mutex);
+    while (job->next_lg < job->lg_num) {
+        uint32_t lg_id = job->next_lg++;
+        job->mutex.Unlock();
+        Status s = (*job->task)(job->arg, lg_id);
+        job->mutex.Lock();
+        if (job->status.ok() && !s.ok()) {
+            job->status = s;
+        }
+        if (++job->done_num == job->lg_num) {
+            job->cv.Signal();
+        }
+    }
+}
+
+void LGWriteThreadPool::UnrefJob(Job* job) {
+    job->mutex.Lock();
+    bool last = (--job->refs == 0);
+    job->mutex.Unlock();
+    if (last) {
+        delete job;
+    }
+}
+
+} // namespace leveldb
@@ -5,34 +5,52 @@
 #ifndef LEVELDB_DB_LG_WRITE_THREAD_H_
 #define LEVELDB_DB_LG_WRITE_THREAD_H_
 
-#include "db/db_impl.h"
-#include "leveldb/write_batch.h"
-#include "util/thread.h"
+#include <stdint.h>
+
+#include "leveldb/status.h"
+#include "port/port.h"
+#include "util/thread_pool.h"
 
 namespace leveldb {
 
-class LGWriteThread : public Thread {
+// Applies the per-locality-group parts of a DBTable write (or a recovered
+// log record) in parallel.
+//
+// One pool is shared by all tablets of the process. The calling thread
+// also runs the lg tasks that are not yet picked up by the pool, so a busy
+// pool never makes a write slower than applying lgs one by one.
+class LGWriteThreadPool {
 public:
-    LGWriteThread(uint32_t lg_id, DBImpl* impl,
-                  const WriteOptions& opts, WriteBatch* bench)
-        : wopts_(opts), wbench_(bench);
-    virtual ~LGWriteThread() {}
+    typedef Status (*LGTask)(void* arg, uint32_t lg_id);
+
+    static LGWriteThreadPool* Default();
 
-    virtual void Run(void* params) {
-        std::cout << "LG Thread #" << lg_id_ << ": Write()" << std::endl;
-        lg_impl_->Write(wopts_, wbatch_);
-    }
+    // Set the number of pool threads, 0 applies lgs in the calling thread.
+    void SetBackgroundThreads(int num);
 
-    Status GetResult() {
-        return ret_;
-    }
+    // Run "task(arg, i)" for every i in [0, lg_num) and wait until all are
+    // done. Return the first non-ok status.
+    Status RunAll(LGTask task, void* arg, uint32_t lg_num);
 
 private:
-    uint32_t lg_id_;
-    DBImpl* lg_impl_;
-    const WriteOptions& wopts_;
-    WriteBatch* wbatch_;
-    Status ret_;
+    struct Job;
+
+    LGWriteThreadPool();
+    ~LGWriteThreadPool();
+
+    static void InitDefault();
+
+    static void RunJobWrapper(void* job);
+    static void RunJob(Job* job);
+    static void UnrefJob(Job* job);
+
+    port::Mutex mutex_;
+    int thread_num_;
+    ThreadPool* pool_;
+
+    // No copying allowed
+    LGWriteThreadPool(const LGWriteThreadPool&);
+    void operator=(const LGWriteThreadPool&);
 };
 
 } // namespace leveldb
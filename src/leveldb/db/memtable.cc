@@ -22,10 +22,12 @@ static Slice GetLengthPrefixedSlice(const char* data) {
   return Slice(p, len);
 }
 
-MemTable::MemTable(const InternalKeyComparator& cmp, CompactStrategyFactory* compact_strategy_factory)
+MemTable::MemTable(const InternalKeyComparator& cmp, CompactStrategyFactory* compact_strategy_factory,
+                   ArenaPool* arena_pool)
     : last_seq_(0),
       comparator_(cmp),
       refs_(0),
+      arena_(arena_pool),
       table_(comparator_, &arena_),
       empty_(true),
       compact_strategy_factory_(compact_strategy_factory) {
@@ -26,8 +26,11 @@ class MemTable {
  public:
   // MemTables are reference counted.  The initial reference count
   // is zero and the caller must call Ref() at least once.
+  // The arena of the memtable draws its chunks from "arena_pool" if it
+  // is non-NULL.
   explicit MemTable(const InternalKeyComparator& comparator,
-          CompactStrategyFactory* compact_strategy_factory = NULL);
+          CompactStrategyFactory* compact_strategy_factory = NULL,
+          ArenaPool* arena_pool = NULL);
 
   // Increase reference count.
   void Ref() { ++refs_; }
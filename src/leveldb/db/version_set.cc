@@ -428,10 +428,10 @@ Status Version::Get(const ReadOptions& options,
   return Status::NotFound(Slice());  // Use an empty error message for speed
 }
 
-bool Version::UpdateStats(const GetStats& stats) {
+bool Version::UpdateStats(const GetStats& stats, int seeks) {
   FileMetaData* f = stats.seek_file;
   if (f != NULL) {
-    f->allowed_seeks--;
+    f->allowed_seeks -= seeks;
     if (f->allowed_seeks <= 0 && file_to_compact_ == NULL) {
       file_to_compact_ = f;
       file_to_compact_level_ = stats.seek_file_level;
@@ -1666,6 +1666,8 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   options.verify_checksums =
       options_->paranoid_checks || options_->verify_checksums_in_compaction;
   options.fill_cache = false;
+  options.low_cache_priority = true;
+  options.readahead_size = options_->compaction_readahead_size;
   options.db_opt = options_;
 
   // Level-0 files have to be merged together.  For other levels,
@@ -1698,6 +1700,54 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   return result;
 }
 
+namespace {
+struct ByLargestKey {
+  const InternalKeyComparator* icmp;
+
+  bool operator()(FileMetaData* f1, FileMetaData* f2) const {
+    return icmp->Compare(f1->largest, f2->largest) < 0;
+  }
+};
+}  // namespace
+
+void VersionSet::GetSubCompactionBoundaries(Compaction* c, int max_parts,
+                                            std::vector<std::string>* boundaries) {
+  boundaries->clear();
+  std::vector<FileMetaData*> files(c->inputs_[0]);
+  files.insert(files.end(), c->inputs_[1].begin(), c->inputs_[1].end());
+  if (max_parts <= 1 || files.size() <= 1) {
+    return;
+  }
+  ByLargestKey cmp = {&icmp_};
+  std::sort(files.begin(), files.end(), cmp);
+
+  // A part is never smaller than an output file, so that small
+  // compactions are not split at all.
+  int64_t part_size = std::max(TotalFileSize(files) / max_parts,
+                               static_cast<int64_t>(c->MaxOutputFileSize()));
+  const Comparator* ucmp = icmp_.user_comparator();
+  const Slice last_key = files.back()->largest.user_key();
+  int64_t part_bytes = 0;
+  for (size_t i = 0; i + 1 < files.size(); i++) {
+    part_bytes += files[i]->file_size;
+    if (part_bytes < part_size) {
+      continue;
+    }
+    Slice key = files[i]->largest.user_key();
+    if (ucmp->Compare(key, last_key) >= 0) {
+      break;
+    }
+    if (!boundaries->empty() && ucmp->Compare(key, boundaries->back()) <= 0) {
+      continue;
+    }
+    boundaries->push_back(key.ToString());
+    part_bytes = 0;
+    if (static_cast<int>(boundaries->size()) + 1 >= max_parts) {
+      break;
+    }
+  }
+}
+
 Compaction* VersionSet::PickCompaction() {
   Compaction* c;
   int level;
@@ -1893,12 +1943,15 @@ Compaction* VersionSet::CompactRange(
 Compaction::Compaction(int level)
     : level_(level),
       max_output_file_size_(0),
-      input_version_(NULL),
-      grandparent_index_(0),
-      seen_key_(false),
-      overlapped_bytes_(0) {
+      input_version_(NULL) {
+}
+
+Compaction::Cursor::Cursor()
+    : grandparent_index(0),
+      seen_key(false),
+      overlapped_bytes(0) {
   for (int i = 0; i < config::kNumLevels; i++) {
-    level_ptrs_[i] = 0;
+    level_ptrs[i] = 0;
   }
 }
 
@@ -1926,13 +1979,13 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
   }
 }
 
-bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+bool Compaction::IsBaseLevelForKey(const Slice& user_key, Cursor* cursor) {
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
   for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
     const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
-    for (; level_ptrs_[lvl] < files.size(); ) {
-      FileMetaData* f = files[level_ptrs_[lvl]];
+    for (; cursor->level_ptrs[lvl] < files.size(); ) {
+      FileMetaData* f = files[cursor->level_ptrs[lvl]];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
         // We've advanced far enough
         if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
@@ -1941,28 +1994,28 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
         }
         break;
       }
-      level_ptrs_[lvl]++;
+      cursor->level_ptrs[lvl]++;
     }
   }
   return true;
 }
 
-bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+bool Compaction::ShouldStopBefore(const Slice& internal_key, Cursor* cursor) {
   // Scan to find earliest grandparent file that contains key.
   const InternalKeyComparator* icmp = &input_version_->vset_->icmp_;
-  while (grandparent_index_ < grandparents_.size() &&
+  while (cursor->grandparent_index < grandparents_.size() &&
       icmp->Compare(internal_key,
-                    grandparents_[grandparent_index_]->largest.Encode()) > 0) {
-    if (seen_key_) {
-      overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+                    grandparents_[cursor->grandparent_index]->largest.Encode()) > 0) {
+    if (cursor->seen_key) {
+      cursor->overlapped_bytes += grandparents_[cursor->grandparent_index]->file_size;
     }
-    grandparent_index_++;
+    cursor->grandparent_index++;
   }
-  seen_key_ = true;
+  cursor->seen_key = true;
 
-  if (overlapped_bytes_ > MaxGrandParentOverlapBytes(max_output_file_size_)) {
+  if (cursor->overlapped_bytes > MaxGrandParentOverlapBytes(max_output_file_size_)) {
     // Too much overlap for current output; start new output
-    overlapped_bytes_ = 0;
+    cursor->overlapped_bytes = 0;
     return true;
   } else {
     return false;
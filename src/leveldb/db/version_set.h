@@ -78,10 +78,11 @@ class Version {
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
              GetStats* stats);
 
-  // Adds "stats" into the current state.  Returns true if a new
-  // compaction may need to be triggered, false otherwise.
+  // Adds "stats", weighing "seeks" reads, into the current state.
+  // Returns true if a new compaction may need to be triggered, false
+  // otherwise.
   // REQUIRES: lock is held
-  bool UpdateStats(const GetStats& stats);
+  bool UpdateStats(const GetStats& stats, int seeks);
 
   // Reference count management (so Versions do not disappear out from
   // under live iterators)
@@ -220,6 +221,14 @@ class VersionSet {
   // being compacted, or zero if there is no such log file.
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
+  // Split the key range of compaction "c" into at most "max_parts" parts
+  // of about the same input size for subcompactions, cutting at the
+  // largest keys of its input files.  Stores the user keys that end all
+  // parts but the last into *boundaries in ascending order, or nothing
+  // if "c" is not worth splitting.
+  void GetSubCompactionBoundaries(Compaction* c, int max_parts,
+                                  std::vector<std::string>* boundaries);
+
   // Pick level and inputs for a new compaction.
   // Returns NULL if there is no compaction to be done.
   // Otherwise returns a pointer to a heap-allocated object that
@@ -364,14 +373,34 @@ class Compaction {
   // Add all inputs to this compaction as delete operations to *edit.
   void AddInputDeletions(VersionEdit* edit);
 
+  // Position of one output stream of the compaction in its inputs, kept
+  // by IsBaseLevelForKey() and ShouldStopBefore().  The subcompactions of
+  // a compaction walk their key ranges concurrently, each with its own
+  // cursor.
+  struct Cursor {
+    size_t grandparent_index;   // Index in grandparents_
+    bool seen_key;              // Some output key has been seen
+    int64_t overlapped_bytes;   // Bytes of overlap between current output
+                                // and grandparent files
+
+    // level_ptrs holds indices into input_version_->levels_: our state
+    // is that we are positioned at one of the file ranges for each
+    // higher level than the ones involved in this compaction (i.e. for
+    // all L >= level_ + 2).
+    size_t level_ptrs[config::kNumLevels];
+
+    Cursor();
+  };
+
   // Returns true if the information we have available guarantees that
   // the compaction is producing data in "level+1" for which no data exists
   // in levels greater than "level+1".
-  bool IsBaseLevelForKey(const Slice& user_key);
+  // REQUIRES: keys passed with the same cursor are in ascending order
+  bool IsBaseLevelForKey(const Slice& user_key, Cursor* cursor);
 
   // Returns true iff we should stop building the current output
   // before processing "internal_key".
-  bool ShouldStopBefore(const Slice& internal_key);
+  bool ShouldStopBefore(const Slice& internal_key, Cursor* cursor);
 
   // Release the input version for the compaction, once the compaction
   // is successful.
@@ -396,21 +425,9 @@ class Compaction {
   // Each compaction reads inputs from "level_" and "level_+1"
   std::vector<FileMetaData*> inputs_[2];      // The two sets of inputs
 
-  // State used to check for number of of overlapping grandparent files
+  // Used to check for number of of overlapping grandparent files
   // (parent == level_ + 1, grandparent == level_ + 2)
   std::vector<FileMetaData*> grandparents_;
-  size_t grandparent_index_;  // Index in grandparent_starts_
-  bool seen_key_;             // Some output key has been seen
-  int64_t overlapped_bytes_;  // Bytes of overlap between current output
-                              // and grandparent files
-
-  // State for implementing IsBaseLevelForKey
-
-  // level_ptrs_ holds indices into input_version_->levels_: our state
-  // is that we are positioned at one of the file ranges for each
-  // higher level than the ones involved in this compaction (i.e. for
-  // all L >= level_ + 2).
-  size_t level_ptrs_[config::kNumLevels];
 
   // tera-specific
   // State for drop base level delete mark.
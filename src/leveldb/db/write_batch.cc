@@ -207,6 +207,88 @@ Status WriteBatchInternal::InsertInto(const WriteBatch* b,
   return b->Iterate(&inserter);
 }
 
+Status WriteBatchInternal::SeperateLocalityGroup(const WriteBatch* b,
+                                                 std::vector<LGBatchView>* views) {
+  for (size_t i = 0; i < views->size(); ++i) {
+    (*views)[i].batch = b;
+    (*views)[i].offsets.clear();
+  }
+  Slice input(b->rep_);
+  if (input.size() < kHeader) {
+    return Status::Corruption("malformed WriteBatch (too small)");
+  }
+
+  input.remove_prefix(kHeader);
+  Slice key, value;
+  int found = 0;
+  while (!input.empty()) {
+    found++;
+    uint32_t offset = static_cast<uint32_t>(input.data() - b->rep_.data());
+    char tag = input[0];
+    input.remove_prefix(1);
+    if (!GetLengthPrefixedSlice(&input, &key)) {
+      return Status::Corruption("bad WriteBatch fetch key");
+    }
+    switch (tag) {
+      case kTypeValue:
+        if (!GetLengthPrefixedSlice(&input, &value)) {
+          return Status::Corruption("bad WriteBatch Put");
+        }
+        break;
+      case kTypeDeletion:
+        break;
+      default:
+        return Status::Corruption("unknown WriteBatch tag");
+    }
+    uint32_t lg_id = 0;
+    if (!GetFixed32LGId(&key, &lg_id)) {
+      lg_id = 0;
+    }
+    assert(lg_id < views->size());
+    (*views)[lg_id].offsets.push_back(offset);
+  }
+
+  uint64_t last_sequence = Sequence(b) + Count(b) - 1;
+  for (size_t i = 0; i < views->size(); ++i) {
+    (*views)[i].sequence = last_sequence - (*views)[i].Count() + 1;
+  }
+  if (found != Count(b)) {
+    return Status::Corruption("WriteBatch has wrong count");
+  } else {
+    return Status::OK();
+  }
+}
+
+Status WriteBatchInternal::InsertInto(const LGBatchView& view,
+                                      MemTable* memtable) {
+  const std::string& rep = view.batch->rep_;
+  SequenceNumber sequence = view.sequence;
+  Slice key, value;
+  for (size_t i = 0; i < view.offsets.size(); ++i) {
+    Slice input(rep.data() + view.offsets[i], rep.size() - view.offsets[i]);
+    char tag = input[0];
+    input.remove_prefix(1);
+    if (!GetLengthPrefixedSlice(&input, &key)) {
+      return Status::Corruption("bad WriteBatch fetch key");
+    }
+    Slice lg_key = key;
+    uint32_t lg_id = 0;
+    if (GetFixed32LGId(&lg_key, &lg_id)) {
+      key = lg_key;
+    }
+    if (tag == kTypeValue) {
+      if (!GetLengthPrefixedSlice(&input, &value)) {
+        return Status::Corruption("bad WriteBatch Put");
+      }
+      memtable->Add(sequence, kTypeValue, key, value);
+    } else {
+      memtable->Add(sequence, kTypeDeletion, key, Slice());
+    }
+    sequence++;
+  }
+  return Status::OK();
+}
+
 void WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
   assert(contents.size() >= kHeader);
   b->rep_.assign(contents.data(), contents.size());
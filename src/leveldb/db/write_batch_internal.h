@@ -9,12 +9,26 @@
 #ifndef STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 #define STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 
+#include <vector>
+
+#include "db/dbformat.h"
 #include "leveldb/write_batch.h"
 
 namespace leveldb {
 
 class MemTable;
 
+// The entries of one locality group in a WriteBatch. It only records where
+// the entries are in the rep of "batch", so the batch must outlive it.
+struct LGBatchView {
+  const WriteBatch* batch;
+  SequenceNumber sequence;        // sequence of the first entry
+  std::vector<uint32_t> offsets;  // offsets of the entries in batch rep
+
+  LGBatchView() : batch(NULL), sequence(0) { }
+  int Count() const { return static_cast<int>(offsets.size()); }
+};
+
 // WriteBatchInternal provides static methods for manipulating a
 // WriteBatch that we don't want in the public WriteBatch interface.
 class WriteBatchInternal {
@@ -44,6 +58,16 @@ class WriteBatchInternal {
 
   static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
 
+  // Split "batch" into one view per locality group without copying the
+  // entries. "views" must hold a view for each lg, their offset lists are
+  // cleared first so the views can be reused across batches.
+  static Status SeperateLocalityGroup(const WriteBatch* batch,
+                                      std::vector<LGBatchView>* views);
+
+  // Insert the entries of "view" into "memtable", with the lg id stripped
+  // from the keys.
+  static Status InsertInto(const LGBatchView& view, MemTable* memtable);
+
   static void Append(WriteBatch* dst, const WriteBatch* src);
 };
 
@@ -11,17 +11,20 @@
 #include "db/memtable.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/env.h"
+#include "leveldb/lg_coding.h"
 #include "util/logging.h"
 #include "util/testharness.h"
 
 namespace leveldb {
 
-static std::string PrintContents(WriteBatch* b) {
+static std::string PrintContents(WriteBatch* b, const LGBatchView* view = NULL) {
   InternalKeyComparator cmp(BytewiseComparator());
   MemTable* mem = new MemTable(cmp);
   mem->Ref();
   std::string state;
-  Status s = WriteBatchInternal::InsertInto(b, mem);
+  Status s = (view != NULL) ? WriteBatchInternal::InsertInto(*view, mem)
+                            : WriteBatchInternal::InsertInto(b, mem);
+  int expected = (view != NULL) ? view->Count() : WriteBatchInternal::Count(b);
   int count = 0;
   Iterator* iter = mem->NewIterator();
   for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
@@ -49,7 +52,7 @@ static std::string PrintContents(WriteBatch* b) {
   delete iter;
   if (!s.ok()) {
     state.append("ParseError()");
-  } else if (count != WriteBatchInternal::Count(b)) {
+  } else if (count != expected) {
     state.append("CountMismatch()");
   }
   mem->Unref();
@@ -117,6 +120,38 @@ TEST(WriteBatchTest, Append) {
             PrintContents(&b1));
 }
 
+TEST(WriteBatchTest, SeperateLocalityGroup) {
+  std::string k0("foo"), k1("bar"), k2("box");
+  PutFixed32LGId(&k0, 0);
+  PutFixed32LGId(&k1, 1);
+  PutFixed32LGId(&k2, 1);
+  WriteBatch batch;
+  batch.Put(k0, "v0");
+  batch.Put(k1, "v1");
+  batch.Delete(k2);
+  WriteBatchInternal::SetSequence(&batch, 100);
+
+  std::vector<LGBatchView> views(3);
+  ASSERT_OK(WriteBatchInternal::SeperateLocalityGroup(&batch, &views));
+  ASSERT_EQ(1, views[0].Count());
+  ASSERT_EQ(2, views[1].Count());
+  ASSERT_EQ(0, views[2].Count());
+  // the entries of every lg end at the last sequence of the batch
+  ASSERT_EQ("Put(foo, v0)@102", PrintContents(&batch, &views[0]));
+  ASSERT_EQ("Put(bar, v1)@101"
+            "Delete(box)@102", PrintContents(&batch, &views[1]));
+  ASSERT_EQ("", PrintContents(&batch, &views[2]));
+  ASSERT_EQ(103U, views[2].sequence);
+
+  // views are reusable
+  batch.Clear();
+  batch.Put(k1, "v2");
+  WriteBatchInternal::SetSequence(&batch, 200);
+  ASSERT_OK(WriteBatchInternal::SeperateLocalityGroup(&batch, &views));
+  ASSERT_EQ(0, views[0].Count());
+  ASSERT_EQ("Put(bar, v2)@200", PrintContents(&batch, &views[1]));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
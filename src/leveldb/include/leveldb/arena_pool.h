@@ -0,0 +1,60 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// An ArenaPool hands out the chunks that memtable arenas carve their
+// allocations from.  Chunks are mapped straight from the kernel instead of
+// malloc, and handed back whole when a memtable is dropped, so memtables
+// churning through the process do not fragment the malloc heap.  It has
+// internal synchronization, one pool is usually shared by all the dbs of a
+// process.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_ARENA_POOL_H_
+#define STORAGE_LEVELDB_INCLUDE_ARENA_POOL_H_
+
+#include <stddef.h>
+
+namespace leveldb {
+
+class ArenaPool {
+ public:
+  // Chunks come in power of two size classes from kMinChunkSize up to
+  // MaxChunkSize().  An arena starts with 4KB blocks from the heap and
+  // doubles them as it grows, so an idle memtable holds 4KB and a full
+  // one a few large chunks.
+  static const size_t kMinChunkSize = 64 << 10;
+
+  ArenaPool() { }
+  virtual ~ArenaPool();
+
+  // Return a chunk of "size" bytes, a size class of this pool, or NULL if
+  // the memory could not be mapped.
+  virtual char* NewChunk(size_t size) = 0;
+
+  // Return a chunk got from NewChunk(size) to the pool.
+  virtual void DeleteChunk(char* chunk, size_t size) = 0;
+
+  virtual size_t MaxChunkSize() const = 0;
+
+  // Bytes of the chunks in use by arenas, and of those cached for reuse.
+  // Cached chunks stay mapped but their pages are given back to the
+  // kernel.
+  virtual size_t UsedBytes() = 0;
+  virtual size_t FreeBytes() = 0;
+
+ private:
+  // No copying allowed
+  ArenaPool(const ArenaPool&);
+  void operator=(const ArenaPool&);
+};
+
+// Create a pool of chunks up to "max_chunk_size" bytes, which is rounded
+// to a power of two.  Up to "max_free_bytes" of returned chunks are kept
+// mapped for reuse, the others are unmapped.  If "huge_page" is true, chunks of
+// 2MB and more are aligned to 2MB and backed by transparent huge pages.
+extern ArenaPool* NewArenaPool(size_t max_chunk_size, size_t max_free_bytes,
+                               bool huge_page);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_ARENA_POOL_H_
@@ -33,6 +33,18 @@ class Cache;
 // of Cache uses a least-recently-used eviction policy.
 extern Cache* NewLRUCache(size_t capacity);
 
+// Same as above, with the cache split into 2^num_shard_bits shards,
+// each with its own lock. More shards reduce lock contention between
+// reader threads. num_shard_bits is clamped to [0, 16]; the default is 4.
+extern Cache* NewLRUCache(size_t capacity, int num_shard_bits);
+
+// Create a scan-resistant cache using a segmented LRU policy. New entries
+// enter a probation segment and are promoted to the protected segment
+// (80% of the capacity) by a high priority hit. Entries only read by
+// low priority lookups, e.g. blocks of a long scan, are evicted from the
+// probation segment without disturbing the protected working set.
+extern Cache* NewSLRUCache(size_t capacity, int num_shard_bits);
+
 class Cache {
  public:
   Cache() { }
@@ -44,6 +56,14 @@ class Cache {
   // Opaque handle to an entry stored in the cache.
   struct Handle { };
 
+  // Priority of a lookup. A low priority hit does not promote the entry
+  // out of the probation segment of a scan-resistant cache. Caches with
+  // a plain LRU policy treat both priorities the same.
+  enum Priority {
+    kHighPriority = 0,
+    kLowPriority = 1
+  };
+
   // Insert a mapping from key->value into the cache and assign it
   // the specified charge against the total cache capacity.
   //
@@ -61,7 +81,7 @@ class Cache {
   // Else return a handle that corresponds to the mapping.  The caller
   // must call this->Release(handle) when the returned mapping is no
   // longer needed.
-  virtual Handle* Lookup(const Slice& key) = 0;
+  virtual Handle* Lookup(const Slice& key, Priority priority = kHighPriority) = 0;
 
   // Release a mapping returned by a previous Lookup().
   // REQUIRES: handle must not have been released yet.
@@ -85,6 +105,9 @@ class Cache {
   // its cache keys.
   virtual uint64_t NewId() = 0;
 
+  // Return the name of the eviction policy, e.g. "lru".
+  virtual const char* Name() const = 0;
+
   // Return the look-up hit rate.
   virtual double HitRate() = 0;
 
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <string>
 #include "leveldb/iterator.h"
+#include "leveldb/slice.h"
 
 namespace leveldb {
 
@@ -39,6 +40,13 @@ public:
     // are protected by snpashot
     virtual void SetSnapshot(uint64_t snapshot) = 0;
 
+    // Returns true if user keys "k1" and "k2" belong to the same row, whose
+    // keys Drop() and MergeAtomicOPs() look at together. A compaction split
+    // into subcompactions never puts the keys of a row into two of them.
+    virtual bool IsSameRow(const Slice& k1, const Slice& k2) {
+        return k1 == k2;
+    }
+
     virtual const char* Name() const = 0;
 };
 
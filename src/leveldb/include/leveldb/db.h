@@ -147,6 +147,12 @@ class DB {
   virtual void GetApproximateSizes(uint64_t* size,
                                    std::vector<uint64_t>* lgsize = NULL) = 0;
 
+  // tera-specific
+  // Return the approximate memory usage of the memtables (mem and imm) of
+  // all lgs, i.e. the bytes their arenas hold, be they heap blocks or
+  // chunks of the arena pool.  The pool does not account chunks per db.
+  virtual uint64_t GetMemTableUsage() = 0;
+
   // Compact the underlying storage for the key range [*begin,*end].
   // In particular, deleted and overwritten versions are discarded,
   // and the data is rearranged to reduce the cost of operations
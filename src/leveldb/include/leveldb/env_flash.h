@@ -65,12 +65,27 @@ public:
     static const std::vector<std::string>& GetFlashPaths() {
         return flash_paths_;
     }
+    /// sst files missing on flash are copied from dfs by "threads"
+    /// background threads in "chunk_size" reads, and read from dfs until
+    /// the copy is over; 0 threads copy on open
+    static void SetCopyOptions(int threads, size_t chunk_size);
+    /// each flash path holds at most "capacity" bytes (0 for no limit),
+    /// files not opened are evicted, least recently closed first, to make
+    /// room; a file is copied once it has been read "admit_reads" times
+    /// from dfs
+    static void SetCapacity(uint64_t capacity, int admit_reads);
+    /// account for the sst files found in the flash paths, such as those
+    /// left by an earlier process, before they are opened again
+    static void LoadFlashFiles();
 
 private:
     Env* dfs_env_;
     Env* posix_env_;
     static std::vector<std::string> flash_paths_;
     static bool vanish_allowed_;
+    static int copy_threads_;
+    static size_t copy_chunk_size_;
+    static int admit_reads_;
 };
 
 /// new flash env
@@ -24,6 +24,7 @@
 
 namespace leveldb {
 
+class RawKeyOperator;
 class Slice;
 
 class FilterPolicy {
@@ -51,6 +52,11 @@ class FilterPolicy {
   // This method may return true or false if the key was not on the
   // list, but it should aim to return false with a high probability.
   virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const = 0;
+
+  // Return true if the filter only summarizes the row of tera keys, so any
+  // key of a row, e.g. a seek key built from the row, can be checked with
+  // KeyMayMatch() to tell whether the row exists.
+  virtual bool IsRowFilter() const { return false; }
 };
 
 // Return a new filter policy that uses a bloom filter with approximately
@@ -70,6 +76,10 @@ class FilterPolicy {
 extern const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
 // bloomfilter for ttl-kv mode.
 extern const FilterPolicy* NewTTLKvBloomFilterPolicy(int bits_per_key);
+// bloomfilter on the row of tera keys parsed by "key_operator", used by
+// tables whose reads seek by row. "key_operator" must outlive the result.
+extern const FilterPolicy* NewRowKeyBloomFilterPolicy(int bits_per_key,
+                                                      const RawKeyOperator* key_operator);
 
 }
 
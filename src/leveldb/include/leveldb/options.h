@@ -25,13 +25,16 @@ static const uint64_t kMaxSequenceNumber = ((0x1ull << 56) - 1);
 
 static const size_t kDefaultBlockSize = 4096;
 static const size_t kDefaultSstSize = 8 * 1024 * 1024; // 8 MB
+class ArenaPool;
 class Cache;
+class CommitLog;
 class TableCache;
 class CompactStrategyFactory;
 class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class RateLimiter;
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -43,7 +46,8 @@ enum CompressionType {
   kNoCompression     = 0x0,
   kSnappyCompression = 0x1,
   kBmzCompression    = 0x2,
-  kLZ4Compression    = 0x3
+  kLZ4Compression    = 0x3,
+  kZstdCompression   = 0x4
 };
 
 enum RawKeyFormat {
@@ -63,6 +67,14 @@ struct LG_info {
   // compress type
   CompressionType compression;
 
+  // compress type of the sst files compacted to bottom_compression_level
+  // and deeper, disabled if the level is negative
+  CompressionType bottom_compression;
+  int bottom_compression_level;
+
+  // zstd dictionary size, 0 for no dictionary
+  size_t compression_dict_size;
+
   // block size
   size_t block_size;
 
@@ -83,6 +95,9 @@ struct LG_info {
       : lg_id(id),
         env(custom_env),
         compression(kNoCompression),
+        bottom_compression(kNoCompression),
+        bottom_compression_level(-1),
+        compression_dict_size(0),
         block_size(kDefaultBlockSize),
         use_memtable_on_leveldb(false),
         memtable_ldb_write_buffer_size(1 << 20),
@@ -201,6 +216,21 @@ struct Options {
   // efficiently detect that and will switch to uncompressed mode.
   CompressionType compression;
 
+  // Compression of the sst files that compactions write to level
+  // "bottom_compression_level" and deeper, so that the cold levels can
+  // use a denser codec than the hot ones.  A negative level disables it.
+  //
+  // Default: kSnappyCompression, level -1
+  CompressionType bottom_compression;
+  int bottom_compression_level;
+
+  // Size of the zstd dictionary that each sst file trains on its first
+  // data blocks and stores in a meta block.  Later data blocks of the
+  // file are compressed with it.  0 disables the dictionary.
+  //
+  // Default: 0
+  size_t compression_dict_size;
+
   // If non-NULL, use the specified filter policy to reduce disk reads.
   // Many applications will benefit from passing the result of
   // NewBloomFilterPolicy() here.
@@ -230,6 +260,11 @@ struct Options {
   // AddRecord and Sync will be apllied asynchronously
   bool log_async_mode;
 
+  // If non-NULL, write-ahead records are appended to this node-wide
+  // commit log shared by all tablets instead of a log file per tablet.
+  // Default: NULL
+  CommitLog* commit_log;
+
   // max number of unsed log files produced by switching log
   // default: 50
   int max_block_log_number;
@@ -287,6 +322,26 @@ struct Options {
   // Default: false
   bool ignore_corruption_in_compaction;
 
+  // If non-NULL, the sst files of compactions and memtable dumps are
+  // written at the pace of this limiter.
+  // Default: NULL
+  RateLimiter* rate_limiter;
+
+  // Split a compaction into at most this many key ranges, compacted in
+  // parallel on the background threads of "env".
+  // Default: 1
+  int max_subcompactions;
+
+  // If non-zero, compactions read their input files sequentially in
+  // chunks of this size, see ReadOptions::readahead_size.
+  // Default: 0
+  size_t compaction_readahead_size;
+
+  // If non-NULL, memtables allocate their memory in chunks of this pool
+  // instead of from the heap.
+  // Default: NULL
+  ArenaPool* arena_pool;
+
   // disable write-ahead-log
   bool disable_wal;
 
@@ -321,6 +376,28 @@ struct ReadOptions {
   // Default: NULL
   std::set<uint32_t>* target_lgs;
 
+  // If true, every Seek() of the iterator targets keys of one row and
+  // the caller stops at the first key of another row. Sst files whose row
+  // filter (see FilterPolicy::IsRowFilter) rules out the row are skipped
+  // without reading any data block, so the iterator may stop before keys
+  // of the following rows.
+  // Default: false
+  bool single_row_read;
+
+  // If true, the blocks read are unlikely to be read again soon, e.g. by
+  // a long scan. Their block cache lookups use Cache::kLowPriority, so a
+  // scan-resistant block cache keeps them in its probation segment.
+  // Default: false
+  bool low_cache_priority;
+
+  // If non-zero, once an iterator has read a few data blocks of an sst
+  // file in a row, it reads the file in chunks of up to this size and
+  // prefetches the next chunk in background, instead of one read per
+  // block.  Only worth it for iterators that go through most of a file,
+  // such as compactions and long scans.
+  // Default: 0
+  size_t readahead_size;
+
   // db option
   const Options* db_opt;
 
@@ -329,6 +406,9 @@ struct ReadOptions {
         fill_cache(true),
         snapshot(kMaxSequenceNumber),
         target_lgs(NULL),
+        single_row_read(false),
+        low_cache_priority(false),
+        readahead_size(0),
         db_opt(db_option) {
   }
   ReadOptions() {
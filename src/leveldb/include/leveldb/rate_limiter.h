@@ -0,0 +1,60 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A RateLimiter paces the background writes of compactions and memtable
+// dumps, so that they leave disk and dfs bandwidth to foreground reads.
+// It has internal synchronization, one limiter is usually shared by all
+// the dbs of a process.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <stdint.h>
+
+namespace leveldb {
+
+class WritableFile;
+
+class RateLimiter {
+ public:
+  // Waiting requests of a higher priority are served first, memtable
+  // dumps must not queue behind compactions or writes would stall.
+  enum Priority {
+    kCompaction = 0,
+    kFlush = 1,
+    kNumPriorities = 2
+  };
+
+  RateLimiter() { }
+  virtual ~RateLimiter();
+
+  // Block until "bytes" may be written.
+  virtual void Request(int64_t bytes, Priority priority) = 0;
+
+  // Change the budget, takes effect from the next refill on.  A
+  // non-positive budget grants every request at once.
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) = 0;
+  virtual int64_t GetBytesPerSecond() = 0;
+
+ private:
+  // No copying allowed
+  RateLimiter(const RateLimiter&);
+  void operator=(const RateLimiter&);
+};
+
+// Create a token bucket that grants "bytes_per_second" in portions
+// refilled every "refill_period_us".  Unused tokens do not carry over to
+// the next period, so bursts are bounded by a single portion.
+extern RateLimiter* NewRateLimiter(int64_t bytes_per_second,
+                                   int64_t refill_period_us = 100 * 1000);
+
+// Return a file that requests the bytes of every Append() from "limiter"
+// at "priority" before passing it to "file".  The result owns "file".
+extern WritableFile* NewRateLimitedFile(WritableFile* file,
+                                        RateLimiter* limiter,
+                                        RateLimiter::Priority priority);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
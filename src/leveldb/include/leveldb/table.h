@@ -70,6 +70,17 @@ class Table {
   explicit Table(Rep* rep) { rep_ = rep; }
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
 
+  // Same as BlockReader(), for iterators reading their blocks through a
+  // readahead file of their own, see ReadOptions::readahead_size.
+  static Iterator* ReadaheadBlockReader(void*, const ReadOptions&, const Slice&);
+  static Iterator* ReadDataBlock(Table* table, RandomAccessFile* file,
+                                 const ReadOptions&, const Slice& index_value);
+  Iterator* NewBlockIterator(const ReadOptions&) const;
+
+  // Return false if the row filter tells the row of "key" is not in table.
+  friend class TableIter;
+  bool RowMayMatch(const Slice& key) const;
+
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
   // that key is not present.
@@ -82,6 +93,7 @@ class Table {
 
   void ReadMeta(const Footer& footer);
   void ReadFilter(const Slice& filter_handle_value);
+  void ReadCompressionDict(const Slice& dict_handle_value);
 
   // No copying allowed
   Table(const Table&);
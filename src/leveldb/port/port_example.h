@@ -46,6 +46,19 @@ class Mutex {
   void AssertHeld();
 };
 
+// A lock for critical sections of a few instructions, that never block
+// while holding it.  Waiters busy-wait instead of sleeping.
+class SpinLock {
+ public:
+  SpinLock();
+  ~SpinLock();
+
+  void Lock();
+
+  // REQUIRES: This lock was locked by this thread.
+  void Unlock();
+};
+
 class CondVar {
  public:
   explicit CondVar(Mutex* mu);
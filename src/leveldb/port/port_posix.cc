@@ -24,6 +24,11 @@
 bmz::BmzCodec bmc;
 #endif
 
+#ifdef USE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
 namespace leveldb {
 namespace port {
 
@@ -48,6 +53,16 @@ void Mutex::Lock() { PthreadCall("lock", pthread_mutex_lock(&mu_)); }
 
 void Mutex::Unlock() { PthreadCall("unlock", pthread_mutex_unlock(&mu_)); }
 
+SpinLock::SpinLock() {
+  PthreadCall("init spinlock", pthread_spin_init(&lock_, PTHREAD_PROCESS_PRIVATE));
+}
+
+SpinLock::~SpinLock() { PthreadCall("destroy spinlock", pthread_spin_destroy(&lock_)); }
+
+void SpinLock::Lock() { PthreadCall("spin lock", pthread_spin_lock(&lock_)); }
+
+void SpinLock::Unlock() { PthreadCall("spin unlock", pthread_spin_unlock(&lock_)); }
+
 CondVar::CondVar(Mutex* mu)
     : mu_(mu) {
     PthreadCall("init cv", pthread_cond_init(&cv_, NULL));
@@ -136,6 +151,156 @@ bool Lz4_Uncompress(const char* input, size_t input_size,
 #endif
 }
 
+// zstd level 3 is close to snappy in decode speed, the dictionary makes up
+// for the small blocks
+static const int kZstdLevel = 3;
+
+ZstdCompressor::ZstdCompressor() : ctx_(NULL), cdict_(NULL) {
+#ifdef USE_ZSTD
+    ctx_ = ZSTD_createCCtx();
+#endif
+}
+
+ZstdCompressor::~ZstdCompressor() {
+#ifdef USE_ZSTD
+    ZSTD_freeCDict(cdict_);
+    ZSTD_freeCCtx(ctx_);
+#endif
+}
+
+bool ZstdCompressor::SetDict(const char* dict, size_t dict_size) {
+#ifdef USE_ZSTD
+    ZSTD_freeCDict(cdict_);
+    cdict_ = ZSTD_createCDict(dict, dict_size, kZstdLevel);
+    return cdict_ != NULL;
+#else
+    return false;
+#endif
+}
+
+bool ZstdCompressor::Compress(const char* input, size_t input_size,
+                              bool use_dict, std::string* output) {
+#ifdef USE_ZSTD
+    if (ctx_ == NULL) {
+        return false;
+    }
+    output->resize(ZSTD_compressBound(input_size));
+    size_t output_size;
+    if (use_dict && cdict_ != NULL) {
+        output_size = ZSTD_compress_usingCDict(ctx_, &(*output)[0], output->size(),
+                                               input, input_size, cdict_);
+    } else {
+        output_size = ZSTD_compressCCtx(ctx_, &(*output)[0], output->size(),
+                                        input, input_size, kZstdLevel);
+    }
+    if (ZSTD_isError(output_size)) {
+        return false;
+    }
+    output->resize(output_size);
+    return true;
+#else
+    return false;
+#endif
+}
+
+ZstdUncompressDict::ZstdUncompressDict(const char* dict, size_t dict_size)
+    : ddict_(NULL) {
+#ifdef USE_ZSTD
+    ddict_ = ZSTD_createDDict(dict, dict_size);
+#endif
+}
+
+ZstdUncompressDict::~ZstdUncompressDict() {
+#ifdef USE_ZSTD
+    ZSTD_freeDDict(ddict_);
+#endif
+}
+
+bool Zstd_GetUncompressedLength(const char* input, size_t input_size,
+                                size_t* result) {
+#ifdef USE_ZSTD
+    unsigned long long size = ZSTD_getFrameContentSize(input, input_size);
+    if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
+        return false;
+    }
+    *result = static_cast<size_t>(size);
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef USE_ZSTD
+// decompression context of the thread, freed when the thread exits
+static pthread_once_t zstd_dctx_once = PTHREAD_ONCE_INIT;
+static pthread_key_t zstd_dctx_key;
+
+static void FreeZstdDCtx(void* ctx) {
+    ZSTD_freeDCtx(reinterpret_cast<ZSTD_DCtx*>(ctx));
+}
+
+static void InitZstdDCtxKey() {
+    PthreadCall("key create", pthread_key_create(&zstd_dctx_key, FreeZstdDCtx));
+}
+
+static ZSTD_DCtx* ThreadZstdDCtx() {
+    PthreadCall("once", pthread_once(&zstd_dctx_once, InitZstdDCtxKey));
+    ZSTD_DCtx* ctx = reinterpret_cast<ZSTD_DCtx*>(pthread_getspecific(zstd_dctx_key));
+    if (ctx == NULL) {
+        ctx = ZSTD_createDCtx();
+        if (ctx != NULL) {
+            PthreadCall("set specific", pthread_setspecific(zstd_dctx_key, ctx));
+        }
+    }
+    return ctx;
+}
+#endif
+
+bool Zstd_Uncompress(const char* input, size_t input_size,
+                     const ZstdUncompressDict* dict,
+                     char* output, size_t output_size) {
+#ifdef USE_ZSTD
+    ZSTD_DCtx* ctx = ThreadZstdDCtx();
+    if (ctx == NULL) {
+        return false;
+    }
+    size_t ret;
+    if (dict != NULL) {
+        if (!dict->ok()) {
+            return false;
+        }
+        ret = ZSTD_decompress_usingDDict(ctx, output, output_size,
+                                         input, input_size, dict->ddict());
+    } else {
+        ret = ZSTD_decompressDCtx(ctx, output, output_size, input, input_size);
+    }
+    return !ZSTD_isError(ret) && ret == output_size;
+#else
+    return false;
+#endif
+}
+
+bool Zstd_TrainDict(const std::string& samples,
+                    const std::vector<size_t>& sample_sizes,
+                    size_t dict_size, std::string* dict) {
+#ifdef USE_ZSTD
+    if (sample_sizes.empty()) {
+        return false;
+    }
+    dict->resize(dict_size);
+    size_t ret = ZDICT_trainFromBuffer(&(*dict)[0], dict_size, samples.data(),
+                                       &sample_sizes[0], sample_sizes.size());
+    if (ZDICT_isError(ret)) {
+        dict->clear();
+        return false;
+    }
+    dict->resize(ret);
+    return true;
+#else
+    return false;
+#endif
+}
+
 //////////////////////////////
 
 }  // namespace port
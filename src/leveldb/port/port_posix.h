@@ -51,6 +51,7 @@
 #endif
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include "port/atomic_pointer.h"
 
 #ifndef PLATFORM_IS_LITTLE_ENDIAN
@@ -78,6 +79,11 @@
 #define fdatasync fsync
 #endif
 
+// zstd types, see zstd.h
+struct ZSTD_CCtx_s;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
 namespace leveldb {
 namespace port {
 
@@ -104,6 +110,22 @@ class Mutex {
   void operator=(const Mutex&);
 };
 
+class SpinLock {
+ public:
+  SpinLock();
+  ~SpinLock();
+
+  void Lock();
+  void Unlock();
+
+ private:
+  pthread_spinlock_t lock_;
+
+  // No copying
+  SpinLock(const SpinLock&);
+  void operator=(const SpinLock&);
+};
+
 class CondVar {
  public:
   explicit CondVar(Mutex* mu);
@@ -166,6 +188,65 @@ bool Lz4_Compress(const char* input, size_t input_size,
 bool Lz4_Uncompress(const char* input, size_t input_size,
                     char* output, size_t* output_size);
 
+// Compresses the blocks of one table with zstd. The context is reused
+// from block to block and the dictionary, once set, is digested only
+// once. Not thread-safe.
+class ZstdCompressor {
+ public:
+  ZstdCompressor();
+  ~ZstdCompressor();
+
+  // Compress the following blocks with "dict"
+  bool SetDict(const char* dict, size_t dict_size);
+  bool HasDict() const { return cdict_ != NULL; }
+
+  // "use_dict" is ignored until a dictionary is set
+  bool Compress(const char* input, size_t input_size, bool use_dict,
+                std::string* output);
+
+ private:
+  ZSTD_CCtx_s* ctx_;
+  ZSTD_CDict_s* cdict_;
+
+  // No copying allowed
+  ZstdCompressor(const ZstdCompressor&);
+  void operator=(const ZstdCompressor&);
+};
+
+// A zstd dictionary digested for decompression. Read-only once built, it
+// is shared by all the readers of a table.
+class ZstdUncompressDict {
+ public:
+  ZstdUncompressDict(const char* dict, size_t dict_size);
+  ~ZstdUncompressDict();
+
+  bool ok() const { return ddict_ != NULL; }
+  const ZSTD_DDict_s* ddict() const { return ddict_; }
+
+ private:
+  ZSTD_DDict_s* ddict_;
+
+  // No copying allowed
+  ZstdUncompressDict(const ZstdUncompressDict&);
+  void operator=(const ZstdUncompressDict&);
+};
+
+bool Zstd_GetUncompressedLength(const char* input, size_t input_size,
+                                size_t* result);
+
+// "dict" is NULL for blocks compressed without dictionary, else it must be
+// the one the block was compressed with. Each thread reuses its own
+// decompression context.
+bool Zstd_Uncompress(const char* input, size_t input_size,
+                     const ZstdUncompressDict* dict,
+                     char* output, size_t output_size);
+
+// Train a dictionary of at most "dict_size" bytes on the concatenated
+// "samples", whose lengths are "sample_sizes"
+bool Zstd_TrainDict(const std::string& samples,
+                    const std::vector<size_t>& sample_sizes,
+                    size_t dict_size, std::string* dict);
+
 //////////////////////////////
 
 inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
@@ -70,7 +70,8 @@ Status Footer::DecodeFrom(Slice* input) {
 Status ReadBlock(RandomAccessFile* file,
                  const ReadOptions& options,
                  const BlockHandle& handle,
-                 BlockContents* result) {
+                 BlockContents* result,
+                 const port::ZstdUncompressDict* compression_dict) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
@@ -140,34 +141,60 @@ Status ReadBlock(RandomAccessFile* file,
     }
     case kBmzCompression: {
         size_t uncompressed_size = 4 * 1024 * 2; // should be doubled block size, say > 4K * 2
-        std::vector<char> uncompressed_buffer;
-        uncompressed_buffer.resize(uncompressed_size);
-        if (!port::Bmz_Uncompress(data, n, &uncompressed_buffer[0],
-                                  &uncompressed_size)) {
+        // the block owns the buffer, it must outlive this function
+        char* ubuf = new char[uncompressed_size];
+        if (!port::Bmz_Uncompress(data, n, ubuf, &uncompressed_size)) {
             delete[] buf;
+            delete[] ubuf;
             return Status::Corruption("Bmz: corrupted compressed block contents");
         }
         delete[] buf;
-        result->data = Slice(&uncompressed_buffer[0], uncompressed_size);
+        result->data = Slice(ubuf, uncompressed_size);
         result->heap_allocated = true;
         result->cachable = true;
         break;
     }
     case kLZ4Compression: {
         size_t uncompressed_size = 4 * 1024 * 2; // should be doubled block size, say > 4K * 2
-        std::vector<char> uncompressed_buffer;
-        uncompressed_buffer.resize(uncompressed_size);
-        if (!port::Lz4_Uncompress(data, n, &uncompressed_buffer[0],
-                                  &uncompressed_size)) {
+        char* ubuf = new char[uncompressed_size];
+        if (!port::Lz4_Uncompress(data, n, ubuf, &uncompressed_size)) {
             delete[] buf;
+            delete[] ubuf;
             return Status::Corruption("LZ4: corrupted compressed block contents");
         }
         delete[] buf;
-        result->data = Slice(&uncompressed_buffer[0], uncompressed_size);
+        result->data = Slice(ubuf, uncompressed_size);
         result->heap_allocated = true;
         result->cachable = true;
         break;
     }
+    case kZstdCompression:
+    case kZstdDictCompression: {
+      const port::ZstdUncompressDict* dict = NULL;
+      if (data[n] == kZstdDictCompression) {
+        if (compression_dict == NULL) {
+          delete[] buf;
+          return Status::Corruption("zstd: missing compression dictionary");
+        }
+        dict = compression_dict;
+      }
+      size_t ulength = 0;
+      if (!port::Zstd_GetUncompressedLength(data, n, &ulength)) {
+        delete[] buf;
+        return Status::Corruption("zstd: corrupted compressed block contents");
+      }
+      char* ubuf = new char[ulength];
+      if (!port::Zstd_Uncompress(data, n, dict, ubuf, ulength)) {
+        delete[] buf;
+        delete[] ubuf;
+        return Status::Corruption("zstd: corrupted compressed block contents");
+      }
+      delete[] buf;
+      result->data = Slice(ubuf, ulength);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
+    }
     default:
       delete[] buf;
       return Status::Corruption("bad block type");
@@ -14,6 +14,7 @@
 #include "leveldb/slice.h"
 #include "leveldb/status.h"
 #include "leveldb/table_builder.h"
+#include "port/port.h"
 
 namespace leveldb {
 
@@ -93,12 +94,31 @@ struct BlockContents {
   bool heap_allocated;  // True iff caller should delete[] data.data()
 };
 
+// Metaindex key of the zstd dictionary of the data blocks
+static const char kCompressionDictBlockName[] = "compression.dict";
+
+// Block type of the zstd data blocks compressed with the dictionary of
+// their table.  Blocks written before the dictionary was trained keep
+// kZstdCompression.  Options never ask for it.
+static const CompressionType kZstdDictCompression =
+    static_cast<CompressionType>(0x5);
+
 // Read the block identified by "handle" from "file".  On failure
 // return non-OK.  On success fill *result and return OK.
+// "compression_dict" is the zstd dictionary of the table, NULL if the
+// table has none.
 extern Status ReadBlock(RandomAccessFile* file,
                         const ReadOptions& options,
                         const BlockHandle& handle,
-                        BlockContents* result);
+                        BlockContents* result,
+                        const port::ZstdUncompressDict* compression_dict);
+
+inline Status ReadBlock(RandomAccessFile* file,
+                        const ReadOptions& options,
+                        const BlockHandle& handle,
+                        BlockContents* result) {
+  return ReadBlock(file, options, handle, result, NULL);
+}
 
 // Implementation details follow.  Clients should ignore,
 
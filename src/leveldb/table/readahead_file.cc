@@ -0,0 +1,280 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "table/readahead_file.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <algorithm>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "util/thread_pool.h"
+
+namespace leveldb {
+
+namespace {
+
+// A chunk of the file, read either by a pool thread or by its owner,
+// whichever comes first.
+struct Chunk {
+  enum State {
+    kQueued,
+    kRunning,
+    kDone
+  };
+
+  port::Mutex mu;
+  port::CondVar cv;
+  const RandomAccessFile* file;
+  uint64_t offset;
+  size_t n;
+  char* buf;
+  Slice data;         // valid once state is kDone
+  Status status;
+  State state;
+  int refs;           // owner and pending pool task
+
+  Chunk(const RandomAccessFile* f, uint64_t off, size_t size)
+      : cv(&mu), file(f), offset(off), n(size), buf(new char[size]),
+        state(kQueued), refs(1) {
+  }
+  ~Chunk() {
+    delete[] buf;
+  }
+
+  bool Covers(uint64_t pos) const {
+    return pos >= offset && pos < offset + data.size();
+  }
+};
+
+void UnrefChunk(Chunk* c) {
+  c->mu.Lock();
+  bool last = (--c->refs == 0);
+  c->mu.Unlock();
+  if (last) {
+    delete c;
+  }
+}
+
+// Read the chunk unless somebody else has started on it.
+void FillChunk(Chunk* c) {
+  c->mu.Lock();
+  if (c->state != Chunk::kQueued) {
+    c->mu.Unlock();
+    return;
+  }
+  c->state = Chunk::kRunning;
+  c->mu.Unlock();
+
+  Slice data;
+  Status s = c->file->Read(c->offset, c->n, &data, c->buf);
+  if (s.ok() && data.data() != c->buf) {
+    memcpy(c->buf, data.data(), data.size());
+  }
+
+  c->mu.Lock();
+  c->data = s.ok() ? Slice(c->buf, data.size()) : Slice();
+  c->status = s;
+  c->state = Chunk::kDone;
+  c->cv.SignalAll();
+  c->mu.Unlock();
+}
+
+void FillChunkWork(void* arg) {
+  Chunk* c = reinterpret_cast<Chunk*>(arg);
+  FillChunk(c);
+  UnrefChunk(c);
+}
+
+// Wait until the chunk is read, read it here if no pool thread has
+// picked it up yet.
+void WaitChunk(Chunk* c) {
+  FillChunk(c);
+  MutexLock l(&c->mu);
+  while (c->state != Chunk::kDone) {
+    c->cv.Wait();
+  }
+}
+
+// Give up a chunk.  A read not started is skipped, a running one is
+// waited for, the file must not be used after its reader is deleted.
+void CancelChunk(Chunk* c) {
+  c->mu.Lock();
+  if (c->state == Chunk::kQueued) {
+    c->state = Chunk::kDone;
+  }
+  while (c->state != Chunk::kDone) {
+    c->cv.Wait();
+  }
+  c->mu.Unlock();
+  UnrefChunk(c);
+}
+
+// Reads go straight to the file until this many of them in a row are
+// sequential, so that short scans do not pay for chunks they never use.
+const int kSequentialReadsForReadahead = 4;
+
+// The first chunk of a sequential run is at most this large, the next
+// ones double up to the readahead size.
+const size_t kInitialChunkSize = 64 << 10;
+
+pthread_once_t readahead_pool_once = PTHREAD_ONCE_INIT;
+port::Mutex* readahead_mu = NULL;
+ThreadPool* readahead_pool = NULL;
+int readahead_threads = 4;
+
+void InitReadaheadPool() {
+  readahead_mu = new port::Mutex;
+  readahead_pool = new ThreadPool;
+  readahead_pool->SetBackgroundThreads(readahead_threads);
+}
+
+// Return NULL if prefetch is disabled
+ThreadPool* ReadaheadPool() {
+  pthread_once(&readahead_pool_once, &InitReadaheadPool);
+  MutexLock l(readahead_mu);
+  return readahead_threads > 0 ? readahead_pool : NULL;
+}
+
+class ReadaheadFile : public RandomAccessFile {
+ public:
+  ReadaheadFile(RandomAccessFile* file, uint64_t size, size_t readahead_size)
+      : file_(file),
+        size_(size),
+        readahead_size_(readahead_size),
+        sequential_reads_(0),
+        last_end_(0),
+        current_(NULL),
+        next_(NULL) {
+  }
+
+  virtual ~ReadaheadFile() {
+    Reset();
+  }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    if (offset + n > size_) {
+      return file_->Read(offset, n, result, scratch);
+    }
+    // Read() of RandomAccessFile is const, chunks are mutable state of
+    // the single reader of this file.
+    //
+    // A read is sequential if it starts at most a chunk after the end of
+    // the previous one: blocks found in the block cache are skipped.
+    bool sequential = sequential_reads_ > 0 && offset >= last_end_ &&
+                      offset - last_end_ <= readahead_size_;
+    sequential_reads_ = sequential ? sequential_reads_ + 1 : 1;
+    last_end_ = offset + n;
+    if (!sequential) {
+      Reset();
+    }
+    if (current_ == NULL && sequential_reads_ < kSequentialReadsForReadahead) {
+      return file_->Read(offset, n, result, scratch);
+    }
+
+    size_t copied = 0;
+    while (copied < n) {
+      uint64_t pos = offset + copied;
+      if (current_ == NULL || !current_->Covers(pos)) {
+        if (next_ != NULL && pos >= next_->offset &&
+            pos < next_->offset + next_->n) {
+          WaitChunk(next_);
+          if (current_ != NULL) {
+            UnrefChunk(current_);
+          }
+          current_ = next_;
+          next_ = NULL;
+        } else {
+          // start a run, or skipped past the prefetched chunk
+          Reset();
+          current_ = new Chunk(file_, pos,
+                               ChunkSize(pos, n - copied,
+                                         std::min(readahead_size_,
+                                                  kInitialChunkSize)));
+          FillChunk(current_);
+        }
+        if (!current_->status.ok()) {
+          Status s = current_->status;
+          Reset();
+          return s;
+        }
+        if (!current_->Covers(pos)) {
+          break;  // end of file
+        }
+        Prefetch();
+      }
+      size_t len = std::min<uint64_t>(
+          n - copied, current_->offset + current_->data.size() - pos);
+      memcpy(scratch + copied,
+             current_->data.data() + (pos - current_->offset), len);
+      copied += len;
+    }
+    *result = Slice(scratch, copied);
+    return Status::OK();
+  }
+
+ private:
+  void Reset() const {
+    if (current_ != NULL) {
+      UnrefChunk(current_);
+      current_ = NULL;
+    }
+    if (next_ != NULL) {
+      CancelChunk(next_);
+      next_ = NULL;
+    }
+  }
+
+  // The size of a chunk at "pos" of "chunk_size" bytes that holds at
+  // least "n" bytes
+  size_t ChunkSize(uint64_t pos, size_t n, size_t chunk_size) const {
+    return std::min<uint64_t>(std::max(chunk_size, n), size_ - pos);
+  }
+
+  // Start reading the chunk after the current one, twice as large up to
+  // readahead_size_, unless the current one already hit the end of file.
+  void Prefetch() const {
+    uint64_t pos = current_->offset + current_->n;
+    if (next_ != NULL || current_->data.size() < current_->n || pos >= size_) {
+      return;
+    }
+    size_t chunk_size = std::min(readahead_size_, 2 * current_->n);
+    next_ = new Chunk(file_, pos, ChunkSize(pos, 0, chunk_size));
+    ThreadPool* pool = ReadaheadPool();
+    if (pool != NULL) {
+      next_->refs++;
+      pool->Schedule(&FillChunkWork, next_, 0, 0);
+    }
+    // without pool the chunk is read by WaitChunk() when it is reached
+  }
+
+  const RandomAccessFile* file_;
+  const uint64_t size_;
+  const size_t readahead_size_;
+  mutable int sequential_reads_;   // in a row, including the last one
+  mutable uint64_t last_end_;      // end of the last read
+  mutable Chunk* current_;
+  mutable Chunk* next_;
+};
+
+}  // namespace
+
+RandomAccessFile* NewReadaheadFile(RandomAccessFile* file, uint64_t size,
+                                   size_t readahead_size) {
+  return new ReadaheadFile(file, size, readahead_size);
+}
+
+void SetReadaheadThreads(int num) {
+  pthread_once(&readahead_pool_once, &InitReadaheadPool);
+  MutexLock l(readahead_mu);
+  readahead_threads = num;
+  if (num > 0) {
+    readahead_pool->SetBackgroundThreads(num);
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,38 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef STORAGE_LEVELDB_TABLE_READAHEAD_FILE_H_
+#define STORAGE_LEVELDB_TABLE_READAHEAD_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace leveldb {
+
+class RandomAccessFile;
+
+// Return a file that reads the first "size" bytes of "file" in chunks of
+// up to "readahead_size" bytes and serves sequential Read()s out of them.
+// While a chunk is consumed, the next one is prefetched by a background
+// thread, so a sequential reader such as a compaction waits for at most
+// one read of "file" per chunk instead of one per block.
+//
+// Chunks are only read once a few Read()s in a row were sequential, and
+// they start small and double, so a short scan holds little memory and
+// reads little more than it uses.  Other reads, and reads beyond "size",
+// go to "file" directly.
+//
+// The result does not own "file".  Unlike "file", it is not safe for
+// concurrent use, every iterator needs its own.
+extern RandomAccessFile* NewReadaheadFile(RandomAccessFile* file,
+                                          uint64_t size,
+                                          size_t readahead_size);
+
+// Set the number of threads prefetching for the readahead files of the
+// process, 0 reads every chunk in the calling thread.
+extern void SetReadaheadThreads(int num);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_READAHEAD_FILE_H_
@@ -0,0 +1,173 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "table/readahead_file.h"
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+// In memory file counting the reads it serves
+class CountingFile : public RandomAccessFile {
+ public:
+  explicit CountingFile(const std::string& contents)
+      : contents_(contents), reads_(0), last_offset_(0), max_n_(0) { }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    MutexLock l(&mu_);
+    reads_++;
+    last_offset_ = offset;
+    max_n_ = std::max(max_n_, n);
+    if (offset > contents_.size()) {
+      return Status::IOError("read beyond end of file");
+    }
+    n = std::min<size_t>(n, contents_.size() - offset);
+    memcpy(scratch, contents_.data() + offset, n);
+    *result = Slice(scratch, n);
+    return Status::OK();
+  }
+
+  int Reads() const {
+    MutexLock l(&mu_);
+    return reads_;
+  }
+
+  uint64_t LastOffset() const {
+    MutexLock l(&mu_);
+    return last_offset_;
+  }
+
+  size_t MaxRead() const {
+    MutexLock l(&mu_);
+    return max_n_;
+  }
+
+ private:
+  std::string contents_;
+  mutable port::Mutex mu_;
+  mutable int reads_;
+  mutable uint64_t last_offset_;
+  mutable size_t max_n_;
+};
+
+class ReadaheadFileTest {
+ public:
+  ReadaheadFileTest() {
+    for (int i = 0; i < 100000; i++) {
+      contents_.push_back(static_cast<char>('a' + i % 26));
+    }
+  }
+
+  void CheckRead(RandomAccessFile* file, uint64_t offset, size_t n) {
+    char scratch[4096];
+    Slice result;
+    ASSERT_OK(file->Read(offset, n, &result, scratch));
+    size_t expected = std::min<size_t>(n, contents_.size() - offset);
+    ASSERT_EQ(result.ToString(), contents_.substr(offset, expected));
+  }
+
+  std::string contents_;
+};
+
+TEST(ReadaheadFileTest, Sequential) {
+  CountingFile base(contents_);
+  RandomAccessFile* file = NewReadaheadFile(&base, contents_.size(), 10000);
+  // blocks that straddle chunk boundaries
+  for (uint64_t offset = 0; offset + 3500 <= contents_.size(); offset += 3500) {
+    CheckRead(file, offset, 3500);
+  }
+  delete file;
+  // three reads before the run is sequential, then one read per chunk
+  ASSERT_EQ(base.Reads(), 3 + 9);
+}
+
+TEST(ReadaheadFileTest, ShortScan) {
+  CountingFile base(contents_);
+  RandomAccessFile* file = NewReadaheadFile(&base, contents_.size(), 10000);
+  CheckRead(file, 0, 1000);
+  CheckRead(file, 1000, 1000);
+  CheckRead(file, 2000, 1000);
+  delete file;
+  // no chunk is read for a few blocks
+  ASSERT_EQ(base.Reads(), 3);
+  ASSERT_EQ(base.MaxRead(), 1000u);
+}
+
+TEST(ReadaheadFileTest, Jump) {
+  CountingFile base(contents_);
+  RandomAccessFile* file = NewReadaheadFile(&base, contents_.size(), 10000);
+  CheckRead(file, 0, 100);
+  CheckRead(file, 50000, 100);
+  CheckRead(file, 50100, 100);
+  CheckRead(file, 20000, 4000);
+  CheckRead(file, 99900, 100);
+  // beyond the read-ahead range
+  CheckRead(file, 99990, 100);
+  delete file;
+}
+
+TEST(ReadaheadFileTest, LargeRead) {
+  CountingFile base(contents_);
+  RandomAccessFile* file = NewReadaheadFile(&base, contents_.size(), 1000);
+  CheckRead(file, 500, 4000);
+  CheckRead(file, 4500, 4000);
+  delete file;
+}
+
+TEST(ReadaheadFileTest, NoPrefetchThread) {
+  SetReadaheadThreads(0);
+  CountingFile base(contents_);
+  RandomAccessFile* file = NewReadaheadFile(&base, contents_.size(), 10000);
+  for (uint64_t offset = 0; offset < 30000; offset += 1000) {
+    CheckRead(file, offset, 1000);
+  }
+  delete file;
+  // chunks are only read when they are reached
+  ASSERT_EQ(base.Reads(), 3 + 3);
+  SetReadaheadThreads(4);
+}
+
+TEST(ReadaheadFileTest, SkipIntoNextChunk) {
+  SetReadaheadThreads(0);
+  CountingFile base(contents_);
+  RandomAccessFile* file = NewReadaheadFile(&base, contents_.size(), 10000);
+  for (uint64_t offset = 0; offset < 5000; offset += 1000) {
+    CheckRead(file, offset, 1000);
+  }
+  // chunks are [3000, 13000) and [13000, 23000), a block cache hit
+  // skips the start of the second one
+  CheckRead(file, 14000, 1000);
+  ASSERT_EQ(base.LastOffset(), 13000u);
+  delete file;
+  ASSERT_EQ(base.Reads(), 3 + 2);
+  SetReadaheadThreads(4);
+}
+
+TEST(ReadaheadFileTest, ChunksGrow) {
+  SetReadaheadThreads(0);
+  CountingFile base(contents_);
+  RandomAccessFile* file = NewReadaheadFile(&base, contents_.size(), 1 << 20);
+  for (uint64_t offset = 0; offset < contents_.size(); offset += 1000) {
+    CheckRead(file, offset, 1000);
+  }
+  delete file;
+  // the first chunk is small, the second one reads up to the end
+  ASSERT_EQ(base.MaxRead(), 64u << 10);
+  ASSERT_EQ(base.Reads(), 3 + 2);
+  SetReadaheadThreads(4);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -17,16 +17,23 @@
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
+#include "table/readahead_file.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
+#include "../utils/latency_histogram.h"
+#include "../utils/timer.h"
 
 namespace leveldb {
 
+// latency of the data blocks read from the file, cache misses only
+tera::LatencyHistogram block_read_latency;
+
 struct Table::Rep {
   ~Rep() {
     delete filter;
     delete [] filter_data;
     delete index_block;
+    delete compression_dict;
   }
 
   Options options;
@@ -35,6 +42,8 @@ struct Table::Rep {
   uint64_t cache_id;
   FilterBlockReader* filter;
   const char* filter_data;
+  // digested zstd dictionary of the data blocks, NULL if none
+  port::ZstdUncompressDict* compression_dict;
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
   Block* index_block;
@@ -42,20 +51,29 @@ struct Table::Rep {
 
 class TableIter : public Iterator {
  public:
+  // "row_table" is not NULL if seeks should be checked by its row filter
   TableIter(Iterator* iter,
             const Comparator* comparator,
             const Slice& smallest,
-            const Slice& largest)
+            const Slice& largest,
+            const Table* row_table)
       : iter_(iter),
         comparator_(comparator),
         smallest_(smallest.ToString()),
-        largest_(largest.ToString()) { }
+        largest_(largest.ToString()),
+        row_table_(row_table),
+        row_filtered_(false) { }
 
   virtual ~TableIter() {
     delete iter_;
   }
 
   virtual void Seek(const Slice& target) {
+    row_filtered_ = (row_table_ != NULL && !row_table_->RowMayMatch(target));
+    if (row_filtered_) {
+      // row not in this table, leave iterator invalid without block read
+      return;
+    }
     if (smallest_.empty() && largest_.empty()) {
       iter_->Seek(target);
     } else if (!smallest_.empty() && largest_.empty()) {
@@ -85,6 +103,7 @@ class TableIter : public Iterator {
     }
   }
   virtual void SeekToFirst() {
+    row_filtered_ = false;
     if (smallest_.empty()) {
       iter_->SeekToFirst();
     } else {
@@ -93,6 +112,7 @@ class TableIter : public Iterator {
     }
   }
   virtual void SeekToLast() {
+    row_filtered_ = false;
     if (largest_.empty()) {
       iter_->SeekToLast();
     } else {
@@ -107,7 +127,7 @@ class TableIter : public Iterator {
     iter_->Prev();
   }
   virtual bool Valid() const {
-    if (!iter_->Valid()) {
+    if (row_filtered_ || !iter_->Valid()) {
       return false;
     }
     if (!largest_.empty() && comparator_->Compare(iter_->key(), largest_) > 0) {
@@ -135,6 +155,8 @@ class TableIter : public Iterator {
   const Comparator* const comparator_;
   std::string smallest_;
   std::string largest_;
+  const Table* row_table_;
+  bool row_filtered_;
 };
 
 Status Table::Open(const Options& options,
@@ -179,6 +201,7 @@ Status Table::Open(const Options& options,
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     rep->filter_data = NULL;
     rep->filter = NULL;
+    rep->compression_dict = NULL;
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
   } else {
@@ -189,12 +212,8 @@ Status Table::Open(const Options& options,
 }
 
 void Table::ReadMeta(const Footer& footer) {
-  if (rep_->options.filter_policy == NULL) {
-    return;  // Do not need any metadata
-  }
-
-  // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
-  // it is an empty block.
+  // The metaindex block is read even without filter policy: the data
+  // blocks may need the compression dictionary whatever the options are.
   ReadOptions opt;
   opt.verify_checksums = true;
   BlockContents contents;
@@ -205,11 +224,17 @@ void Table::ReadMeta(const Footer& footer) {
   Block* meta = new Block(contents);
 
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.filter_policy->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+  iter->Seek(kCompressionDictBlockName);
+  if (iter->Valid() && iter->key() == Slice(kCompressionDictBlockName)) {
+    ReadCompressionDict(iter->value());
+  }
+  if (rep_->options.filter_policy != NULL) {
+    std::string key = "filter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value());
+    }
   }
   delete iter;
   delete meta;
@@ -236,6 +261,31 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
   rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
 }
 
+void Table::ReadCompressionDict(const Slice& dict_handle_value) {
+  Slice v = dict_handle_value;
+  BlockHandle dict_handle;
+  if (!dict_handle.DecodeFrom(&v).ok()) {
+    return;
+  }
+  ReadOptions opt;
+  opt.verify_checksums = true;
+  BlockContents block;
+  if (!ReadBlock(rep_->file, opt, dict_handle, &block).ok()) {
+    // blocks compressed with it will fail to read
+    return;
+  }
+  port::ZstdUncompressDict* dict =
+      new port::ZstdUncompressDict(block.data.data(), block.data.size());
+  if (block.heap_allocated) {
+    delete[] block.data.data();
+  }
+  if (dict->ok()) {
+    rep_->compression_dict = dict;
+  } else {
+    delete dict;
+  }
+}
+
 Table::~Table() {
   delete rep_;
 }
@@ -255,12 +305,37 @@ static void ReleaseBlock(void* arg, void* h) {
   cache->Release(handle);
 }
 
+// the block function argument of an iterator with read-ahead
+struct TableReadahead {
+  Table* table;
+  RandomAccessFile* file;
+};
+
+static void DeleteReadahead(void* arg, void* ignored) {
+  TableReadahead* readahead = reinterpret_cast<TableReadahead*>(arg);
+  delete readahead->file;
+  delete readahead;
+}
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg,
                              const ReadOptions& options,
                              const Slice& index_value) {
   Table* table = reinterpret_cast<Table*>(arg);
+  return ReadDataBlock(table, table->rep_->file, options, index_value);
+}
+
+Iterator* Table::ReadaheadBlockReader(void* arg,
+                                      const ReadOptions& options,
+                                      const Slice& index_value) {
+  TableReadahead* readahead = reinterpret_cast<TableReadahead*>(arg);
+  return ReadDataBlock(readahead->table, readahead->file, options, index_value);
+}
+
+Iterator* Table::ReadDataBlock(Table* table, RandomAccessFile* file,
+                               const ReadOptions& options,
+                               const Slice& index_value) {
   Cache* block_cache = table->rep_->options.block_cache;
   Block* block = NULL;
   Cache::Handle* cache_handle = NULL;
@@ -278,11 +353,15 @@ Iterator* Table::BlockReader(void* arg,
       EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
       EncodeFixed64(cache_key_buffer+8, handle.offset());
       Slice key(cache_key_buffer, sizeof(cache_key_buffer));
-      cache_handle = block_cache->Lookup(key);
+      cache_handle = block_cache->Lookup(key, options.low_cache_priority ?
+                                         Cache::kLowPriority : Cache::kHighPriority);
       if (cache_handle != NULL) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
+        int64_t start_micros = tera::get_micros();
+        s = ReadBlock(file, options, handle, &contents,
+                      table->rep_->compression_dict);
+        block_read_latency.Add(tera::get_micros() - start_micros);
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
@@ -292,7 +371,10 @@ Iterator* Table::BlockReader(void* arg,
         }
       }
     } else {
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      int64_t start_micros = tera::get_micros();
+      s = ReadBlock(file, options, handle, &contents,
+                    table->rep_->compression_dict);
+      block_read_latency.Add(tera::get_micros() - start_micros);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -313,20 +395,58 @@ Iterator* Table::BlockReader(void* arg,
   return iter;
 }
 
+Iterator* Table::NewBlockIterator(const ReadOptions& options) const {
+  Iterator* index_iter =
+      rep_->index_block->NewIterator(options.db_opt->comparator);
+  if (options.readahead_size == 0) {
+    return NewTwoLevelIterator(index_iter, &Table::BlockReader,
+                               const_cast<Table*>(this), options);
+  }
+  TableReadahead* readahead = new TableReadahead;
+  readahead->table = const_cast<Table*>(this);
+  // data blocks end where the meta blocks begin
+  readahead->file = NewReadaheadFile(rep_->file, rep_->metaindex_handle.offset(),
+                                     options.readahead_size);
+  Iterator* iter = NewTwoLevelIterator(index_iter, &Table::ReadaheadBlockReader,
+                                       readahead, options);
+  iter->RegisterCleanup(&DeleteReadahead, readahead, NULL);
+  return iter;
+}
+
 Iterator* Table::NewIterator(const ReadOptions& options) const {
-  return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(options.db_opt->comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+  return NewBlockIterator(options);
 }
 
 Iterator* Table::NewIterator(const ReadOptions& options,
                              const Slice& smallest,
                              const Slice& largest) const {
-  return new TableIter(
-      NewTwoLevelIterator(
-          rep_->index_block->NewIterator(options.db_opt->comparator),
-          &Table::BlockReader, const_cast<Table*>(this), options),
-      options.db_opt->comparator, smallest, largest);
+  const Table* row_table = NULL;
+  if (options.single_row_read && rep_->filter != NULL &&
+      rep_->options.filter_policy->IsRowFilter()) {
+    row_table = this;
+  }
+  // single_row_read is handled here, blocks of the table must be concatenated
+  ReadOptions block_options = options;
+  block_options.single_row_read = false;
+  return new TableIter(NewBlockIterator(block_options),
+                       options.db_opt->comparator, smallest, largest, row_table);
+}
+
+bool Table::RowMayMatch(const Slice& key) const {
+  bool may_match = true;
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  iiter->Seek(key);
+  if (iiter->Valid()) {
+    // the first key of the row, if any, must be in this block
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    if (handle.DecodeFrom(&handle_value).ok() &&
+        !rep_->filter->KeyMayMatch(handle.offset(), key)) {
+      may_match = false;
+    }
+  }
+  delete iiter;
+  return may_match;
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k,
@@ -9,6 +9,7 @@
 #include "leveldb/table_builder.h"
 
 #include <assert.h>
+#include <vector>
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
@@ -22,8 +23,12 @@
 
 namespace leveldb {
 
-tera::Counter snappy_before_size_counter;
-tera::Counter snappy_after_size_counter;
+tera::ShardedCounter snappy_before_size_counter;
+tera::ShardedCounter snappy_after_size_counter;
+
+// The zstd dictionary is trained once the sampled data blocks hold
+// this many times its size
+static const size_t kDictSampleFactor = 32;
 
 struct TableBuilder::Rep {
   Options options;
@@ -53,6 +58,14 @@ struct TableBuilder::Rep {
 
   std::string compressed_output;
 
+  // zstd dictionary of the data blocks, empty until trained.  Blocks
+  // written before it is trained are compressed without it.
+  std::string compression_dict;
+  port::ZstdCompressor zstd;
+  std::string dict_samples;
+  std::vector<size_t> dict_sample_sizes;
+  bool dict_done;       // dictionary trained, failed or not wanted
+
   Rep(const Options& opt, WritableFile* f)
       : options(opt),
         index_block_options(opt),
@@ -65,7 +78,9 @@ struct TableBuilder::Rep {
         closed(false),
         filter_block(opt.filter_policy == NULL ? NULL
                      : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+        pending_index_entry(false),
+        dict_done(opt.compression != kZstdCompression ||
+                  opt.compression_dict_size == 0) {
     index_block_options.block_restart_interval = 1;
   }
 };
@@ -156,6 +171,8 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   Slice raw = block->Finish();
 
   Slice block_contents;
+  // index and meta blocks are read before the dictionary
+  bool is_data_block = (block == &r->data_block);
   CompressionType type = r->options.compression;
   // TODO(postrelease): Support more compression options: zlib?
   switch (type) {
@@ -200,6 +217,25 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
       }
       break;
     }
+    case kZstdCompression: {
+      bool use_dict = false;
+      if (is_data_block) {
+        SampleForDict(raw);
+        use_dict = r->zstd.HasDict();
+      }
+      std::string* compressed = &r->compressed_output;
+      if (r->zstd.Compress(raw.data(), raw.size(), use_dict, compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        block_contents = *compressed;
+        if (use_dict) {
+          type = kZstdDictCompression;
+        }
+      } else {
+        block_contents = raw;
+        type = kNoCompression;
+      }
+      break;
+    }
   }
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
@@ -207,6 +243,30 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   r->saved_size += raw.size() - block_contents.size();
 }
 
+void TableBuilder::SampleForDict(const Slice& raw) {
+  Rep* r = rep_;
+  if (r->dict_done) {
+    return;
+  }
+  r->dict_samples.append(raw.data(), raw.size());
+  r->dict_sample_sizes.push_back(raw.size());
+  if (r->dict_samples.size() <
+      r->options.compression_dict_size * kDictSampleFactor) {
+    return;
+  }
+  if (port::Zstd_TrainDict(r->dict_samples, r->dict_sample_sizes,
+                           r->options.compression_dict_size,
+                           &r->compression_dict) &&
+      !r->zstd.SetDict(r->compression_dict.data(),
+                       r->compression_dict.size())) {
+    // no block uses it
+    r->compression_dict.clear();
+  }
+  r->dict_done = true;
+  std::string().swap(r->dict_samples);
+  std::vector<size_t>().swap(r->dict_sample_sizes);
+}
+
 void TableBuilder::WriteRawBlock(const Slice& block_contents,
                                  CompressionType type,
                                  BlockHandle* handle) {
@@ -238,6 +298,12 @@ Status TableBuilder::Finish() {
   r->closed = true;
 
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
+  BlockHandle dict_block_handle;
+
+  // Write compression dictionary block
+  if (ok() && !r->compression_dict.empty()) {
+    WriteRawBlock(r->compression_dict, kNoCompression, &dict_block_handle);
+  }
 
   // Write filter block
   if (ok() && r->filter_block != NULL) {
@@ -248,6 +314,12 @@ Status TableBuilder::Finish() {
   // Write metaindex block
   if (ok()) {
     BlockBuilder meta_index_block(&r->options);
+    // keys of the metaindex block must be added in order
+    if (!r->compression_dict.empty()) {
+      std::string handle_encoding;
+      dict_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(kCompressionDictBlockName, handle_encoding);
+    }
     if (r->filter_block != NULL) {
       // Add mapping from "filter.Name" to location of filter data
       std::string key = "filter.";
@@ -869,6 +869,63 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"),    4000,   6000));
 }
 
+static bool ZstdCompressionSupported() {
+  std::string out;
+  Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  port::ZstdCompressor zstd;
+  return zstd.Compress(in.data(), in.size(), false, &out);
+}
+
+// Round trip of a zstd table of many small blocks, "dict_size" 0 for
+// no dictionary.  With a dictionary, the first blocks are compressed
+// before it is trained and must be read without it.
+static void TestZstdTable(size_t dict_size) {
+  Random rnd(301);
+  TableConstructor c(BytewiseComparator());
+  std::string tmp;
+  char key[32];
+  for (int i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "k%06d", i);
+    c.Add(key, test::CompressibleString(&rnd, 0.25, 200, &tmp));
+  }
+  std::vector<std::string> keys;
+  KVMap kvmap;
+  Options options;
+  options.block_size = 1024;
+  options.compression = kZstdCompression;
+  options.compression_dict_size = dict_size;
+  c.Finish(options, &keys, &kvmap);
+
+  Iterator* iter = c.NewIterator();
+  iter->SeekToFirst();
+  for (KVMap::const_iterator it = kvmap.begin(); it != kvmap.end(); ++it) {
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key().ToString(), it->first);
+    ASSERT_EQ(iter->value().ToString(), it->second);
+    iter->Next();
+  }
+  ASSERT_TRUE(!iter->Valid());
+  ASSERT_TRUE(iter->status().ok()) << iter->status().ToString();
+  iter->Seek("k000999");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(iter->value().ToString(), kvmap["k000999"]);
+  delete iter;
+
+  // compressed, most blocks by a quarter
+  if (ZstdCompressionSupported()) {
+    ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 0, 100000));
+  }
+}
+
+TEST(TableTest, ZstdCompressed) {
+  TestZstdTable(0);
+}
+
+TEST(TableTest, ZstdCompressedWithDict) {
+  // trained after 32KB of blocks, a sixth of the table
+  TestZstdTable(1024);
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -96,6 +96,12 @@ void TwoLevelIterator::Seek(const Slice& target) {
   index_iter_.Seek(target);
   InitDataBlock();
   if (data_iter_.iter() != NULL) data_iter_.Seek(target);
+  if (options_.single_row_read && data_iter_.iter() != NULL) {
+    // The sst found by index holds keys >= target, if it has no key for the
+    // row, its row filter ruled the row out and the following ssts only
+    // hold larger rows, no need to open them.
+    return;
+  }
   SkipEmptyDataBlocksForward();
 }
 
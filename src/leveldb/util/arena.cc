@@ -8,12 +8,13 @@
 
 #include "util/arena.h"
 #include <assert.h>
+#include "leveldb/arena_pool.h"
 
 namespace leveldb {
 
 static const int kBlockSize = 4096;
 
-Arena::Arena() {
+Arena::Arena(ArenaPool* pool) : pool_(pool) {
   blocks_memory_ = 0;
   alloc_ptr_ = NULL;  // First allocation will allocate a block
   alloc_bytes_remaining_ = 0;
@@ -23,10 +24,22 @@ Arena::~Arena() {
   for (size_t i = 0; i < blocks_.size(); i++) {
     delete[] blocks_[i];
   }
+  for (size_t i = 0; i < chunks_.size(); i++) {
+    pool_->DeleteChunk(chunks_[i].first, chunks_[i].second);
+  }
 }
 
 char* Arena::AllocateFallback(size_t bytes) {
-  if (bytes > kBlockSize / 4) {
+  size_t block_size = kBlockSize;
+  if (pool_ != NULL) {
+    // blocks double in size as the arena grows, the small ones come from
+    // the heap and the others are chunks of the pool
+    while (block_size < pool_->MaxChunkSize() &&
+           block_size <= blocks_memory_) {
+      block_size <<= 1;
+    }
+  }
+  if (bytes > block_size / 4) {
     // Object is more than a quarter of our block size.  Allocate it separately
     // to avoid wasting too much space in leftover bytes.
     char* result = AllocateNewBlock(bytes);
@@ -34,8 +47,10 @@ char* Arena::AllocateFallback(size_t bytes) {
   }
 
   // We waste the remaining space in the current block.
-  alloc_ptr_ = AllocateNewBlock(kBlockSize);
-  alloc_bytes_remaining_ = kBlockSize;
+  alloc_ptr_ = (pool_ != NULL && block_size >= ArenaPool::kMinChunkSize
+                    ? AllocateNewChunk(block_size)
+                    : AllocateNewBlock(block_size));
+  alloc_bytes_remaining_ = block_size;
 
   char* result = alloc_ptr_;
   alloc_ptr_ += bytes;
@@ -62,6 +77,17 @@ char* Arena::AllocateAligned(size_t bytes) {
   return result;
 }
 
+char* Arena::AllocateNewChunk(size_t chunk_bytes) {
+  char* result = pool_->NewChunk(chunk_bytes);
+  if (result == NULL) {
+    // out of mappings, fall back to the heap
+    return AllocateNewBlock(chunk_bytes);
+  }
+  blocks_memory_ += chunk_bytes;
+  chunks_.push_back(std::make_pair(result, chunk_bytes));
+  return result;
+}
+
 char* Arena::AllocateNewBlock(size_t block_bytes) {
   char* result = new char[block_bytes];
   blocks_memory_ += block_bytes;
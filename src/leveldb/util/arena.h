@@ -10,15 +10,21 @@
 #define STORAGE_LEVELDB_UTIL_ARENA_H_
 
 #include <cstddef>
+#include <utility>
 #include <vector>
 #include <assert.h>
 #include <stdint.h>
 
 namespace leveldb {
 
+class ArenaPool;
+
 class Arena {
  public:
-  Arena();
+  // If "pool" is non-NULL, blocks double from 4KB up to the max chunk
+  // size of the pool, and those of ArenaPool::kMinChunkSize and more are
+  // chunks of the pool, instead of 4KB blocks from new[].
+  explicit Arena(ArenaPool* pool = NULL);
   ~Arena();
 
   // Return a pointer to a newly allocated memory block of "bytes" bytes.
@@ -31,12 +37,14 @@ class Arena {
   // by the arena (including space allocated but not yet used for user
   // allocations).
   size_t MemoryUsage() const {
-    return blocks_memory_ + blocks_.capacity() * sizeof(char*);
+    return blocks_memory_ + blocks_.capacity() * sizeof(char*) +
+        chunks_.capacity() * sizeof(chunks_[0]);
   }
 
  private:
   char* AllocateFallback(size_t bytes);
   char* AllocateNewBlock(size_t block_bytes);
+  char* AllocateNewChunk(size_t chunk_bytes);
 
   // Allocation state
   char* alloc_ptr_;
@@ -45,6 +53,10 @@ class Arena {
   // Array of new[] allocated memory blocks
   std::vector<char*> blocks_;
 
+  // Chunks of the pool, and their sizes
+  ArenaPool* const pool_;
+  std::vector<std::pair<char*, size_t> > chunks_;
+
   // Bytes of memory in blocks allocated so far
   size_t blocks_memory_;
 
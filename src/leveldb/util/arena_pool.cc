@@ -0,0 +1,158 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "leveldb/arena_pool.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <vector>
+
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+const size_t ArenaPool::kMinChunkSize;
+
+ArenaPool::~ArenaPool() {
+}
+
+namespace {
+
+static const size_t kHugePageSize = 2 << 20;
+
+class MmapArenaPool : public ArenaPool {
+ public:
+  MmapArenaPool(size_t max_chunk_size, size_t max_free_bytes, bool huge_page)
+      : max_chunk_size_(kMinChunkSize),
+        max_free_bytes_(max_free_bytes),
+        huge_page_(huge_page),
+        used_bytes_(0),
+        free_bytes_(0) {
+    while (max_chunk_size_ < max_chunk_size) {
+      max_chunk_size_ <<= 1;
+    }
+    free_.resize(SizeClass(max_chunk_size_) + 1);
+  }
+
+  virtual ~MmapArenaPool() {
+    for (size_t i = 0; i < free_.size(); i++) {
+      for (size_t j = 0; j < free_[i].size(); j++) {
+        munmap(free_[i][j], kMinChunkSize << i);
+      }
+    }
+  }
+
+  virtual char* NewChunk(size_t size) {
+    size_t size_class = SizeClass(size);
+    assert(size_class < free_.size() && (kMinChunkSize << size_class) == size);
+    {
+      MutexLock l(&mu_);
+      if (!free_[size_class].empty()) {
+        char* chunk = free_[size_class].back();
+        free_[size_class].pop_back();
+        free_bytes_ -= size;
+        used_bytes_ += size;
+        return chunk;
+      }
+    }
+    char* chunk = Map(size);
+    if (chunk != NULL) {
+      MutexLock l(&mu_);
+      used_bytes_ += size;
+    }
+    return chunk;
+  }
+
+  virtual void DeleteChunk(char* chunk, size_t size) {
+    bool keep = false;
+    {
+      MutexLock l(&mu_);
+      used_bytes_ -= size;
+      if (free_bytes_ + size <= max_free_bytes_) {
+        free_bytes_ += size;
+        keep = true;
+      }
+    }
+    if (!keep) {
+      munmap(chunk, size);
+      return;
+    }
+    // a cached chunk only keeps its mapping, drop its pages so that it
+    // costs no memory until it is reused
+    madvise(chunk, size, MADV_DONTNEED);
+    MutexLock l(&mu_);
+    free_[SizeClass(size)].push_back(chunk);
+  }
+
+  virtual size_t MaxChunkSize() const {
+    return max_chunk_size_;
+  }
+
+  virtual size_t UsedBytes() {
+    MutexLock l(&mu_);
+    return used_bytes_;
+  }
+
+  virtual size_t FreeBytes() {
+    MutexLock l(&mu_);
+    return free_bytes_;
+  }
+
+ private:
+  static size_t SizeClass(size_t size) {
+    size_t size_class = 0;
+    while ((kMinChunkSize << size_class) < size) {
+      size_class++;
+    }
+    return size_class;
+  }
+
+  char* Map(size_t size) {
+    if (!huge_page_ || size < kHugePageSize) {
+      void* p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      return p == MAP_FAILED ? NULL : reinterpret_cast<char*>(p);
+    }
+    // map one huge page more and trim both ends to align the chunk
+    void* p = mmap(NULL, size + kHugePageSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      return NULL;
+    }
+    char* base = reinterpret_cast<char*>(p);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(base);
+    char* chunk = base + ((kHugePageSize - addr % kHugePageSize) % kHugePageSize);
+    if (chunk > base) {
+      munmap(base, chunk - base);
+    }
+    size_t tail = base + size + kHugePageSize - (chunk + size);
+    if (tail > 0) {
+      munmap(chunk + size, tail);
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(chunk, size, MADV_HUGEPAGE);
+#endif
+    return chunk;
+  }
+
+  size_t max_chunk_size_;
+  const size_t max_free_bytes_;
+  const bool huge_page_;
+
+  port::Mutex mu_;
+  std::vector<std::vector<char*> > free_;   // by size class
+  size_t used_bytes_;
+  size_t free_bytes_;
+};
+
+}  // namespace
+
+ArenaPool* NewArenaPool(size_t max_chunk_size, size_t max_free_bytes,
+                        bool huge_page) {
+  return new MmapArenaPool(max_chunk_size, max_free_bytes, huge_page);
+}
+
+}  // namespace leveldb
@@ -8,6 +8,9 @@
 
 #include "util/arena.h"
 
+#include <stdint.h>
+
+#include "leveldb/arena_pool.h"
 #include "util/random.h"
 #include "util/testharness.h"
 
@@ -65,6 +68,67 @@ TEST(ArenaTest, Simple) {
   }
 }
 
+TEST(ArenaTest, Pool) {
+  ArenaPool* pool = NewArenaPool(1 << 20, 4 << 20, false);
+  ASSERT_EQ(pool->MaxChunkSize(), 1u << 20);
+  {
+    Arena arena(pool);
+    char* small = arena.Allocate(100);
+    memset(small, 'a', 100);
+    // an idle arena holds a single heap block
+    ASSERT_EQ(pool->UsedBytes(), 0u);
+    ASSERT_LT(arena.MemoryUsage(), ArenaPool::kMinChunkSize);
+    for (int i = 0; i < 10000; i++) {
+      memset(arena.Allocate(1000), 'b', 1000);
+    }
+    // all but the first few small blocks are chunks of the pool
+    ASSERT_GE(arena.MemoryUsage(), 10000 * 1000u);
+    ASSERT_LE(arena.MemoryUsage(),
+              pool->UsedBytes() + ArenaPool::kMinChunkSize);
+    ASSERT_EQ(pool->FreeBytes(), 0u);
+  }
+  // chunks are back in the pool and reused
+  ASSERT_EQ(pool->UsedBytes(), 0u);
+  size_t free_bytes = pool->FreeBytes();
+  ASSERT_GT(free_bytes, 0u);
+  {
+    Arena arena(pool);
+    for (int i = 0; i < 100; i++) {
+      arena.Allocate(1000);
+    }
+    ASSERT_EQ(pool->UsedBytes(), ArenaPool::kMinChunkSize);
+    ASSERT_EQ(pool->FreeBytes(), free_bytes - ArenaPool::kMinChunkSize);
+  }
+  delete pool;
+}
+
+TEST(ArenaTest, PoolDropsFreePages) {
+  ArenaPool* pool = NewArenaPool(1 << 20, 4 << 20, false);
+  char* chunk = pool->NewChunk(ArenaPool::kMinChunkSize);
+  ASSERT_TRUE(chunk != NULL);
+  memset(chunk, 'a', ArenaPool::kMinChunkSize);
+  pool->DeleteChunk(chunk, ArenaPool::kMinChunkSize);
+  ASSERT_EQ(pool->FreeBytes(), ArenaPool::kMinChunkSize);
+  // the cached chunk is reused, its old pages are gone
+  ASSERT_TRUE(pool->NewChunk(ArenaPool::kMinChunkSize) == chunk);
+  ASSERT_EQ(chunk[0], 0);
+  ASSERT_EQ(chunk[ArenaPool::kMinChunkSize - 1], 0);
+  pool->DeleteChunk(chunk, ArenaPool::kMinChunkSize);
+  delete pool;
+}
+
+TEST(ArenaTest, HugePagePool) {
+  ArenaPool* pool = NewArenaPool(2 << 20, 0, true);
+  char* chunk = pool->NewChunk(2 << 20);
+  ASSERT_TRUE(chunk != NULL);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(chunk) % (2 << 20), 0u);
+  memset(chunk, 'a', 2 << 20);
+  pool->DeleteChunk(chunk, 2 << 20);
+  // nothing cached beyond max_free_bytes
+  ASSERT_EQ(pool->FreeBytes(), 0u);
+  delete pool;
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -8,6 +8,9 @@
 
 #include "leveldb/filter_policy.h"
 
+#include <vector>
+
+#include "leveldb/raw_key_operator.h"
 #include "leveldb/slice.h"
 #include "util/hash.h"
 
@@ -30,11 +33,26 @@ class BloomFilterPolicy : public FilterPolicy {
   size_t bits_per_key_;
   size_t k_;
   BloomHashMethod hash_method_;
+  // if not NULL, only the row of tera keys is added to the filter
+  const RawKeyOperator* key_operator_;
+
+  uint32_t BloomHash(const Slice& key) const {
+    if (key_operator_ == NULL) {
+      return hash_method_(key);
+    }
+    Slice row;
+    if (!key_operator_->ExtractTeraKey(key, &row, NULL, NULL, NULL, NULL)) {
+      row = key;
+    }
+    return hash_method_(row);
+  }
 
  public:
-  explicit BloomFilterPolicy(int bits_per_key, BloomHashMethod hash_method)
+  BloomFilterPolicy(int bits_per_key, BloomHashMethod hash_method,
+                    const RawKeyOperator* key_operator = NULL)
       : bits_per_key_(bits_per_key),
-        hash_method_(hash_method) {
+        hash_method_(hash_method),
+        key_operator_(key_operator) {
     // We intentionally round down to reduce probing cost a little bit
     k_ = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
     if (k_ < 1) k_ = 1;
@@ -42,12 +60,30 @@ class BloomFilterPolicy : public FilterPolicy {
   }
 
   virtual const char* Name() const {
+    if (key_operator_ != NULL) {
+      return "tera.RowKeyBloomFilter";
+    }
     return "leveldb.BuiltinBloomFilter";
   }
 
+  virtual bool IsRowFilter() const {
+    return key_operator_ != NULL;
+  }
+
   virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    // Keys are sorted, versions of a key (or cells of a row for row filter)
+    // are adjacent and share the same hash, count them once.
+    std::vector<uint32_t> hashes;
+    hashes.reserve(n);
+    for (int i = 0; i < n; i++) {
+      uint32_t h = BloomHash(keys[i]);
+      if (hashes.empty() || hashes.back() != h) {
+        hashes.push_back(h);
+      }
+    }
+
     // Compute bloom filter size (in both bits and bytes)
-    size_t bits = n * bits_per_key_;
+    size_t bits = hashes.size() * bits_per_key_;
 
     // For small n, we can see a very high false positive rate.  Fix it
     // by enforcing a minimum bloom filter length.
@@ -60,10 +96,10 @@ class BloomFilterPolicy : public FilterPolicy {
     dst->resize(init_size + bytes, 0);
     dst->push_back(static_cast<char>(k_));  // Remember # of probes in filter
     char* array = &(*dst)[init_size];
-    for (size_t i = 0; i < static_cast<size_t>(n); i++) {
+    for (size_t i = 0; i < hashes.size(); i++) {
       // Use double-hashing to generate a sequence of hash values.
       // See analysis in [Kirsch,Mitzenmacher 2006].
-      uint32_t h = hash_method_(keys[i]);
+      uint32_t h = hashes[i];
       const uint32_t delta = (h >> 17) | (h << 15);  // Rotate right 17 bits
       for (size_t j = 0; j < k_; j++) {
         const uint32_t bitpos = h % bits;
@@ -89,7 +125,7 @@ class BloomFilterPolicy : public FilterPolicy {
       return true;
     }
 
-    uint32_t h = hash_method_(key);
+    uint32_t h = BloomHash(key);
     const uint32_t delta = (h >> 17) | (h << 15);  // Rotate right 17 bits
     for (size_t j = 0; j < k; j++) {
       const uint32_t bitpos = h % bits;
@@ -109,4 +145,9 @@ const FilterPolicy* NewTTLKvBloomFilterPolicy(int bits_per_key) {
   return new BloomFilterPolicy(bits_per_key, TTLKvBloomHash);
 }
 
+const FilterPolicy* NewRowKeyBloomFilterPolicy(int bits_per_key,
+                                               const RawKeyOperator* key_operator) {
+  return new BloomFilterPolicy(bits_per_key, BuiltInBloomHash, key_operator);
+}
+
 }  // namespace leveldb
@@ -36,6 +36,7 @@ struct LRUHandle {
   size_t key_length;
   uint32_t refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
+  bool in_protected;  // In the protected list of a segmented LRU shard
   char key_data[1];   // Beginning of key
 
   Slice key() const {
@@ -136,54 +137,84 @@ class HandleTable {
 };
 
 // A single shard of sharded cache.
+//
+// With a protected capacity of 0 the shard is a plain LRU. Otherwise it is
+// a segmented LRU: new entries enter the probation list and move to the
+// protected list on their first high priority hit. Entries demoted from
+// the protected list go back to the probation list, and eviction takes
+// the oldest probation entry first. A scan touching many blocks once only
+// churns the probation list, the protected working set survives it.
 class LRUCache {
  public:
   LRUCache();
   ~LRUCache();
 
   // Separate from constructor so caller can easily make an array of LRUCache
-  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+  void SetCapacity(size_t capacity, size_t protected_capacity) {
+    capacity_ = capacity;
+    protected_capacity_ = protected_capacity;
+  }
 
   // Like Cache methods, but with an extra "hash" parameter.
   Cache::Handle* Insert(const Slice& key, uint32_t hash,
                         void* value, size_t charge,
                         void (*deleter)(const Slice& key, void* value));
-  Cache::Handle* Lookup(const Slice& key, uint32_t hash);
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash,
+                        Cache::Priority priority);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
 
+  // Add lookup statistics of this shard to "*lookups" and "*hits".
+  void AddStats(uint64_t* lookups, uint64_t* hits);
+
  private:
   void LRU_Remove(LRUHandle* e);
-  void LRU_Append(LRUHandle* e);
+  void LRU_Append(LRUHandle* list, LRUHandle* e);
   void Unref(LRUHandle* e);
 
+  // Remove "e" from the list holding it
+  void Detach(LRUHandle* e);
+  void Protect(LRUHandle* e);
+
   // Initialized before use.
   size_t capacity_;
+  size_t protected_capacity_;
 
   // mutex_ protects the following state.
   port::Mutex mutex_;
   size_t usage_;
+  size_t protected_usage_;
+  uint64_t lookups_;
+  uint64_t hits_;
 
-  // Dummy head of LRU list.
+  // Dummy heads of LRU lists.
   // lru.prev is newest entry, lru.next is oldest entry.
+  // lru_ is the probation list, protected_ the protected list.
   LRUHandle lru_;
+  LRUHandle protected_;
 
   HandleTable table_;
 };
 
 LRUCache::LRUCache()
-    : usage_(0) {
-  // Make empty circular linked list
+    : capacity_(0), protected_capacity_(0),
+      usage_(0), protected_usage_(0), lookups_(0), hits_(0) {
+  // Make empty circular linked lists
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  protected_.next = &protected_;
+  protected_.prev = &protected_;
 }
 
 LRUCache::~LRUCache() {
-  for (LRUHandle* e = lru_.next; e != &lru_; ) {
-    LRUHandle* next = e->next;
-    assert(e->refs == 1);  // Error if caller has an unreleased handle
-    Unref(e);
-    e = next;
+  LRUHandle* lists[2] = { &lru_, &protected_ };
+  for (int i = 0; i < 2; i++) {
+    for (LRUHandle* e = lists[i]->next; e != lists[i]; ) {
+      LRUHandle* next = e->next;
+      assert(e->refs == 1);  // Error if caller has an unreleased handle
+      Unref(e);
+      e = next;
+    }
   }
 }
 
@@ -202,25 +233,59 @@ void LRUCache::LRU_Remove(LRUHandle* e) {
   e->prev->next = e->next;
 }
 
-void LRUCache::LRU_Append(LRUHandle* e) {
-  // Make "e" newest entry by inserting just before lru_
-  e->next = &lru_;
-  e->prev = lru_.prev;
+void LRUCache::LRU_Append(LRUHandle* list, LRUHandle* e) {
+  // Make "e" newest entry by inserting just before list
+  e->next = list;
+  e->prev = list->prev;
   e->prev->next = e;
   e->next->prev = e;
 }
 
-Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash) {
+void LRUCache::Detach(LRUHandle* e) {
+  LRU_Remove(e);
+  if (e->in_protected) {
+    e->in_protected = false;
+    protected_usage_ -= e->charge;
+  }
+}
+
+void LRUCache::Protect(LRUHandle* e) {
+  e->in_protected = true;
+  protected_usage_ += e->charge;
+  LRU_Append(&protected_, e);
+  while (protected_usage_ > protected_capacity_ && protected_.next != e) {
+    // demote the oldest protected entry
+    LRUHandle* old = protected_.next;
+    Detach(old);
+    LRU_Append(&lru_, old);
+  }
+}
+
+Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash,
+                                Cache::Priority priority) {
   MutexLock l(&mutex_);
   LRUHandle* e = table_.Lookup(key, hash);
+  lookups_++;
   if (e != NULL) {
+    hits_++;
     e->refs++;
-    LRU_Remove(e);
-    LRU_Append(e);
+    if (protected_capacity_ == 0) {
+      LRU_Remove(e);
+      LRU_Append(&lru_, e);
+    } else if (priority == Cache::kHighPriority) {
+      Detach(e);
+      Protect(e);
+    }
   }
   return reinterpret_cast<Cache::Handle*>(e);
 }
 
+void LRUCache::AddStats(uint64_t* lookups, uint64_t* hits) {
+  MutexLock l(&mutex_);
+  *lookups += lookups_;
+  *hits += hits_;
+}
+
 void LRUCache::Release(Cache::Handle* handle) {
   MutexLock l(&mutex_);
   Unref(reinterpret_cast<LRUHandle*>(handle));
@@ -239,19 +304,26 @@ Cache::Handle* LRUCache::Insert(
   e->key_length = key.size();
   e->hash = hash;
   e->refs = 2;  // One from LRUCache, one for the returned handle
+  e->in_protected = false;
   memcpy(e->key_data, key.data(), key.size());
-  LRU_Append(e);
+  LRU_Append(&lru_, e);
   usage_ += charge;
 
   LRUHandle* old = table_.Insert(e);
   if (old != NULL) {
-    LRU_Remove(old);
+    Detach(old);
     Unref(old);
   }
 
-  while (usage_ > capacity_ && lru_.next != &lru_) {
+  while (usage_ > capacity_) {
     LRUHandle* old = lru_.next;
-    LRU_Remove(old);
+    if (old == &lru_) {
+      old = protected_.next;
+      if (old == &protected_) {
+        break;
+      }
+    }
+    Detach(old);
     table_.Remove(old->key(), old->hash);
     Unref(old);
   }
@@ -263,55 +335,70 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
   MutexLock l(&mutex_);
   LRUHandle* e = table_.Remove(key, hash);
   if (e != NULL) {
-    LRU_Remove(e);
+    Detach(e);
     Unref(e);
   }
 }
 
 static const int kNumShardBits = 4;
-static const int kNumShards = 1 << kNumShardBits;
+static const int kMaxNumShardBits = 16;
+
+// Share of a segmented LRU shard kept for the protected list
+static const double kProtectedRatio = 0.8;
 
 class ShardedLRUCache : public Cache {
  private:
-  LRUCache shard_[kNumShards];
+  LRUCache* shard_;
+  int num_shard_bits_;
+  bool segmented_;
   port::Mutex id_mutex_;
   uint64_t last_id_;
-  uint64_t hits_;
-  uint64_t lookups_;
 
   static inline uint32_t HashSlice(const Slice& s) {
     return Hash(s.data(), s.size(), 0);
   }
 
-  static uint32_t Shard(uint32_t hash) {
-    return hash >> (32 - kNumShardBits);
+  uint32_t Shard(uint32_t hash) {
+    return num_shard_bits_ > 0 ? hash >> (32 - num_shard_bits_) : 0;
   }
 
  public:
-  explicit ShardedLRUCache(size_t capacity)
-      : last_id_(0),
-        hits_(0),
-        lookups_(0) {
-    const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
-    for (int s = 0; s < kNumShards; s++) {
-      shard_[s].SetCapacity(per_shard);
+  ShardedLRUCache(size_t capacity, int num_shard_bits, bool segmented)
+      : num_shard_bits_(num_shard_bits),
+        segmented_(segmented),
+        last_id_(0) {
+    if (num_shard_bits_ < 0) {
+      num_shard_bits_ = 0;
+    } else if (num_shard_bits_ > kMaxNumShardBits) {
+      num_shard_bits_ = kMaxNumShardBits;
     }
+    const int num_shards = 1 << num_shard_bits_;
+    shard_ = new LRUCache[num_shards];
+    const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
+    // at least 1 byte protected to tell the segmented mode apart
+    size_t protected_per_shard = 0;
+    if (segmented_) {
+      protected_per_shard = static_cast<size_t>(per_shard * kProtectedRatio);
+      if (protected_per_shard == 0) {
+        protected_per_shard = 1;
+      }
+    }
+    for (int s = 0; s < num_shards; s++) {
+      shard_[s].SetCapacity(per_shard, protected_per_shard);
+    }
+  }
+  virtual ~ShardedLRUCache() {
+    delete[] shard_;
   }
-  virtual ~ShardedLRUCache() { }
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) {
     const uint32_t hash = HashSlice(key);
     return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
   }
-  virtual Handle* Lookup(const Slice& key) {
+  virtual Handle* Lookup(const Slice& key, Priority priority) {
+    // hits and lookups are counted by the shard under its own mutex
     const uint32_t hash = HashSlice(key);
-    Handle* h = shard_[Shard(hash)].Lookup(key, hash);
-    MutexLock l(&id_mutex_);
-    lookups_++;
-    if (h != NULL) {
-      hits_++;
-    }
-    return h;
+    return shard_[Shard(hash)].Lookup(key, hash, priority);
   }
   virtual void Release(Handle* handle) {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(handle);
@@ -328,10 +415,18 @@ class ShardedLRUCache : public Cache {
     MutexLock l(&id_mutex_);
     return ++(last_id_);
   }
+  virtual const char* Name() const {
+    return segmented_ ? "slru" : "lru";
+  }
   virtual double HitRate() {
-    MutexLock l(&id_mutex_);
-    if (lookups_ > 0) {
-      return (double)hits_ / (double)lookups_;
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    const int num_shards = 1 << num_shard_bits_;
+    for (int s = 0; s < num_shards; s++) {
+      shard_[s].AddStats(&lookups, &hits);
+    }
+    if (lookups > 0) {
+      return (double)hits / (double)lookups;
     } else {
       return 0.0;
     }
@@ -341,7 +436,15 @@ class ShardedLRUCache : public Cache {
 }  // end anonymous namespace
 
 Cache* NewLRUCache(size_t capacity) {
-  return new ShardedLRUCache(capacity);
+  return new ShardedLRUCache(capacity, kNumShardBits, false);
+}
+
+Cache* NewLRUCache(size_t capacity, int num_shard_bits) {
+  return new ShardedLRUCache(capacity, num_shard_bits, false);
+}
+
+Cache* NewSLRUCache(size_t capacity, int num_shard_bits) {
+  return new ShardedLRUCache(capacity, num_shard_bits, true);
 }
 
 }  // namespace leveldb
@@ -177,6 +177,77 @@ TEST(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize/10);
 }
 
+TEST(CacheTest, HitRate) {
+  ASSERT_EQ(0.0, cache_->HitRate());
+  Insert(100, 101);
+  Insert(200, 201);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(300));
+  ASSERT_EQ(201, Lookup(200));
+  ASSERT_EQ(-1, Lookup(400));
+  ASSERT_EQ(0.5, cache_->HitRate());
+}
+
+TEST(CacheTest, ShardBits) {
+  for (int bits = 0; bits <= 8; bits += 4) {
+    delete cache_;
+    cache_ = NewLRUCache(kCacheSize, bits);
+    for (int i = 0; i < 100; i++) {
+      Insert(i, 1000 + i);
+    }
+    for (int i = 0; i < 100; i++) {
+      ASSERT_EQ(1000 + i, Lookup(i));
+    }
+    ASSERT_EQ(1.0, cache_->HitRate());
+  }
+}
+
+TEST(CacheTest, ScanResistance) {
+  delete cache_;
+  cache_ = NewSLRUCache(kCacheSize, 0);
+  ASSERT_EQ(std::string("slru"), std::string(cache_->Name()));
+
+  // working set, promoted by a second read
+  for (int i = 0; i < 100; i++) {
+    Insert(i, 1000 + i);
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+
+  // a scan reads many more blocks, each several times
+  for (int i = 0; i < 5 * kCacheSize; i++) {
+    int key = 10000 + i;
+    Cache::Handle* h = cache_->Lookup(EncodeKey(key), Cache::kLowPriority);
+    ASSERT_TRUE(h == NULL);
+    Insert(key, key);
+    h = cache_->Lookup(EncodeKey(key), Cache::kLowPriority);
+    ASSERT_TRUE(h != NULL);
+    cache_->Release(h);
+  }
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+}
+
+TEST(CacheTest, SegmentedEviction) {
+  delete cache_;
+  cache_ = NewSLRUCache(kCacheSize, 0);
+
+  // more promoted entries than the protected segment holds
+  for (int i = 0; i < kCacheSize; i++) {
+    Insert(i, 1000 + i);
+    ASSERT_EQ(1000 + i, Lookup(i));
+  }
+  Insert(kCacheSize, 1000 + kCacheSize);
+  ASSERT_EQ(-1, Lookup(0));
+  ASSERT_EQ(1001, Lookup(1));
+  ASSERT_EQ(1000 + kCacheSize, Lookup(kCacheSize));
+
+  Erase(1);
+  ASSERT_EQ(-1, Lookup(1));
+  ASSERT_EQ(1, deleted_keys_[deleted_keys_.size() - 1]);
+}
+
 TEST(CacheTest, NewId) {
   uint64_t a = cache_->NewId();
   uint64_t b = cache_->NewId();
@@ -23,41 +23,44 @@
 #include "nfs.h"
 #include "util/mutexlock.h"
 #include "../utils/counter.h"
+#include "../utils/latency_histogram.h"
 
 namespace leveldb {
 
-tera::Counter dfs_read_size_counter;
-tera::Counter dfs_write_size_counter;
-
-tera::Counter dfs_read_delay_counter;
-tera::Counter dfs_write_delay_counter;
-tera::Counter dfs_sync_delay_counter;
-
-tera::Counter dfs_read_counter;
-tera::Counter dfs_write_counter;
-tera::Counter dfs_sync_counter;
-tera::Counter dfs_flush_counter;
-tera::Counter dfs_list_counter;
-tera::Counter dfs_other_counter;
-tera::Counter dfs_exists_counter;
-tera::Counter dfs_open_counter;
-tera::Counter dfs_close_counter;
-tera::Counter dfs_delete_counter;
-tera::Counter dfs_tell_counter;
-tera::Counter dfs_info_counter;
-
-tera::Counter dfs_read_hang_counter;
-tera::Counter dfs_write_hang_counter;
-tera::Counter dfs_sync_hang_counter;
-tera::Counter dfs_flush_hang_counter;
-tera::Counter dfs_list_hang_counter;
-tera::Counter dfs_other_hang_counter;
-tera::Counter dfs_exists_hang_counter;
-tera::Counter dfs_open_hang_counter;
-tera::Counter dfs_close_hang_counter;
-tera::Counter dfs_delete_hang_counter;
-tera::Counter dfs_tell_hang_counter;
-tera::Counter dfs_info_hang_counter;
+tera::ShardedCounter dfs_read_size_counter;
+tera::ShardedCounter dfs_write_size_counter;
+
+tera::ShardedCounter dfs_read_delay_counter;
+tera::ShardedCounter dfs_write_delay_counter;
+tera::ShardedCounter dfs_sync_delay_counter;
+
+tera::ShardedCounter dfs_read_counter;
+tera::ShardedCounter dfs_write_counter;
+tera::ShardedCounter dfs_sync_counter;
+tera::ShardedCounter dfs_flush_counter;
+tera::ShardedCounter dfs_list_counter;
+tera::ShardedCounter dfs_other_counter;
+tera::ShardedCounter dfs_exists_counter;
+tera::ShardedCounter dfs_open_counter;
+tera::ShardedCounter dfs_close_counter;
+tera::ShardedCounter dfs_delete_counter;
+tera::ShardedCounter dfs_tell_counter;
+tera::ShardedCounter dfs_info_counter;
+
+tera::ShardedCounter dfs_read_hang_counter;
+tera::ShardedCounter dfs_write_hang_counter;
+tera::ShardedCounter dfs_sync_hang_counter;
+tera::ShardedCounter dfs_flush_hang_counter;
+tera::ShardedCounter dfs_list_hang_counter;
+tera::ShardedCounter dfs_other_hang_counter;
+tera::ShardedCounter dfs_exists_hang_counter;
+tera::ShardedCounter dfs_open_hang_counter;
+tera::ShardedCounter dfs_close_hang_counter;
+tera::ShardedCounter dfs_delete_hang_counter;
+tera::ShardedCounter dfs_tell_hang_counter;
+tera::ShardedCounter dfs_info_hang_counter;
+
+tera::LatencyHistogram dfs_pread_latency;
 
 bool split_filename(const std::string filename,
         std::string* path, std::string* file)
@@ -161,7 +164,9 @@ public:
         int64_t t = tera::get_micros();
         tera::AutoCounter ac(&dfs_read_hang_counter, "Read", filename_.c_str());
         int32_t bytes_read = file_->Pread(offset, scratch, n);
-        dfs_read_delay_counter.Add(tera::get_micros() - t);
+        int64_t used = tera::get_micros() - t;
+        dfs_read_delay_counter.Add(used);
+        dfs_pread_latency.Add(used);
         dfs_read_counter.Inc();
         *result = Slice(scratch, (bytes_read < 0) ? 0 : bytes_read);
         if (bytes_read < 0) {
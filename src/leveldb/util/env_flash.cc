@@ -11,6 +11,7 @@
 #include <sys/time.h>
 #include <time.h>
 #include <algorithm>
+#include <map>
 #include <set>
 #include <iostream>
 #include <sstream>
@@ -18,8 +19,10 @@
 #include "leveldb/status.h"
 #include "leveldb/env_dfs.h"
 #include "leveldb/table_utils.h"
+#include "port/port.h"
 #include "util/hash.h"
 #include "util/mutexlock.h"
+#include "util/thread_pool.h"
 #include "helpers/memenv/memenv.h"
 #include "../utils/counter.h"
 
@@ -28,19 +31,23 @@
 
 namespace leveldb {
 
-tera::Counter ssd_read_counter;
-tera::Counter ssd_read_size_counter;
-tera::Counter ssd_write_counter;
-tera::Counter ssd_write_size_counter;
+tera::ShardedCounter ssd_read_counter;
+tera::ShardedCounter ssd_read_size_counter;
+tera::ShardedCounter ssd_write_counter;
+tera::ShardedCounter ssd_write_size_counter;
+tera::ShardedCounter flash_hit_size_counter;
+tera::ShardedCounter flash_miss_size_counter;
+tera::ShardedCounter flash_evict_size_counter;
 
 // Log error message
 static Status IOError(const std::string& context, int err_number) {
     return Status::IOError(context, strerror(err_number));
 }
 
-/// copy file from env to local
+/// copy file from env to local, reading "chunk_size" bytes at a time
 Status CopyToLocal(const std::string& local_fname, Env* env,
-                   const std::string& fname, uint64_t fsize, bool vanish_allowed) {
+                   const std::string& fname, uint64_t fsize, bool vanish_allowed,
+                   size_t chunk_size) {
     uint64_t time_s = env->NowMicros();
 
     uint64_t local_size = 0;
@@ -78,13 +85,14 @@ Status CopyToLocal(const std::string& local_fname, Env* env,
         return s;
     }
 
-    char buf[4096];
+    char* buf = new char[chunk_size];
     Slice result;
     local_size = 0;
-    while (dfs_file->Read(4096, &result, buf).ok() && result.size() > 0
+    while (dfs_file->Read(chunk_size, &result, buf).ok() && result.size() > 0
         && local_file->Append(result).ok()) {
         local_size += result.size();
     }
+    delete[] buf;
     delete dfs_file;
     delete local_file;
 
@@ -150,55 +158,614 @@ public:
 
 };
 
+// Space accounting of the flash paths. Every sst copy on flash is known
+// here with the path it lives in, and charged to the path from the moment
+// it is placed, while it is written. Copies held open by readers are never
+// evicted; when a path is over its byte budget, the least recently closed
+// idle copies are evicted to make room for new ones, and a new copy that
+// still does not fit is refused.
+class FlashTier {
+public:
+    struct Handle;
+
+    FlashTier() : capacity_(0) {}
+
+    ~FlashTier() {
+        for (FileMap::iterator it = files_.begin(); it != files_.end(); ++it) {
+            delete it->second;
+        }
+        for (size_t i = 0; i < idle_.size(); i++) {
+            delete idle_[i];
+        }
+    }
+
+    // 0 for no limit
+    void SetCapacity(uint64_t capacity) {
+        std::vector<std::string> victims;
+        {
+            MutexLock lock(&mutex_);
+            capacity_ = capacity;
+            for (size_t i = 0; i < used_.size(); i++) {
+                Reclaim(i, &victims);
+            }
+        }
+        DeleteLocal(victims);
+    }
+
+    // Forget the idle copies and account for the sst copies found in the
+    // flash paths instead, such as those left by an earlier process.
+    void Load() {
+        const std::vector<std::string>& paths = FlashEnv::GetFlashPaths();
+        std::vector<std::pair<std::string, uint64_t> > found;
+        std::vector<size_t> found_path;
+        for (size_t i = 0; i < paths.size(); i++) {
+            size_t num = found.size();
+            ListLocal(paths[i], "", &found);
+            found_path.resize(found.size(), i);
+            Log("[env_flash] found %lu sst files in %s\n",
+                found.size() - num, paths[i].c_str());
+        }
+
+        std::vector<std::string> victims;
+        {
+            MutexLock lock(&mutex_);
+            FileMap::iterator it = files_.begin();
+            while (it != files_.end()) {
+                Handle* file = it->second;
+                ++it;
+                if (file->refs == 0) {
+                    Unlink(file);
+                    Erase(file);
+                }
+            }
+            for (size_t i = 0; i < found.size(); i++) {
+                if (files_.find(found[i].first) != files_.end()) {
+                    continue;
+                }
+                Handle* file = Insert(found[i].first, found_path[i], found[i].second);
+                LinkIdle(file);
+            }
+            for (size_t i = 0; i < used_.size(); i++) {
+                Reclaim(i, &victims);
+            }
+        }
+        DeleteLocal(victims);
+    }
+
+    // Return a handle of the complete flash copy of "fname", which is not
+    // evicted until Close(), or NULL if there is none. A copy of another
+    // size is stale and deleted.
+    Handle* Open(const std::string& fname, uint64_t fsize) {
+        const std::vector<std::string>& paths = FlashEnv::GetFlashPaths();
+        std::vector<std::string> victims;
+        Handle* file = NULL;
+        {
+            MutexLock lock(&mutex_);
+            FileMap::iterator it = files_.find(fname);
+            if (it == files_.end()) {
+                // copies made behind our back by another process on flash
+                for (size_t i = 0; i < paths.size(); i++) {
+                    uint64_t local_size = 0;
+                    if (Env::Default()->GetFileSize(paths[i] + fname, &local_size).ok()
+                        && local_size == fsize) {
+                        Handle* file = Insert(fname, i, fsize);
+                        LinkIdle(file);
+                        Reclaim(i, &victims);
+                        it = files_.find(fname);
+                        break;
+                    }
+                }
+            }
+            file = (it != files_.end() ? it->second : NULL);
+            if (file != NULL && !file->pinned && file->size != fsize && file->refs == 0) {
+                victims.push_back(paths[file->path] + fname);
+                Unlink(file);
+                Erase(file);
+                file = NULL;
+            }
+            if (file == NULL || file->pinned || file->size != fsize) {
+                file = NULL;
+            } else if (file->refs++ == 0) {
+                Unlink(file);
+            }
+        }
+        DeleteLocal(victims);
+        return file;
+    }
+
+    void Close(Handle* file) {
+        MutexLock lock(&mutex_);
+        assert(file->refs > 0);
+        if (--file->refs > 0) {
+            return;
+        }
+        if (file->removed) {
+            // deleted from dfs and flash while open, the space is free now
+            used_[file->path] -= file->size;
+            delete file;
+            return;
+        }
+        LinkIdle(file);
+    }
+
+    // Reserve "size" bytes for a new flash copy of "fname", evicting idle
+    // copies if needed. The copy is pinned and held by the caller until it
+    // is either Commit()ed and Close()d or Drop()ped. NULL means no path
+    // has room for it.
+    Handle* Place(const std::string& fname, uint64_t size) {
+        const std::vector<std::string>& paths = FlashEnv::GetFlashPaths();
+        std::vector<std::string> victims;
+        Handle* file = NULL;
+        {
+            MutexLock lock(&mutex_);
+            if (files_.find(fname) != files_.end()) {
+                return NULL;
+            }
+            size_t path = 0;
+            if (capacity_ == 0) {
+                // keep the placement of unbounded paths
+                const std::string& flash_path = FlashEnv::FlashPath(fname);
+                while (path < paths.size() && paths[path] != flash_path) {
+                    path++;
+                }
+            } else {
+                if (size > capacity_) {
+                    return NULL;
+                }
+                // the path with most free space
+                for (size_t i = 1; i < paths.size(); i++) {
+                    if (Used(i) < Used(path)) {
+                        path = i;
+                    }
+                }
+            }
+            file = Insert(fname, path, size);
+            file->pinned = true;
+            file->refs = 1;
+            if (!Reclaim(path, &victims)) {
+                Erase(file);
+                file = NULL;
+            }
+        }
+        DeleteLocal(victims);
+        return file;
+    }
+
+    // Charge "bytes" more written to a pinned copy. Return false if the
+    // path has no room for them, the caller then Drop()s the copy.
+    bool Grow(Handle* file, uint64_t bytes) {
+        std::vector<std::string> victims;
+        bool fit = false;
+        {
+            MutexLock lock(&mutex_);
+            assert(file->pinned);
+            file->size += bytes;
+            used_[file->path] += bytes;
+            fit = Reclaim(file->path, &victims);
+        }
+        DeleteLocal(victims);
+        return fit;
+    }
+
+    // The pinned copy is complete, it can be opened and evicted.
+    void Commit(Handle* file) {
+        MutexLock lock(&mutex_);
+        file->pinned = false;
+    }
+
+    // Give up a pinned copy, the caller deletes the local file.
+    void Drop(Handle* file) {
+        MutexLock lock(&mutex_);
+        assert(file->pinned && file->refs == 1);
+        Erase(file);
+    }
+
+    std::string LocalName(Handle* file) {
+        MutexLock lock(&mutex_);
+        return FlashEnv::GetFlashPaths()[file->path] + file->fname;
+    }
+
+    // "fname" is deleted, the caller deletes the local file. A copy still
+    // held open is charged until it is closed.
+    void Remove(const std::string& fname) {
+        MutexLock lock(&mutex_);
+        FileMap::iterator it = files_.find(fname);
+        if (it != files_.end()) {
+            Forget(it->second);
+        }
+    }
+
+    void Rename(const std::string& src, const std::string& target) {
+        MutexLock lock(&mutex_);
+        FileMap::iterator it = files_.find(src);
+        if (it == files_.end()) {
+            return;
+        }
+        Handle* file = it->second;
+        files_.erase(it);
+        FileMap::iterator old = files_.find(target);
+        if (old != files_.end()) {
+            Forget(old->second);
+        }
+        file->fname = target;
+        files_[target] = file;
+    }
+
+    struct Handle {
+        std::string fname;
+        size_t path;
+        uint64_t size;
+        int refs;           // readers, or the writer while pinned
+        bool pinned;        // being written, can not be opened
+        bool removed;       // out of the file map, freed on last Close()
+        Handle* prev;       // idle list of the path, if refs == 0
+        Handle* next;
+    };
+
+private:
+    typedef std::map<std::string, Handle*> FileMap;
+
+    uint64_t Used(size_t path) const {
+        return path < used_.size() ? used_[path] : 0;
+    }
+
+    Handle* Insert(const std::string& fname, size_t path, uint64_t size) {
+        while (used_.size() <= path) {
+            Handle* head = new Handle;
+            head->prev = head->next = head;
+            idle_.push_back(head);
+            used_.push_back(0);
+        }
+        Handle* file = new Handle;
+        file->fname = fname;
+        file->path = path;
+        file->size = size;
+        file->refs = 0;
+        file->pinned = false;
+        file->removed = false;
+        file->prev = file->next = NULL;
+        files_[fname] = file;
+        used_[path] += size;
+        return file;
+    }
+
+    // REQUIRES: "file" is in the file map and not on an idle list
+    void Erase(Handle* file) {
+        used_[file->path] -= file->size;
+        files_.erase(file->fname);
+        delete file;
+    }
+
+    void Forget(Handle* file) {
+        if (file->refs > 0) {
+            files_.erase(file->fname);
+            file->removed = true;
+        } else {
+            Unlink(file);
+            Erase(file);
+        }
+    }
+
+    // most recently closed first
+    void LinkIdle(Handle* file) {
+        Handle* head = idle_[file->path];
+        file->next = head->next;
+        file->prev = head;
+        head->next->prev = file;
+        head->next = file;
+    }
+
+    void Unlink(Handle* file) {
+        if (file->next != NULL) {
+            file->next->prev = file->prev;
+            file->prev->next = file->next;
+            file->prev = file->next = NULL;
+        }
+    }
+
+    // Evict the least recently closed idle copies of "path" until it is
+    // within budget. Return false if the idle copies are not enough.
+    bool Reclaim(size_t path, std::vector<std::string>* victims) {
+        const std::vector<std::string>& paths = FlashEnv::GetFlashPaths();
+        Handle* head = idle_[path];
+        while (capacity_ > 0 && used_[path] > capacity_) {
+            Handle* victim = head->prev;
+            if (victim == head) {
+                return false;
+            }
+            victims->push_back(paths[path] + victim->fname);
+            flash_evict_size_counter.Add(victim->size);
+            Unlink(victim);
+            Erase(victim);
+        }
+        return true;
+    }
+
+    static void DeleteLocal(const std::vector<std::string>& victims) {
+        for (size_t i = 0; i < victims.size(); i++) {
+            Log("[env_flash] evict %s\n", victims[i].c_str());
+            Env::Default()->DeleteFile(victims[i]);
+        }
+    }
+
+    // Append the sst files under "dir" + "name" with their sizes.
+    static void ListLocal(const std::string& dir, const std::string& name,
+                          std::vector<std::pair<std::string, uint64_t> >* found) {
+        std::vector<std::string> children;
+        if (!Env::Default()->GetChildren(dir + name, &children).ok()) {
+            return;
+        }
+        for (size_t i = 0; i < children.size(); i++) {
+            std::string child = name + "/" + children[i];
+            uint64_t size = 0;
+            if (child.rfind(".sst") != child.size() - 4) {
+                ListLocal(dir, child, found);
+            } else if (Env::Default()->GetFileSize(dir + child, &size).ok()) {
+                found->push_back(std::make_pair(child, size));
+            }
+        }
+    }
+
+    port::Mutex mutex_;
+    uint64_t capacity_;             // per path
+    FileMap files_;                 // by dfs name
+    std::vector<uint64_t> used_;    // by path
+    std::vector<Handle*> idle_;     // list heads by path
+};
+
+static FlashTier flash_tier;
+
+// A copy of a dfs file onto flash made by a staging thread. Shared by the
+// copy task and every opened FlashRandomAccessFile of the file, so a file
+// opened twice is copied once.
+struct FlashStaging {
+    std::string fname;
+    std::string local_fname;
+    uint64_t fsize;
+    Env* dfs_env;
+    bool vanish_allowed;
+    size_t chunk_size;
+    FlashTier::Handle* handle;      // pinned until the copy is over
+    bool ok;                        // set before finished
+    port::AtomicPointer finished;   // non-NULL once the copy is over
+    int refs;                       // guarded by staging_mutex
+};
+
+static port::Mutex staging_mutex;
+// files being copied, by dfs name
+static std::map<std::string, FlashStaging*> staging_files;
+static ThreadPool* staging_pool = NULL;
+
+static void UnrefStaging(FlashStaging* staging) {
+    MutexLock lock(&staging_mutex);
+    if (--staging->refs == 0) {
+        delete staging;
+    }
+}
+
+static void StageToLocal(void* arg) {
+    FlashStaging* staging = reinterpret_cast<FlashStaging*>(arg);
+    Status s = CopyToLocal(staging->local_fname, staging->dfs_env, staging->fname,
+                           staging->fsize, staging->vanish_allowed,
+                           staging->chunk_size);
+    if (s.ok()) {
+        flash_tier.Commit(staging->handle);
+        flash_tier.Close(staging->handle);
+    } else {
+        Log("[env_flash] copy to local fail [%s]: %s\n",
+            s.ToString().c_str(), staging->local_fname.c_str());
+        flash_tier.Drop(staging->handle);
+    }
+    staging->handle = NULL;
+    {
+        MutexLock lock(&staging_mutex);
+        staging_files.erase(staging->fname);
+        staging->ok = s.ok();
+        staging->finished.Release_Store(staging);
+    }
+    UnrefStaging(staging);
+}
+
+// Return the staging copy of "fname", started if there is none yet, or
+// NULL if there is no room for it on flash.
+static FlashStaging* StartStaging(Env* dfs_env, const std::string& fname,
+                                  uint64_t fsize, bool vanish_allowed,
+                                  int threads, size_t chunk_size) {
+    MutexLock lock(&staging_mutex);
+    std::map<std::string, FlashStaging*>::iterator it = staging_files.find(fname);
+    if (it != staging_files.end()) {
+        it->second->refs++;
+        return it->second;
+    }
+
+    FlashStaging* staging = new FlashStaging;
+    staging->fname = fname;
+    staging->fsize = fsize;
+    staging->dfs_env = dfs_env;
+    staging->vanish_allowed = vanish_allowed;
+    staging->chunk_size = chunk_size;
+    staging->ok = false;
+    staging->finished.Release_Store(NULL);
+    FlashTier::Handle* handle = flash_tier.Open(fname, fsize);
+    if (handle != NULL) {
+        // copied since the file was opened
+        flash_tier.Close(handle);
+        staging->handle = NULL;
+        staging->ok = true;
+        staging->finished.Release_Store(staging);
+        staging->refs = 1;
+        return staging;
+    }
+    staging->handle = flash_tier.Place(fname, fsize);
+    if (staging->handle == NULL) {
+        delete staging;
+        return NULL;
+    }
+    staging->local_fname = flash_tier.LocalName(staging->handle);
+    staging->refs = 2;  // the opened file and the copy task
+    staging_files[fname] = staging;
+    if (staging_pool == NULL) {
+        staging_pool = new ThreadPool;
+    }
+    staging_pool->SetBackgroundThreads(threads);
+    staging_pool->Schedule(&StageToLocal, staging, 0, 0);
+    return staging;
+}
+
 // A file abstraction for randomly reading the contents of a file.
+//
+// A file that is not on flash yet is read from dfs, and copied onto flash
+// in the background once it has been read "admit_reads" times; reads move
+// to the flash copy when the copy is over. The flash copy is held open in
+// the flash tier, it is not evicted while this file is alive.
 class FlashRandomAccessFile :public RandomAccessFile{
 private:
+    Env* posix_env_;
+    Env* dfs_env_;
+    std::string fname_;
+    uint64_t fsize_;
+    bool vanish_allowed_;
+    int copy_threads_;
+    size_t copy_chunk_size_;
+    int admit_reads_;
+
     RandomAccessFile* dfs_file_;
-    RandomAccessFile* flash_file_;
+    mutable port::AtomicPointer flash_file_;
+    mutable FlashTier::Handle* flash_handle_;
+    mutable port::AtomicPointer staging_;
+    // non-NULL once the staging copy has been opened or given up
+    mutable port::AtomicPointer staged_;
+    mutable port::Mutex mutex_;
+    mutable tera::Counter reads_;
+
 public:
     FlashRandomAccessFile(Env* posix_env, Env* dfs_env, const std::string& fname,
-                          uint64_t fsize, bool vanish_allowed)
-        :dfs_file_(NULL), flash_file_(NULL) {
-        std::string local_fname = FlashEnv::FlashPath(fname) + fname;
-
-        // copy from dfs with seq read
-        Status copy_status = CopyToLocal(local_fname, dfs_env, fname, fsize,
-                                         vanish_allowed);
-        if (!copy_status.ok()) {
-            Log("[env_flash] copy to local fail [%s]: %s\n",
-                copy_status.ToString().c_str(), local_fname.c_str());
-            // no flash file, use dfs file
-            dfs_env->NewRandomAccessFile(fname, &dfs_file_);
+                          uint64_t fsize, bool vanish_allowed,
+                          int copy_threads, size_t copy_chunk_size, int admit_reads)
+        : posix_env_(posix_env), dfs_env_(dfs_env), fname_(fname), fsize_(fsize),
+          vanish_allowed_(vanish_allowed), copy_threads_(copy_threads),
+          copy_chunk_size_(copy_chunk_size), admit_reads_(admit_reads),
+          dfs_file_(NULL), flash_file_(NULL), flash_handle_(NULL),
+          staging_(NULL), staged_(NULL) {
+        if (OpenFlash()) {
             return;
         }
-
-        Status s = posix_env->NewRandomAccessFile(local_fname, &flash_file_);
-        if (s.ok()) {
+        if (copy_threads <= 0 && CopyOnOpen()) {
             return;
         }
-        Log("[env_flash] local file exists, but open for RandomAccess fail: %s\n",
-            local_fname.c_str());
-        Env::Default()->DeleteFile(local_fname);
+        // read from dfs until the copy is over
         dfs_env->NewRandomAccessFile(fname, &dfs_file_);
+        if (copy_threads > 0 && admit_reads <= 0) {
+            Admit();
+        }
     }
     ~FlashRandomAccessFile() {
         delete dfs_file_;
-        delete flash_file_;
+        delete reinterpret_cast<RandomAccessFile*>(flash_file_.NoBarrier_Load());
+        if (flash_handle_ != NULL) {
+            flash_tier.Close(flash_handle_);
+        }
+        FlashStaging* staging = reinterpret_cast<FlashStaging*>(staging_.NoBarrier_Load());
+        if (staging != NULL) {
+            UnrefStaging(staging);
+        }
     }
     Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const {
-        if (flash_file_) {
-            Status read_status = flash_file_->Read(offset, n, result, scratch);
+        RandomAccessFile* flash_file = FlashFile();
+        if (flash_file) {
+            Status read_status = flash_file->Read(offset, n, result, scratch);
             if (read_status.ok()) {
                 ssd_read_counter.Inc();
                 ssd_read_size_counter.Add(result->size());
+                flash_hit_size_counter.Add(result->size());
             }
             return read_status;
         }
-        return dfs_file_->Read(offset, n, result, scratch);
+        Status read_status = dfs_file_->Read(offset, n, result, scratch);
+        if (read_status.ok()) {
+            flash_miss_size_counter.Add(result->size());
+            if (copy_threads_ > 0 && reads_.Inc() == admit_reads_) {
+                Admit();
+            }
+        }
+        return read_status;
     }
     bool isValid() {
-        return (dfs_file_ || flash_file_);
+        return (dfs_file_ || flash_file_.NoBarrier_Load());
+    }
+
+private:
+    // Open the complete flash copy of the file if there is one
+    bool OpenFlash() const {
+        FlashTier::Handle* handle = flash_tier.Open(fname_, fsize_);
+        if (handle == NULL) {
+            return false;
+        }
+        std::string local_fname = flash_tier.LocalName(handle);
+        RandomAccessFile* flash_file = NULL;
+        Status s = posix_env_->NewRandomAccessFile(local_fname, &flash_file);
+        if (s.ok()) {
+            flash_handle_ = handle;
+            flash_file_.Release_Store(flash_file);
+            return true;
+        }
+        Log("[env_flash] local file exists, but open for RandomAccess fail: %s\n",
+            local_fname.c_str());
+        flash_tier.Remove(fname_);
+        flash_tier.Close(handle);
+        Env::Default()->DeleteFile(local_fname);
+        return false;
+    }
+
+    // copy from dfs with seq read
+    bool CopyOnOpen() {
+        FlashTier::Handle* handle = flash_tier.Place(fname_, fsize_);
+        if (handle == NULL) {
+            return false;
+        }
+        std::string local_fname = flash_tier.LocalName(handle);
+        Status copy_status = CopyToLocal(local_fname, dfs_env_, fname_, fsize_,
+                                         vanish_allowed_, copy_chunk_size_);
+        if (!copy_status.ok()) {
+            Log("[env_flash] copy to local fail [%s]: %s\n",
+                copy_status.ToString().c_str(), local_fname.c_str());
+            flash_tier.Drop(handle);
+            return false;
+        }
+        flash_tier.Commit(handle);
+        bool opened = OpenFlash();
+        flash_tier.Close(handle);
+        return opened;
+    }
+
+    // the file is hot enough, start copying it onto flash
+    void Admit() const {
+        FlashStaging* staging = StartStaging(dfs_env_, fname_, fsize_, vanish_allowed_,
+                                             copy_threads_, copy_chunk_size_);
+        if (staging != NULL) {
+            staging_.Release_Store(staging);
+        }
+    }
+
+    RandomAccessFile* FlashFile() const {
+        RandomAccessFile* flash_file =
+            reinterpret_cast<RandomAccessFile*>(flash_file_.Acquire_Load());
+        FlashStaging* staging = reinterpret_cast<FlashStaging*>(staging_.Acquire_Load());
+        if (flash_file != NULL || staging == NULL || staged_.Acquire_Load() != NULL
+            || staging->finished.Acquire_Load() == NULL) {
+            return flash_file;
+        }
+
+        MutexLock lock(&mutex_);
+        if (staged_.NoBarrier_Load() == NULL) {
+            // the copy may have been evicted already, stay on dfs then
+            if (staging->ok && !OpenFlash()) {
+                Log("[env_flash] staged file open fail: %s\n", fname_.c_str());
+            }
+            staged_.Release_Store(staging);
+        }
+        return reinterpret_cast<RandomAccessFile*>(flash_file_.NoBarrier_Load());
     }
 };
 
@@ -207,10 +774,12 @@ class FlashWritableFile: public WritableFile {
 private:
     WritableFile* dfs_file_;
     WritableFile* flash_file_;
+    std::string fname_;
     std::string local_fname_;
+    FlashTier::Handle* flash_handle_;
 public:
     FlashWritableFile(Env* posix_env, Env* dfs_env, const std::string& fname)
-        :dfs_file_(NULL), flash_file_(NULL) {
+        :dfs_file_(NULL), flash_file_(NULL), fname_(fname), flash_handle_(NULL) {
         Status s = dfs_env->NewWritableFile(fname, &dfs_file_);
         if (!s.ok()) {
             return;
@@ -219,7 +788,12 @@ public:
             // Log(logger, "[env_flash] Don't cache %s\n", fname.c_str());
             return;
         }
-        local_fname_ = FlashEnv::FlashPath(fname) + fname;
+        // appends are charged as they are written
+        flash_handle_ = flash_tier.Place(fname, 0);
+        if (flash_handle_ == NULL) {
+            return;
+        }
+        local_fname_ = flash_tier.LocalName(flash_handle_);
         for(size_t i = 1; i < local_fname_.size(); i++) {
             if (local_fname_.at(i) == '/') {
                 posix_env->CreateDir(local_fname_.substr(0,i));
@@ -229,15 +803,22 @@ public:
         if (!s.ok()) {
             Log("[env_flash] Open local flash file for write fail: %s\n",
                 local_fname_.c_str());
+            flash_tier.Drop(flash_handle_);
+            flash_handle_ = NULL;
         }
     }
     virtual ~FlashWritableFile() {
         delete dfs_file_;
-        delete flash_file_;
+        if (flash_file_) {
+            // never closed
+            DeleteLocal();
+        }
     }
     void DeleteLocal() {
         delete flash_file_;
         flash_file_ = NULL;
+        flash_tier.Drop(flash_handle_);
+        flash_handle_ = NULL;
         Env::Default()->DeleteFile(local_fname_);
     }
     virtual Status Append(const Slice& data) {
@@ -246,6 +827,11 @@ public:
             return s;
         }
         if (flash_file_) {
+            if (!flash_tier.Grow(flash_handle_, data.size())) {
+                Log("[env_flash] no flash space left for %s\n", local_fname_.c_str());
+                DeleteLocal();
+                return s;
+            }
             Status local_s = flash_file_->Append(data);
             if (!local_s.ok()) {
                 DeleteLocal();
@@ -297,6 +883,12 @@ public:
             Status local_s = flash_file_->Close();
             if (!local_s.ok()) {
                 DeleteLocal();
+            } else {
+                delete flash_file_;
+                flash_file_ = NULL;
+                flash_tier.Commit(flash_handle_);
+                flash_tier.Close(flash_handle_);
+                flash_handle_ = NULL;
             }
         }
         return dfs_file_->Close();
@@ -304,6 +896,9 @@ public:
 };
 
 std::vector<std::string> FlashEnv::flash_paths_(1, "./flash");
+int FlashEnv::copy_threads_ = 0;
+size_t FlashEnv::copy_chunk_size_ = 4096;
+int FlashEnv::admit_reads_ = 0;
 
 FlashEnv::FlashEnv(Env* base_env) : EnvWrapper(Env::Default())
 {
@@ -333,8 +928,9 @@ Status FlashEnv::NewRandomAccessFile(const std::string& fname,
         uint64_t fsize, RandomAccessFile** result)
 {
     FlashRandomAccessFile* f =
-        new FlashRandomAccessFile(posix_env_, dfs_env_, fname,
-                                  fsize, vanish_allowed_);
+        new FlashRandomAccessFile(posix_env_, dfs_env_, fname, fsize,
+                                  vanish_allowed_, copy_threads_, copy_chunk_size_,
+                                  admit_reads_);
     if (f == NULL || !f->isValid()) {
         *result = NULL;
         delete f;
@@ -378,27 +974,35 @@ Status FlashEnv::GetChildren(const std::string& path,
     return dfs_env_->GetChildren(path, result);
 }
 
+// a file may live in any flash path
 Status FlashEnv::DeleteFile(const std::string& fname)
 {
-    posix_env_->DeleteFile(FlashEnv::FlashPath(fname) + fname);
+    flash_tier.Remove(fname);
+    for (size_t i = 0; i < flash_paths_.size(); ++i) {
+        posix_env_->DeleteFile(flash_paths_[i] + fname);
+    }
     return dfs_env_->DeleteFile(fname);
 }
 
 Status FlashEnv::CreateDir(const std::string& name)
 {
-    std::string local_name = FlashEnv::FlashPath(name) + name;
-    for(size_t i=1 ;i<local_name.size(); i++) {
-        if (local_name.at(i) == '/') {
-            posix_env_->CreateDir(local_name.substr(0,i));
+    for (size_t p = 0; p < flash_paths_.size(); ++p) {
+        std::string local_name = flash_paths_[p] + name;
+        for(size_t i=1 ;i<local_name.size(); i++) {
+            if (local_name.at(i) == '/') {
+                posix_env_->CreateDir(local_name.substr(0,i));
+            }
         }
+        posix_env_->CreateDir(local_name);
     }
-    posix_env_->CreateDir(local_name);
     return dfs_env_->CreateDir(name);
 };
 
 Status FlashEnv::DeleteDir(const std::string& name)
 {
-    posix_env_->DeleteDir(FlashEnv::FlashPath(name) + name);
+    for (size_t i = 0; i < flash_paths_.size(); ++i) {
+        posix_env_->DeleteDir(flash_paths_[i] + name);
+    }
     return dfs_env_->DeleteDir(name);
 };
 
@@ -410,7 +1014,10 @@ Status FlashEnv::GetFileSize(const std::string& fname, uint64_t* size)
 ///
 Status FlashEnv::RenameFile(const std::string& src, const std::string& target)
 {
-    posix_env_->RenameFile(FlashEnv::FlashPath(src) + src, FlashEnv::FlashPath(target) + target);
+    flash_tier.Rename(src, target);
+    for (size_t i = 0; i < flash_paths_.size(); ++i) {
+        posix_env_->RenameFile(flash_paths_[i] + src, flash_paths_[i] + target);
+    }
     return dfs_env_->RenameFile(src, target);
 }
 
@@ -450,6 +1057,22 @@ void FlashEnv::SetFlashPath(const std::string& path, bool vanish_allowed) {
     }
 }
 
+void FlashEnv::LoadFlashFiles() {
+    flash_tier.Load();
+}
+
+void FlashEnv::SetCapacity(uint64_t capacity, int admit_reads) {
+    flash_tier.SetCapacity(capacity);
+    admit_reads_ = admit_reads;
+}
+
+void FlashEnv::SetCopyOptions(int threads, size_t chunk_size) {
+    copy_threads_ = threads;
+    if (chunk_size > 0) {
+        copy_chunk_size_ = chunk_size;
+    }
+}
+
 const std::string& FlashEnv::FlashPath(const std::string& fname) {
     if (flash_paths_.size() == 1) {
         return flash_paths_[0];
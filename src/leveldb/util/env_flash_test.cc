@@ -0,0 +1,291 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "leveldb/env_flash.h"
+
+#include "leveldb/env.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+class FlashEnvTest {
+public:
+    Env* posix_env_;
+    Env* env_;
+    std::string dfs_dir_;
+    std::string flash_dir_;
+
+    FlashEnvTest() : posix_env_(Env::Default()) {
+        std::string dir = test::TmpDir() + "/env_flash_test";
+        dfs_dir_ = dir + "/dfs";
+        flash_dir_ = dir + "/flash";
+        DestroyDir(flash_dir_ + dfs_dir_);
+        DestroyDir(dfs_dir_);
+        posix_env_->CreateDir(dir);
+        posix_env_->CreateDir(dfs_dir_);
+        FlashEnv::SetFlashPath(flash_dir_, true);
+        FlashEnv::SetCopyOptions(0, 4096);
+        FlashEnv::SetCapacity(0, 0);
+        env_ = NewFlashEnv(posix_env_);
+    }
+    ~FlashEnvTest() {
+        delete env_;
+    }
+
+    void DestroyDir(const std::string& dir) {
+        std::vector<std::string> children;
+        posix_env_->GetChildren(dir, &children);
+        for (size_t i = 0; i < children.size(); i++) {
+            posix_env_->DeleteFile(dir + "/" + children[i]);
+        }
+        posix_env_->DeleteDir(dir);
+    }
+
+    std::string WriteDfsFile(const std::string& name, size_t size) {
+        Random rnd(301);
+        std::string data;
+        test::RandomString(&rnd, size, &data);
+        WritableFile* file = NULL;
+        ASSERT_OK(posix_env_->NewWritableFile(dfs_dir_ + "/" + name, &file));
+        ASSERT_OK(file->Append(data));
+        ASSERT_OK(file->Close());
+        delete file;
+        return data;
+    }
+
+    void WriteFlashFile(const std::string& fname, size_t size) {
+        Random rnd(301);
+        std::string data;
+        test::RandomString(&rnd, size, &data);
+        WritableFile* file = NULL;
+        ASSERT_OK(env_->NewWritableFile(fname, &file));
+        ASSERT_OK(file->Append(data));
+        ASSERT_OK(file->Close());
+        delete file;
+    }
+
+    void WriteLocalFile(const std::string& fname, size_t size) {
+        Random rnd(301);
+        std::string data;
+        test::RandomString(&rnd, size, &data);
+        std::string local_fname = flash_dir_ + fname;
+        for (size_t i = 1; i < local_fname.size(); i++) {
+            if (local_fname[i] == '/') {
+                posix_env_->CreateDir(local_fname.substr(0, i));
+            }
+        }
+        ASSERT_OK(WriteStringToFile(posix_env_, data, local_fname));
+    }
+
+    void WaitLocal(const std::string& fname, uint64_t size) {
+        for (int i = 0; i < 500 && LocalSize(fname) != size; i++) {
+            posix_env_->SleepForMicroseconds(10000);
+        }
+    }
+
+    uint64_t LocalSize(const std::string& fname) {
+        uint64_t size = 0;
+        if (!posix_env_->GetFileSize(flash_dir_ + fname, &size).ok()) {
+            return 0;
+        }
+        return size;
+    }
+
+    std::string ReadAll(RandomAccessFile* file, size_t size) {
+        std::string scratch(size, '\0');
+        Slice result;
+        ASSERT_OK(file->Read(0, size, &result, &scratch[0]));
+        return result.ToString();
+    }
+};
+
+TEST(FlashEnvTest, StageInBackground) {
+    FlashEnv::SetCopyOptions(2, 1000);
+    const size_t kSize = 100000;
+    std::string data = WriteDfsFile("000001.sst", kSize);
+    std::string fname = dfs_dir_ + "/000001.sst";
+
+    RandomAccessFile* file = NULL;
+    ASSERT_OK(env_->NewRandomAccessFile(fname, kSize, &file));
+    // served from dfs while the copy runs
+    ASSERT_EQ(ReadAll(file, kSize), data);
+
+    WaitLocal(fname, kSize);
+    ASSERT_EQ(LocalSize(fname), kSize);
+    ASSERT_EQ(ReadAll(file, kSize), data);
+    delete file;
+
+    // complete on flash, opened without copying
+    ASSERT_OK(env_->NewRandomAccessFile(fname, kSize, &file));
+    ASSERT_EQ(ReadAll(file, kSize), data);
+    delete file;
+}
+
+TEST(FlashEnvTest, CopyOnOpen) {
+    const size_t kSize = 10000;
+    std::string data = WriteDfsFile("000002.sst", kSize);
+    std::string fname = dfs_dir_ + "/000002.sst";
+
+    RandomAccessFile* file = NULL;
+    ASSERT_OK(env_->NewRandomAccessFile(fname, kSize, &file));
+    ASSERT_EQ(LocalSize(fname), kSize);
+    ASSERT_EQ(ReadAll(file, kSize), data);
+    delete file;
+}
+
+TEST(FlashEnvTest, WriteThrough) {
+    const size_t kSize = 10000;
+    Random rnd(301);
+    std::string data;
+    test::RandomString(&rnd, kSize, &data);
+    std::string fname = dfs_dir_ + "/000003.sst";
+
+    WritableFile* file = NULL;
+    ASSERT_OK(env_->NewWritableFile(fname, &file));
+    ASSERT_OK(file->Append(data));
+    ASSERT_OK(file->Close());
+    delete file;
+
+    // new ssts are on flash as soon as they are written
+    uint64_t dfs_size = 0;
+    ASSERT_OK(posix_env_->GetFileSize(fname, &dfs_size));
+    ASSERT_EQ(dfs_size, kSize);
+    ASSERT_EQ(LocalSize(fname), kSize);
+}
+
+TEST(FlashEnvTest, AdmitByReads) {
+    FlashEnv::SetCopyOptions(2, 4096);
+    FlashEnv::SetCapacity(0, 2);
+    const size_t kSize = 10000;
+    std::string data = WriteDfsFile("000004.sst", kSize);
+    std::string fname = dfs_dir_ + "/000004.sst";
+
+    RandomAccessFile* file = NULL;
+    ASSERT_OK(env_->NewRandomAccessFile(fname, kSize, &file));
+    ASSERT_EQ(ReadAll(file, kSize), data);
+    posix_env_->SleepForMicroseconds(100000);
+    // read once, still cold
+    ASSERT_EQ(LocalSize(fname), 0U);
+
+    ASSERT_EQ(ReadAll(file, kSize), data);
+    WaitLocal(fname, kSize);
+    ASSERT_EQ(LocalSize(fname), kSize);
+    ASSERT_EQ(ReadAll(file, kSize), data);
+    delete file;
+}
+
+TEST(FlashEnvTest, EvictLeastRecentlyRead) {
+    const size_t kSize = 10000;
+    FlashEnv::SetCapacity(kSize * 5 / 2, 0);
+    std::string a = dfs_dir_ + "/000005.sst";
+    std::string b = dfs_dir_ + "/000006.sst";
+    std::string c = dfs_dir_ + "/000007.sst";
+    std::string d = dfs_dir_ + "/000008.sst";
+
+    WriteFlashFile(a, kSize);
+    WriteFlashFile(b, kSize);
+    WriteFlashFile(c, kSize);
+    ASSERT_EQ(LocalSize(a), 0U);
+    ASSERT_EQ(LocalSize(b), kSize);
+    ASSERT_EQ(LocalSize(c), kSize);
+
+    // opening b makes c the coldest
+    RandomAccessFile* file = NULL;
+    ASSERT_OK(env_->NewRandomAccessFile(b, kSize, &file));
+    delete file;
+    WriteFlashFile(d, kSize);
+    ASSERT_EQ(LocalSize(b), kSize);
+    ASSERT_EQ(LocalSize(c), 0U);
+    ASSERT_EQ(LocalSize(d), kSize);
+
+    // larger than a path, stays on dfs
+    std::string e = dfs_dir_ + "/000009.sst";
+    WriteFlashFile(e, kSize * 3);
+    ASSERT_EQ(LocalSize(e), 0U);
+    uint64_t dfs_size = 0;
+    ASSERT_OK(posix_env_->GetFileSize(e, &dfs_size));
+    ASSERT_EQ(dfs_size, kSize * 3);
+}
+
+TEST(FlashEnvTest, OpenCopiesNotEvicted) {
+    const size_t kSize = 10000;
+    FlashEnv::SetCapacity(kSize * 5 / 2, 0);
+    std::string a = dfs_dir_ + "/000010.sst";
+    std::string b = dfs_dir_ + "/000011.sst";
+    std::string c = dfs_dir_ + "/000012.sst";
+
+    WriteFlashFile(a, kSize);
+    WriteFlashFile(b, kSize);
+    RandomAccessFile* file_a = NULL;
+    RandomAccessFile* file_b = NULL;
+    ASSERT_OK(env_->NewRandomAccessFile(a, kSize, &file_a));
+    ASSERT_OK(env_->NewRandomAccessFile(b, kSize, &file_b));
+
+    // both copies are held open, there is no room for c
+    WriteFlashFile(c, kSize);
+    ASSERT_EQ(LocalSize(a), kSize);
+    ASSERT_EQ(LocalSize(b), kSize);
+    ASSERT_EQ(LocalSize(c), 0U);
+
+    // a is closed, its copy can make room for c
+    delete file_a;
+    posix_env_->DeleteFile(c);
+    WriteFlashFile(c, kSize);
+    ASSERT_EQ(LocalSize(a), 0U);
+    ASSERT_EQ(LocalSize(b), kSize);
+    ASSERT_EQ(LocalSize(c), kSize);
+    delete file_b;
+}
+
+TEST(FlashEnvTest, ChargeWrites) {
+    const size_t kSize = 10000;
+    FlashEnv::SetCapacity(kSize * 5 / 2, 0);
+    std::string a = dfs_dir_ + "/000013.sst";
+    std::string b = dfs_dir_ + "/000014.sst";
+    WriteFlashFile(a, kSize * 2);
+
+    Random rnd(301);
+    std::string data;
+    test::RandomString(&rnd, kSize, &data);
+    WritableFile* file = NULL;
+    ASSERT_OK(env_->NewWritableFile(b, &file));
+    ASSERT_OK(file->Append(data));
+    // a is evicted as soon as b outgrows the free space
+    ASSERT_EQ(LocalSize(a), 0U);
+    ASSERT_OK(file->Append(data));
+    ASSERT_OK(file->Append(data));
+    // b alone is over the capacity, the flash copy is given up
+    ASSERT_OK(file->Close());
+    delete file;
+    ASSERT_EQ(LocalSize(b), 0U);
+    uint64_t dfs_size = 0;
+    ASSERT_OK(posix_env_->GetFileSize(b, &dfs_size));
+    ASSERT_EQ(dfs_size, kSize * 3);
+}
+
+TEST(FlashEnvTest, LoadLeftCopies) {
+    const size_t kSize = 10000;
+    std::string a = dfs_dir_ + "/000015.sst";
+    std::string b = dfs_dir_ + "/000016.sst";
+    std::string c = dfs_dir_ + "/000017.sst";
+    // copies left by an earlier process
+    WriteLocalFile(a, kSize);
+    WriteLocalFile(b, kSize);
+
+    // they are known before they are opened again
+    FlashEnv::SetCapacity(kSize * 5 / 2, 0);
+    FlashEnv::LoadFlashFiles();
+    ASSERT_EQ(LocalSize(a), kSize);
+    ASSERT_EQ(LocalSize(b), kSize);
+    WriteFlashFile(c, kSize);
+    ASSERT_EQ(LocalSize(a) + LocalSize(b), kSize);
+    ASSERT_EQ(LocalSize(c), kSize);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+    return leveldb::test::RunAllTests();
+}
@@ -40,21 +40,21 @@
 
 namespace leveldb {
 
-tera::Counter posix_read_size_counter;
-tera::Counter posix_write_size_counter;
-
-tera::Counter posix_read_counter;
-tera::Counter posix_write_counter;
-tera::Counter posix_sync_counter;
-tera::Counter posix_list_counter;
-tera::Counter posix_exists_counter;
-tera::Counter posix_open_counter;
-tera::Counter posix_close_counter;
-tera::Counter posix_delete_counter;
-tera::Counter posix_tell_counter;
-tera::Counter posix_seek_counter;
-tera::Counter posix_info_counter;
-tera::Counter posix_other_counter;
+tera::ShardedCounter posix_read_size_counter;
+tera::ShardedCounter posix_write_size_counter;
+
+tera::ShardedCounter posix_read_counter;
+tera::ShardedCounter posix_write_counter;
+tera::ShardedCounter posix_sync_counter;
+tera::ShardedCounter posix_list_counter;
+tera::ShardedCounter posix_exists_counter;
+tera::ShardedCounter posix_open_counter;
+tera::ShardedCounter posix_close_counter;
+tera::ShardedCounter posix_delete_counter;
+tera::ShardedCounter posix_tell_counter;
+tera::ShardedCounter posix_seek_counter;
+tera::ShardedCounter posix_info_counter;
+tera::ShardedCounter posix_other_counter;
 
 namespace {
 
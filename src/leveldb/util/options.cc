@@ -27,6 +27,9 @@ Options::Options()
       block_size(kDefaultBlockSize),
       block_restart_interval(16),
       compression(kSnappyCompression),
+      bottom_compression(kSnappyCompression),
+      bottom_compression_level(-1),
+      compression_dict_size(0),
       filter_policy(NULL),
       exist_lg_list(NULL),
       lg_info_list(NULL),
@@ -34,6 +37,7 @@ Options::Options()
       compact_strategy_factory(NULL),
       log_file_size(2 << 20),
       log_async_mode(true),
+      commit_log(NULL),
       max_block_log_number(50),
       write_log_time_out(5),
       flush_triggered_log_num(100000),
@@ -49,6 +53,10 @@ Options::Options()
       sst_size(kDefaultSstSize),
       verify_checksums_in_compaction(false),
       ignore_corruption_in_compaction(false),
+      rate_limiter(NULL),
+      max_subcompactions(1),
+      compaction_readahead_size(0),
+      arena_pool(NULL),
       disable_wal(false) {
 }
 
@@ -0,0 +1,154 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "leveldb/rate_limiter.h"
+
+#include <algorithm>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "../utils/latency_histogram.h"
+
+namespace leveldb {
+
+// time that throttled requests waited for tokens
+tera::LatencyHistogram rate_limit_wait_latency;
+
+RateLimiter::~RateLimiter() {
+}
+
+namespace {
+
+class TokenBucketRateLimiter : public RateLimiter {
+ public:
+  TokenBucketRateLimiter(int64_t bytes_per_second, int64_t refill_period_us)
+      : cv_(&mu_),
+        env_(Env::Default()),
+        bytes_per_second_(bytes_per_second),
+        refill_period_us_(refill_period_us),
+        available_bytes_(0),
+        next_refill_us_(0) {
+    for (int i = 0; i < kNumPriorities; i++) {
+      waiters_[i] = 0;
+    }
+  }
+
+  virtual void Request(int64_t bytes, Priority priority) {
+    const uint64_t start_us = env_->NowMicros();
+    bool throttled = false;
+    MutexLock l(&mu_);
+    while (bytes > 0) {
+      if (bytes_per_second_ <= 0) {
+        // unlimited, maybe since we started waiting
+        break;
+      }
+      uint64_t now_us = env_->NowMicros();
+      Refill(now_us);
+      if (available_bytes_ > 0 && !HigherPriorityWaiting(priority)) {
+        // large requests are granted piece by piece
+        int64_t granted = std::min(bytes, available_bytes_);
+        available_bytes_ -= granted;
+        bytes -= granted;
+        continue;
+      }
+      throttled = true;
+      int64_t wait_ms = (next_refill_us_ - now_us + 999) / 1000;
+      waiters_[priority]++;
+      cv_.Wait(static_cast<int32_t>(std::max<int64_t>(wait_ms, 1)));
+      waiters_[priority]--;
+    }
+    if (throttled) {
+      // tokens may be left for the requests that waited behind us
+      cv_.SignalAll();
+      rate_limit_wait_latency.Add(env_->NowMicros() - start_us);
+    }
+  }
+
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) {
+    MutexLock l(&mu_);
+    bytes_per_second_ = bytes_per_second;
+    // waiters pick up the new rate now rather than after their wait
+    cv_.SignalAll();
+  }
+
+  virtual int64_t GetBytesPerSecond() {
+    MutexLock l(&mu_);
+    return bytes_per_second_;
+  }
+
+ private:
+  // REQUIRES: mu_ held
+  void Refill(uint64_t now_us) {
+    if (now_us < next_refill_us_) {
+      return;
+    }
+    available_bytes_ = std::max<int64_t>(
+        bytes_per_second_ * refill_period_us_ / 1000000, 1);
+    next_refill_us_ = now_us + refill_period_us_;
+  }
+
+  // REQUIRES: mu_ held
+  bool HigherPriorityWaiting(Priority priority) const {
+    for (int i = priority + 1; i < kNumPriorities; i++) {
+      if (waiters_[i] > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  port::Mutex mu_;
+  port::CondVar cv_;
+  Env* const env_;
+  int64_t bytes_per_second_;
+  const int64_t refill_period_us_;
+  int64_t available_bytes_;
+  uint64_t next_refill_us_;
+  int waiters_[kNumPriorities];
+};
+
+class RateLimitedFile : public WritableFile {
+ public:
+  RateLimitedFile(WritableFile* file, RateLimiter* limiter,
+                  RateLimiter::Priority priority)
+      : file_(file), limiter_(limiter), priority_(priority) {
+  }
+  virtual ~RateLimitedFile() {
+    delete file_;
+  }
+
+  virtual Status Append(const Slice& data) {
+    limiter_->Request(data.size(), priority_);
+    return file_->Append(data);
+  }
+  virtual Status Close() {
+    return file_->Close();
+  }
+  virtual Status Flush() {
+    return file_->Flush();
+  }
+  virtual Status Sync() {
+    return file_->Sync();
+  }
+
+ private:
+  WritableFile* file_;
+  RateLimiter* limiter_;
+  RateLimiter::Priority priority_;
+};
+
+}  // namespace
+
+RateLimiter* NewRateLimiter(int64_t bytes_per_second,
+                            int64_t refill_period_us) {
+  return new TokenBucketRateLimiter(bytes_per_second, refill_period_us);
+}
+
+WritableFile* NewRateLimitedFile(WritableFile* file, RateLimiter* limiter,
+                                 RateLimiter::Priority priority) {
+  return new RateLimitedFile(file, limiter, priority);
+}
+
+}  // namespace leveldb
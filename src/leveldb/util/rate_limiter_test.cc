@@ -0,0 +1,116 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "leveldb/rate_limiter.h"
+
+#include <string>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class RateLimiterTest { };
+
+class StringFile : public WritableFile {
+ public:
+  explicit StringFile(std::string* contents) : contents_(contents) { }
+  virtual Status Append(const Slice& data) {
+    contents_->append(data.data(), data.size());
+    return Status::OK();
+  }
+  virtual Status Close() { return Status::OK(); }
+  virtual Status Flush() { return Status::OK(); }
+  virtual Status Sync() { return Status::OK(); }
+
+ private:
+  std::string* contents_;
+};
+
+TEST(RateLimiterTest, Pace) {
+  // 1MB/s in portions of 10KB
+  RateLimiter* limiter = NewRateLimiter(1 << 20, 10 * 1000);
+  ASSERT_EQ(limiter->GetBytesPerSecond(), 1 << 20);
+  uint64_t start = Env::Default()->NowMicros();
+  for (int i = 0; i < 20; i++) {
+    limiter->Request(10 << 10, RateLimiter::kCompaction);
+  }
+  uint64_t elapsed = Env::Default()->NowMicros() - start;
+  ASSERT_GE(elapsed, 150 * 1000u);
+  ASSERT_LT(elapsed, 2000 * 1000u);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, LargeRequest) {
+  // a request beyond a portion goes through piece by piece
+  RateLimiter* limiter = NewRateLimiter(1 << 20, 10 * 1000);
+  uint64_t start = Env::Default()->NowMicros();
+  limiter->Request(200 << 10, RateLimiter::kFlush);
+  uint64_t elapsed = Env::Default()->NowMicros() - start;
+  ASSERT_GE(elapsed, 150 * 1000u);
+  ASSERT_LT(elapsed, 2000 * 1000u);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, Unlimited) {
+  RateLimiter* limiter = NewRateLimiter(1 << 10, 10 * 1000);
+  limiter->SetBytesPerSecond(0);
+  uint64_t start = Env::Default()->NowMicros();
+  limiter->Request(100 << 20, RateLimiter::kCompaction);
+  ASSERT_LT(Env::Default()->NowMicros() - start, 100 * 1000u);
+  delete limiter;
+}
+
+struct WaitingRequest {
+  RateLimiter* limiter;
+  port::AtomicPointer done;
+};
+
+static void RequestMegabyte(void* arg) {
+  WaitingRequest* request = reinterpret_cast<WaitingRequest*>(arg);
+  request->limiter->Request(1 << 20, RateLimiter::kCompaction);
+  request->done.Release_Store(request);
+}
+
+TEST(RateLimiterTest, UnlimitedWhileWaiting) {
+  // 1KB/s would take a quarter of an hour for the request, lifting the
+  // limit grants the rest of it at once
+  WaitingRequest request;
+  request.limiter = NewRateLimiter(1 << 10, 10 * 1000);
+  request.done.Release_Store(NULL);
+  Env::Default()->StartThread(&RequestMegabyte, &request);
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  ASSERT_TRUE(request.done.Acquire_Load() == NULL);
+  request.limiter->SetBytesPerSecond(0);
+  for (int i = 0; i < 100 && request.done.Acquire_Load() == NULL; i++) {
+    Env::Default()->SleepForMicroseconds(10 * 1000);
+  }
+  ASSERT_TRUE(request.done.Acquire_Load() != NULL);
+  delete request.limiter;
+}
+
+TEST(RateLimiterTest, RateLimitedFile) {
+  RateLimiter* limiter = NewRateLimiter(1 << 20, 10 * 1000);
+  std::string contents;
+  WritableFile* file = NewRateLimitedFile(new StringFile(&contents), limiter,
+                                          RateLimiter::kCompaction);
+  uint64_t start = Env::Default()->NowMicros();
+  for (int i = 0; i < 20; i++) {
+    ASSERT_OK(file->Append(std::string(10 << 10, 'a' + i)));
+  }
+  ASSERT_OK(file->Close());
+  ASSERT_GE(Env::Default()->NowMicros() - start, 150 * 1000u);
+  ASSERT_EQ(contents.size(), 200u << 10);
+  ASSERT_EQ(contents[0], 'a');
+  ASSERT_EQ(contents[contents.size() - 1], 'a' + 19);
+  delete file;
+  delete limiter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -12,7 +12,7 @@
 namespace leveldb {
 
 // performance test
-tera::Counter rawkey_compare_counter;
+tera::ShardedCounter rawkey_compare_counter;
 
 static inline void AppendTsAndType(std::string* tera_key,
                                    int64_t timestamp,
@@ -3900,7 +3900,7 @@ void MasterImpl::MergeTabletAsyncPhase2(TabletPtr tablet_p1, TabletPtr tablet_p2
         leveldb::FileType type = leveldb::kUnknown;
         uint64_t number = 0;
         if (ParseFileName(children[i], &number, &type) &&
-            type == leveldb::kLogFile) {
+            (type == leveldb::kLogFile || type == leveldb::kCommitLogRefFile)) {
             LOG(ERROR) << "[merge] tablet log not clear, merge failed: " << tablet_path;
             MergeTabletFailed(tablet_p1, tablet_p2);
             return;
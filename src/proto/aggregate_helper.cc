@@ -0,0 +1,61 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "proto/aggregate_helper.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace tera {
+
+static void FoldInt64(int64_t min, int64_t max, int64_t sum, uint64_t count,
+                      AggregateResult* aggregate) {
+    if (aggregate->int64_count() == 0 || min < aggregate->min()) {
+        aggregate->set_min(min);
+    }
+    if (aggregate->int64_count() == 0 || max > aggregate->max()) {
+        aggregate->set_max(max);
+    }
+    aggregate->set_sum(aggregate->sum() + sum);
+    aggregate->set_int64_count(aggregate->int64_count() + count);
+}
+
+void AggregateCell(const leveldb::Slice& row, const leveldb::Slice& value,
+                   bool new_row, AggregateResult* aggregate) {
+    if (new_row) {
+        if (aggregate->row_count() == 0) {
+            aggregate->set_first_row(row.data(), row.size());
+        }
+        aggregate->set_last_row(row.data(), row.size());
+        aggregate->set_row_count(aggregate->row_count() + 1);
+    }
+    aggregate->set_cell_count(aggregate->cell_count() + 1);
+    if (value.size() != sizeof(int64_t)) {
+        return;
+    }
+    int64_t v;
+    memcpy(&v, value.data(), sizeof(v));
+    FoldInt64(v, v, v, 1, aggregate);
+}
+
+void MergeAggregate(const AggregateResult& partial, AggregateResult* total) {
+    if (partial.row_count() > 0) {
+        uint64_t row_count = partial.row_count();
+        if (total->row_count() == 0) {
+            total->set_first_row(partial.first_row());
+        } else if (partial.first_row() == total->last_row()) {
+            // row split over two partials
+            row_count--;
+        }
+        total->set_last_row(partial.last_row());
+        total->set_row_count(total->row_count() + row_count);
+    }
+    total->set_cell_count(total->cell_count() + partial.cell_count());
+    if (partial.int64_count() > 0) {
+        FoldInt64(partial.min(), partial.max(), partial.sum(),
+                  partial.int64_count(), total);
+    }
+}
+
+} // namespace tera
@@ -0,0 +1,24 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef  TERA_PROTO_AGGREGATE_HELPER_H_
+#define  TERA_PROTO_AGGREGATE_HELPER_H_
+
+#include "leveldb/slice.h"
+#include "proto/table_meta.pb.h"
+
+namespace tera {
+
+// Fold a cell of "row" into "aggregate", "new_row" if it is the first cell
+// of its row. Only 8 bytes values count as int64 for sum/min/max.
+void AggregateCell(const leveldb::Slice& row, const leveldb::Slice& value,
+                   bool new_row, AggregateResult* aggregate);
+
+// Add "partial" to "total". Partials must come in row order; a row that
+// ends "total" and starts "partial" is counted once.
+void MergeAggregate(const AggregateResult& partial, AggregateResult* total);
+
+} // namespace tera
+
+#endif  // TERA_PROTO_AGGREGATE_HELPER_H_
@@ -0,0 +1,174 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "proto/packed_result.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+namespace tera {
+
+// Base 128 varints, the encoding of leveldb's util/coding.h.  The sdk
+// libraries do not link leveldb, and must not export its symbols to
+// users that link their own.
+static void PutVarint64(std::string* dst, uint64_t v) {
+    char buf[10];
+    int len = 0;
+    while (v >= 128) {
+        buf[len++] = static_cast<char>(v | 128);
+        v >>= 7;
+    }
+    buf[len++] = static_cast<char>(v);
+    dst->append(buf, len);
+}
+
+static void PutVarint32(std::string* dst, uint32_t v) {
+    PutVarint64(dst, v);
+}
+
+// Return the position after the varint, or NULL if it is truncated or
+// longer than "max_bits"
+static const char* GetVarintPtr(const char* p, const char* limit, int max_bits,
+                                uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < max_bits && p < limit; shift += 7) {
+        uint64_t byte = static_cast<unsigned char>(*p++);
+        result |= (byte & 127) << shift;
+        if ((byte & 128) == 0) {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static const char* GetVarint32Ptr(const char* p, const char* limit,
+                                  uint32_t* value) {
+    uint64_t result = 0;
+    p = GetVarintPtr(p, limit, 32, &result);
+    *value = static_cast<uint32_t>(result);
+    return p;
+}
+
+static const char* GetVarint64Ptr(const char* p, const char* limit,
+                                  uint64_t* value) {
+    return GetVarintPtr(p, limit, 64, value);
+}
+
+void PackRowResult(RowResult* result) {
+    if (result->key_values_size() == 0) {
+        return;
+    }
+    // cells of kv-only tables have no column, keep them as they are
+    for (int i = 0; i < result->key_values_size(); ++i) {
+        if (!result->key_values(i).has_column_family()) {
+            return;
+        }
+    }
+    PackedRowResult* packed = result->mutable_packed();
+    packed->Clear();
+    std::string* cells = packed->mutable_cells();
+    std::string* values = packed->mutable_values();
+    std::map<std::string, uint32_t> family_ids;
+    const std::string* last_qualifier = NULL;
+
+    for (int i = 0; i < result->key_values_size(); ++i) {
+        const KeyValuePair& kv = result->key_values(i);
+        int row_num = packed->row_keys_size();
+        if (row_num == 0 || kv.key() != packed->row_keys(row_num - 1)) {
+            packed->add_row_keys(kv.key());
+            packed->add_row_cell_num(0);
+            last_qualifier = NULL;
+        }
+        row_num = packed->row_keys_size();
+        packed->set_row_cell_num(row_num - 1, packed->row_cell_num(row_num - 1) + 1);
+
+        std::map<std::string, uint32_t>::iterator it =
+            family_ids.find(kv.column_family());
+        if (it == family_ids.end()) {
+            it = family_ids.insert(std::make_pair(kv.column_family(),
+                                                  packed->families_size())).first;
+            packed->add_families(kv.column_family());
+        }
+        PutVarint32(cells, (it->second << 1) | (kv.del() ? 1 : 0));
+
+        const std::string& qualifier = kv.qualifier();
+        size_t shared = 0;
+        if (last_qualifier != NULL) {
+            size_t max_shared = std::min(qualifier.size(), last_qualifier->size());
+            while (shared < max_shared && qualifier[shared] == (*last_qualifier)[shared]) {
+                ++shared;
+            }
+        }
+        PutVarint32(cells, shared);
+        PutVarint32(cells, qualifier.size() - shared);
+        cells->append(qualifier.data() + shared, qualifier.size() - shared);
+        last_qualifier = &qualifier;
+
+        PutVarint64(cells, static_cast<uint64_t>(kv.timestamp()));
+        PutVarint32(cells, kv.value().size());
+        values->append(kv.value());
+    }
+    result->clear_key_values();
+}
+
+bool UnpackRowResult(RowResult* result) {
+    if (!result->has_packed()) {
+        return true;
+    }
+    const PackedRowResult& packed = result->packed();
+    const char* p = packed.cells().data();
+    const char* limit = p + packed.cells().size();
+    const std::string& values = packed.values();
+    size_t value_offset = 0;
+    result->clear_key_values();
+
+    for (int r = 0; r < packed.row_keys_size(); ++r) {
+        if (r >= packed.row_cell_num_size()) {
+            return false;
+        }
+        std::string qualifier;
+        for (uint32_t c = 0; c < packed.row_cell_num(r); ++c) {
+            uint32_t family_id = 0;
+            uint32_t shared = 0;
+            uint32_t unshared = 0;
+            uint64_t timestamp = 0;
+            uint32_t value_size = 0;
+            if ((p = GetVarint32Ptr(p, limit, &family_id)) == NULL
+                || (family_id >> 1) >= static_cast<uint32_t>(packed.families_size())
+                || (p = GetVarint32Ptr(p, limit, &shared)) == NULL
+                || shared > qualifier.size()
+                || (p = GetVarint32Ptr(p, limit, &unshared)) == NULL
+                || static_cast<size_t>(limit - p) < unshared) {
+                return false;
+            }
+            qualifier.resize(shared);
+            qualifier.append(p, unshared);
+            p += unshared;
+            if ((p = GetVarint64Ptr(p, limit, &timestamp)) == NULL
+                || (p = GetVarint32Ptr(p, limit, &value_size)) == NULL
+                || values.size() - value_offset < value_size) {
+                return false;
+            }
+
+            KeyValuePair* kv = result->add_key_values();
+            kv->set_key(packed.row_keys(r));
+            kv->set_column_family(packed.families(family_id >> 1));
+            kv->set_qualifier(qualifier);
+            kv->set_timestamp(static_cast<int64_t>(timestamp));
+            kv->set_value(values.data() + value_offset, value_size);
+            if (family_id & 1) {
+                kv->set_del(true);
+            }
+            value_offset += value_size;
+        }
+    }
+    result->clear_packed();
+    return true;
+}
+
+} // namespace tera
@@ -0,0 +1,23 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef  TERA_PROTO_PACKED_RESULT_H_
+#define  TERA_PROTO_PACKED_RESULT_H_
+
+#include "proto/table_meta.pb.h"
+
+namespace tera {
+
+// Move result->key_values into result->packed. Cells of a row must be
+// contiguous, as scan and read results are. Results of kv-only tables are
+// left unpacked.
+void PackRowResult(RowResult* result);
+
+// Move result->packed back into result->key_values, a no-op if the result
+// is not packed. Return false if the packed data is corrupted.
+bool UnpackRowResult(RowResult* result);
+
+} // namespace tera
+
+#endif  // TERA_PROTO_PACKED_RESULT_H_
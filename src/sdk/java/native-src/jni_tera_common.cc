@@ -73,9 +73,10 @@ void JByteArrayToString(JNIEnv *env, jbyteArray& jbarray, std::string* str) {
 }
 
 void StringToJByteArray(JNIEnv *env, const std::string& str, jbyteArray* jbarray) {
-    size_t str_len = str.size();
-    *jbarray = env->NewByteArray(str_len);
-    jbyte* buffer = env->GetByteArrayElements(*jbarray, 0);
-    memcpy(buffer, str.data(), str_len);
-    env->SetByteArrayRegion(*jbarray, 0, str_len, buffer);
+    BufferToJByteArray(env, str.data(), str.size(), jbarray);
+}
+
+void BufferToJByteArray(JNIEnv *env, const char* data, size_t size, jbyteArray* jbarray) {
+    *jbarray = env->NewByteArray(size);
+    env->SetByteArrayRegion(*jbarray, 0, size, reinterpret_cast<const jbyte*>(data));
 }
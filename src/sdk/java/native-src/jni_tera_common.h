@@ -26,4 +26,6 @@ void JByteArrayToString(JNIEnv *env, jbyteArray& jbarray, std::string* str);
 
 void StringToJByteArray(JNIEnv *env, const std::string& str, jbyteArray* jbarray);
 
+void BufferToJByteArray(JNIEnv *env, const char* data, size_t size, jbyteArray* jbarray);
+
 #endif // _JAVATERA_NATIVE_SRC_JNI_TERA_COMMON_H_
@@ -56,8 +56,7 @@ JNIEXPORT jbyteArray NativeGetRow(JNIEnv *env, jobject jobj,
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string row = reader->RowName();
-    StringToJByteArray(env, row, &jrow);
+    StringToJByteArray(env, reader->RowName(), &jrow);
     return jrow;
 }
 
@@ -70,8 +69,13 @@ JNIEXPORT jbyteArray NativeGetFamily(JNIEnv *env, jobject jobj,
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string family = reader->Family();
-    StringToJByteArray(env, family, &jfamily);
+    tera::CellRef cell;
+    if (!reader->GetCell(&cell)) {
+        std::string msg = "no cell in reader.";
+        SendErrorJ(env, jobj, msg);
+        return NULL;
+    }
+    BufferToJByteArray(env, cell.family, cell.family_size, &jfamily);
     return jfamily;
 }
 
@@ -84,8 +88,13 @@ JNIEXPORT jbyteArray NativeGetColumn(JNIEnv *env, jobject jobj,
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string column = reader->Qualifier();
-    StringToJByteArray(env, column, &jcolumn);
+    tera::CellRef cell;
+    if (!reader->GetCell(&cell)) {
+        std::string msg = "no cell in reader.";
+        SendErrorJ(env, jobj, msg);
+        return NULL;
+    }
+    BufferToJByteArray(env, cell.qualifier, cell.qualifier_size, &jcolumn);
     return jcolumn;
 }
 
@@ -111,7 +120,12 @@ JNIEXPORT jbyteArray NativeGetValue(JNIEnv *env, jobject jobj,
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string value = reader->Value();
-    StringToJByteArray(env, value, &jvalue);
+    tera::CellRef cell;
+    if (!reader->GetCell(&cell)) {
+        std::string msg = "no cell in reader.";
+        SendErrorJ(env, jobj, msg);
+        return NULL;
+    }
+    BufferToJByteArray(env, cell.value, cell.value_size, &jvalue);
     return jvalue;
 }
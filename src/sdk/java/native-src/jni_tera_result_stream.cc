@@ -6,6 +6,8 @@
 #include "jni_tera_result_stream.h"
 #include "jni_tera_common.h"
 
+#include <vector>
+
 #include "sdk/tera.h"
 
 #define NativeDone \
@@ -22,6 +24,8 @@
     JNICALL Java_com_baidu_tera_client_ScanResultStreamImpl_nativeGetTimeStamp
 #define NativeGetValue \
     JNICALL Java_com_baidu_tera_client_ScanResultStreamImpl_nativeGetValue
+#define NativeNextBatch \
+    JNICALL Java_com_baidu_tera_client_ScanResultStreamImpl_nativeNextBatch
 #define NativeDeleteResultStream \
     JNICALL Java_com_baidu_tera_client_ScanResultStreamImpl_nativeDeleteResultStream
 
@@ -57,8 +61,13 @@ JNIEXPORT jbyteArray NativeGetRow(JNIEnv *env, jobject jobj, jlong jresult) {
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string row = result->RowName();
-    StringToJByteArray(env, row, &jrow);
+    tera::CellRef cell;
+    if (!result->GetCell(&cell)) {
+        std::string msg = "no cell in result.";
+        SendErrorJ(env, jobj, msg);
+        return NULL;
+    }
+    BufferToJByteArray(env, cell.row_key, cell.row_key_size, &jrow);
     return jrow;
 }
 
@@ -70,8 +79,13 @@ JNIEXPORT jbyteArray NativeGetFamily(JNIEnv *env, jobject jobj, jlong jresult) {
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string family = result->Family();
-    StringToJByteArray(env, family, &jfamily);
+    tera::CellRef cell;
+    if (!result->GetCell(&cell)) {
+        std::string msg = "no cell in result.";
+        SendErrorJ(env, jobj, msg);
+        return NULL;
+    }
+    BufferToJByteArray(env, cell.family, cell.family_size, &jfamily);
     return jfamily;
 }
 
@@ -83,8 +97,13 @@ JNIEXPORT jbyteArray NativeGetColumn(JNIEnv *env, jobject jobj, jlong jresult) {
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string column = result->Qualifier();
-    StringToJByteArray(env, column, &jcolumn);
+    tera::CellRef cell;
+    if (!result->GetCell(&cell)) {
+        std::string msg = "no cell in result.";
+        SendErrorJ(env, jobj, msg);
+        return NULL;
+    }
+    BufferToJByteArray(env, cell.qualifier, cell.qualifier_size, &jcolumn);
     return jcolumn;
 }
 
@@ -108,11 +127,76 @@ JNIEXPORT jbyteArray NativeGetValue(JNIEnv *env, jobject jobj, jlong jresult) {
         SendErrorJ(env, jobj, msg);
         return NULL;
     }
-    std::string value = result->Value();
-    StringToJByteArray(env, value, &jvalue);
+    tera::CellRef cell;
+    if (!result->GetCell(&cell)) {
+        std::string msg = "no cell in result.";
+        SendErrorJ(env, jobj, msg);
+        return NULL;
+    }
+    BufferToJByteArray(env, cell.value, cell.value_size, &jvalue);
     return jvalue;
 }
 
+static jobjectArray NewBytesArray(JNIEnv *env, jsize size) {
+    jclass bytes_class = env->FindClass("[B");
+    jobjectArray array = env->NewObjectArray(size, bytes_class, NULL);
+    env->DeleteLocalRef(bytes_class);
+    return array;
+}
+
+static void SetBytesElement(JNIEnv *env, jobjectArray array, jsize idx,
+                            const char* data, size_t size) {
+    jbyteArray jbytes;
+    BufferToJByteArray(env, data, size, &jbytes);
+    env->SetObjectArrayElement(array, idx, jbytes);
+    env->DeleteLocalRef(jbytes);
+}
+
+// fill the fields of a ScanResultStreamImpl.CellBatch with the rest cells of
+// the current buffer, one jni call per buffer instead of five per cell
+JNIEXPORT jint NativeNextBatch(JNIEnv *env, jobject jobj, jlong jresult, jobject jbatch) {
+    tera::ResultStream* result = reinterpret_cast<tera::ResultStream*>(jresult);
+    if (result == NULL) {
+        std::string msg = "result not initialized.";
+        SendErrorJ(env, jobj, msg);
+        return 0;
+    }
+    std::vector<tera::CellRef> cells;
+    jsize num = result->NextBatch(&cells);
+    if (num < 0) {
+        std::string msg = "next batch not supported.";
+        SendErrorJ(env, jobj, msg);
+        return 0;
+    }
+
+    jobjectArray jrows = NewBytesArray(env, num);
+    jobjectArray jfamilies = NewBytesArray(env, num);
+    jobjectArray jqualifiers = NewBytesArray(env, num);
+    jobjectArray jvalues = NewBytesArray(env, num);
+    jlongArray jtimestamps = env->NewLongArray(num);
+    std::vector<jlong> timestamps(num);
+    for (jsize i = 0; i < num; ++i) {
+        const tera::CellRef& cell = cells[i];
+        SetBytesElement(env, jrows, i, cell.row_key, cell.row_key_size);
+        SetBytesElement(env, jfamilies, i, cell.family, cell.family_size);
+        SetBytesElement(env, jqualifiers, i, cell.qualifier, cell.qualifier_size);
+        SetBytesElement(env, jvalues, i, cell.value, cell.value_size);
+        timestamps[i] = cell.timestamp;
+    }
+    if (num > 0) {
+        env->SetLongArrayRegion(jtimestamps, 0, num, &timestamps[0]);
+    }
+
+    jclass batch_class = env->GetObjectClass(jbatch);
+    env->SetObjectField(jbatch, env->GetFieldID(batch_class, "rows", "[[B"), jrows);
+    env->SetObjectField(jbatch, env->GetFieldID(batch_class, "families", "[[B"), jfamilies);
+    env->SetObjectField(jbatch, env->GetFieldID(batch_class, "qualifiers", "[[B"), jqualifiers);
+    env->SetObjectField(jbatch, env->GetFieldID(batch_class, "values", "[[B"), jvalues);
+    env->SetObjectField(jbatch, env->GetFieldID(batch_class, "timeStamps", "[J"), jtimestamps);
+    env->DeleteLocalRef(batch_class);
+    return num;
+}
+
 JNIEXPORT void NativeDeleteResultStream(JNIEnv *env, jobject jobj, jlong jresult) {
     tera::ResultStream* result = reinterpret_cast<tera::ResultStream*>(jresult);
     if (result == NULL) {
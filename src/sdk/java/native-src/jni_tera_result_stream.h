@@ -63,6 +63,14 @@ JNIEXPORT jlong JNICALL Java_com_baidu_tera_client_ScanResultStreamImpl_nativeGe
 JNIEXPORT jbyteArray JNICALL Java_com_baidu_tera_client_ScanResultStreamImpl_nativeGetValue
   (JNIEnv *, jobject, jlong);
 
+/*
+ * Class:     com_baidu_tera_client_ScanResultStreamImpl
+ * Method:    nativeNextBatch
+ * Signature: (JLcom/baidu/tera/client/ScanResultStreamImpl$CellBatch;)I
+ */
+JNIEXPORT jint JNICALL Java_com_baidu_tera_client_ScanResultStreamImpl_nativeNextBatch
+  (JNIEnv *, jobject, jlong, jobject);
+
 /*
  * Class:     com_baidu_tera_client_ScanResultStreamImpl
  * Method:    nativeDeleteResultStream
@@ -1,6 +1,15 @@
 package com.baidu.tera.client;
 
 public class ScanResultStreamImpl extends TeraBase {
+    // cells of a buffer, the i-th cell is rows[i], families[i], ...
+    public static class CellBatch {
+        public byte[][] rows;
+        public byte[][] families;
+        public byte[][] qualifiers;
+        public byte[][] values;
+        public long[] timeStamps;
+    }
+
     private long nativeStreamPointer;
 
     private native boolean nativeDone(long nativeStreamPointer);
@@ -10,6 +19,7 @@ public class ScanResultStreamImpl extends TeraBase {
     private native byte[] nativeGetColumn(long nativeStreamPointer);
     private native long nativeGetTimeStamp(long nativeStreamPointer);
     private native byte[] nativeGetValue(long nativeStreamPointer);
+    private native int nativeNextBatch(long nativeStreamPointer, CellBatch batch);
     private native void nativeDeleteResultStream(long nativeStreamPointer);
 
     public ScanResultStreamImpl(long nativeStreamPtr) {
@@ -46,6 +56,13 @@ public class ScanResultStreamImpl extends TeraBase {
         return nativeGetTimeStamp(nativeStreamPointer);
     }
 
+    // the rest cells of the current buffer, call done() for the next batch
+    public CellBatch nextBatch() {
+        CellBatch batch = new CellBatch();
+        nativeNextBatch(nativeStreamPointer, batch);
+        return batch;
+    }
+
     public void finalize() {
         if (nativeStreamPointer != 0) {
             nativeDeleteResultStream(nativeStreamPointer);
@@ -6,7 +6,7 @@ Tera Python SDK. It needs a libtera_c.so
 TODO(taocipian) __init__.py
 """
 
-from ctypes import CFUNCTYPE, POINTER
+from ctypes import CFUNCTYPE, POINTER, Structure
 from ctypes import byref, cdll, string_at
 from ctypes import c_bool, c_char_p, c_void_p
 from ctypes import c_int32, c_int64, c_ubyte, c_uint64
@@ -73,6 +73,27 @@ class ScanDescriptor(object):
         return lib.tera_scan_descriptor_set_filter(self.desc, filter_str)
 
 
+class TeraCell(Structure):
+    """ 对应 tera_cell_t, 各字段指向result stream内部buffer
+    """
+    _fields_ = [("row_key", c_void_p), ("row_key_len", c_uint64),
+                ("family", c_void_p), ("family_len", c_uint64),
+                ("qualifier", c_void_p), ("qualifier_len", c_uint64),
+                ("value", c_void_p), ("value_len", c_uint64),
+                ("timestamp", c_int64)]
+
+    def ToTuple(self):
+        """
+        Returns:
+            (tuple) (rowkey, family, qualifier, value, timestamp)
+        """
+        return (string_at(self.row_key, self.row_key_len),
+                string_at(self.family, self.family_len),
+                string_at(self.qualifier, self.qualifier_len),
+                string_at(self.value, self.value_len),
+                self.timestamp)
+
+
 class ResultStream(object):
     """ scan操作返回的输出流
     """
@@ -157,6 +178,27 @@ class ResultStream(object):
         """
         return lib.tera_result_stream_timestamp(self.stream)
 
+    def Cell(self):
+        """ 一次取出当前cell的全部字段
+
+        Returns:
+            (tuple) (rowkey, family, qualifier, value, timestamp)
+        """
+        cell = TeraCell()
+        if not lib.tera_result_stream_cell(self.stream, byref(cell)):
+            raise TeraSdkException("get cell failed")
+        return cell.ToTuple()
+
+    def NextBatch(self):
+        """ 取出当前buffer中剩余的全部cell, 之后调用Done()等待下一批
+
+        Returns:
+            (list) [(rowkey, family, qualifier, value, timestamp), ...]
+        """
+        cells = POINTER(TeraCell)()
+        num = lib.tera_result_stream_next_batch(self.stream, byref(cells))
+        return [cells[i].ToTuple() for i in range(num)]
+
 
 class Client(object):
     """ 通过Client对象访问一个tera集群
@@ -428,6 +470,13 @@ def init_function_prototype():
     lib.tera_result_stream_value_int64.argtypes = [c_void_p]
     lib.tera_result_stream_value_int64.restype = c_int64
 
+    lib.tera_result_stream_cell.argtypes = [c_void_p, POINTER(TeraCell)]
+    lib.tera_result_stream_cell.restype = c_bool
+
+    lib.tera_result_stream_next_batch.argtypes = [c_void_p,
+                                                  POINTER(POINTER(TeraCell))]
+    lib.tera_result_stream_next_batch.restype = c_int64
+
     ###################
     # scan descriptor #
     ###################
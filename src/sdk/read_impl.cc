@@ -4,6 +4,8 @@
 
 #include "sdk/read_impl.h"
 
+#include "sdk/sdk_utils.h"
+
 namespace tera {
 
 /// 读取操作
@@ -159,6 +161,15 @@ std::string RowReaderImpl::Family() {
     }
 }
 
+bool RowReaderImpl::GetCell(CellRef* cell) {
+    KeyValueToCellRef(_result.key_values(_result_pos), cell);
+    if (cell->row_key_size == 0) {
+        cell->row_key = _row_key.data();
+        cell->row_key_size = _row_key.size();
+    }
+    return true;
+}
+
 /// Qualifier
 std::string RowReaderImpl::Qualifier() {
     if (_result.key_values(_result_pos).has_qualifier()) {
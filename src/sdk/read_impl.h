@@ -77,6 +77,8 @@ public:
     std::string Family();
     /// Qualifier
     std::string Qualifier();
+    /// 当前cell, 不拷贝数据
+    bool GetCell(CellRef* cell);
     /// 将结果转存到一个std::map中, 格式为: map<column, map<timestamp, value>>
     typedef std::map< std::string, std::map<int64_t, std::string> > Map;
     void ToMap(Map* rowmap);
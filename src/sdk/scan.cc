@@ -63,6 +63,14 @@ bool ScanDescriptor::IsAsync() const {
     return _impl->IsAsync();
 }
 
+void ScanDescriptor::SetAggregate(bool aggregate) {
+    _impl->SetAggregate(aggregate);
+}
+
+void ScanDescriptor::SetParallel(int32_t max_tablets, bool ordered) {
+    _impl->SetParallel(max_tablets, ordered);
+}
+
 ScanDescImpl* ScanDescriptor::GetImpl() const {
     return _impl;
 }
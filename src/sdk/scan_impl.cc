@@ -4,16 +4,20 @@
 
 #include "sdk/scan_impl.h"
 
+#include <algorithm>
+
 #include <boost/bind.hpp>
 
 #include "common/this_thread.h"
 #include "common/base/closure.h"
 #include "common/base/string_ext.h"
 
+#include "proto/aggregate_helper.h"
 #include "proto/proto_helper.h"
 #include "proto/table_schema.pb.h"
 #include "sdk/table_impl.h"
 #include "sdk/filter_utils.h"
+#include "sdk/sdk_utils.h"
 #include "utils/atomic.h"
 #include "utils/timer.h"
 
@@ -66,9 +70,10 @@ std::string ResultStreamImpl::GetNextStartPoint(const std::string& str) {
 ///////////////////////////////////////
 /////    high performance scan    /////
 ///////////////////////////////////////
-ResultStreamBatchImpl::ResultStreamBatchImpl(TableImpl* table, ScanDescImpl* scan_desc)
+ResultStreamBatchImpl::ResultStreamBatchImpl(TableImpl* table, ScanDescImpl* scan_desc,
+                                             AutoResetEvent* notify)
     : ResultStreamImpl(table, scan_desc),
-    cv_(&mu_), ref_count_(1) {
+    cv_(&mu_), ref_count_(1), notify_(notify) {
     // do something startup
     sliding_window_.resize(FLAGS_tera_sdk_max_batch_scan_req);
     session_end_key_ = _scan_desc_impl->GetStartRowKey();
@@ -99,6 +104,9 @@ void ResultStreamBatchImpl::ReleaseRpcHandle(ScanTabletRequest* request,
     ref_count_--;
     VLOG(28) << "release rpc handle and wakeup, ref_count_ " << ref_count_;
     cv_.Signal();
+    if (notify_ != NULL) {
+        notify_->Set();
+    }
 }
 
 // scan request callback trigger:
@@ -121,6 +129,7 @@ void ResultStreamBatchImpl::OnFinish(ScanTabletRequest* request,
         session_done_ = true;
     } else if ((response->results_id() == 0) &&
                (response->results().key_values_size() == 0) &&
+               !response->results().has_aggregate() &&
                request->part_of_session()) {
         // handle old ts, results_id not init
         VLOG(28) << "batch scan old ts";
@@ -224,9 +233,16 @@ void ResultStreamBatchImpl::ClearAndScanNextSlot(bool scan_next) {
 }
 
 bool ResultStreamBatchImpl::Done(ErrorCode* error) {
+    bool done = false;
+    TryDone(error, true, &done);
+    return done;
+}
+
+bool ResultStreamBatchImpl::TryDone(ErrorCode* error, bool wait, bool* done) {
     if (error) {
         error->SetFailed(ErrorCode::kOK);
     }
+    *done = true;
     MutexLock mutex(&mu_);
     while (1) {
         // not wait condition:
@@ -249,9 +265,19 @@ bool ResultStreamBatchImpl::Done(ErrorCode* error) {
                 LOG(WARNING) << "ts refuse scan, scan later...\n";
                 return true;
             }
+            if (!wait) {
+                return false;
+            }
             cv_.Wait();
         }
-        if (next_idx_ < slot->cell_.key_values_size()) { break; }
+        if (_scan_desc_impl->IsAggregate()) {
+            // no cell is returned, run through the slots
+            MergeAggregate(&slot->cell_);
+        }
+        if (next_idx_ < slot->cell_.key_values_size()) {
+            *done = false;
+            return true;
+        }
 
         VLOG(28) << "session_done_ " << session_done_ << ", session_data_idx_ "
             << session_data_idx_ << ", session_last_idx_ " << session_last_idx_;
@@ -277,7 +303,65 @@ bool ResultStreamBatchImpl::Done(ErrorCode* error) {
         // scan next tablet
         ScanSessionReset();
     }
-    return false;
+    return true;
+}
+
+// merge the partial aggregate of a slot and empty it, slots come in row order
+void ResultStreamBatchImpl::MergeAggregate(RowResult* result) {
+    mu_.AssertHeld();
+    if (!result->has_aggregate() && result->key_values_size() > 0) {
+        // tabletnode does not aggregate, fold the cells here
+        AggregateResult* partial = result->mutable_aggregate();
+        for (int32_t i = 0; i < result->key_values_size(); ++i) {
+            const KeyValuePair& kv = result->key_values(i);
+            bool new_row = (i == 0 || kv.key() != result->key_values(i - 1).key());
+            AggregateCell(kv.key(), kv.value(), new_row, partial);
+        }
+    }
+    tera::MergeAggregate(result->aggregate(), &aggregate_);
+    result->Clear();
+}
+
+bool ResultStreamBatchImpl::GetCell(CellRef* cell) const {
+    KeyValueToCellRef(sliding_window_[sliding_window_idx_].cell_.key_values(next_idx_), cell);
+    return true;
+}
+
+int32_t ResultStreamBatchImpl::NextBatch(std::vector<CellRef>* cells) {
+    const RowResult& result = sliding_window_[sliding_window_idx_].cell_;
+    int32_t num = result.key_values_size() - next_idx_;
+    if (num <= 0) {
+        return 0;
+    }
+    size_t pos = cells->size();
+    cells->resize(pos + num);
+    for (; next_idx_ < result.key_values_size(); ++next_idx_, ++pos) {
+        KeyValueToCellRef(result.key_values(next_idx_), &(*cells)[pos]);
+    }
+    return num;
+}
+
+static void ToScanAggregate(const AggregateResult& result, ScanAggregate* aggregate) {
+    aggregate->row_count = result.row_count();
+    aggregate->cell_count = result.cell_count();
+    aggregate->int64_count = result.int64_count();
+    aggregate->sum = result.sum();
+    aggregate->min = result.min();
+    aggregate->max = result.max();
+}
+
+bool ResultStreamBatchImpl::GetAggregate(ScanAggregate* aggregate) const {
+    if (!_scan_desc_impl->IsAggregate()) {
+        return false;
+    }
+    MutexLock mutex(&mu_);
+    ToScanAggregate(aggregate_, aggregate);
+    return true;
+}
+
+void ResultStreamBatchImpl::GetAggregateResult(AggregateResult* aggregate) const {
+    MutexLock mutex(&mu_);
+    aggregate->CopyFrom(aggregate_);
 }
 
 void ResultStreamBatchImpl::Next() { next_idx_++; }
@@ -312,6 +396,155 @@ int64_t ResultStreamBatchImpl::ValueInt64() const {
     return (v.size() == sizeof(int64_t)) ? *(int64_t*)v.c_str() : 0;
 }
 
+///////////////////////////////////////
+/////     parallel tablet scan    /////
+///////////////////////////////////////
+ResultStreamParallelImpl::ResultStreamParallelImpl(TableImpl* table, ScanDescImpl* scan_desc,
+                                                   const std::vector<std::string>& split_keys)
+    : table_(table), scan_desc_(new ScanDescImpl(*scan_desc)),
+      ordered_(scan_desc->IsParallelOrdered()),
+      max_streams_(scan_desc->GetParallelNum()),
+      next_range_(0), current_(NULL) {
+    // every open range may hold a full sliding window of results
+    int64_t buf_size = std::max<int64_t>(scan_desc_->GetBufferSize(), 1);
+    int64_t window_size = buf_size * FLAGS_tera_sdk_max_batch_scan_req;
+    int64_t budget = (FLAGS_tera_sdk_scan_async_cache_size << 20) / window_size;
+    if (max_streams_ > budget) {
+        max_streams_ = std::max<int64_t>(budget, 1);
+    }
+    // and every open range keeps a full window of scan requests in flight
+    int32_t max_tasks = FLAGS_tera_sdk_scan_async_parallel_max_num
+        / std::max(FLAGS_tera_sdk_max_batch_scan_req, 1);
+    if (max_streams_ > max_tasks) {
+        max_streams_ = std::max(max_tasks, 1);
+    }
+    split_keys_.push_back(scan_desc_->GetStartRowKey());
+    split_keys_.insert(split_keys_.end(), split_keys.begin(), split_keys.end());
+    split_keys_.push_back(scan_desc_->GetEndRowKey());
+    VLOG(6) << "parallel scan " << split_keys_.size() - 1 << " ranges, "
+        << max_streams_ << " at a time, ordered " << ordered_;
+}
+
+ResultStreamParallelImpl::~ResultStreamParallelImpl() {
+    for (size_t i = 0; i < streams_.size(); ++i) {
+        delete streams_[i];
+    }
+    delete scan_desc_;
+}
+
+void ResultStreamParallelImpl::OpenStreams() {
+    while (streams_.size() < static_cast<size_t>(max_streams_)
+           && next_range_ + 1 < split_keys_.size()) {
+        ScanDescImpl range_desc(*scan_desc_);
+        range_desc.SetStart(split_keys_[next_range_]);
+        range_desc.SetEnd(split_keys_[next_range_ + 1]);
+        range_desc.SetParallel(0, true);
+        streams_.push_back(NewStream(&range_desc));
+        next_range_++;
+    }
+}
+
+ResultStreamBatchImpl* ResultStreamParallelImpl::NewStream(ScanDescImpl* range_desc) {
+    return new ResultStreamBatchImpl(table_, range_desc, &ready_event_);
+}
+
+bool ResultStreamParallelImpl::CloseStream(size_t idx, ErrorCode* err) {
+    ResultStreamBatchImpl* stream = streams_[idx];
+    if (scan_desc_->IsAggregate()) {
+        // ranges do not share rows, the partials simply add up
+        AggregateResult partial;
+        stream->GetAggregateResult(&partial);
+        tera::MergeAggregate(partial, &aggregate_);
+    }
+    if (stream == current_) {
+        current_ = NULL;
+    }
+    streams_.erase(streams_.begin() + idx);
+    delete stream;
+    return err->GetType() == ErrorCode::kOK;
+}
+
+bool ResultStreamParallelImpl::Done(ErrorCode* error) {
+    ErrorCode err;
+    if (error == NULL) {
+        error = &err;
+    }
+    while (true) {
+        OpenStreams();
+        if (streams_.empty()) {
+            error->SetFailed(ErrorCode::kOK);
+            return true;
+        }
+        if (ordered_) {
+            current_ = streams_.front();
+            if (!current_->Done(error)) {
+                return false;
+            }
+            if (!CloseStream(0, error)) {
+                return true;
+            }
+            continue;
+        }
+        // keep reading the current range while it has results back
+        bool pending = true;
+        if (current_ != NULL) {
+            bool done = false;
+            if (current_->TryDone(error, false, &done)) {
+                if (!done) {
+                    return false;
+                }
+                size_t idx = std::find(streams_.begin(), streams_.end(), current_)
+                    - streams_.begin();
+                if (!CloseStream(idx, error)) {
+                    return true;
+                }
+                continue;
+            }
+        }
+        for (size_t i = 0; i < streams_.size(); ++i) {
+            bool done = false;
+            if (streams_[i] == current_ ||
+                !streams_[i]->TryDone(error, false, &done)) {
+                continue;
+            }
+            pending = false;
+            if (!done) {
+                current_ = streams_[i];
+                return false;
+            }
+            if (!CloseStream(i, error)) {
+                return true;
+            }
+            break;
+        }
+        if (pending) {
+            ready_event_.Wait();
+        }
+    }
+}
+
+void ResultStreamParallelImpl::Next() { current_->Next(); }
+bool ResultStreamParallelImpl::LookUp(const std::string& row_key) { return true; }
+std::string ResultStreamParallelImpl::RowName() const { return current_->RowName(); }
+std::string ResultStreamParallelImpl::Family() const { return current_->Family(); }
+std::string ResultStreamParallelImpl::ColumnName() const { return current_->ColumnName(); }
+std::string ResultStreamParallelImpl::Qualifier() const { return current_->Qualifier(); }
+int64_t ResultStreamParallelImpl::Timestamp() const { return current_->Timestamp(); }
+std::string ResultStreamParallelImpl::Value() const { return current_->Value(); }
+int64_t ResultStreamParallelImpl::ValueInt64() const { return current_->ValueInt64(); }
+bool ResultStreamParallelImpl::GetCell(CellRef* cell) const { return current_->GetCell(cell); }
+int32_t ResultStreamParallelImpl::NextBatch(std::vector<CellRef>* cells) {
+    return current_->NextBatch(cells);
+}
+
+bool ResultStreamParallelImpl::GetAggregate(ScanAggregate* aggregate) const {
+    if (!scan_desc_->IsAggregate()) {
+        return false;
+    }
+    ToScanAggregate(aggregate_, aggregate);
+    return true;
+}
+
 /////////////////////////////
 /////    stream scan    /////
 /////////////////////////////
@@ -725,6 +958,25 @@ int64_t ResultStreamSyncImpl::ValueInt64() const {
     return (v.size() == sizeof(int64_t)) ? *(int64_t*)v.c_str() : 0;
 }
 
+bool ResultStreamSyncImpl::GetCell(CellRef* cell) const {
+    KeyValueToCellRef(_response->results().key_values(_result_pos), cell);
+    return true;
+}
+
+int32_t ResultStreamSyncImpl::NextBatch(std::vector<CellRef>* cells) {
+    const RowResult& result = _response->results();
+    int32_t num = result.key_values_size() - _result_pos;
+    if (num <= 0) {
+        return 0;
+    }
+    size_t pos = cells->size();
+    cells->resize(pos + num);
+    for (; _result_pos < result.key_values_size(); ++_result_pos, ++pos) {
+        KeyValueToCellRef(result.key_values(_result_pos), &(*cells)[pos]);
+    }
+    return num;
+}
+
 void ResultStreamSyncImpl::GetRpcHandle(ScanTabletRequest** request,
                                     ScanTabletResponse** response) {
     *request = new ScanTabletRequest;
@@ -766,6 +1018,9 @@ ScanDescImpl::ScanDescImpl(const string& rowkey)
       _timer_range(NULL),
       _buf_size(65536),
       _is_async(FLAGS_tera_sdk_scan_async_enabled),
+      _is_aggregate(false),
+      _parallel_num(0),
+      _parallel_ordered(true),
       _max_version(1),
       _pack_interval(5000),
       _snapshot(0),
@@ -781,6 +1036,9 @@ ScanDescImpl::ScanDescImpl(const ScanDescImpl& impl)
       _start_timestamp(impl._start_timestamp),
       _buf_size(impl._buf_size),
       _is_async(impl._is_async),
+      _is_aggregate(impl._is_aggregate),
+      _parallel_num(impl._parallel_num),
+      _parallel_ordered(impl._parallel_ordered),
       _max_version(impl._max_version),
       _pack_interval(impl._pack_interval),
       _snapshot(impl._snapshot),
@@ -878,6 +1136,15 @@ void ScanDescImpl::SetAsync(bool async) {
     _is_async = async;
 }
 
+void ScanDescImpl::SetAggregate(bool aggregate) {
+    _is_aggregate = aggregate;
+}
+
+void ScanDescImpl::SetParallel(int32_t max_tablets, bool ordered) {
+    _parallel_num = max_tablets;
+    _parallel_ordered = ordered;
+}
+
 const string& ScanDescImpl::GetStartRowKey() const {
     return _start_key;
 }
@@ -941,6 +1208,18 @@ bool ScanDescImpl::IsAsync() const {
     return _is_async;
 }
 
+bool ScanDescImpl::IsAggregate() const {
+    return _is_aggregate;
+}
+
+int32_t ScanDescImpl::GetParallelNum() const {
+    return _parallel_num;
+}
+
+bool ScanDescImpl::IsParallelOrdered() const {
+    return _parallel_ordered;
+}
+
 void ScanDescImpl::SetTableSchema(const TableSchema& schema) {
     _table_schema = schema;
 }
@@ -5,6 +5,7 @@
 #ifndef  TERA_SDK_SCAN_IMPL_H_
 #define  TERA_SDK_SCAN_IMPL_H_
 
+#include <deque>
 #include <list>
 #include <queue>
 #include <string>
@@ -66,11 +67,16 @@ private:
 class ResultStreamBatchImpl : public ResultStreamImpl {
 public:
     // user interface
-    ResultStreamBatchImpl(TableImpl* table, ScanDescImpl* scan_desc);
+    // "notify" is set whenever a scan rpc comes back, may be NULL
+    ResultStreamBatchImpl(TableImpl* table, ScanDescImpl* scan_desc,
+                          AutoResetEvent* notify = NULL);
     virtual ~ResultStreamBatchImpl();
 
     bool LookUp(const std::string& row_key); // TODO: result maybe search like a map
     bool Done(ErrorCode* err);// wait until slot become valid
+    // same as Done() but return false at once if "wait" is false and the
+    // next slot is not back yet, "*done" is the result of Done()
+    virtual bool TryDone(ErrorCode* err, bool wait, bool* done);
     void Next(); // get next kv in RowResult
 
     std::string RowName() const; // get row key
@@ -80,6 +86,10 @@ public:
     int64_t Timestamp() const; // get ts
     std::string Value() const; // get value
     int64_t ValueInt64() const; // get value as int64_t
+    bool GetCell(CellRef* cell) const; // get kv without copy
+    int32_t NextBatch(std::vector<CellRef>* cells); // get the rest kvs of slot
+    bool GetAggregate(ScanAggregate* aggregate) const;
+    void GetAggregateResult(AggregateResult* aggregate) const;
 
 public:
     // TableImpl interface
@@ -92,6 +102,7 @@ public:
 private:
     void ClearAndScanNextSlot(bool scan_next);
     void ScanSessionReset();
+    void MergeAggregate(RowResult* result);
 
 private:
     mutable Mutex mu_;
@@ -120,6 +131,68 @@ private:
     std::vector<ScanSlot> sliding_window_; // scan_slot buffer
     int32_t sliding_window_idx_; // current slot index
     int32_t next_idx_; // offset in sliding_window[cur_buffer_idx]
+
+    // aggregate scan, partials merged in row order
+    AggregateResult aggregate_;
+
+    AutoResetEvent* notify_;
+};
+
+///////////////////////////////////////
+/////     parallel tablet scan    /////
+///////////////////////////////////////
+// Cut the scan range at tablet boundaries and run a batch scan on up to
+// GetParallelNum() ranges at a time, fewer if the scan cache or
+// tera_sdk_scan_async_parallel_max_num cannot hold them. The ranges are
+// opened by the first Done(). Ordered delivery reads the ranges one after
+// another while the following ones fill their sliding windows; unordered
+// delivery reads the current range while it has results back, then
+// whichever range has.
+class ResultStreamParallelImpl : public ResultStream {
+public:
+    ResultStreamParallelImpl(TableImpl* table, ScanDescImpl* scan_desc,
+                             const std::vector<std::string>& split_keys);
+    virtual ~ResultStreamParallelImpl();
+
+    bool LookUp(const std::string& row_key);
+    bool Done(ErrorCode* err);
+    void Next();
+
+    std::string RowName() const;
+    std::string Family() const;
+    std::string ColumnName() const;
+    std::string Qualifier() const;
+    int64_t Timestamp() const;
+    std::string Value() const;
+    int64_t ValueInt64() const;
+    bool GetCell(CellRef* cell) const;
+    int32_t NextBatch(std::vector<CellRef>* cells);
+    bool GetAggregate(ScanAggregate* aggregate) const;
+
+protected:
+    // scan one range, results are signaled to "ready_event_"
+    virtual ResultStreamBatchImpl* NewStream(ScanDescImpl* range_desc);
+
+private:
+    void OpenStreams();
+    // close a finished stream, return false if it failed
+    bool CloseStream(size_t idx, ErrorCode* err);
+
+private:
+    TableImpl* table_;
+    ScanDescImpl* scan_desc_;
+    bool ordered_;
+    int32_t max_streams_;
+
+    // the scan range is [split_keys_[i], split_keys_[i + 1]), the
+    // first is the scan start, the last is the scan end
+    std::vector<std::string> split_keys_;
+    size_t next_range_;
+    std::deque<ResultStreamBatchImpl*> streams_; // open ranges, in key order
+    ResultStreamBatchImpl* current_;
+    AutoResetEvent ready_event_;
+
+    AggregateResult aggregate_;
 };
 
 /////////////////////////////
@@ -194,6 +267,8 @@ public:
     int64_t Timestamp() const;
     std::string Value() const;
     int64_t ValueInt64() const;
+    bool GetCell(CellRef* cell) const;
+    int32_t NextBatch(std::vector<CellRef>* cells);
 
 public:
     void GetRpcHandle(ScanTabletRequest** request,
@@ -262,6 +337,10 @@ public:
 
     void SetAsync(bool async);
 
+    void SetAggregate(bool aggregate);
+
+    void SetParallel(int32_t max_tablets, bool ordered);
+
     void SetStart(const std::string& row_key, const std::string& column_family = "",
                   const std::string& qualifier = "", int64_t time_stamp = kLatestTs);
 
@@ -297,6 +376,12 @@ public:
 
     bool IsAsync() const;
 
+    bool IsAggregate() const;
+
+    int32_t GetParallelNum() const;
+
+    bool IsParallelOrdered() const;
+
     void SetTableSchema(const TableSchema& schema);
 
 
@@ -319,6 +404,9 @@ private:
     tera::TimeRange* _timer_range;
     int64_t _buf_size;
     bool _is_async;
+    bool _is_aggregate;
+    int32_t _parallel_num;
+    bool _parallel_ordered;
     int32_t _max_version;
     int64_t _pack_interval;
     uint64_t _snapshot;
@@ -104,7 +104,10 @@ LGDescImpl::LGDescImpl(const std::string& lg_name, int32_t id)
       _use_memtable_on_leveldb(false),
       _memtable_ldb_write_buffer_size(0),
       _memtable_ldb_block_size(0),
-      _sst_size(FLAGS_tera_tablet_ldb_sst_size << 20){
+      _sst_size(FLAGS_tera_tablet_ldb_sst_size << 20),
+      _bottom_compress_type(kSnappyCompress),
+      _bottom_compress_level(-1),
+      _compress_dict_size(0) {
 }
 
 /// Id read only
@@ -184,6 +187,27 @@ void LGDescImpl::SetSstSize(int32_t sst_size) {
     _sst_size = sst_size;
 }
 
+void LGDescImpl::SetBottomCompress(CompressType type, int32_t level) {
+    _bottom_compress_type = type;
+    _bottom_compress_level = level;
+}
+
+CompressType LGDescImpl::BottomCompress() const {
+    return _bottom_compress_type;
+}
+
+int32_t LGDescImpl::BottomCompressLevel() const {
+    return _bottom_compress_level;
+}
+
+void LGDescImpl::SetCompressDictSize(int32_t dict_size) {
+    _compress_dict_size = dict_size;
+}
+
+int32_t LGDescImpl::CompressDictSize() const {
+    return _compress_dict_size;
+}
+
 /// 表格名字仅允许使用字母、数字和下划线构造,长度不超过256
 TableDescImpl::TableDescImpl(const std::string& tb_name)
     : _name(tb_name),
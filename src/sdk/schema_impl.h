@@ -116,6 +116,15 @@ public:
     int32_t SstSize() const;
     void SetSstSize(int32_t sst_size);
 
+    /// Compress type of the bottom levels
+    void SetBottomCompress(CompressType type, int32_t level);
+    CompressType BottomCompress() const;
+    int32_t BottomCompressLevel() const;
+
+    /// zstd dictionary size, in Bytes
+    void SetCompressDictSize(int32_t dict_size);
+    int32_t CompressDictSize() const;
+
 private:
     int32_t         _id;
     std::string     _name;
@@ -127,6 +136,9 @@ private:
     int32_t         _memtable_ldb_write_buffer_size;
     int32_t         _memtable_ldb_block_size;
     int32_t         _sst_size; // in bytes
+    CompressType    _bottom_compress_type;
+    int32_t         _bottom_compress_level;
+    int32_t         _compress_dict_size; // in bytes
 };
 
 /// 表描述符.
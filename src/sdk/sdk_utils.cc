@@ -32,6 +32,52 @@ string LgProp2Str(bool type) {
     }
 }
 
+string LgProp2Str(CompressCodec codec) {
+    switch (codec) {
+    case CodecSnappy:
+        return "snappy";
+    case CodecZstd:
+        return "zstd";
+    default:
+        return "none";
+    }
+}
+
+static CompressCodec CompressTypeToCodec(CompressType type) {
+    switch (type) {
+    case kSnappyCompress:
+        return CodecSnappy;
+    case kZstdCompress:
+        return CodecZstd;
+    default:
+        return CodecNone;
+    }
+}
+
+static CompressType CodecToCompressType(CompressCodec codec) {
+    switch (codec) {
+    case CodecSnappy:
+        return kSnappyCompress;
+    case CodecZstd:
+        return kZstdCompress;
+    default:
+        return kNoneCompress;
+    }
+}
+
+static bool Str2CompressType(const string& value, CompressType* type) {
+    if (value == "none") {
+        *type = kNoneCompress;
+    } else if (value == "snappy") {
+        *type = kSnappyCompress;
+    } else if (value == "zstd") {
+        *type = kZstdCompress;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 string LgProp2Str(StoreMedium type) {
     if (type == DiskStore) {
         return "disk";
@@ -151,6 +197,18 @@ void ShowTableSchema(const TableSchema& s, bool is_x) {
         if (is_x) {
             ss << "sst_size=" << (lg_schema.sst_size() >> 20) << ",";
         }
+        if (lg_schema.has_compress_codec()) {
+            ss << "compress=" << LgProp2Str(lg_schema.compress_codec()) << ",";
+        } else if (is_x) {
+            ss << "compress=" << LgProp2Str(lg_schema.compress_type()) << ",";
+        }
+        if (lg_schema.bottom_compress_level() >= 0) {
+            ss << "bottom_compress=" << LgProp2Str(lg_schema.bottom_compress_codec())
+                << ",bottom_compress_level=" << lg_schema.bottom_compress_level() << ",";
+        }
+        if (lg_schema.compress_dict_size() > 0) {
+            ss << "compress_dict_size=" << lg_schema.compress_dict_size() << ",";
+        }
         if (lg_schema.use_memtable_on_leveldb()) {
             ss << "use_memtable_on_leveldb=true"
                 << ",memtable_ldb_write_buffer_size="
@@ -243,7 +301,16 @@ void TableDescToSchema(const TableDescriptor& desc, TableSchema* schema) {
         LocalityGroupSchema* lg = schema->add_locality_groups();
         const LocalityGroupDescriptor* lgdesc = desc.LocalityGroup(i);
         lg->set_block_size(lgdesc->BlockSize());
+        // compress_type for the tabletnodes that do not know compress_codec
         lg->set_compress_type(lgdesc->Compress() != kNoneCompress);
+        lg->set_compress_codec(CompressTypeToCodec(lgdesc->Compress()));
+        if (lgdesc->BottomCompressLevel() >= 0) {
+            lg->set_bottom_compress_codec(CompressTypeToCodec(lgdesc->BottomCompress()));
+            lg->set_bottom_compress_level(lgdesc->BottomCompressLevel());
+        }
+        if (lgdesc->CompressDictSize() > 0) {
+            lg->set_compress_dict_size(lgdesc->CompressDictSize());
+        }
         lg->set_name(lgdesc->Name());
         // printf("add lg %s\n", lgdesc->Name().c_str());
         switch (lgdesc->Store()) {
@@ -339,7 +406,16 @@ void TableSchemaToDesc(const TableSchema& schema, TableDescriptor* desc) {
                 lgd->SetStore(kInDisk);
                 break;
         }
-        lgd->SetCompress(lg.compress_type() ? kSnappyCompress : kNoneCompress);
+        if (lg.has_compress_codec()) {
+            lgd->SetCompress(CodecToCompressType(lg.compress_codec()));
+        } else {
+            lgd->SetCompress(lg.compress_type() ? kSnappyCompress : kNoneCompress);
+        }
+        if (lg.bottom_compress_level() >= 0) {
+            lgd->SetBottomCompress(CodecToCompressType(lg.bottom_compress_codec()),
+                                   lg.bottom_compress_level());
+        }
+        lgd->SetCompressDictSize(lg.compress_dict_size());
         lgd->SetUseBloomfilter(lg.use_bloom_filter());
         lgd->SetUseMemtableOnLeveldb(lg.use_memtable_on_leveldb());
         lgd->SetMemtableLdbWriteBufferSize(lg.memtable_ldb_write_buffer_size());
@@ -408,13 +484,29 @@ bool SetLgProperties(const string& name, const string& value,
         return false;
     }
     if (name == "compress") {
-        if (value == "none") {
-            desc->SetCompress(kNoneCompress);
-        } else if (value == "snappy") {
-            desc->SetCompress(kSnappyCompress);
-        } else {
+        CompressType type;
+        if (!Str2CompressType(value, &type)) {
             return false;
         }
+        desc->SetCompress(type);
+    } else if (name == "bottom_compress") {
+        CompressType type;
+        if (!Str2CompressType(value, &type)) {
+            return false;
+        }
+        desc->SetBottomCompress(type, desc->BottomCompressLevel());
+    } else if (name == "bottom_compress_level") {
+        int32_t level;
+        if (!StringToNumber(value, &level)) {
+            return false;
+        }
+        desc->SetBottomCompress(desc->BottomCompress(), level);
+    } else if (name == "compress_dict_size") {
+        int32_t dict_size; // Bytes
+        if (!StringToNumber(value, &dict_size) || (dict_size < 0)) {
+            return false;
+        }
+        desc->SetCompressDictSize(dict_size);
     } else if (name == "storage") {
         if (value == "disk") {
             desc->SetStore(kInDisk);
@@ -926,4 +1018,16 @@ bool ParseDelimiterFile(const string& filename, std::vector<string>* delims) {
     delims->swap(delimiters);
     return true;
 }
+
+void KeyValueToCellRef(const KeyValuePair& kv, CellRef* cell) {
+    cell->row_key = kv.key().data();
+    cell->row_key_size = kv.key().size();
+    cell->family = kv.column_family().data();
+    cell->family_size = kv.column_family().size();
+    cell->qualifier = kv.qualifier().data();
+    cell->qualifier_size = kv.qualifier().size();
+    cell->value = kv.value().data();
+    cell->value_size = kv.value().size();
+    cell->timestamp = kv.timestamp();
+}
 } // namespace tera
@@ -48,5 +48,8 @@ typedef std::vector<Property> PropertyList;
 bool BuildSchema(TableDescriptor* table_desc, string* schema);
 
 bool ParseDelimiterFile(const string& filename, std::vector<string>* delims);
+
+// point "cell" at the fields of "kv", no copy
+void KeyValueToCellRef(const KeyValuePair& kv, CellRef* cell);
 } // namespace tera
 #endif // TERA_SDK_SDK_UTILS_H_
@@ -22,6 +22,7 @@
 
 #include "io/coding.h"
 #include "proto/kv_helper.h"
+#include "proto/packed_result.h"
 #include "proto/proto_helper.h"
 #include "proto/tabletnode_client.h"
 #include "sdk/mutate_impl.h"
@@ -48,6 +49,7 @@ DECLARE_int64(tera_sdk_max_reader_pending_num);
 DECLARE_bool(tera_sdk_async_blocking_enabled);
 DECLARE_int32(tera_sdk_timeout);
 DECLARE_int32(tera_sdk_scan_buffer_limit);
+DECLARE_bool(tera_sdk_packed_result_enabled);
 DECLARE_int32(tera_sdk_update_meta_concurrency);
 DECLARE_int32(tera_sdk_update_meta_buffer_limit);
 DECLARE_bool(tera_sdk_cookie_enabled);
@@ -288,9 +290,21 @@ ResultStream* TableImpl::Scan(const ScanDescriptor& desc, ErrorCode* err) {
     ScanDescImpl * impl = desc.GetImpl();
     impl->SetTableSchema(_table_schema);
     ResultStream * results = NULL;
-    if (desc.IsAsync() && (_table_schema.raw_key() != GeneralKv)) {
+    if (desc.IsAsync() && (_table_schema.raw_key() != GeneralKv)
+        && impl->GetParallelNum() > 1) {
+        VLOG(6) << "activate parallel-scan";
+        std::vector<std::string> split_keys;
+        GetTabletStartKeys(impl->GetStartRowKey(), impl->GetEndRowKey(), &split_keys);
+        results = new ResultStreamParallelImpl(this, impl, split_keys);
+    } else if (desc.IsAsync() && (_table_schema.raw_key() != GeneralKv)) {
         VLOG(6) << "activate async-scan";
         results = new ResultStreamBatchImpl(this, impl);
+    } else if (impl->IsAggregate()) {
+        // the sync stream returns cells only
+        LOG(WARNING) << "aggregate scan needs an async scan of a table";
+        if (err) {
+            err->SetFailed(ErrorCode::kBadParam, "aggregate scan must be async");
+        }
     } else {
         VLOG(6) << "activate sync-scan";
         results = new ResultStreamSyncImpl(this, impl);
@@ -361,6 +375,12 @@ void TableImpl::CommitScan(ScanTask* scan_task,
         FilterList* filter_list = request->mutable_filter_list();
         filter_list->CopyFrom(impl->GetFilterList());
     }
+    if (impl->IsAggregate()) {
+        request->set_aggregate(true);
+    }
+    if (FLAGS_tera_sdk_packed_result_enabled) {
+        request->set_packed(true);
+    }
     for (int32_t i = 0; i < impl->GetSizeofColumnFamilyList(); ++i) {
         tera::ColumnFamily* column_family = request->add_cf_list();
         column_family->CopyFrom(*(impl->GetColumnFamily(i)));
@@ -398,6 +418,12 @@ void TableImpl::ScanCallBack(ScanTask* scan_task,
         }
     }
 
+    if (response->status() == kTabletNodeOk
+        && !UnpackRowResult(response->mutable_results())) {
+        LOG(ERROR) << "fail to unpack scan result of table: " << _name;
+        response->set_status(kRPCError);
+    }
+
     StatusCode err = response->status();
     if (err != kTabletNodeOk && err != kSnapshotNotExist) {
         VLOG(10) << "fail to scan table: " << _name
@@ -1003,6 +1029,9 @@ void TableImpl::CommitReaders(const std::string server_addr,
     request->set_sequence_id(_last_sequence_id++);
     request->set_tablet_name(_name);
     request->set_client_timeout_ms(_pending_timeout_ms);
+    if (FLAGS_tera_sdk_packed_result_enabled) {
+        request->set_packed(true);
+    }
     for (uint32_t i = 0; i < reader_list.size(); ++i) {
         RowReaderImpl* row_reader = reader_list[i];
         RowReaderInfo* row_reader_info = request->add_row_info_list();
@@ -1041,6 +1070,16 @@ void TableImpl::ReaderCallBack(std::vector<int64_t>* reader_id_list,
             response->set_status(kRPCError);
         }
     }
+    if (response->status() == kTabletNodeOk && response->has_detail()) {
+        BytesList* detail = response->mutable_detail();
+        for (int32_t i = 0; i < detail->row_result_size(); ++i) {
+            if (!UnpackRowResult(detail->mutable_row_result(i))) {
+                LOG(ERROR) << "fail to unpack read result of table: " << _name;
+                response->set_status(kRPCError);
+                break;
+            }
+        }
+    }
 
     std::map<uint32_t, std::vector<int64_t>* > retry_times_list;
     std::vector<RowReaderImpl*> not_in_range_list;
@@ -1328,6 +1367,21 @@ void TableImpl::ScanMetaTable(const std::string& key_start,
     }
 }
 
+void TableImpl::GetTabletStartKeys(const std::string& key_start,
+                                   const std::string& key_end,
+                                   std::vector<std::string>* start_keys) {
+    ScanMetaTable(key_start, key_end);
+    MutexLock lock(&_meta_mutex);
+    std::map<std::string, TabletMetaNode>::iterator it =
+        _tablet_meta_list.upper_bound(key_start);
+    for (; it != _tablet_meta_list.end(); ++it) {
+        if (key_end != "" && it->first >= key_end) {
+            break;
+        }
+        start_keys->push_back(it->first);
+    }
+}
+
 void TableImpl::ScanMetaTableAsyncInLock(std::string key_start, std::string key_end,
                                          std::string expand_key_end, bool zk_access) {
     MutexLock lock(&_meta_mutex);
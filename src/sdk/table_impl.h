@@ -190,6 +190,11 @@ public:
     void ScanMetaTable(const std::string& key_start,
                        const std::string& key_end);
 
+    // start keys of the tablets inside (key_start, key_end), in order
+    void GetTabletStartKeys(const std::string& key_start,
+                            const std::string& key_end,
+                            std::vector<std::string>* start_keys);
+
     bool GetTabletMetaForKey(const std::string& key, TabletMeta* meta);
 
     uint64_t GetMaxMutationPendingNum() { return _max_commit_pending_num; }
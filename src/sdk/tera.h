@@ -45,6 +45,7 @@ const char* strerr(ErrorCode error_code);
 enum CompressType {
     kNoneCompress = 1,
     kSnappyCompress = 2,
+    kZstdCompress = 3,
 };
 
 enum StoreType {
@@ -137,6 +138,14 @@ public:
     /// sst file size, in Bytes
     virtual int32_t SstSize() const = 0;
     virtual void SetSstSize(int32_t sst_size) = 0;
+    /// Compress type of the sst files compacted to level "level" and deeper,
+    /// negative level for the same compress type on all levels
+    virtual void SetBottomCompress(CompressType type, int32_t level) = 0;
+    virtual CompressType BottomCompress() const = 0;
+    virtual int32_t BottomCompressLevel() const = 0;
+    /// zstd dictionary size of each sst file, in Bytes, 0 for none
+    virtual void SetCompressDictSize(int32_t dict_size) = 0;
+    virtual int32_t CompressDictSize() const = 0;
 
 private:
     LocalityGroupDescriptor(const LocalityGroupDescriptor&);
@@ -215,6 +224,33 @@ private:
     TableDescImpl* _impl;
 };
 
+/// 不拷贝数据的cell, 各字段指向sdk内部的结果buffer;
+/// ResultStream的cell在下一次Done()前有效, RowReader的cell在reader释放前有效
+struct CellRef {
+    const char* row_key;
+    size_t row_key_size;
+    const char* family;
+    size_t family_size;
+    const char* qualifier;
+    size_t qualifier_size;
+    const char* value;
+    size_t value_size;
+    int64_t timestamp;
+};
+
+/// 聚合scan的结果, 见ScanDescriptor::SetAggregate
+struct ScanAggregate {
+    int64_t row_count;
+    int64_t cell_count;
+    /// 值为int64(如AddInt64写入)的cell数, sum/min/max只统计这些cell
+    int64_t int64_count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    ScanAggregate()
+        : row_count(0), cell_count(0), int64_count(0), sum(0), min(0), max(0) {}
+};
+
 /// 从表格里读取的结果流
 class ResultStream {
 public:
@@ -236,6 +272,13 @@ public:
     /// Value
     virtual std::string Value() const = 0;
     virtual int64_t ValueInt64() const = 0;
+    /// 当前cell, 不拷贝数据; 不支持时返回false
+    virtual bool GetCell(CellRef* cell) const { return false; }
+    /// 取出当前buffer中剩余的全部cell(不拷贝数据), 追加到cells, 返回cell数;
+    /// 之后调用Done()等待下一批. 不支持时返回-1
+    virtual int32_t NextBatch(std::vector<CellRef>* cells) { return -1; }
+    /// 聚合scan在Done()返回true后取结果, 不支持聚合时返回false
+    virtual bool GetAggregate(ScanAggregate* aggregate) const { return false; }
     ResultStream() {}
     virtual ~ResultStream() {}
 
@@ -280,6 +323,15 @@ public:
     /// 判断当前scan是否是async
     bool IsAsync() const;
 
+    /// 设置聚合scan: tabletnode只返回行数、cell数及int64值的sum/min/max,
+    /// 不返回cell; 仅async scan支持, sync scan或kv表的Scan()返回NULL(kBadParam)
+    void SetAggregate(bool aggregate);
+
+    /// 设置并发scan: 按tablet切分scan范围, 最多同时scan max_tablets个tablet,
+    /// 受tera_sdk_scan_async_cache_size限制; ordered为false时结果不保证按key有序.
+    /// 仅async scan支持
+    void SetParallel(int32_t max_tablets, bool ordered = true);
+
     ScanDescImpl* GetImpl() const;
 
 private:
@@ -479,6 +531,8 @@ public:
     virtual std::string ColumnName() = 0;
     virtual std::string Qualifier() = 0;
     virtual int64_t Timestamp() = 0;
+    /// 当前cell, 不拷贝数据; 不支持时返回false
+    virtual bool GetCell(CellRef* cell) { return false; }
 
     virtual uint32_t GetReadColumnNum() = 0;
     virtual const ReadColumnList& GetReadColumnList() = 0;
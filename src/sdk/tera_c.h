@@ -17,6 +17,20 @@ typedef struct tera_row_mutation_t tera_row_mutation_t;
 typedef struct tera_scan_descriptor_t tera_scan_descriptor_t;
 typedef struct tera_result_stream_t tera_result_stream_t;
 
+// a cell of a scan, points into the result stream buffer without copy,
+// valid until the next tera_result_stream_done()
+typedef struct tera_cell_t {
+    const char* row_key;
+    uint64_t row_key_len;
+    const char* family;
+    uint64_t family_len;
+    const char* qualifier;
+    uint64_t qualifier_len;
+    const char* value;
+    uint64_t value_len;
+    int64_t timestamp;
+} tera_cell_t;
+
 typedef void (*MutationCallbackType)(void* param);
 tera_client_t* tera_client_open(const char* conf_path, const char* log_prefix, char** err);
 
@@ -90,6 +104,11 @@ void tera_result_stream_qualifier(tera_result_stream_t* stream, char** str, uint
 void tera_result_stream_row_name(tera_result_stream_t* stream, char** str, uint64_t* strlen);
 void tera_result_stream_value(tera_result_stream_t* stream, char** str, uint64_t* strlen);
 int64_t tera_result_stream_value_int64(tera_result_stream_t* stream);
+// false if there is no current cell or the stream does not support it
+bool tera_result_stream_cell(tera_result_stream_t* stream, tera_cell_t* cell);
+// the rest cells of the current buffer, owned by the stream, call
+// tera_result_stream_done() for the next batch; -1 if not supported
+int64_t tera_result_stream_next_batch(tera_result_stream_t* stream, tera_cell_t** cells);
 
 #ifdef __cplusplus
 }  /* end extern "C" */
@@ -0,0 +1,49 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sdk/read_impl.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace tera {
+
+TEST(RowReaderImplTest, GetCell) {
+    RowReaderImpl reader(NULL, "row");
+    RowResult result;
+    KeyValuePair* kv = result.add_key_values();
+    kv->set_column_family("cf");
+    kv->set_qualifier("qu");
+    kv->set_value("value");
+    kv->set_timestamp(10);
+    kv = result.add_key_values();
+    kv->set_key("row");
+    kv->set_column_family("cf");
+    kv->set_timestamp(5);
+    reader.SetResult(result);
+
+    CellRef cell;
+    ASSERT_FALSE(reader.Done());
+    ASSERT_TRUE(reader.GetCell(&cell));
+    // read results leave out the row key, the cell refers to the reader's
+    EXPECT_EQ(std::string(cell.row_key, cell.row_key_size), "row");
+    EXPECT_EQ(std::string(cell.family, cell.family_size), "cf");
+    EXPECT_EQ(std::string(cell.qualifier, cell.qualifier_size), "qu");
+    EXPECT_EQ(std::string(cell.value, cell.value_size), "value");
+    EXPECT_EQ(cell.timestamp, 10);
+
+    reader.Next();
+    ASSERT_FALSE(reader.Done());
+    ASSERT_TRUE(reader.GetCell(&cell));
+    EXPECT_EQ(std::string(cell.row_key, cell.row_key_size), "row");
+    EXPECT_EQ(cell.qualifier_size, 0U);
+    EXPECT_EQ(cell.value_size, 0U);
+    EXPECT_EQ(cell.timestamp, 5);
+
+    reader.Next();
+    EXPECT_TRUE(reader.Done());
+}
+
+} // namespace tera
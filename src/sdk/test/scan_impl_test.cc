@@ -6,8 +6,16 @@
 
 #include "scan_impl.h"
 
+#include <map>
+#include <vector>
+
+#include <gflags/gflags.h>
+
 #include "gtest/gtest.h"
 
+DECLARE_int32(tera_sdk_max_batch_scan_req);
+DECLARE_int32(tera_sdk_scan_async_parallel_max_num);
+
 using std::string;
 
 namespace tera {
@@ -133,4 +141,223 @@ TEST_F(ScanDescImplTest, ParseFilterString) {
     EXPECT_FALSE(ParseFilterString());
 }
 
+static void AddCell(RowResult* result, const string& row, const string& qualifier,
+                    const string& value) {
+    KeyValuePair* kv = result->add_key_values();
+    kv->set_key(row);
+    kv->set_column_family("cf");
+    kv->set_qualifier(qualifier);
+    kv->set_value(value);
+    kv->set_timestamp(row.size() + qualifier.size());
+}
+
+static string CellToString(const CellRef& cell) {
+    return string(cell.row_key, cell.row_key_size) + "/"
+        + string(cell.family, cell.family_size) + ":"
+        + string(cell.qualifier, cell.qualifier_size) + "="
+        + string(cell.value, cell.value_size);
+}
+
+TEST(ResultStreamBatchImplTest, GetCellAndNextBatch) {
+    ScanDescImpl desc("");
+    // no scan request is sent with an empty sliding window
+    int32_t batch_scan_req = FLAGS_tera_sdk_max_batch_scan_req;
+    FLAGS_tera_sdk_max_batch_scan_req = 0;
+    ResultStreamBatchImpl stream(NULL, &desc);
+    FLAGS_tera_sdk_max_batch_scan_req = batch_scan_req;
+
+    stream.sliding_window_.resize(1);
+    RowResult* result = &stream.sliding_window_[0].cell_;
+    AddCell(result, "r1", "q1", "v1");
+    AddCell(result, "r1", "q2", "");
+    AddCell(result, "r22", "q", "v3");
+
+    CellRef cell;
+    ASSERT_TRUE(stream.GetCell(&cell));
+    EXPECT_EQ(CellToString(cell), "r1/cf:q1=v1");
+    EXPECT_EQ(cell.timestamp, 4);
+    // the cell points into the result buffer
+    EXPECT_EQ(cell.value, result->key_values(0).value().data());
+
+    stream.Next();
+    std::vector<CellRef> cells(1, cell);
+    ASSERT_EQ(stream.NextBatch(&cells), 2);
+    ASSERT_EQ(cells.size(), 3U);
+    EXPECT_EQ(CellToString(cells[0]), "r1/cf:q1=v1");
+    EXPECT_EQ(CellToString(cells[1]), "r1/cf:q2=");
+    EXPECT_EQ(CellToString(cells[2]), "r22/cf:q=v3");
+    EXPECT_EQ(cells[2].timestamp, 4);
+
+    // the buffer is drained
+    EXPECT_EQ(stream.NextBatch(&cells), 0);
+    EXPECT_EQ(cells.size(), 3U);
+}
+
+// a stream implemented out of the tree, without the cell accessors
+class PlainResultStream : public ResultStream {
+public:
+    bool LookUp(const string& row_key) { return true; }
+    bool Done(ErrorCode* err) { return true; }
+    void Next() {}
+    string RowName() const { return ""; }
+    string ColumnName() const { return ""; }
+    string Family() const { return ""; }
+    string Qualifier() const { return ""; }
+    int64_t Timestamp() const { return 0; }
+    string Value() const { return ""; }
+    int64_t ValueInt64() const { return 0; }
+};
+
+TEST(ResultStreamTest, CellAccessorsDefault) {
+    PlainResultStream stream;
+    CellRef cell;
+    std::vector<CellRef> cells;
+    EXPECT_FALSE(stream.GetCell(&cell));
+    EXPECT_EQ(stream.NextBatch(&cells), -1);
+    EXPECT_TRUE(cells.empty());
+}
+
+// a range stream fed from a row list, its results are back once it has
+// been polled "delay" times
+class FakeRangeStream : public ResultStreamBatchImpl {
+public:
+    FakeRangeStream(ScanDescImpl* desc, AutoResetEvent* event,
+                    const std::vector<string>& rows, int32_t delay,
+                    int32_t* open_num, int32_t* max_open_num)
+        : ResultStreamBatchImpl(NULL, desc, event), m_event(event),
+          m_rows(rows), m_delay(delay), m_pos(0), m_ready(0),
+          m_open_num(open_num) {
+        ++*m_open_num;
+        *max_open_num = std::max(*max_open_num, *m_open_num);
+    }
+    ~FakeRangeStream() {
+        --*m_open_num;
+    }
+
+    bool TryDone(ErrorCode* err, bool wait, bool* done) {
+        err->SetFailed(ErrorCode::kOK);
+        *done = (m_pos == m_rows.size());
+        if (*done || m_pos < m_ready) {
+            return true;
+        }
+        if (!wait && m_delay-- > 0) {
+            // let the parallel stream poll again
+            m_event->Set();
+            return false;
+        }
+        m_ready = m_rows.size();
+        return true;
+    }
+    void Next() { m_pos++; }
+    string RowName() const { return m_rows[m_pos]; }
+
+private:
+    AutoResetEvent* m_event;
+    std::vector<string> m_rows;
+    int32_t m_delay;
+    size_t m_pos;
+    size_t m_ready;
+    int32_t* m_open_num;
+};
+
+class ResultStreamParallelTest : public ::testing::Test {
+public:
+    ResultStreamParallelTest() : m_open_num(0), m_max_open_num(0) {}
+
+    // range start key => rows and delay of the range
+    void AddRange(const string& start, const string& rows, int32_t delay) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            m_rows[start].push_back(string(1, rows[i]));
+        }
+        m_delays[start] = delay;
+    }
+
+    // scan all ranges, return the rows in delivery order
+    string Scan(int32_t parallel_num, bool ordered) {
+        ScanDescImpl desc("");
+        desc.SetParallel(parallel_num, ordered);
+        std::vector<string> split_keys;
+        std::map<string, int32_t>::iterator it = m_delays.begin();
+        for (++it; it != m_delays.end(); ++it) {
+            split_keys.push_back(it->first);
+        }
+        FakeParallelStream stream(this, &desc, split_keys);
+        string result;
+        while (!stream.Done(NULL)) {
+            result += stream.RowName();
+            stream.Next();
+        }
+        EXPECT_EQ(m_open_num, 0);
+        return result;
+    }
+
+protected:
+    class FakeParallelStream : public ResultStreamParallelImpl {
+    public:
+        FakeParallelStream(ResultStreamParallelTest* test, ScanDescImpl* desc,
+                           const std::vector<string>& split_keys)
+            : ResultStreamParallelImpl(NULL, desc, split_keys), m_test(test) {}
+    protected:
+        ResultStreamBatchImpl* NewStream(ScanDescImpl* range_desc) {
+            const string& start = range_desc->GetStartRowKey();
+            // no scan request is sent with an empty sliding window
+            int32_t batch_scan_req = FLAGS_tera_sdk_max_batch_scan_req;
+            FLAGS_tera_sdk_max_batch_scan_req = 0;
+            ResultStreamBatchImpl* stream =
+                new FakeRangeStream(range_desc, &ready_event_, m_test->m_rows[start],
+                                    m_test->m_delays[start], &m_test->m_open_num,
+                                    &m_test->m_max_open_num);
+            FLAGS_tera_sdk_max_batch_scan_req = batch_scan_req;
+            return stream;
+        }
+    private:
+        ResultStreamParallelTest* m_test;
+    };
+
+    std::map<string, std::vector<string> > m_rows;
+    std::map<string, int32_t> m_delays;
+    int32_t m_open_num;
+    int32_t m_max_open_num;
+};
+
+TEST_F(ResultStreamParallelTest, Ordered) {
+    AddRange("", "a", 3);
+    AddRange("b", "bc", 0);
+    AddRange("d", "", 0);
+    AddRange("e", "ef", 1);
+    EXPECT_EQ(Scan(2, true), "abcef");
+    EXPECT_EQ(m_max_open_num, 2);
+}
+
+TEST_F(ResultStreamParallelTest, UnorderedStaysOnCurrentRange) {
+    // the first range is back only after the second one is picked, it
+    // must not cut in while the second still has results buffered
+    AddRange("", "ab", 1);
+    AddRange("m", "mn", 0);
+    EXPECT_EQ(Scan(2, false), "mnab");
+    EXPECT_EQ(m_max_open_num, 2);
+}
+
+TEST_F(ResultStreamParallelTest, UnorderedOpensRangesAsOthersFinish) {
+    AddRange("", "ab", 2);
+    AddRange("c", "cd", 0);
+    AddRange("e", "e", 0);
+    AddRange("f", "", 0);
+    string result = Scan(2, false);
+    EXPECT_EQ(result.size(), 5U);
+    EXPECT_EQ(result.substr(0, 3), "cde");
+    EXPECT_EQ(m_max_open_num, 2);
+}
+
+TEST_F(ResultStreamParallelTest, MaxStreams) {
+    int32_t parallel_max_num = FLAGS_tera_sdk_scan_async_parallel_max_num;
+    FLAGS_tera_sdk_scan_async_parallel_max_num = FLAGS_tera_sdk_max_batch_scan_req * 2;
+    for (char c = 'a'; c <= 'h'; ++c) {
+        AddRange(c == 'a' ? "" : string(1, c), string(1, c), 0);
+    }
+    EXPECT_EQ(Scan(8, true), "abcdefgh");
+    EXPECT_EQ(m_max_open_num, 2);
+    FLAGS_tera_sdk_scan_async_parallel_max_num = parallel_max_num;
+}
+
 } // namespace tera
@@ -11,6 +11,7 @@
 
 #include "tabletnode/tabletnode_impl.h"
 #include "utils/counter.h"
+#include "utils/latency_histogram.h"
 #include "utils/timer.h"
 
 DECLARE_int32(tera_tabletnode_ctrl_thread_num);
@@ -26,6 +27,10 @@ extern tera::Counter write_pending_counter;
 extern tera::Counter scan_pending_counter;
 extern tera::Counter compact_pending_counter;
 
+extern tera::LatencyHistogram read_queue_latency;
+extern tera::LatencyHistogram write_queue_latency;
+extern tera::LatencyHistogram scan_queue_latency;
+
 namespace tera {
 namespace tabletnode {
 
@@ -56,12 +61,13 @@ struct ScanRpc : public RpcTask {
     const ScanTabletRequest* request;
     ScanTabletResponse* response;
     google::protobuf::Closure* done;
+    int64_t start_micros;
 
     ScanRpc(google::protobuf::RpcController* ctrl,
             const ScanTabletRequest* req, ScanTabletResponse* resp,
-            google::protobuf::Closure* done)
+            google::protobuf::Closure* done, int64_t start_micros)
       : RpcTask(RPC_SCAN), controller(ctrl), request(req),
-        response(resp), done(done) {}
+        response(resp), done(done), start_micros(start_micros) {}
 };
 
 RemoteTabletNode::RemoteTabletNode(TabletNodeImpl* tabletnode_impl)
@@ -213,7 +219,7 @@ void RemoteTabletNode::ScanTablet(google::protobuf::RpcController* controller,
         done->Run();
     } else {
         scan_pending_counter.Inc();
-        ScanRpc* rpc = new ScanRpc(controller, request, response, done);
+        ScanRpc* rpc = new ScanRpc(controller, request, response, done, get_micros());
         m_scan_rpc_schedule->EnqueueRpc(request->table_name(), rpc);
         m_scan_thread_pool->AddTask(boost::bind(&RemoteTabletNode::DoScheduleRpc,
                                                 this, m_scan_rpc_schedule.get()));
@@ -278,6 +284,7 @@ void RemoteTabletNode::DoReadTablet(google::protobuf::RpcController* controller,
     VLOG(8) << "accept RPC (ReadTablet)";
     int32_t row_num = request->row_info_list_size();
     read_pending_counter.Sub(row_num);
+    read_queue_latency.Add(get_micros() - start_micros);
 
     bool is_read_timeout = false;
     if (request->has_client_timeout_ms()) {
@@ -292,7 +299,8 @@ void RemoteTabletNode::DoReadTablet(google::protobuf::RpcController* controller,
     }
 
     if (!is_read_timeout) {
-        m_tabletnode_impl->ReadTablet(start_micros, request, response, done);
+        m_tabletnode_impl->ReadTablet(start_micros, request, response, done,
+                                      m_read_thread_pool.get());
     } else {
         response->set_sequence_id(request->sequence_id());
         response->set_success_num(0);
@@ -315,6 +323,9 @@ void RemoteTabletNode::DoWriteTablet(google::protobuf::RpcController* controller
     VLOG(8) << "accept RPC (WriteTablet)";
     int32_t row_num = request->row_list_size();
     write_pending_counter.Sub(row_num);
+    if (NULL != timer) {
+        write_queue_latency.Add(get_micros() - timer->time);
+    }
     m_tabletnode_impl->WriteTablet(request, response, done, timer);
     VLOG(8) << "finish RPC (WriteTablet)";
 }
@@ -421,6 +432,7 @@ void RemoteTabletNode::DoScheduleRpc(RpcSchedule* rpc_schedule) {
     case RPC_SCAN: {
         ScanRpc* scan_rpc = (ScanRpc*)rpc;
         table_name = scan_rpc->request->table_name();
+        scan_queue_latency.Add(get_micros() - scan_rpc->start_micros);
         DoScanTablet(scan_rpc->controller, scan_rpc->request,
                      scan_rpc->response, scan_rpc->done);
     } break;
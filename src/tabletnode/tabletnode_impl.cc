@@ -4,6 +4,7 @@
 
 #include "tabletnode/tabletnode_impl.h"
 
+#include <algorithm>
 #include <set>
 #include <vector>
 
@@ -12,20 +13,26 @@
 #include <glog/logging.h>
 #include <gperftools/malloc_extension.h>
 
+#include "db/commit_log.h"
 #include "db/filename.h"
+#include "db/lg_write_thread.h"
 #include "db/table_cache.h"
 #include "io/io_utils.h"
 #include "io/utils_leveldb.h"
+#include "leveldb/arena_pool.h"
 #include "leveldb/cache.h"
 #include "leveldb/env_cache.h"
 #include "leveldb/env_dfs.h"
 #include "leveldb/env_flash.h"
 #include "leveldb/env_inmem.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/slog.h"
 #include "leveldb/table_utils.h"
 #include "proto/kv_helper.h"
+#include "proto/packed_result.h"
 #include "proto/proto_helper.h"
 #include "proto/tabletnode_client.h"
+#include "table/readahead_file.h"
 #include "tabletnode/tablet_manager.h"
 #include "tabletnode/tabletnode_zk_adapter.h"
 #include "types.h"
@@ -60,8 +67,23 @@ DECLARE_int32(tera_tabletnode_rpc_max_pending_buffer_size);
 DECLARE_int32(tera_tabletnode_rpc_work_thread_num);
 DECLARE_int32(tera_tabletnode_scan_pack_max_size);
 DECLARE_int32(tera_tabletnode_block_cache_size);
+DECLARE_int32(tera_tabletnode_block_cache_shard_bits);
+DECLARE_string(tera_tabletnode_block_cache_policy);
 DECLARE_int32(tera_tabletnode_table_cache_size);
+DECLARE_bool(tera_tabletnode_commit_log_enabled);
+DECLARE_int64(tera_tabletnode_commit_log_file_size);
+DECLARE_int32(tera_tabletnode_commit_log_max_file_num);
+DECLARE_int32(tera_tabletnode_compact_rate_limit);
+DECLARE_int32(tera_tabletnode_compact_rate_limit_min);
+DECLARE_int32(tera_tabletnode_compact_read_latency_target);
+DECLARE_bool(tera_tabletnode_memtable_pool_enabled);
+DECLARE_int32(tera_tabletnode_memtable_chunk_size);
+DECLARE_int32(tera_tabletnode_memtable_pool_free_size);
+DECLARE_bool(tera_tabletnode_memtable_huge_page);
 DECLARE_int32(tera_tabletnode_compact_thread_num);
+DECLARE_int32(tera_tabletnode_lg_write_thread_num);
+DECLARE_int32(tera_tabletnode_readahead_thread_num);
+DECLARE_int32(tera_tabletnode_read_rows_per_task);
 DECLARE_string(tera_tabletnode_path_prefix);
 
 // cache-related
@@ -73,6 +95,10 @@ DECLARE_int32(tera_tabletnode_cache_mem_size);
 DECLARE_int32(tera_tabletnode_cache_disk_size);
 DECLARE_int32(tera_tabletnode_cache_disk_filenum);
 DECLARE_int32(tera_tabletnode_cache_log_level);
+DECLARE_int32(tera_tabletnode_flash_copy_thread_num);
+DECLARE_int32(tera_tabletnode_flash_copy_chunk_size);
+DECLARE_int64(tera_tabletnode_flash_capacity);
+DECLARE_int32(tera_tabletnode_flash_admit_reads);
 DECLARE_int32(tera_tabletnode_gc_log_level);
 
 DECLARE_string(tera_leveldb_env_type);
@@ -85,7 +111,7 @@ DECLARE_int64(tera_tabletnode_tcm_cache_size);
 DECLARE_string(flagfile);
 
 extern tera::Counter range_error_counter;
-extern tera::Counter rand_read_delay;
+extern tera::ShardedCounter rand_read_delay;
 
 static const int GC_LOG_LEVEL = FLAGS_tera_tabletnode_gc_log_level;
 
@@ -99,7 +125,10 @@ TabletNodeImpl::TabletNodeImpl(const TabletNodeInfo& tabletnode_info,
       m_zk_adapter(NULL),
       m_release_cache_timer_id(kInvalidTimerId),
       m_sysinfo(tabletnode_info),
-      m_thread_pool(new ThreadPool(FLAGS_tera_tabletnode_impl_thread_max_num)) {
+      m_thread_pool(new ThreadPool(FLAGS_tera_tabletnode_impl_thread_max_num)),
+      m_ldb_commit_log(NULL),
+      m_ldb_rate_limiter(NULL),
+      m_ldb_arena_pool(NULL) {
     if (FLAGS_tera_local_addr == "") {
         m_local_addr = utils::GetLocalHostName()+ ":" + FLAGS_tera_tabletnode_port;
     } else {
@@ -108,16 +137,40 @@ TabletNodeImpl::TabletNodeImpl(const TabletNodeInfo& tabletnode_info,
     TabletNodeClient::SetThreadPool(m_thread_pool.get());
 
     leveldb::Env::Default()->SetBackgroundThreads(FLAGS_tera_tabletnode_compact_thread_num);
+    leveldb::LGWriteThreadPool::Default()->SetBackgroundThreads(
+        FLAGS_tera_tabletnode_lg_write_thread_num);
+    leveldb::SetReadaheadThreads(FLAGS_tera_tabletnode_readahead_thread_num);
     leveldb::Env::Default()->RenameFile(FLAGS_tera_leveldb_log_path,
                                         FLAGS_tera_leveldb_log_path + ".bak");
     leveldb::Status s =
         leveldb::Env::Default()->NewLogger(FLAGS_tera_leveldb_log_path, &m_ldb_logger);
     leveldb::Env::Default()->SetLogger(m_ldb_logger);
 
-    m_ldb_block_cache =
-        leveldb::NewLRUCache(FLAGS_tera_tabletnode_block_cache_size * 1024UL * 1024);
+    if (FLAGS_tera_tabletnode_block_cache_policy == "slru") {
+        m_ldb_block_cache =
+            leveldb::NewSLRUCache(FLAGS_tera_tabletnode_block_cache_size * 1024UL * 1024,
+                                  FLAGS_tera_tabletnode_block_cache_shard_bits);
+    } else {
+        if (FLAGS_tera_tabletnode_block_cache_policy != "lru") {
+            LOG(WARNING) << "unknown block cache policy: "
+                << FLAGS_tera_tabletnode_block_cache_policy << ", use lru";
+        }
+        m_ldb_block_cache =
+            leveldb::NewLRUCache(FLAGS_tera_tabletnode_block_cache_size * 1024UL * 1024,
+                                 FLAGS_tera_tabletnode_block_cache_shard_bits);
+    }
     m_ldb_table_cache =
         new leveldb::TableCache(FLAGS_tera_tabletnode_table_cache_size);
+    if (FLAGS_tera_tabletnode_compact_rate_limit > 0) {
+        m_ldb_rate_limiter = leveldb::NewRateLimiter(
+            static_cast<int64_t>(FLAGS_tera_tabletnode_compact_rate_limit) << 20);
+    }
+    if (FLAGS_tera_tabletnode_memtable_pool_enabled) {
+        m_ldb_arena_pool = leveldb::NewArenaPool(
+            static_cast<size_t>(FLAGS_tera_tabletnode_memtable_chunk_size) << 10,
+            static_cast<size_t>(FLAGS_tera_tabletnode_memtable_pool_free_size) << 20,
+            FLAGS_tera_tabletnode_memtable_huge_page);
+    }
     if (!s.ok()) {
         m_ldb_logger = NULL;
     }
@@ -127,6 +180,7 @@ TabletNodeImpl::TabletNodeImpl(const TabletNodeInfo& tabletnode_info,
     }
 
     InitCacheSystem();
+    InitCommitLog();
 
     if (m_tablet_manager.get() == NULL) {
         m_tablet_manager.reset(new TabletManager());
@@ -148,6 +202,9 @@ TabletNodeImpl::~TabletNodeImpl() {
     if (FLAGS_tera_tabletnode_cache_enabled) {
         leveldb::ThreeLevelCacheEnv::RemoveCachePaths();
     }
+    delete m_ldb_commit_log;
+    delete m_ldb_rate_limiter;
+    delete m_ldb_arena_pool;
 }
 
 bool TabletNodeImpl::Init() {
@@ -171,6 +228,11 @@ void TabletNodeImpl::InitCacheSystem() {
         // compitable with legacy FlashEnv
         leveldb::FlashEnv::SetFlashPath(FLAGS_tera_tabletnode_cache_paths,
                                         FLAGS_tera_io_cache_path_vanish_allowed);
+        leveldb::FlashEnv::SetCopyOptions(FLAGS_tera_tabletnode_flash_copy_thread_num,
+                                          FLAGS_tera_tabletnode_flash_copy_chunk_size * 1024);
+        leveldb::FlashEnv::SetCapacity(FLAGS_tera_tabletnode_flash_capacity << 20,
+                                       FLAGS_tera_tabletnode_flash_admit_reads);
+        leveldb::FlashEnv::LoadFlashFiles();
         return;
     }
 
@@ -192,6 +254,28 @@ void TabletNodeImpl::InitCacheSystem() {
     }
 }
 
+void TabletNodeImpl::InitCommitLog() {
+    if (!FLAGS_tera_tabletnode_commit_log_enabled) {
+        return;
+    }
+    // commit log must be on dfs, tablets may be recovered on other nodes
+    std::string log_dir = FLAGS_tera_tabletnode_path_prefix;
+    if (*log_dir.rbegin() != '/') {
+        log_dir.push_back('/');
+    }
+    std::string node_name = m_local_addr;
+    std::replace(node_name.begin(), node_name.end(), ':', '_');
+    log_dir += "#commitlog/" + node_name;
+
+    m_ldb_commit_log = new leveldb::CommitLog(
+        io::LeveldbBaseEnv(), log_dir,
+        FLAGS_tera_tabletnode_commit_log_file_size * 1024 * 1024,
+        FLAGS_tera_tabletnode_commit_log_max_file_num);
+    leveldb::Status s = m_ldb_commit_log->Open();
+    CHECK(s.ok()) << "fail to open commit log " << log_dir << ": " << s.ToString();
+    LOG(INFO) << "activate node-wide commit log: " << log_dir;
+}
+
 bool TabletNodeImpl::Exit() {
     m_thread_pool.reset();
 
@@ -263,6 +347,14 @@ void TabletNodeImpl::LoadTablet(const LoadTabletRequest* request,
         parent_tablets.push_back(request->parent_tablets(i));
     }
 
+    io::TabletIO::SharedResources resources;
+    resources.logger = m_ldb_logger;
+    resources.block_cache = m_ldb_block_cache;
+    resources.table_cache = m_ldb_table_cache;
+    resources.commit_log = m_ldb_commit_log;
+    resources.rate_limiter = m_ldb_rate_limiter;
+    resources.arena_pool = m_ldb_arena_pool;
+
     io::TabletIO* tablet_io = NULL;
     StatusCode status = kTabletNodeOk;
     if (!m_tablet_manager->AddTablet(request->tablet_name(), request->path(),
@@ -274,8 +366,7 @@ void TabletNodeImpl::LoadTablet(const LoadTabletRequest* request,
         response->set_status((StatusCode)tablet_io->GetStatus());
         tablet_io->DecRef();
     } else if (!tablet_io->Load(schema, request->path(), parent_tablets,
-                                snapshots, rollbacks, m_ldb_logger,
-                                m_ldb_block_cache, m_ldb_table_cache, &status)) {
+                                snapshots, rollbacks, resources, &status)) {
         tablet_io->DecRef();
         LOG(ERROR) << "fail to load tablet: " << request->path()
             << " [" << DebugString(key_start) << ", "
@@ -387,33 +478,89 @@ void TabletNodeImpl::CompactTablet(const CompactTabletRequest* request,
     done->Run();
 }
 
+// Rows of one ReadTabletRequest, sorted by key so that rows of the same
+// tablet are neighbours, and cut into parts claimed one by one by the
+// read threads.
+struct TabletNodeImpl::ReadTabletTask {
+    const ReadTabletRequest* request;
+    uint64_t snapshot_id;
+    std::vector<int32_t> row_index;     // request rows in key order
+    std::vector<RowResult*> results;    // by request row, NULL on failure
+    std::vector<StatusCode> status;     // by request row
+    int32_t part_num;
+
+    Mutex mutex;
+    CondVar cond;
+    int32_t next_part;
+    int32_t finished_part;
+    int32_t ref;
+
+    ReadTabletTask(const ReadTabletRequest* req, uint64_t snapshot)
+        : request(req), snapshot_id(snapshot), part_num(1),
+          cond(&mutex), next_part(0), finished_part(0), ref(1) {}
+};
+
+namespace {
+class RowKeyLess {
+public:
+    explicit RowKeyLess(const ReadTabletRequest* request) : m_request(request) {}
+    bool operator()(int32_t a, int32_t b) const {
+        return m_request->row_info_list(a).key() < m_request->row_info_list(b).key();
+    }
+private:
+    const ReadTabletRequest* m_request;
+};
+} // namespace
+
 void TabletNodeImpl::ReadTablet(int64_t start_micros,
                                 const ReadTabletRequest* request,
                                 ReadTabletResponse* response,
-                                google::protobuf::Closure* done) {
+                                google::protobuf::Closure* done,
+                                ThreadPool* read_thread_pool) {
     int32_t row_num = request->row_info_list_size();
     uint64_t snapshot_id = request->snapshot_id() == 0 ? 0 : request->snapshot_id();
     uint32_t read_success_num = 0;
 
+    ReadTabletTask* task = new ReadTabletTask(request, snapshot_id);
+    task->row_index.resize(row_num);
     for (int32_t i = 0; i < row_num; i++) {
-        StatusCode row_status = kTabletNodeOk;
-        io::TabletIO* tablet_io = m_tablet_manager->GetTablet(
-            request->tablet_name(), request->row_info_list(i).key(), &row_status);
-        if (tablet_io == NULL) {
-            range_error_counter.Inc();
-            response->mutable_detail()->add_status(kKeyNotInRange);
-        } else {
-            if (tablet_io->ReadCells(request->row_info_list(i),
-                                     response->mutable_detail()->add_row_result(),
-                                     snapshot_id, &row_status)) {
-                read_success_num++;
-            } else {
-                response->mutable_detail()->mutable_row_result()->RemoveLast();
-            }
-            tablet_io->DecRef();
-            response->mutable_detail()->add_status(row_status);
+        task->row_index[i] = i;
+    }
+    std::sort(task->row_index.begin(), task->row_index.end(), RowKeyLess(request));
+    task->results.resize(row_num, NULL);
+    task->status.resize(row_num, kTabletNodeOk);
+
+    int32_t rows_per_task = FLAGS_tera_tabletnode_read_rows_per_task;
+    if (read_thread_pool != NULL && rows_per_task > 0 && row_num > rows_per_task) {
+        task->part_num = (row_num + rows_per_task - 1) / rows_per_task;
+    }
+    // one ref per ReadTabletParts() call, this thread keeps its own
+    task->ref += task->part_num;
+    for (int32_t i = 1; i < task->part_num; i++) {
+        // ahead of queued rpcs, this rpc already holds a read thread
+        read_thread_pool->AddPriorityTask(
+            boost::bind(&TabletNodeImpl::ReadTabletParts, this, task));
+    }
+    // this thread reads the parts no read thread has claimed yet, so the
+    // join below only waits for parts that are being read
+    ReadTabletParts(task);
+    {
+        MutexLock lock(&task->mutex);
+        while (task->finished_part < task->part_num) {
+            task->cond.Wait();
+        }
+    }
+
+    BytesList* detail = response->mutable_detail();
+    for (int32_t i = 0; i < row_num; i++) {
+        detail->add_status(task->status[i]);
+        if (task->results[i] != NULL) {
+            detail->mutable_row_result()->AddAllocated(task->results[i]);
+            task->results[i] = NULL;
+            read_success_num++;
         }
     }
+    ReleaseReadTabletTask(task);
 
     VLOG(10) << "seq_id: " << request->sequence_id()
         << ", req_row: " << row_num
@@ -431,6 +578,81 @@ void TabletNodeImpl::ReadTablet(int64_t start_micros,
     rand_read_delay.Add(used_ms);
 }
 
+void TabletNodeImpl::ReadTabletParts(ReadTabletTask* task) {
+    int32_t row_num = task->row_index.size();
+    while (true) {
+        int32_t part = 0;
+        {
+            MutexLock lock(&task->mutex);
+            if (task->next_part >= task->part_num) {
+                break;
+            }
+            part = task->next_part++;
+        }
+        int64_t begin = (int64_t)row_num * part / task->part_num;
+        int64_t end = (int64_t)row_num * (part + 1) / task->part_num;
+        ReadTabletRows(task, begin, end);
+
+        MutexLock lock(&task->mutex);
+        if (++task->finished_part == task->part_num) {
+            task->cond.Signal();
+        }
+    }
+    ReleaseReadTabletTask(task);
+}
+
+void TabletNodeImpl::ReadTabletRows(ReadTabletTask* task, int32_t begin, int32_t end) {
+    const ReadTabletRequest* request = task->request;
+    io::TabletIO* tablet_io = NULL;
+    for (int32_t i = begin; i < end; i++) {
+        int32_t index = task->row_index[i];
+        const RowReaderInfo& row_info = request->row_info_list(index);
+        // rows are sorted, the tablet of the previous row is looked up
+        // again only when the key runs past its end
+        if (tablet_io != NULL && tablet_io->GetEndKey() != ""
+            && tablet_io->GetEndKey() <= row_info.key()) {
+            tablet_io->DecRef();
+            tablet_io = NULL;
+        }
+        StatusCode row_status = kTabletNodeOk;
+        if (tablet_io == NULL) {
+            tablet_io = m_tablet_manager->GetTablet(request->tablet_name(),
+                                                    row_info.key(), &row_status);
+        }
+        if (tablet_io == NULL) {
+            range_error_counter.Inc();
+            task->status[index] = kKeyNotInRange;
+            continue;
+        }
+        RowResult* result = new RowResult;
+        if (tablet_io->ReadCells(row_info, result, task->snapshot_id, &row_status)) {
+            if (request->packed()) {
+                PackRowResult(result);
+            }
+            task->results[index] = result;
+        } else {
+            delete result;
+        }
+        task->status[index] = row_status;
+    }
+    if (tablet_io != NULL) {
+        tablet_io->DecRef();
+    }
+}
+
+void TabletNodeImpl::ReleaseReadTabletTask(ReadTabletTask* task) {
+    {
+        MutexLock lock(&task->mutex);
+        if (--task->ref > 0) {
+            return;
+        }
+    }
+    for (uint32_t i = 0; i < task->results.size(); i++) {
+        delete task->results[i];
+    }
+    delete task;
+}
+
 void TabletNodeImpl::WriteTablet(const WriteTabletRequest* request,
                                  WriteTabletResponse* response,
                                  google::protobuf::Closure* done,
@@ -705,12 +927,58 @@ void TabletNodeImpl::RefreshSysInfo() {
     int64_t cur_ts = get_micros();
 
     m_sysinfo.CollectTabletNodeInfo(m_tablet_manager.get(), m_local_addr);
+    m_sysinfo.CollectBlockCacheInfo(m_ldb_block_cache);
+    if (m_ldb_arena_pool != NULL) {
+        m_sysinfo.CollectArenaPoolInfo(m_ldb_arena_pool);
+    }
     m_sysinfo.CollectHardwareInfo();
     m_sysinfo.SetTimeStamp(cur_ts);
+    AdjustCompactRateLimit();
 
     VLOG(15) << "collect sysinfo finished, time used: " << get_micros() - cur_ts << " us.";
 }
 
+// Compactions run at full rate while writes stall, on level0 or on a memtable
+// dump paced by the same limiter, back off by half while reads are slower
+// than the target, and recover linearly otherwise.
+void TabletNodeImpl::AdjustCompactRateLimit() {
+    if (m_ldb_rate_limiter == NULL) {
+        return;
+    }
+    const int64_t max_rate =
+        static_cast<int64_t>(FLAGS_tera_tabletnode_compact_rate_limit) << 20;
+    // a rate of 0 would lift the limit, never throttle below 1 MB/s
+    const int64_t min_rate = std::min(max_rate, static_cast<int64_t>(
+        std::max(FLAGS_tera_tabletnode_compact_rate_limit_min, 1)) << 20);
+
+    // the raw count, a single stall per interval counts
+    int64_t write_stall = m_sysinfo.GetWriteStallCount();
+    TabletNodeInfo info;
+    m_sysinfo.GetTabletNodeInfo(&info);
+    int64_t read_p99 = 0;
+    for (int i = 0; i < info.latency_info_size(); ++i) {
+        if (info.latency_info(i).name() == "read_cells") {
+            read_p99 = info.latency_info(i).p99();
+        }
+    }
+
+    int64_t rate = m_ldb_rate_limiter->GetBytesPerSecond();
+    if (write_stall > 0 || FLAGS_tera_tabletnode_compact_read_latency_target <= 0) {
+        rate = max_rate;
+    } else if (read_p99 > FLAGS_tera_tabletnode_compact_read_latency_target) {
+        rate /= 2;
+    } else {
+        rate += max_rate / 10;
+    }
+    rate = std::max(min_rate, std::min(max_rate, rate));
+    if (rate != m_ldb_rate_limiter->GetBytesPerSecond()) {
+        VLOG(6) << "compact rate limit " << (rate >> 20) << " MB/s, read p99 "
+            << read_p99 << " us, write stall " << write_stall;
+        m_ldb_rate_limiter->SetBytesPerSecond(rate);
+    }
+    m_sysinfo.CollectRateLimitInfo(m_ldb_rate_limiter);
+}
+
 void TabletNodeImpl::ScanTablet(const ScanTabletRequest* request,
                                 ScanTabletResponse* response,
                                 google::protobuf::Closure* done) {
@@ -60,10 +60,13 @@ public:
                        CompactTabletResponse* response,
                        google::protobuf::Closure* done);
 
+    // Rows of a large batch are shared with "read_thread_pool" and read in
+    // parallel; returns once every row is read.
     void ReadTablet(int64_t start_micros,
                     const ReadTabletRequest* request,
                     ReadTabletResponse* response,
-                    google::protobuf::Closure* done);
+                    google::protobuf::Closure* done,
+                    ThreadPool* read_thread_pool = NULL);
 
     void WriteTablet(const WriteTabletRequest* request,
                      WriteTabletResponse* response,
@@ -138,8 +141,18 @@ private:
              WriteTabletRequest* request, WriteTabletResponse* response,
              bool failed, int error_code);
 
+    struct ReadTabletTask;
+    void ReadTabletParts(ReadTabletTask* task);
+    void ReadTabletRows(ReadTabletTask* task, int32_t begin, int32_t end);
+    void ReleaseReadTabletTask(ReadTabletTask* task);
+
     void InitCacheSystem();
 
+    void InitCommitLog();
+
+    // adapt the compaction rate limit to read latency and level0 pressure
+    void AdjustCompactRateLimit();
+
     void ReleaseMallocCache();
     void EnableReleaseMallocCacheTimer(int32_t expand_factor = 1);
     void DisableReleaseMallocCacheTimer();
@@ -171,6 +184,9 @@ private:
     leveldb::Logger* m_ldb_logger;
     leveldb::Cache* m_ldb_block_cache;
     leveldb::TableCache* m_ldb_table_cache;
+    leveldb::CommitLog* m_ldb_commit_log;
+    leveldb::RateLimiter* m_ldb_rate_limiter;
+    leveldb::ArenaPool* m_ldb_arena_pool;
 };
 
 } // namespace tabletnode
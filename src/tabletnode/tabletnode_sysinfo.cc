@@ -17,6 +17,7 @@
 
 #include "common/base/string_number.h"
 #include "proto/proto_helper.h"
+#include "utils/latency_histogram.h"
 #include "utils/timer.h"
 #include "utils/tprinter.h"
 #include "utils/utils_cmd.h"
@@ -26,72 +27,88 @@ DEFINE_int32(tera_tabletnode_sysinfo_net_collect_interval, 5, "interval of net c
 DEFINE_int32(tera_tabletnode_sysinfo_cpu_collect_interval, 5, "interval of cpu checking(s)");
 
 namespace leveldb {
-extern tera::Counter rawkey_compare_counter;
-
-extern tera::Counter dfs_read_size_counter;
-extern tera::Counter dfs_write_size_counter;
-extern tera::Counter posix_read_size_counter;
-extern tera::Counter posix_write_size_counter;
-
-extern tera::Counter posix_read_counter;
-extern tera::Counter posix_write_counter;
-extern tera::Counter posix_sync_counter;
-extern tera::Counter posix_list_counter;
-extern tera::Counter posix_exists_counter;
-extern tera::Counter posix_open_counter;
-extern tera::Counter posix_close_counter;
-extern tera::Counter posix_delete_counter;
-extern tera::Counter posix_tell_counter;
-extern tera::Counter posix_seek_counter;
-extern tera::Counter posix_info_counter;
-extern tera::Counter posix_other_counter;
-
-extern tera::Counter snappy_before_size_counter;
-extern tera::Counter snappy_after_size_counter;
-
-extern tera::Counter dfs_read_counter;
-extern tera::Counter dfs_write_counter;
-extern tera::Counter dfs_read_delay_counter;
-extern tera::Counter dfs_write_delay_counter;
-extern tera::Counter dfs_sync_delay_counter;
-extern tera::Counter dfs_sync_counter;
-extern tera::Counter dfs_flush_counter;
-extern tera::Counter dfs_list_counter;
-extern tera::Counter dfs_exists_counter;
-extern tera::Counter dfs_open_counter;
-extern tera::Counter dfs_close_counter;
-extern tera::Counter dfs_delete_counter;
-extern tera::Counter dfs_tell_counter;
-extern tera::Counter dfs_info_counter;
-extern tera::Counter dfs_other_counter;
-
-extern tera::Counter dfs_read_hang_counter;
-extern tera::Counter dfs_write_hang_counter;
-extern tera::Counter dfs_sync_hang_counter;
-extern tera::Counter dfs_flush_hang_counter;
-extern tera::Counter dfs_list_hang_counter;
-extern tera::Counter dfs_exists_hang_counter;
-extern tera::Counter dfs_open_hang_counter;
-extern tera::Counter dfs_close_hang_counter;
-extern tera::Counter dfs_delete_hang_counter;
-extern tera::Counter dfs_tell_hang_counter;
-extern tera::Counter dfs_info_hang_counter;
-extern tera::Counter dfs_other_hang_counter;
-
-extern tera::Counter ssd_read_counter;
-extern tera::Counter ssd_read_size_counter;
-extern tera::Counter ssd_write_counter;
-extern tera::Counter ssd_write_size_counter;
+extern tera::ShardedCounter rawkey_compare_counter;
+
+extern tera::ShardedCounter dfs_read_size_counter;
+extern tera::ShardedCounter dfs_write_size_counter;
+extern tera::ShardedCounter posix_read_size_counter;
+extern tera::ShardedCounter posix_write_size_counter;
+
+extern tera::ShardedCounter posix_read_counter;
+extern tera::ShardedCounter posix_write_counter;
+extern tera::ShardedCounter posix_sync_counter;
+extern tera::ShardedCounter posix_list_counter;
+extern tera::ShardedCounter posix_exists_counter;
+extern tera::ShardedCounter posix_open_counter;
+extern tera::ShardedCounter posix_close_counter;
+extern tera::ShardedCounter posix_delete_counter;
+extern tera::ShardedCounter posix_tell_counter;
+extern tera::ShardedCounter posix_seek_counter;
+extern tera::ShardedCounter posix_info_counter;
+extern tera::ShardedCounter posix_other_counter;
+
+extern tera::ShardedCounter snappy_before_size_counter;
+extern tera::ShardedCounter snappy_after_size_counter;
+
+extern tera::ShardedCounter dfs_read_counter;
+extern tera::ShardedCounter dfs_write_counter;
+extern tera::ShardedCounter dfs_read_delay_counter;
+extern tera::ShardedCounter dfs_write_delay_counter;
+extern tera::ShardedCounter dfs_sync_delay_counter;
+extern tera::ShardedCounter dfs_sync_counter;
+extern tera::ShardedCounter dfs_flush_counter;
+extern tera::ShardedCounter dfs_list_counter;
+extern tera::ShardedCounter dfs_exists_counter;
+extern tera::ShardedCounter dfs_open_counter;
+extern tera::ShardedCounter dfs_close_counter;
+extern tera::ShardedCounter dfs_delete_counter;
+extern tera::ShardedCounter dfs_tell_counter;
+extern tera::ShardedCounter dfs_info_counter;
+extern tera::ShardedCounter dfs_other_counter;
+
+extern tera::ShardedCounter dfs_read_hang_counter;
+extern tera::ShardedCounter dfs_write_hang_counter;
+extern tera::ShardedCounter dfs_sync_hang_counter;
+extern tera::ShardedCounter dfs_flush_hang_counter;
+extern tera::ShardedCounter dfs_list_hang_counter;
+extern tera::ShardedCounter dfs_exists_hang_counter;
+extern tera::ShardedCounter dfs_open_hang_counter;
+extern tera::ShardedCounter dfs_close_hang_counter;
+extern tera::ShardedCounter dfs_delete_hang_counter;
+extern tera::ShardedCounter dfs_tell_hang_counter;
+extern tera::ShardedCounter dfs_info_hang_counter;
+extern tera::ShardedCounter dfs_other_hang_counter;
+
+extern tera::ShardedCounter ssd_read_counter;
+extern tera::ShardedCounter ssd_read_size_counter;
+extern tera::ShardedCounter ssd_write_counter;
+extern tera::ShardedCounter ssd_write_size_counter;
+extern tera::ShardedCounter flash_hit_size_counter;
+extern tera::ShardedCounter flash_miss_size_counter;
+extern tera::ShardedCounter flash_evict_size_counter;
+
+extern tera::LatencyHistogram wal_sync_latency;
+extern tera::LatencyHistogram block_read_latency;
+extern tera::LatencyHistogram dfs_pread_latency;
+extern tera::LatencyHistogram rate_limit_wait_latency;
+extern tera::Counter l0_write_stall_counter;
+extern tera::Counter mem_write_stall_counter;
 }
 
-tera::Counter rand_read_delay;
-tera::Counter row_read_delay;
+tera::ShardedCounter rand_read_delay;
+tera::ShardedCounter row_read_delay;
 tera::Counter range_error_counter;
 tera::Counter read_pending_counter;
 tera::Counter write_pending_counter;
 tera::Counter scan_pending_counter;
 tera::Counter compact_pending_counter;
 
+tera::LatencyHistogram read_queue_latency;
+tera::LatencyHistogram write_queue_latency;
+tera::LatencyHistogram scan_queue_latency;
+tera::LatencyHistogram read_cells_latency;
+tera::LatencyHistogram write_flush_latency;
+
 namespace tera {
 namespace tabletnode {
 
@@ -102,7 +119,8 @@ TabletNodeSysInfo::TabletNodeSysInfo()
       m_net_tx_total(0),
       m_net_rx_total(0),
       m_cpu_check_ts(0),
-      m_tablet_check_ts(0) {
+      m_tablet_check_ts(0),
+      m_write_stall_count(0) {
 }
 
 TabletNodeSysInfo::TabletNodeSysInfo(const TabletNodeInfo& info)
@@ -112,7 +130,8 @@ TabletNodeSysInfo::TabletNodeSysInfo(const TabletNodeInfo& info)
       m_net_tx_total(0),
       m_net_rx_total(0),
       m_cpu_check_ts(0),
-      m_tablet_check_ts(0) {
+      m_tablet_check_ts(0),
+      m_write_stall_count(0) {
 }
 
 TabletNodeSysInfo::~TabletNodeSysInfo() {
@@ -125,6 +144,30 @@ void TabletNodeSysInfo::AddExtraInfo(const std::string& name, int64_t value) {
     e_info->set_value(value);
 }
 
+void TabletNodeSysInfo::CollectBlockCacheInfo(leveldb::Cache* block_cache) {
+    MutexLock lock(&m_mutex);
+    ExtraTsInfo* einfo = m_info.add_extra_info();
+    einfo->set_name(std::string("block_cache_hit_") + block_cache->Name());
+    einfo->set_value(static_cast<int64_t>(block_cache->HitRate() * 100));
+}
+
+void TabletNodeSysInfo::CollectRateLimitInfo(leveldb::RateLimiter* rate_limiter) {
+    MutexLock lock(&m_mutex);
+    ExtraTsInfo* einfo = m_info.add_extra_info();
+    einfo->set_name("compact_rate_limit");
+    einfo->set_value(rate_limiter->GetBytesPerSecond());
+}
+
+void TabletNodeSysInfo::CollectArenaPoolInfo(leveldb::ArenaPool* arena_pool) {
+    MutexLock lock(&m_mutex);
+    ExtraTsInfo* einfo = m_info.add_extra_info();
+    einfo->set_name("memtable_pool_used");
+    einfo->set_value(arena_pool->UsedBytes());
+    einfo = m_info.add_extra_info();
+    einfo->set_name("memtable_pool_free");
+    einfo->set_value(arena_pool->FreeBytes());
+}
+
 void TabletNodeSysInfo::SetCurrentTime() {
     MutexLock lock(&m_mutex);
     m_info.set_timestamp(get_micros());
@@ -139,6 +182,18 @@ void TabletNodeSysInfo::SetTimeStamp(int64_t ts) {
     m_info.set_timestamp(ts);
 }
 
+static void CollectLatency(const char* name, tera::LatencyHistogram* histogram,
+                           TabletNodeInfo* info) {
+    LatencyStat stat;
+    histogram->Clear(&stat);
+    LatencyInfo* latency = info->add_latency_info();
+    latency->set_name(name);
+    latency->set_count(stat.Count());
+    latency->set_p50(stat.Percentile(50));
+    latency->set_p99(stat.Percentile(99));
+    latency->set_p999(stat.Percentile(99.9));
+}
+
 void TabletNodeSysInfo::CollectTabletNodeInfo(TabletManager* tablet_manager,
                                               const string& server_addr) {
     MutexLock lock(&m_mutex);
@@ -159,6 +214,7 @@ void TabletNodeSysInfo::CollectTabletNodeInfo(TabletManager* tablet_manager,
     int64_t write_kvs = 0;
     int64_t write_size = 0;
     int64_t busy_cnt = 0;
+    int64_t memtable_size = 0;
 
     std::vector<io::TabletIO*> tablet_ios;
     tablet_manager->GetAllTablets(&tablet_ios);
@@ -195,6 +251,7 @@ void TabletNodeSysInfo::CollectTabletNodeInfo(TabletManager* tablet_manager,
         write_rows += counter->write_rows();
         write_kvs += counter->write_kvs();
         write_size += counter->write_size();
+        memtable_size += counter->memtable_size();
 
         if (counter->is_on_busy()) {
             busy_cnt++;
@@ -275,6 +332,50 @@ void TabletNodeSysInfo::CollectTabletNodeInfo(TabletManager* tablet_manager,
     tmp = compact_pending_counter.Get();
     einfo->set_name("compact_pending");
     einfo->set_value(tmp);
+
+    einfo = m_info.add_extra_info();
+    tmp = leveldb::flash_hit_size_counter.Clear() * 1000000 / interval;
+    einfo->set_name("flash_hit_size");
+    einfo->set_value(tmp);
+
+    einfo = m_info.add_extra_info();
+    tmp = leveldb::flash_miss_size_counter.Clear() * 1000000 / interval;
+    einfo->set_name("flash_miss_size");
+    einfo->set_value(tmp);
+
+    einfo = m_info.add_extra_info();
+    tmp = leveldb::flash_evict_size_counter.Clear() * 1000000 / interval;
+    einfo->set_name("flash_evict_size");
+    einfo->set_value(tmp);
+
+    int64_t l0_write_stall = leveldb::l0_write_stall_counter.Clear();
+    einfo = m_info.add_extra_info();
+    tmp = l0_write_stall * 1000000 / interval;
+    einfo->set_name("l0_write_stall");
+    einfo->set_value(tmp);
+
+    int64_t mem_write_stall = leveldb::mem_write_stall_counter.Clear();
+    einfo = m_info.add_extra_info();
+    tmp = mem_write_stall * 1000000 / interval;
+    einfo->set_name("mem_write_stall");
+    einfo->set_value(tmp);
+    m_write_stall_count = l0_write_stall + mem_write_stall;
+
+    einfo = m_info.add_extra_info();
+    einfo->set_name("memtable_size");
+    einfo->set_value(memtable_size);
+
+    // collect latency percentiles
+    m_info.clear_latency_info();
+    CollectLatency("read_queue", &read_queue_latency, &m_info);
+    CollectLatency("write_queue", &write_queue_latency, &m_info);
+    CollectLatency("scan_queue", &scan_queue_latency, &m_info);
+    CollectLatency("read_cells", &read_cells_latency, &m_info);
+    CollectLatency("write_flush", &write_flush_latency, &m_info);
+    CollectLatency("wal_sync", &leveldb::wal_sync_latency, &m_info);
+    CollectLatency("block_read", &leveldb::block_read_latency, &m_info);
+    CollectLatency("dfs_pread", &leveldb::dfs_pread_latency, &m_info);
+    CollectLatency("compact_throttle", &leveldb::rate_limit_wait_latency, &m_info);
 }
 
 // return the number of ticks(jiffies) that this process
@@ -439,6 +540,11 @@ void TabletNodeSysInfo::CollectHardwareInfo() {
     }
 }
 
+int64_t TabletNodeSysInfo::GetWriteStallCount() {
+    MutexLock lock(&m_mutex);
+    return m_write_stall_count;
+}
+
 void TabletNodeSysInfo::GetTabletNodeInfo(TabletNodeInfo* info) {
     MutexLock lock(&m_mutex);
     info->CopyFrom(m_info);
@@ -504,6 +610,16 @@ void TabletNodeSysInfo::DumpLog() {
     }
     LOG(INFO) << ss.str();
 
+    // latency info, in us
+    ss.str("");
+    ss << "[Latency]";
+    for (int i = 0; i < m_info.latency_info_size(); ++i) {
+        const LatencyInfo& latency = m_info.latency_info(i);
+        ss << " " << latency.name() << " " << latency.p50() << "/"
+            << latency.p99() << "/" << latency.p999();
+    }
+    LOG(INFO) << ss.str();
+
     // DFS info
     double rdelay = leveldb::dfs_read_counter.Get() ?
         leveldb::dfs_read_delay_counter.Clear()/1000/leveldb::dfs_read_counter.Get()
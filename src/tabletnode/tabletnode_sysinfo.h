@@ -11,6 +11,9 @@
 #include <string>
 
 #include "common/mutex.h"
+#include "leveldb/arena_pool.h"
+#include "leveldb/cache.h"
+#include "leveldb/rate_limiter.h"
 #include "proto/tabletnode.pb.h"
 #include "tabletnode/tablet_manager.h"
 
@@ -29,6 +32,18 @@ public:
 
     void CollectHardwareInfo();
 
+    // add the hit rate (in percent) of the block cache to extra info,
+    // named after its eviction policy
+    void CollectBlockCacheInfo(leveldb::Cache* block_cache);
+
+    // add the current budget (bytes/s) of the compaction rate limiter
+    // to extra info
+    void CollectRateLimitInfo(leveldb::RateLimiter* rate_limiter);
+
+    // add the bytes of memtable chunks in use and cached in the pool
+    // to extra info
+    void CollectArenaPoolInfo(leveldb::ArenaPool* arena_pool);
+
     void AddExtraInfo(const std::string& name, int64_t value);
 
     void Reset();
@@ -41,6 +56,10 @@ public:
 
     void SetStatus(TabletNodeStatus status);
 
+    // the number of writes stalled on level0 or on a memtable dump during
+    // the last interval of CollectTabletNodeInfo
+    int64_t GetWriteStallCount();
+
     void GetTabletNodeInfo(TabletNodeInfo* info);
 
     void GetTabletMetaList(TabletMetaList* meta_list);
@@ -58,6 +77,7 @@ private:
     int64_t m_cpu_check_ts;
 
     int64_t m_tablet_check_ts;
+    int64_t m_write_stall_count;
     mutable Mutex m_mutex;
 };
 } // namespace tabletnode
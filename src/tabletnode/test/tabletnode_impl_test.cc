@@ -17,9 +17,11 @@
 #include "io/mock_tablet_io.h"
 
 DECLARE_bool(tera_zk_enabled);
+DECLARE_int32(tera_tabletnode_read_rows_per_task);
 DECLARE_int32(tera_tabletnode_retry_period);
 DECLARE_string(tera_leveldb_env_type);
 
+using ::testing::AnyNumber;
 using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::_;
@@ -98,13 +100,11 @@ public:
     // mock tablet io
 
     bool IO_Load(const TableSchema& schema,
-                 const std::string& key_start, const std::string& key_end,
                  const std::string& path,
                  const std::vector<uint64_t>& parent_tablets,
                  std::map<uint64_t, uint64_t> snapshots,
-                 leveldb::Logger* logger,
-                 leveldb::Cache* block_cache,
-                 leveldb::TableCache* table_cache,
+                 std::map<uint64_t, uint64_t> rollbacks,
+                 const io::TabletIO::SharedResources& resources,
                  StatusCode* status) {
         return m_ret_io_load;
     }
@@ -126,9 +126,20 @@ public:
         return true;
     }
     bool IO_ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
-                      StatusCode* status) {
+                      uint64_t snapshot_id, StatusCode* status) {
         return m_ret_io_readcell;
     }
+    // returns the row key as the only cell, fails rows starting with "bad"
+    bool IO_ReadCellsOfKey(const RowReaderInfo& row_reader, RowResult* value_list,
+                           uint64_t snapshot_id, StatusCode* status) {
+        if (row_reader.key().compare(0, 3, "bad") == 0) {
+            *status = kKeyNotExist;
+            return false;
+        }
+        value_list->add_key_values()->set_key(row_reader.key());
+        *status = kTabletNodeOk;
+        return true;
+    }
     bool IO_Write(const WriteTabletRequest* request,
                   WriteTabletResponse* response,
                   google::protobuf::Closure* done,
@@ -186,7 +197,7 @@ TEST_F(TabletNodeImplTest, Init_Exit) {
 TEST_F(TabletNodeImplTest, LoadTabletSuccess) {
     EXPECT_CALL(*m_tablet_manager, AddTablet(_, _, _, _, _, _))
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::AddTablet));
-    EXPECT_CALL(m_tablet_io, Load(_, _, _, _, _, _, _, _, _, _))
+    EXPECT_CALL(m_tablet_io, Load(_, _, _, _, _, _, _))
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::IO_Load));
 
     LoadTabletRequest request;
@@ -260,7 +271,7 @@ TEST_F(TabletNodeImplTest, LoadTabletFailureForIOLoad) {
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::AddTablet));
     EXPECT_CALL(*m_tablet_manager, RemoveTablet(_, _, _, _))
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::RemoveTablet));
-    EXPECT_CALL(m_tablet_io, Load(_, _, _, _, _, _, _, _, _, _))
+    EXPECT_CALL(m_tablet_io, Load(_, _, _, _, _, _, _))
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::IO_Load));
 
     LoadTabletRequest request;
@@ -389,7 +400,7 @@ TEST_F(TabletNodeImplTest, ReadTabletSuccessOfKeyList) {
 TEST_F(TabletNodeImplTest, ReadTabletSuccessOfRowList) {
     EXPECT_CALL(*m_tablet_manager, GetTablet(_, _, _))
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::GetTablet2));
-    EXPECT_CALL(m_tablet_io, ReadCells(_, _, _))
+    EXPECT_CALL(m_tablet_io, ReadCells(_, _, _, _))
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::IO_ReadCells));
 
     ReadTabletRequest request;
@@ -420,6 +431,119 @@ TEST_F(TabletNodeImplTest, ReadTabletSuccessOfNullData) {
     EXPECT_EQ(response.status(), kTabletNodeOk);
 }
 
+// tablets ["", "m") and ["m", "x"), keys from "x" on are not served
+class ReadTabletPartsTest : public TabletNodeImplTest {
+public:
+    ReadTabletPartsTest()
+        : m_tablet_a("", "m"), m_tablet_b("m", "x"), m_read_pool(4),
+          m_saved_rows_per_task(0) {}
+
+    // ReadAndCheck() changes the flag, later tests get it back
+    virtual void SetUp() {
+        m_saved_rows_per_task = FLAGS_tera_tabletnode_read_rows_per_task;
+    }
+
+    virtual void TearDown() {
+        FLAGS_tera_tabletnode_read_rows_per_task = m_saved_rows_per_task;
+    }
+
+    io::TabletIO* GetTabletOfKey(const std::string& table_name,
+                                 const std::string& key,
+                                 StatusCode* status) {
+        io::TabletIO* tablet = NULL;
+        if (key < "m") {
+            tablet = &m_tablet_a;
+        } else if (key < "x") {
+            tablet = &m_tablet_b;
+        } else {
+            *status = kKeyNotInRange;
+            return NULL;
+        }
+        tablet->AddRef();
+        return tablet;
+    }
+
+    void ExpectRead() {
+        EXPECT_CALL(*m_tablet_manager, GetTablet(_, _, _))
+            .WillRepeatedly(Invoke(this, &ReadTabletPartsTest::GetTabletOfKey));
+        EXPECT_CALL(m_tablet_a, ReadCells(_, _, _, _))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke(this, &TabletNodeImplTest::IO_ReadCellsOfKey));
+        EXPECT_CALL(m_tablet_b, ReadCells(_, _, _, _))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke(this, &TabletNodeImplTest::IO_ReadCellsOfKey));
+    }
+
+    // read "keys" in parts of "rows_per_task" rows, and check every row
+    // gets its own result or error back at its request position
+    void ReadAndCheck(const std::vector<std::string>& keys, int32_t rows_per_task) {
+        FLAGS_tera_tabletnode_read_rows_per_task = rows_per_task;
+        ReadTabletRequest request;
+        ReadTabletResponse response;
+        request.set_sequence_id(1);
+        request.set_tablet_name("read_table");
+        for (size_t i = 0; i < keys.size(); ++i) {
+            request.add_row_info_list()->set_key(keys[i]);
+        }
+        CreateCallback();
+        m_tabletnode_impl.ReadTablet(1111, &request, &response, m_done, &m_read_pool);
+
+        EXPECT_EQ(response.status(), kTabletNodeOk);
+        ASSERT_EQ(response.detail().status_size(), static_cast<int>(keys.size()));
+        int32_t success_num = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            StatusCode status = response.detail().status(i);
+            if (keys[i] >= "x") {
+                EXPECT_EQ(status, kKeyNotInRange) << keys[i];
+            } else if (keys[i].compare(0, 3, "bad") == 0) {
+                EXPECT_EQ(status, kKeyNotExist) << keys[i];
+            } else {
+                EXPECT_EQ(status, kTabletNodeOk) << keys[i];
+                ASSERT_LT(success_num, response.detail().row_result_size());
+                const RowResult& row = response.detail().row_result(success_num++);
+                ASSERT_EQ(row.key_values_size(), 1);
+                EXPECT_EQ(row.key_values(0).key(), keys[i]);
+            }
+        }
+        EXPECT_EQ(success_num, response.detail().row_result_size());
+        EXPECT_EQ(static_cast<uint32_t>(success_num), response.success_num());
+    }
+
+protected:
+    io::MockTabletIO m_tablet_a;
+    io::MockTabletIO m_tablet_b;
+    ThreadPool m_read_pool;
+    int32_t m_saved_rows_per_task;
+};
+
+TEST_F(ReadTabletPartsTest, RowsOfManyTablets) {
+    ExpectRead();
+    std::vector<std::string> keys;
+    // unsorted keys of both tablets, 11 rows in parts of 4, 4 and 3
+    const char* row_keys[] = {"p1", "a1", "w9", "c3", "m", "b2",
+                              "l9", "q0", "a0", "n5", "k7"};
+    for (size_t i = 0; i < sizeof(row_keys) / sizeof(row_keys[0]); ++i) {
+        keys.push_back(row_keys[i]);
+    }
+    ReadAndCheck(keys, 4);
+    // one part read by the rpc thread only
+    ReadAndCheck(keys, 0);
+}
+
+TEST_F(ReadTabletPartsTest, ErrorsOfRows) {
+    ExpectRead();
+    std::vector<std::string> keys;
+    const char* row_keys[] = {"zz", "a1", "bad1", "y0", "n5", "bad2",
+                              "c1", "x", "o2"};
+    for (size_t i = 0; i < sizeof(row_keys) / sizeof(row_keys[0]); ++i) {
+        keys.push_back(row_keys[i]);
+    }
+    // a single row in the last part
+    ReadAndCheck(keys, 2);
+    // as many parts as rows
+    ReadAndCheck(keys, 1);
+}
+
 TEST_F(TabletNodeImplTest, WriteTabletSuccessOfKeyValue) {
     EXPECT_CALL(*m_tablet_manager, GetTablet(_, _, _))
         .WillRepeatedly(Invoke(this, &TabletNodeImplTest::GetTablet2));
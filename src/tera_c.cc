@@ -10,11 +10,13 @@
 
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include "common/mutex.h"
 
 #include "sdk/tera.h"
 
+using tera::CellRef;
 using tera::Client;
 using tera::ErrorCode;
 using tera::ResultStream;
@@ -25,7 +27,11 @@ using tera::Table;
 extern "C" {
 
 struct tera_client_t          { Client*         rep; };
-struct tera_result_stream_t   { ResultStream*   rep; };
+struct tera_result_stream_t   {
+    ResultStream* rep;
+    std::vector<CellRef> batch;
+    std::vector<tera_cell_t> c_batch;
+};
 struct tera_row_mutation_t    { RowMutation*    rep; };
 struct tera_scan_descriptor_t { ScanDescriptor* rep; };
 struct tera_table_t           { Table*          rep; };
@@ -331,4 +337,40 @@ int64_t tera_result_stream_value_int64(tera_result_stream_t* stream) {
     return stream->rep->ValueInt64();
 }
 
+static void CellRefToC(const CellRef& ref, tera_cell_t* cell) {
+    cell->row_key = ref.row_key;
+    cell->row_key_len = ref.row_key_size;
+    cell->family = ref.family;
+    cell->family_len = ref.family_size;
+    cell->qualifier = ref.qualifier;
+    cell->qualifier_len = ref.qualifier_size;
+    cell->value = ref.value;
+    cell->value_len = ref.value_size;
+    cell->timestamp = ref.timestamp;
+}
+
+bool tera_result_stream_cell(tera_result_stream_t* stream, tera_cell_t* cell) {
+    CellRef ref;
+    if (!stream->rep->GetCell(&ref)) {
+        return false;
+    }
+    CellRefToC(ref, cell);
+    return true;
+}
+
+int64_t tera_result_stream_next_batch(tera_result_stream_t* stream, tera_cell_t** cells) {
+    stream->batch.clear();
+    int64_t num = stream->rep->NextBatch(&stream->batch);
+    if (num < 0) {
+        *cells = NULL;
+        return num;
+    }
+    stream->c_batch.resize(num);
+    for (int64_t i = 0; i < num; ++i) {
+        CellRefToC(stream->batch[i], &stream->c_batch[i]);
+    }
+    *cells = num > 0 ? &stream->c_batch[0] : NULL;
+    return num;
+}
+
 }  // end extern "C"
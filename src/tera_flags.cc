@@ -65,6 +65,8 @@ DEFINE_int32(tera_memenv_block_cache_size, 20, "block cache size for leveldb whi
 DEFINE_string(tera_leveldb_compact_strategy, "default", "the default strategy to drive consum compaction, should be [default|LG|dummy]");
 DEFINE_bool(tera_leveldb_verify_checksums, true, "enable verify data read from storage against checksums");
 DEFINE_bool(tera_leveldb_ignore_corruption_in_compaction, true, "skip corruption blocks of sst file in compaction");
+DEFINE_int32(tera_leveldb_max_subcompactions, 4, "split a compaction into at most this number of key ranges compacted in parallel");
+DEFINE_int32(tera_leveldb_compact_readahead_size, 2048, "compactions read sst files sequentially in chunks of this size (in KB), the next one prefetched in background, 0 to read block by block");
 
 DEFINE_int64(tera_io_scan_stream_task_max_num, 5000, "the max number of concurrent rpc task");
 DEFINE_int64(tera_io_scan_stream_task_pending_time, 180, "the max pending time (in sec) for timeout and interator cleaning");
@@ -150,19 +152,35 @@ DEFINE_string(tera_tabletnode_port, "20000", "the tablet node port of tera syste
 DEFINE_int32(tera_tabletnode_ctrl_thread_num, 10, "control thread number of tablet node (query/load/unload/split)");
 DEFINE_int32(tera_tabletnode_write_thread_num, 10, "write thread number of tablet node");
 DEFINE_int32(tera_tabletnode_read_thread_num, 40, "read thread number of tablet node");
+DEFINE_int32(tera_tabletnode_read_rows_per_task, 64, "rows of a batch read handled by one read thread, larger batches are split across read threads, 0 to disable");
 DEFINE_int32(tera_tabletnode_scan_thread_num, 5, "scan thread number of tablet node");
 DEFINE_int32(tera_tabletnode_manual_compact_thread_num, 2, "the manual compact thread number of tablet node server");
 DEFINE_int32(tera_tabletnode_impl_thread_min_num, 1, "the min thread number for tablet node impl operations");
 DEFINE_int32(tera_tabletnode_impl_thread_max_num, 10, "the max thread number for tablet node impl operations");
 DEFINE_int32(tera_tabletnode_compact_thread_num, 10, "the max thread number for leveldb compaction");
+DEFINE_int32(tera_tabletnode_lg_write_thread_num, 4, "the thread number for applying writes to locality groups in parallel, 0 to disable");
+DEFINE_int32(tera_tabletnode_readahead_thread_num, 4, "the thread number for prefetching sst chunks of compactions and streaming scans, 0 to read them in the reading thread");
 
 DEFINE_int32(tera_tabletnode_connect_retry_times, 5, "the max retry times when connect to tablet node");
 DEFINE_int32(tera_tabletnode_connect_retry_period, 1000, "the retry period (in ms) between retry two tablet node connection");
 DEFINE_int32(tera_tabletnode_connect_timeout_period, 180000, "the timeout period (in ms) for each tablet node connection");
 DEFINE_string(tera_tabletnode_path_prefix, "../data/", "the path prefix for table storage");
 DEFINE_int32(tera_tabletnode_block_cache_size, 2000, "the cache size of tablet (in MB)");
+DEFINE_string(tera_tabletnode_block_cache_policy, "lru", "eviction policy of block cache, should be one of (lru | slru), slru is scan-resistant");
+DEFINE_int32(tera_tabletnode_block_cache_shard_bits, 4, "the block cache is split into 2^shard_bits shards, each with its own lock");
 DEFINE_int32(tera_tabletnode_table_cache_size, 1000, "the table cache size, means the max num of files keeping open in this tabletnode.");
 DEFINE_int32(tera_tabletnode_scan_pack_max_size, 10240, "the max size(KB) of the package for scan rpc");
+DEFINE_int32(tera_tabletnode_scan_readahead_size, 1024, "streaming scans read sst files sequentially in chunks of up to this size (in KB), 0 to read block by block");
+DEFINE_bool(tera_tabletnode_commit_log_enabled, false, "enable one commit log shared by all tablets instead of a log per tablet");
+DEFINE_int64(tera_tabletnode_commit_log_file_size, 128, "the commit log file size (in MB) for tabletnode");
+DEFINE_int32(tera_tabletnode_commit_log_max_file_num, 32, "the max live commit log files before flush the tablets pinning the oldest one");
+DEFINE_int32(tera_tabletnode_compact_rate_limit, 0, "the max rate (in MB/s) of the sst writes of compactions and memtable dumps, shared by all tablets, 0 to disable");
+DEFINE_int32(tera_tabletnode_compact_rate_limit_min, 10, "the rate (in MB/s, at least 1) that compactions are never throttled below when reads are slow");
+DEFINE_int32(tera_tabletnode_compact_read_latency_target, 100000, "throttle compactions while the p99 latency (in us) of reads is beyond this, 0 to keep the max rate");
+DEFINE_bool(tera_tabletnode_memtable_pool_enabled, false, "allocate memtables in chunks of a node-wide pool mapped apart from the malloc heap");
+DEFINE_int32(tera_tabletnode_memtable_chunk_size, 2048, "the max chunk size (in KB) of the memtable pool, memtables start with 4KB heap blocks and double them as they grow, from 64KB on in chunks of the pool");
+DEFINE_int32(tera_tabletnode_memtable_pool_free_size, 1024, "the max size (in MB) of free chunks kept in the memtable pool for reuse");
+DEFINE_bool(tera_tabletnode_memtable_huge_page, false, "back memtable chunks of 2MB and more with transparent huge pages");
 
 DEFINE_int32(tera_asyncwriter_pending_limit, 10000, "the max pending data size (KB) in async writer");
 DEFINE_bool(tera_enable_level0_limit, true, "enable level0 limit");
@@ -194,6 +212,10 @@ DEFINE_int32(tera_tabletnode_cache_mem_size, 2048, "the maximal size (in KB) of
 DEFINE_int32(tera_tabletnode_cache_disk_size, 1024, "the maximal size (in MB) of disk cache");
 DEFINE_int32(tera_tabletnode_cache_disk_filenum, 1, "the file num of disk cache storage");
 DEFINE_int32(tera_tabletnode_cache_log_level, 1, "the log level [0 - 5] for cache system (0: FATAL, 1: ERROR, 2: WARN, 3: INFO, 5: DEBUG).");
+DEFINE_int32(tera_tabletnode_flash_copy_thread_num, 4, "the thread number for copying sst files onto flash in background, 0 to copy on open");
+DEFINE_int32(tera_tabletnode_flash_copy_chunk_size, 4096, "the read size (in KB) when copying sst files onto flash");
+DEFINE_int64(tera_tabletnode_flash_capacity, 0, "the max size (in MB) of sst files kept in each flash path, the least recently read are evicted, 0 for no limit");
+DEFINE_int32(tera_tabletnode_flash_admit_reads, 0, "reads served from dfs before an sst file is copied onto flash (opening a table reads about 3 blocks), 0 to copy on open");
 DEFINE_int32(tera_tabletnode_gc_log_level, 15, "the vlog level [0 - 16] for cache gc.");
 
 DEFINE_bool(tera_tabletnode_tcm_cache_release_enabled, true, "enable the timer to release tcmalloc cache");
@@ -226,6 +248,7 @@ DEFINE_int32(tera_sdk_check_timer_internal, 100, "the sdk check the resend quest
 DEFINE_int32(tera_sdk_timeout, 60000, "timeout of wait in sync reader&mutation mode");
 DEFINE_int32(tera_sdk_delay_send_internal, 2, "the sdk resend the request internal time(s)");
 DEFINE_int32(tera_sdk_scan_buffer_limit, 2048000, "the pack size limit for scan operation");
+DEFINE_bool(tera_sdk_packed_result_enabled, true, "ask tabletnodes for scan and read results in the packed columnar format");
 DEFINE_bool(tera_sdk_write_sync, false, "sync flag for write");
 DEFINE_int32(tera_sdk_batch_size, 100, "batch_size");
 DEFINE_int32(tera_sdk_write_send_interval, 100, "write batch send interval time");
@@ -1273,6 +1273,21 @@ int32_t ShowSingleTabletNodeInfo(Client* client, const string& addr,
     printer.AddRow(row_int);
     printer.Print();
 
+    std::cout << "\nLatency Infos (us):\n";
+    cols = 5;
+    printer.Reset(cols, "name", "count", "p50", "p99", "p999");
+    for (int i = 0; i < info.latency_info_size(); ++i) {
+        const LatencyInfo& latency = info.latency_info(i);
+        row.clear();
+        row.push_back(latency.name());
+        row.push_back(NumberToString(latency.count()));
+        row.push_back(NumberToString(latency.p50()));
+        row.push_back(NumberToString(latency.p99()));
+        row.push_back(NumberToString(latency.p999()));
+        printer.AddRow(row);
+    }
+    printer.Print();
+
     std::cout << "\nTablets In this TabletNode:\n";
     ShowTabletList(tablet_list, false, is_x);
     return 0;
@@ -12,6 +12,19 @@
 
 namespace tera {
 
+// Slot of the calling thread among "num_shards", for the statistics that
+// spread their hot updates over several cache lines. Threads are assigned
+// round-robin on their first call.
+inline int ThreadShard(int num_shards) {
+    static __thread int index = -1;
+    if (index < 0) {
+        static volatile int next_index = 0;
+        index = static_cast<int>(
+            static_cast<unsigned int>(atomic_add(&next_index, 1)) & 0x7fffffff);
+    }
+    return index % num_shards;
+}
+
 class Counter {
 public:
     Counter() : val_(0) {}
@@ -41,9 +54,69 @@ private:
     volatile int64_t val_;
 };
 
+// Counter for statistics updated by many threads on hot paths.
+//
+// Every thread adds to one of kShards slots, each on its own cache line,
+// so concurrent updates do not bounce a shared line between cores.
+// Get() and Clear() sum up the slots, they are meant for the periodic
+// statistics dump, not for the hot path.
+//
+// Add/Sub/Inc/Dec return the new value of the slot of the calling thread,
+// not the total: use Counter when the caller acts on the returned value.
+class ShardedCounter {
+public:
+    ShardedCounter() {
+        for (int i = 0; i < kShards; ++i) {
+            slots_[i].val = 0;
+        }
+    }
+    int64_t Add(int64_t v) {
+        return atomic_add64(&slots_[ThreadShard(kShards)].val, v) + v;
+    }
+    int64_t Sub(int64_t v) {
+        return atomic_add64(&slots_[ThreadShard(kShards)].val, -v) - v;
+    }
+    int64_t Inc() {
+        return atomic_add64(&slots_[ThreadShard(kShards)].val, 1) + 1;
+    }
+    int64_t Dec() {
+        return atomic_add64(&slots_[ThreadShard(kShards)].val, -1) - 1;
+    }
+    int64_t Get() {
+        int64_t sum = 0;
+        for (int i = 0; i < kShards; ++i) {
+            sum += slots_[i].val;
+        }
+        return sum;
+    }
+    int64_t Set(int64_t v) {
+        int64_t old = atomic_swap64(&slots_[0].val, v);
+        for (int i = 1; i < kShards; ++i) {
+            old += atomic_swap64(&slots_[i].val, 0);
+        }
+        return old;
+    }
+    int64_t Clear() {
+        return Set(0);
+    }
+
+private:
+    static const int kShards = 16;
+    static const int kCacheLineSize = 64;
+
+    // padded so that no two counted values share a cache line, whatever
+    // the alignment of the counter itself
+    struct Slot {
+        volatile int64_t val;
+        char pad[kCacheLineSize - sizeof(int64_t)];
+    };
+
+    Slot slots_[kShards];
+};
+
 class AutoCounter {
 public:
-    AutoCounter(Counter* counter, const char* msg1, const char* msg2 = NULL)
+    AutoCounter(ShardedCounter* counter, const char* msg1, const char* msg2 = NULL)
         : counter_(counter),
           msg1_(msg1),
           msg2_(msg2) {
@@ -66,7 +139,7 @@ public:
     }
 
 private:
-    Counter* counter_;
+    ShardedCounter* counter_;
     int64_t start_;
     const char* msg1_;
     const char* msg2_;
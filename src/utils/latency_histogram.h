@@ -0,0 +1,147 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef  TERA_UTILS_LATENCY_HISTOGRAM_H_
+#define  TERA_UTILS_LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+
+#include "atomic.h"
+#include "counter.h"
+
+namespace tera {
+
+// Log-linear buckets of latencies in microseconds.
+//
+// Values below 16 have a bucket each, larger ones fall into one of 8 linear
+// sub-buckets per power of two, so a percentile is off by at most 1/8 of
+// its value. Latencies beyond 2^40us share the last bucket.
+class LatencyBuckets {
+public:
+    enum {
+        kLinearLimit = 16,
+        kSubBucketBits = 3,
+        kSubBuckets = 1 << kSubBucketBits,
+        kMaxExponent = 40,
+        kNumBuckets = kLinearLimit + (kMaxExponent - 3) * kSubBuckets
+    };
+
+    static int Index(int64_t micros) {
+        if (micros < kLinearLimit) {
+            return micros < 0 ? 0 : static_cast<int>(micros);
+        }
+        int exp = 63 - __builtin_clzll(static_cast<uint64_t>(micros));
+        if (exp > kMaxExponent) {
+            return kNumBuckets - 1;
+        }
+        int sub = static_cast<int>(micros >> (exp - kSubBucketBits)) & (kSubBuckets - 1);
+        return kLinearLimit + (exp - 4) * kSubBuckets + sub;
+    }
+    static int64_t LowerBound(int index) {
+        if (index < kLinearLimit) {
+            return index;
+        }
+        int exp = 4 + (index - kLinearLimit) / kSubBuckets;
+        int sub = (index - kLinearLimit) % kSubBuckets;
+        return static_cast<int64_t>(kSubBuckets + sub) << (exp - kSubBucketBits);
+    }
+    static int64_t Width(int index) {
+        if (index < kLinearLimit) {
+            return 1;
+        }
+        int exp = 4 + (index - kLinearLimit) / kSubBuckets;
+        return 1LL << (exp - kSubBucketBits);
+    }
+};
+
+// Samples taken out of a LatencyHistogram.
+class LatencyStat {
+public:
+    LatencyStat() : num_(0) {
+        for (int i = 0; i < LatencyBuckets::kNumBuckets; ++i) {
+            buckets_[i] = 0;
+        }
+    }
+    int64_t Count() const {
+        return num_;
+    }
+    // "p" in [0, 100], linearly interpolated inside the bucket it falls in,
+    // 0 if there is no sample
+    int64_t Percentile(double p) const {
+        if (num_ == 0) {
+            return 0;
+        }
+        double threshold = num_ * (p / 100.0);
+        int64_t sum = 0;
+        for (int i = 0; i < LatencyBuckets::kNumBuckets; ++i) {
+            if (buckets_[i] == 0) {
+                continue;
+            }
+            if (sum + buckets_[i] >= threshold) {
+                double pos = (threshold - sum) / buckets_[i];
+                return LatencyBuckets::LowerBound(i)
+                    + static_cast<int64_t>(pos * LatencyBuckets::Width(i));
+            }
+            sum += buckets_[i];
+        }
+        return LatencyBuckets::LowerBound(LatencyBuckets::kNumBuckets - 1);
+    }
+
+private:
+    friend class LatencyHistogram;
+    int64_t num_;
+    int64_t buckets_[LatencyBuckets::kNumBuckets];
+};
+
+// Lock-free latency histogram for the statistics of the tabletnode.
+//
+// Add() is one atomic increment, in the buckets of the shard of the calling
+// thread, like ShardedCounter, so that threads recording the same latency
+// do not bounce one cache line. Clear() sums the shards up and moves the
+// samples collected since the last call into a LatencyStat, which computes
+// the percentiles of that interval; samples added meanwhile go either to
+// this interval or the next.
+class LatencyHistogram {
+public:
+    LatencyHistogram() {
+        for (int s = 0; s < kShards; ++s) {
+            for (int i = 0; i < LatencyBuckets::kNumBuckets; ++i) {
+                shards_[s].buckets[i] = 0;
+            }
+        }
+    }
+    void Add(int64_t micros) {
+        atomic_inc64(&shards_[ThreadShard(kShards)].buckets[LatencyBuckets::Index(micros)]);
+    }
+    void Clear(LatencyStat* stat) {
+        stat->num_ = 0;
+        for (int i = 0; i < LatencyBuckets::kNumBuckets; ++i) {
+            stat->buckets_[i] = 0;
+            for (int s = 0; s < kShards; ++s) {
+                stat->buckets_[i] += atomic_swap64(&shards_[s].buckets[i], 0);
+            }
+            stat->num_ += stat->buckets_[i];
+        }
+    }
+
+private:
+    // fewer than ShardedCounter, a shard is 2.5KB
+    static const int kShards = 8;
+    static const int kCacheLineSize = 64;
+
+    // padded so that neighbouring shards share no cache line
+    struct Shard {
+        volatile int64_t buckets[LatencyBuckets::kNumBuckets];
+        char pad[kCacheLineSize];
+    };
+    Shard shards_[kShards];
+
+    // No copying allowed
+    LatencyHistogram(const LatencyHistogram&);
+    void operator=(const LatencyHistogram&);
+};
+
+}
+
+#endif  // TERA_UTILS_LATENCY_HISTOGRAM_H_
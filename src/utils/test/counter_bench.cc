@@ -0,0 +1,67 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Compare Counter and ShardedCounter when many threads bump the same
+// counter, as the read path does with the tablet and dfs statistics.
+
+#include <stdio.h>
+
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include "common/thread.h"
+#include "gflags/gflags.h"
+
+#include "utils/counter.h"
+#include "utils/timer.h"
+
+DEFINE_int32(bench_max_threads, 32, "largest number of threads, doubled from 1");
+DEFINE_int64(bench_ops, 10000000, "updates done by each thread");
+DEFINE_int32(bench_rounds, 3, "rounds of each mode");
+
+namespace tera {
+
+template <typename CounterType>
+static void BumpCounter(CounterType* counter) {
+    for (int64_t i = 0; i < FLAGS_bench_ops; ++i) {
+        counter->Inc();
+    }
+}
+
+template <typename CounterType>
+static void Report(const char* name, int thread_num) {
+    for (int round = 0; round < FLAGS_bench_rounds; ++round) {
+        CounterType counter;
+        std::vector<common::Thread> threads(thread_num);
+        int64_t start = get_micros();
+        for (int i = 0; i < thread_num; ++i) {
+            threads[i].Start(boost::bind(&BumpCounter<CounterType>, &counter));
+        }
+        for (int i = 0; i < thread_num; ++i) {
+            threads[i].Join();
+        }
+        int64_t used = get_micros() - start;
+        if (used <= 0) {
+            used = 1;
+        }
+        int64_t total = FLAGS_bench_ops * thread_num;
+        if (counter.Get() != total) {
+            fprintf(stderr, "%s lost updates: %ld != %ld\n", name, counter.Get(), total);
+        }
+        fprintf(stdout, "%-8s threads %3d round %d: %8.1f Mops/s\n", name, thread_num,
+                round, static_cast<double>(total) / used);
+    }
+}
+
+} // namespace tera
+
+int main(int argc, char* argv[]) {
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    for (int n = 1; n <= FLAGS_bench_max_threads; n *= 2) {
+        tera::Report<tera::Counter>("counter", n);
+        tera::Report<tera::ShardedCounter>("sharded", n);
+    }
+    return 0;
+}
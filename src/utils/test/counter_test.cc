@@ -20,7 +20,8 @@ int ref = 0;
 int loop_num = 100000;
 int thread_num = 1000;
 
-void callback_add(Counter* counter) {
+template <typename CounterType>
+void callback_add(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Add(100000);
     }
@@ -29,7 +30,8 @@ void callback_add(Counter* counter) {
     ref--;
 }
 
-void callback_sub(Counter* counter) {
+template <typename CounterType>
+void callback_sub(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Sub(100000);
     }
@@ -38,7 +40,8 @@ void callback_sub(Counter* counter) {
     ref--;
 }
 
-void callback_inc(Counter* counter) {
+template <typename CounterType>
+void callback_inc(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Inc();
     }
@@ -47,7 +50,8 @@ void callback_inc(Counter* counter) {
     ref--;
 }
 
-void callback_dec(Counter* counter) {
+template <typename CounterType>
+void callback_dec(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Dec();
     }
@@ -56,7 +60,8 @@ void callback_dec(Counter* counter) {
     ref--;
 }
 
-void callback_clear(Counter* counter) {
+template <typename CounterType>
+void callback_clear(CounterType* counter) {
     for (int i = 0; i < loop_num / 300; ++i) {
         ASSERT_GE(counter->Clear(), 0);
     }
@@ -70,16 +75,16 @@ TEST(CounterTest, Basic) {
     ThreadPool* pool = new ThreadPool(thread_num);
     for (int i = 0; i < thread_num / 4; ++i) {
         boost::function<void ()> callback =
-            boost::bind(&callback_add, &counter);
+            boost::bind(&callback_add<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = boost::bind(&callback_sub, &counter);
+        callback = boost::bind(&callback_sub<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = boost::bind(&callback_inc, &counter);
+        callback = boost::bind(&callback_inc<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = boost::bind(&callback_dec, &counter);
+        callback = boost::bind(&callback_dec<Counter>, &counter);
         pool->AddTask(callback);
 
         MutexLock locker(&mutex);
@@ -100,13 +105,13 @@ TEST(CounterTest, Clear) {
     ThreadPool* pool = new ThreadPool(thread_num);
     for (int i = 0; i < thread_num / 3; ++i) {
         boost::function<void ()> callback =
-            boost::bind(&callback_add, &counter);
+            boost::bind(&callback_add<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = boost::bind(&callback_inc, &counter);
+        callback = boost::bind(&callback_inc<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = boost::bind(&callback_clear, &counter);
+        callback = boost::bind(&callback_clear<Counter>, &counter);
         pool->AddTask(callback);
 
         MutexLock lock(&mutex);
@@ -123,4 +128,67 @@ TEST(CounterTest, Clear) {
     delete pool;
 }
 
+TEST(CounterTest, Sharded) {
+    ShardedCounter counter;
+    ThreadPool* pool = new ThreadPool(thread_num);
+    for (int i = 0; i < thread_num / 4; ++i) {
+        boost::function<void ()> callback =
+            boost::bind(&callback_add<ShardedCounter>, &counter);
+        pool->AddTask(callback);
+
+        callback = boost::bind(&callback_sub<ShardedCounter>, &counter);
+        pool->AddTask(callback);
+
+        callback = boost::bind(&callback_inc<ShardedCounter>, &counter);
+        pool->AddTask(callback);
+
+        callback = boost::bind(&callback_dec<ShardedCounter>, &counter);
+        pool->AddTask(callback);
+
+        MutexLock locker(&mutex);
+        ref += 4;
+    }
+    while (1) {
+        MutexLock locker(&mutex);
+        if (ref == 0) {
+            break;
+        }
+    }
+    ASSERT_EQ(counter.Get(), 0);
+    delete pool;
+}
+
+TEST(CounterTest, ShardedClear) {
+    ShardedCounter counter;
+    ThreadPool* pool = new ThreadPool(thread_num);
+    for (int i = 0; i < thread_num / 2; ++i) {
+        boost::function<void ()> callback =
+            boost::bind(&callback_inc<ShardedCounter>, &counter);
+        pool->AddTask(callback);
+
+        callback = boost::bind(&callback_clear<ShardedCounter>, &counter);
+        pool->AddTask(callback);
+
+        MutexLock lock(&mutex);
+        ref += 2;
+    }
+    int64_t cleared = 0;
+    while (1) {
+        cleared += counter.Clear();
+        MutexLock lock(&mutex);
+        if (ref == 0) {
+            break;
+        }
+    }
+    cleared += counter.Clear();
+    ASSERT_GE(cleared, 0);
+    ASSERT_EQ(counter.Get(), 0);
+
+    counter.Set(100);
+    ASSERT_EQ(counter.Get(), 100);
+    ASSERT_EQ(counter.Set(7), 100);
+    ASSERT_EQ(counter.Clear(), 7);
+    delete pool;
+}
+
 } // namespace tera
@@ -0,0 +1,82 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "utils/latency_histogram.h"
+
+#include <pthread.h>
+
+#include <gtest/gtest.h>
+
+namespace tera {
+
+TEST(LatencyHistogramTest, Buckets) {
+    for (int64_t v = 0; v < 100000; ++v) {
+        int index = LatencyBuckets::Index(v);
+        ASSERT_LT(index, LatencyBuckets::kNumBuckets);
+        ASSERT_LE(LatencyBuckets::LowerBound(index), v);
+        ASSERT_GT(LatencyBuckets::LowerBound(index) + LatencyBuckets::Width(index), v);
+        // relative error at most 1/8
+        ASSERT_LE(LatencyBuckets::Width(index) * 8, v < 16 ? 8 : v);
+    }
+    ASSERT_EQ(LatencyBuckets::Index(-1), 0);
+    ASSERT_EQ(LatencyBuckets::Index(1LL << 62), LatencyBuckets::kNumBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, Percentile) {
+    LatencyHistogram histogram;
+    LatencyStat stat;
+    histogram.Clear(&stat);
+    ASSERT_EQ(stat.Count(), 0);
+    ASSERT_EQ(stat.Percentile(99), 0);
+
+    // 990 fast samples and a slow tail
+    for (int i = 0; i < 990; ++i) {
+        histogram.Add(100);
+    }
+    for (int i = 0; i < 10; ++i) {
+        histogram.Add(1000000);
+    }
+    histogram.Clear(&stat);
+    ASSERT_EQ(stat.Count(), 1000);
+    ASSERT_GE(stat.Percentile(50), 96);
+    ASSERT_LE(stat.Percentile(50), 112);
+    ASSERT_LE(stat.Percentile(99), 112);
+    ASSERT_GE(stat.Percentile(99.9), 1000000 * 7 / 8);
+    ASSERT_LE(stat.Percentile(99.9), 1000000 * 9 / 8);
+
+    // cleared
+    histogram.Clear(&stat);
+    ASSERT_EQ(stat.Count(), 0);
+}
+
+static void* AddSamples(void* arg) {
+    LatencyHistogram* histogram = reinterpret_cast<LatencyHistogram*>(arg);
+    for (int i = 0; i < 10000; ++i) {
+        histogram->Add(i % 2 == 0 ? 100 : 1000);
+    }
+    return NULL;
+}
+
+TEST(LatencyHistogramTest, ConcurrentAdd) {
+    LatencyHistogram histogram;
+    // more threads than shards
+    const int kThreads = 20;
+    pthread_t threads[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+        ASSERT_EQ(pthread_create(&threads[i], NULL, AddSamples, &histogram), 0);
+    }
+    for (int i = 0; i < kThreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    LatencyStat stat;
+    histogram.Clear(&stat);
+    ASSERT_EQ(stat.Count(), kThreads * 10000);
+    ASSERT_LE(stat.Percentile(49), 112);
+    ASSERT_GE(stat.Percentile(51), 896);
+
+    histogram.Clear(&stat);
+    ASSERT_EQ(stat.Count(), 0);
+}
+
+} // namespace tera
@@ -6,6 +6,7 @@
 #define  TERA_UTILS_TIMER_H_
 
 #include <sys/time.h>
+#include <time.h>
 #include <string>
 
 namespace tera {